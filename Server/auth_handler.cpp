@@ -1,9 +1,9 @@
 #include "auth_handler.h"
 #include "network_utils.h"
+#include "session_tickets.h"
+#include "crypto_pool.h"
+#include "rate_limiter.h"
 #include <cryptopp/sha.h>
-#include <cryptopp/hex.h>
-#include <cryptopp/filters.h>
-#include <cryptopp/secblock.h>
 #include <cryptopp/misc.h>
 #include <stdexcept>
 #include <cstring>
@@ -12,9 +12,13 @@
  * @brief Создает обработчик аутентификации
  * @param logger Ссылка на логгер для записи событий аутентификации
  * @param authDb Ссылка на базу данных аутентификации
+ * @param io Реализация ввода-вывода через сокет; nullptr - SocketIo::posix()
+ * @param reader Буфер чтения соединения, общий с VectorHandler; nullptr -
+ *        данные аутентификации читаются напрямую через io
  */
-AuthHandler::AuthHandler(Logger& logger, AuthDB& authDb) 
-    : logger_(logger), authDb_(authDb) {}
+AuthHandler::AuthHandler(Logger& logger, AuthDB& authDb, SocketIo* io,
+                         BufferedSocketReader* reader)
+    : logger_(logger), authDb_(authDb), io_(io ? *io : SocketIo::posix()), reader_(reader) {}
 
 /**
  * @brief Выполняет процесс аутентификации клиента
@@ -24,184 +28,391 @@ AuthHandler::AuthHandler(Logger& logger, AuthDB& authDb)
  *          3. Поиск пароля в базе данных по логину
  *          4. Вычисление хэша на стороне сервера и сравнение с клиентским
  *          5. Отправка результата клиенту ("OK" или "ERR")
+ *          Служебные запросы (выдача билета, возобновление по билету)
+ *          разбирает checkAuthRequest()
  * @param client_fd Файловый дескриптор клиентского сокета
  * @param out_login Ссылка на строку для записи аутентифицированного логина
  * @return true если аутентификация успешна, false в противном случае
  * @note Максимальный размер данных аутентификации: 255 байт
+ * @note С буфером чтения байты, прочитанные из сокета сверх
+ *       MAX_AUTH_DATA_SIZE, остаются в буфере и достаются VectorHandler
  * @note Формат данных: <логин><72 шестнадцатеричных символа>
  *       где 72 символа = 16 символов соли + 56 символов хэша SHA224
+ * @note Данные разбираются прямо в буфере на стеке, без копирования в строку
  * @post Если аутентификация успешна, out_login содержит логин клиента
  */
 bool AuthHandler::authenticate(int client_fd, std::string& out_login) {
-    const size_t BUFFER_SIZE = 256;
-    char buffer[BUFFER_SIZE];
+    char buffer[MAX_AUTH_DATA_SIZE + 1];
     
-    ssize_t total_read = recv(client_fd, buffer, BUFFER_SIZE - 1, 0);
+    ssize_t total_read = reader_ ? reader_->readSome(client_fd, buffer, MAX_AUTH_DATA_SIZE)
+                                 : io_.recvSome(client_fd, buffer, MAX_AUTH_DATA_SIZE);
     if(total_read <= 0) {
         logger_.error("Failed to read authentication data");
         return false;
     }
     
     buffer[total_read] = '\0';
-    std::string auth_data(buffer, total_read);
     
+    std::string response;
+    if(!checkAuthRequest(std::string_view(buffer, total_read), out_login, response)) {
+        sendResponse(client_fd, response, false);
+        return false;
+    }
+    
+    return sendResponse(client_fd, response, true);
+}
+
+/**
+ * @brief Разбирает запрос аутентификации и формирует ответ
+ * @details Виды запросов:
+ *          - <логин><72 hex> - полная аутентификация (checkAuthData()),
+ *            ответ "OK" или "ERR"
+ *          - '\0' 'T' <логин><72 hex> - полная аутентификация с выдачей
+ *            билета: ответ "OK", длина билета (1 байт) и билет; при
+ *            выключенных билетах или слишком длинном логине длина равна 0
+ *          - '\0' 'R' <билет> - возобновление по билету (resumeSession()):
+ *            одна проверка MAC без обращения к AuthDB, ответ "OK" или "ERR"
+ *          Логин не может начинаться с нулевого байта, поэтому служебные
+ *          запросы не пересекаются с обычными.
+ *          Проверка состоит из beginAuthRequest() и completeAuthRequest();
+ *          неблокирующие режимы вызывают этапы по отдельности и хэшируют
+ *          между ними в CryptoPool, не занимая поток ввода-вывода.
+ * @param data Сырые данные от клиента
+ * @param out_login Ссылка на строку для записи аутентифицированного логина
+ *        (меняется только при успехе)
+ * @param response Ответ клиенту
+ * @return true если клиент аутентифицирован
+ */
+bool AuthHandler::checkAuthRequest(std::string_view data, std::string& out_login, std::string& response) {
+    HashRequest request;
+    AuthStep step = beginAuthRequest(data, out_login, response, request);
+    if(step != AuthStep::NeedsHash)
+        return step == AuthStep::Accepted;
+    return completeAuthRequest(request, out_login, response);
+}
+
+/**
+ * @brief Разбирает запрос и находит пароль; хэш не вычисляется
+ * @details Возобновление по билету и ошибки разбора завершаются здесь же
+ *          (ответ сформирован). Для полной аутентификации request
+ *          заполняется данными для хэширования, а response остается "ERR"
+ *          до finishAuthRequest().
+ * @param data Сырые данные от клиента
+ * @param out_login Ссылка на строку для записи логина (только при Accepted)
+ * @param response Ответ клиенту
+ * @param request Данные для хэширования (только при NeedsHash)
+ * @return Результат этапа
+ */
+AuthHandler::AuthStep AuthHandler::beginAuthRequest(std::string_view data, std::string& out_login,
+                                                    std::string& response, HashRequest& request) {
+    response = "ERR";
+    request.ticket = false;
+    if(data.size() < 2 || data[0] != REQUEST_MARKER)
+        return prepareAuthData(data, request) ? AuthStep::NeedsHash : AuthStep::Rejected;
+    
+    if(data[1] == RESUME_REQUEST) {
+        if(!resumeSession(data.substr(2), out_login))
+            return AuthStep::Rejected;
+        response = "OK";
+        return AuthStep::Accepted;
+    }
+    if(data[1] != TICKET_REQUEST) {
+        logger_.error("Unknown auth request type");
+        return AuthStep::Rejected;
+    }
+    
+    request.ticket = true;
+    return prepareAuthData(data.substr(2), request) ? AuthStep::NeedsHash : AuthStep::Rejected;
+}
+
+/**
+ * @brief Сравнивает хэши и формирует ответ полной аутентификации
+ * @details Для запроса с выдачей билета ответ дополняется длиной билета
+ *          и самим билетом.
+ * @param request Данные, заполненные beginAuthRequest()
+ * @param server_hash SHA224(salt_hex || password), HASH_SIZE байт
+ * @param out_login Ссылка на строку для записи аутентифицированного логина
+ *        (меняется только при успехе)
+ * @param response Ответ клиенту
+ * @return true если клиент аутентифицирован
+ */
+bool AuthHandler::finishAuthRequest(const HashRequest& request, const unsigned char* server_hash,
+                                    std::string& out_login, std::string& response) {
+    response = "ERR";
+    if(!finishAuthData(request, server_hash, out_login))
+        return false;
+    response = "OK";
+    if(!request.ticket)
+        return true;
+    
+    std::string ticket = tickets_ ? tickets_->issue(out_login) : std::string();
+    response += static_cast<char>(ticket.size());
+    response += ticket;
+    logger_.info({"Issued resumption ticket: ", std::to_string(ticket.size()), " bytes"});
+    return true;
+}
+
+/**
+ * @brief Вычисляет хэш сервера и завершает проверку запроса
+ * @details Хэш считается hashPassword(): при подключенном CryptoPool
+ *          поток ждет результата пула (в пакете с другими проверками).
+ * @param request Данные, заполненные beginAuthRequest()
+ * @param out_login Ссылка на строку для записи аутентифицированного логина
+ * @param response Ответ клиенту
+ * @return true если клиент аутентифицирован
+ */
+bool AuthHandler::completeAuthRequest(const HashRequest& request, std::string& out_login,
+                                      std::string& response) {
+    unsigned char server_hash[HASH_SIZE];
+    hashPassword(request.salt_hex, request.password, server_hash);
+    return finishAuthRequest(request, server_hash, out_login, response);
+}
+
+/**
+ * @brief Возобновляет сеанс по билету
+ * @details Быстрый путь повторного подключения: билет проверяется
+ *          SessionTickets::verify() (HMAC-SHA256), поиск в AuthDB и
+ *          вычисление SHA224 не выполняются, в лог пишется одна строка.
+ *          Логин из билета проходит то же ограничение частоты попыток
+ *          входа (RateLimiter::admitLogin()), что и полная аутентификация.
+ * @param ticket Билет от клиента
+ * @param out_login Ссылка на строку для записи логина из билета
+ *        (очищается, если попытка отклонена ограничителем)
+ * @return true если билеты включены, билет выдан этим сервером, не истек
+ *         и попытка входа по логину допускается
+ * @note Логин, удаленный из базы, принимается по билету до его истечения
+ */
+bool AuthHandler::resumeSession(std::string_view ticket, std::string& out_login) {
+    if(!tickets_) {
+        logger_.error("Session resumption rejected: tickets are disabled");
+        return false;
+    }
+    if(!tickets_->verify(ticket, out_login)) {
+        logger_.error("Session resumption rejected: invalid or expired ticket");
+        return false;
+    }
+    if(limiter_ && !limiter_->admitLogin(out_login)) {
+        out_login.clear();
+        logger_.warning("Login rate limit exceeded");
+        return false;
+    }
+    logger_.info({"Session resumed for: '", out_login, "'"});
+    return true;
+}
+
+/**
+ * @brief Проверяет данные аутентификации, уже полученные от клиента
+ * @details Выполняет шаги 2-4 процесса authenticate() без обращения к сокету:
+ *          парсинг данных и поиск пароля в базе (prepareAuthData()),
+ *          вычисление хэша и сравнение хэшей (finishAuthData()).
+ *          Логин, соль, хэш и пароль передаются как std::string_view на
+ *          данные клиента и значение в AuthDB: проверка не выделяет память
+ *          в куче (кроме записи логина длиннее буфера std::string).
+ * @note Без выделений проходит только полная аутентификация с хэшированием
+ *       в потоке сеанса. Выдача и проверка билетов (строка билета, ключ
+ *       HMAC Crypto++) и передача хэширования в CryptoPool (задание
+ *       в очереди пула) выделяют память.
+ * @param data Сырые данные от клиента (логин + 72 hex символа)
+ * @param out_login Ссылка на строку для записи аутентифицированного логина
+ * @return true если учетные данные верны, false в противном случае
+ * @post Если возвращено true, out_login содержит логин клиента
+ */
+bool AuthHandler::checkAuthData(std::string_view data, std::string& out_login) {
+    HashRequest request;
+    if(!prepareAuthData(data, request))
+        return false;
+    unsigned char server_hash[HASH_SIZE];
+    hashPassword(request.salt_hex, request.password, server_hash);
+    return finishAuthData(request, server_hash, out_login);
+}
+
+/**
+ * @brief Разбирает данные аутентификации и находит пароль в базе
+ * @details Попытка для логина, превысившего частоту RateLimiter,
+ *          отклоняется сразу после разбора: без поиска в AuthDB и SHA224.
+ * @param data Данные аутентификации (логин + 72 hex символа)
+ * @param request Заполняемые данные для хэширования
+ * @return true если данные корректны и логин найден
+ */
+bool AuthHandler::prepareAuthData(std::string_view data, HashRequest& request) {
     logger_.info("=== AUTHENTICATION START ===");
-    logger_.info("Received data: " + std::to_string(total_read) + " bytes");
+    logger_.info({"Received data: ", std::to_string(data.size()), " bytes"});
     
     // Парсинг данных аутентификации
-    std::string login, salt_hex, hash_hex;
-    if(!parseAuthData(auth_data, login, salt_hex, hash_hex)) {
-        sendResponse(client_fd, false);
+    std::string_view hash_hex;
+    if(!parseAuthData(data, request.login, request.salt_hex, hash_hex, request.client_hash)) {
         return false;
     }
     
-    // Поиск пароля в базе данных
-    std::string password;
-    if(!authDb_.findPassword(login, password)) {
-        logger_.error("Login not found: '" + login + "'");
-        sendResponse(client_fd, false);
+    if(limiter_ && !limiter_->admitLogin(request.login)) {
+        logger_.warning("Login rate limit exceeded");
         return false;
     }
     
-    // Проверка хэша
-    if(!verifyHash(login, password, salt_hex, hash_hex)) {
-        logger_.error("Hash verification failed for login: '" + login + "'");
-        sendResponse(client_fd, false);
+    // Поиск пароля в базе данных
+    if(!authDb_.findPassword(request.login, request.password)) {
+        logger_.error({"Login not found: '", request.login, "'"});
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Сравнивает хэш сервера с хэшем клиента и записывает логин
+ * @param request Данные, заполненные prepareAuthData()
+ * @param server_hash Хэш сервера (HASH_SIZE байт)
+ * @param out_login Ссылка на строку для записи аутентифицированного логина
+ * @return true если хэши совпадают
+ */
+bool AuthHandler::finishAuthData(const HashRequest& request, const unsigned char* server_hash,
+                                 std::string& out_login) {
+    if(!compareHash(server_hash, request.client_hash)) {
+        logger_.error({"Hash verification failed for login: '", request.login, "'"});
         return false;
     }
     
-    logger_.info("Authentication successful for: '" + login + "'");
-    out_login = login;
-    return sendResponse(client_fd, true);
+    logger_.info({"Authentication successful for: '", request.login, "'"});
+    out_login.assign(request.login);
+    return true;
 }
 
 /**
  * @brief Парсит данные аутентификации, полученные от клиента
  * @details Формат данных: все символы кроме последних 72 - логин,
- *          последние 72 символа - шестнадцатеричные данные (16 символов соли + 56 символов хэша)
+ *          последние 72 символа - шестнадцатеричные данные (16 символов соли + 56 символов хэша).
+ *          Все 72 символа проверяются и декодируются одним проходом
+ *          NetworkUtils::hexToBytes(); декодированный хэш возвращается в
+ *          client_hash, и verifyHash() не разбирает hex повторно.
+ *          Строковые результаты ссылаются на data, поэтому действительны,
+ *          пока жив буфер с данными клиента.
  * @param data Сырые данные от клиента (логин + hex)
- * @param login Ссылка на строку для записи извлеченного логина
- * @param salt_hex Ссылка на строку для записи соли в hex (16 символов)
- * @param hash_hex Ссылка на строку для записи хэша в hex (56 символов)
+ * @param login Логин (часть data)
+ * @param salt_hex Соль в hex (16 символов, часть data)
+ * @param hash_hex Хэш в hex (56 символов, часть data)
+ * @param client_hash Буфер для декодированного хэша (HASH_SIZE байт);
+ *        nullptr - хэш только проверяется
  * @return true если парсинг успешен, false в противном случае
  * @pre Длина data должна быть не менее 72 символов
  * @pre Последние 72 символа должны быть корректной hex строкой
  * @post Если возвращено true, параметры содержат извлеченные данные
  * @note Логин может быть пустым, если data состоит ровно из 72 hex символов
  */
-bool AuthHandler::parseAuthData(const std::string& data, std::string& login, 
-                               std::string& salt_hex, std::string& hash_hex) {
+bool AuthHandler::parseAuthData(std::string_view data, std::string_view& login,
+                               std::string_view& salt_hex, std::string_view& hash_hex,
+                               unsigned char* client_hash) {
     // Проверяем, что строка содержит хотя бы 72 символа
-    if(data.length() < 72) {
-        logger_.error("Auth data too short: " + std::to_string(data.length()) + " chars");
+    if(data.length() < AUTH_HEX_SIZE) {
+        logger_.error({"Auth data too short: ", std::to_string(data.length()), " chars"});
         return false;
     }
     
-    // Разделяем: все кроме последних 72 символов - логин
-    login = data.substr(0, data.length() - 72);
+    // Последние 72 символа - hex данные, все остальное - логин
+    std::string_view hex_part = data.substr(data.length() - AUTH_HEX_SIZE);
     
-    // Последние 72 символа - hex данные
-    std::string hex_part = data.substr(data.length() - 72);
-    
-    // Проверяем, что hex_part действительно hex
-    if(!NetworkUtils::isValidHex(hex_part)) {
-        logger_.error("Last 72 chars are not valid hex: " + hex_part);
+    // Проверяем и декодируем hex_part за один проход: 8 байт соли и 28 байт хэша
+    unsigned char raw[AUTH_HEX_SIZE / 2];
+    if(!NetworkUtils::hexToBytes(hex_part, raw, sizeof(raw))) {
+        logger_.error({"Last 72 chars are not valid hex: ", hex_part});
         return false;
     }
     
+    login = data.substr(0, data.length() - AUTH_HEX_SIZE);
     // Первые 16 символов hex_part - соль
     // Остальные 56 - хэш
-    salt_hex = hex_part.substr(0, 16);
-    hash_hex = hex_part.substr(16, 56);
+    salt_hex = hex_part.substr(0, SALT_HEX_SIZE);
+    hash_hex = hex_part.substr(SALT_HEX_SIZE);
+    if(client_hash)
+        std::memcpy(client_hash, raw + SALT_HEX_SIZE / 2, HASH_SIZE);
     
-    logger_.info("Parsed - Login: '" + login + 
-                "', Salt: " + salt_hex + 
-                ", Hash: " + hash_hex.substr(0, 16) + "...");
+    logger_.info({"Parsed - Login: '", login,
+                  "', Salt: ", salt_hex,
+                  ", Hash: ", hash_hex.substr(0, 16), "..."});
     
     return true;
 }
 
 /**
- * @brief Вычисляет SHA224 хэш от переданных данных
- * @details Использует библиотеку CryptoPP для вычисления хэша.
- *          Результат возвращается в виде шестнадцатеричной строки.
- * @param data Строка данных для хэширования
- * @return Хэш SHA224 в виде hex строки (56 символов)
- * @note Размер хэша SHA224: 28 байт (224 бита) = 56 hex символов
+ * @brief Вычисляет SHA224(salt_hex || password)
+ * @details Использует библиотеку CryptoPP. Соль и пароль подаются в хэш
+ *          двумя вызовами Update() без сборки общей строки; результат -
+ *          сырые байты хэша.
+ * @param salt_hex Соль в hex формате
+ * @param password Пароль
+ * @param digest Буфер для хэша (HASH_SIZE байт)
+ * @note Размер хэша SHA224: 28 байт (224 бита)
  * @see CryptoPP::SHA224
  */
-std::string AuthHandler::computeSHA224(const std::string& data) {
-    using namespace CryptoPP;
-    
-    SHA224 sha224;
-    SecByteBlock hash(sha224.DigestSize());
-    
-    sha224.Update((const unsigned char*)data.data(), data.size());
-    sha224.Final(hash.data());
-    
-    return NetworkUtils::bytesToHex(hash.data(), hash.size());
+void AuthHandler::computeSHA224(std::string_view salt_hex, std::string_view password,
+                                unsigned char* digest) {
+    CryptoPP::SHA224 sha224;
+    sha224.Update(reinterpret_cast<const unsigned char*>(salt_hex.data()), salt_hex.size());
+    sha224.Update(reinterpret_cast<const unsigned char*>(password.data()), password.size());
+    sha224.Final(digest);
+}
+
+/**
+ * @brief Вычисляет SHA224(salt_hex || password) в пуле или на месте
+ * @details С подключенным CryptoPool поток ждет результата пула: при
+ *          одновременных проверках пул считает их одним пакетом.
+ * @param salt_hex Соль в hex формате
+ * @param password Пароль
+ * @param digest Буфер для хэша (HASH_SIZE байт)
+ */
+void AuthHandler::hashPassword(std::string_view salt_hex, std::string_view password,
+                               unsigned char* digest) {
+    if(crypto_)
+        crypto_->sha224(salt_hex, password, digest);
+    else
+        computeSHA224(salt_hex, password, digest);
 }
 
 /**
  * @brief Проверяет корректность хэша пароля
  * @details Процесс проверки:
- *          1. Конкатенирует соль (hex) и пароль (plaintext)
- *          2. Вычисляет SHA224 от результата конкатенации
- *          3. Сравнивает полученный хэш с хэшем от клиента
- * @param login Логин пользователя (для логирования)
+ *          1. Вычисляет SHA224 от соли (hex) и пароля (plaintext)
+ *          2. Сравнивает байты хэша с хэшем клиента, уже декодированным
+ *             parseAuthData() (compareHash())
  * @param password Пароль из базы данных в plaintext
  * @param salt_hex Соль в hex формате (16 символов, 8 байт)
- * @param client_hash_hex Хэш от клиента в hex формате (56 символов)
+ * @param client_hash Хэш от клиента (HASH_SIZE байт)
  * @return true если хэши совпадают, false в противном случае
  * @note Используется схема: hash = SHA224(salt || password)
+ * @note Пароль в лог не записывается
+ */
+bool AuthHandler::verifyHash(std::string_view password, std::string_view salt_hex,
+                           const unsigned char* client_hash) {
+    unsigned char server_hash[HASH_SIZE];
+    hashPassword(salt_hex, password, server_hash);
+    return compareHash(server_hash, client_hash);
+}
+
+/**
+ * @brief Сравнивает хэш сервера с хэшем клиента
+ * @param server_hash Хэш сервера (HASH_SIZE байт)
+ * @param client_hash Хэш клиента (HASH_SIZE байт)
+ * @return true если хэши совпадают
  * @note Сравнение выполняется с защитой от timing-атак через VerifyBufsEqual
+ * @note Хэши в лог не записываются: по ним можно подбирать пароль офлайн
  */
-bool AuthHandler::verifyHash(const std::string& login, const std::string& password,
-                           const std::string& salt_hex, const std::string& client_hash_hex) {
-    logger_.info("=== HASH VERIFICATION ===");
-    
-    // Готовим данные для хэширования: salt_hex + password
-    std::string data_to_hash = salt_hex + password;
-    logger_.info("Data to hash (SALT||PASSWORD): " + data_to_hash);
-    
-    // Вычисляем хэш на стороне сервера
-    std::string server_hash_hex = computeSHA224(data_to_hash);
-    logger_.info("Server hash: " + server_hash_hex);
-    logger_.info("Client hash: " + client_hash_hex);
-    
-    // Сравниваем хэши побайтово
-    unsigned char client_hash[28];
-    if(!NetworkUtils::hexToBytes(client_hash_hex, client_hash, 28)) {
-        logger_.error("Failed to convert client hash from hex");
-        return false;
-    }
-    
-    unsigned char server_hash[28];
-    if(!NetworkUtils::hexToBytes(server_hash_hex, server_hash, 28)) {
-        logger_.error("Failed to convert server hash from hex");
-        return false;
-    }
-    
-    return CryptoPP::VerifyBufsEqual(server_hash, client_hash, 28);
+bool AuthHandler::compareHash(const unsigned char* server_hash, const unsigned char* client_hash) {
+    return CryptoPP::VerifyBufsEqual(server_hash, client_hash, HASH_SIZE);
 }
 
 /**
  * @brief Отправляет клиенту результат аутентификации
  * @param client_fd Файловый дескриптор клиентского сокета
+ * @param response Ответ, сформированный checkAuthRequest()
  * @param success Результат аутентификации
- * @return true если отправка успешна, false в противном случае
- * @note Формат ответа: "OK" при успехе, "ERR" при неудаче
- * @note Длина ответа: 2 байта для "OK", 3 байта для "ERR"
+ * @return true если аутентификация успешна и ответ отправлен
+ * @note Формат ответа: "OK" при успехе (с билетом - если он запрошен),
+ *       "ERR" при неудаче
  */
-bool AuthHandler::sendResponse(int client_fd, bool success) {
-    const char* response = success ? "OK" : "ERR";
-    size_t len = strlen(response);
-    
-    if(send(client_fd, response, len, 0) != (ssize_t)len) {
+bool AuthHandler::sendResponse(int client_fd, const std::string& response, bool success) {
+    if(!io_.sendAll(client_fd, response.data(), response.size())) {
         logger_.error("Failed to send auth response");
         return false;
     }
     
-    logger_.info("Sent response: " + std::string(response));
+    logger_.info({"Sent response: ", success ? "OK" : "ERR"});
     return success;
 }
\ No newline at end of file
@@ -2,8 +2,15 @@
 #define AUTH_HANDLER_H
 
 #include <string>
+#include <string_view>
 #include "logger.h"
 #include "authdb.h"
+#include "socket_io.h"
+#include "buffered_socket_reader.h"
+
+class SessionTickets;
+class CryptoPool;
+class RateLimiter;
 
 /**
  * @class AuthHandler
@@ -11,12 +18,52 @@
  */
 class AuthHandler {
 public:
+    /// Максимальный размер данных аутентификации, принимаемых за одно чтение
+    static constexpr size_t MAX_AUTH_DATA_SIZE = 255;
+    /// Первый байт служебного запроса (логин не может начинаться с нулевого байта)
+    static constexpr char REQUEST_MARKER = '\0';
+    /// Служебный запрос: полная аутентификация с выдачей билета возобновления
+    static constexpr char TICKET_REQUEST = 'T';
+    /// Служебный запрос: возобновление сеанса по билету
+    static constexpr char RESUME_REQUEST = 'R';
+    /// Длина соли в hex
+    static constexpr size_t SALT_HEX_SIZE = 16;
+    /// Размер хэша SHA224, байт
+    static constexpr size_t HASH_SIZE = 28;
+    /// Длина hex-части данных аутентификации: соль и хэш SHA224
+    static constexpr size_t AUTH_HEX_SIZE = SALT_HEX_SIZE + HASH_SIZE * 2;
+    
+    /**
+     * @brief Результат первого этапа проверки запроса (beginAuthRequest())
+     */
+    enum class AuthStep {
+        Rejected, ///< Запрос отклонен, ответ сформирован
+        Accepted, ///< Клиент аутентифицирован без хэширования (билет), ответ сформирован
+        NeedsHash ///< Нужен хэш SHA224(salt_hex || password) для finishAuthRequest()
+    };
+    
+    /**
+     * @brief Данные запроса между разбором и сравнением хэшей
+     * @details Строки ссылаются на данные клиента и значение в AuthDB и
+     *          действительны, пока жив буфер с данными клиента.
+     */
+    struct HashRequest {
+        std::string_view login;                ///< Логин (часть данных клиента)
+        std::string_view salt_hex;             ///< Соль в hex (часть данных клиента)
+        std::string_view password;             ///< Пароль из AuthDB
+        unsigned char client_hash[HASH_SIZE];  ///< Декодированный хэш клиента
+        bool ticket = false;                   ///< Запрошена выдача билета возобновления
+    };
+    
     /**
      * @brief Конструктор обработчика аутентификации
      * @param logger Логгер для записи событий
      * @param authDb База данных аутентификации
+     * @param io Реализация ввода-вывода (nullptr - обычные recv()/send())
+     * @param reader Буфер чтения соединения (nullptr - чтение напрямую через io)
      */
-    AuthHandler(Logger& logger, AuthDB& authDb);
+    AuthHandler(Logger& logger, AuthDB& authDb, SocketIo* io = nullptr,
+                BufferedSocketReader* reader = nullptr);
     
     /**
      * @brief Основной метод аутентификации
@@ -26,46 +73,164 @@ public:
      */
     bool authenticate(int client_fd, std::string& out_login);
     
+    /**
+     * @brief Проверка уже полученных данных аутентификации (без работы с сокетом)
+     * @param data Сырые данные от клиента
+     * @param out_login Ссылка на строку для записи аутентифицированного логина
+     * @return true если учетные данные верны, false в противном случае
+     */
+    bool checkAuthData(std::string_view data, std::string& out_login);
+    
+    /**
+     * @brief Разбор запроса аутентификации любого вида и формирование ответа
+     * @param data Сырые данные от клиента
+     * @param out_login Ссылка на строку для записи аутентифицированного логина
+     * @param response Ответ клиенту: "OK", "OK" с билетом или "ERR"
+     * @return true если клиент аутентифицирован
+     */
+    bool checkAuthRequest(std::string_view data, std::string& out_login, std::string& response);
+    
+    /**
+     * @brief Первый этап checkAuthRequest(): разбор запроса и поиск пароля
+     * @param data Сырые данные от клиента
+     * @param out_login Ссылка на строку для записи логина (при Accepted)
+     * @param response Ответ клиенту (при Rejected и Accepted)
+     * @param request Данные для хэширования и finishAuthRequest() (при NeedsHash)
+     * @return Результат этапа
+     */
+    AuthStep beginAuthRequest(std::string_view data, std::string& out_login,
+                              std::string& response, HashRequest& request);
+    
+    /**
+     * @brief Второй этап checkAuthRequest(): сравнение хэшей и формирование ответа
+     * @param request Данные, заполненные beginAuthRequest()
+     * @param server_hash SHA224(salt_hex || password), HASH_SIZE байт
+     * @param out_login Ссылка на строку для записи аутентифицированного логина
+     * @param response Ответ клиенту
+     * @return true если клиент аутентифицирован
+     */
+    bool finishAuthRequest(const HashRequest& request, const unsigned char* server_hash,
+                           std::string& out_login, std::string& response);
+    
+    /**
+     * @brief Второй этап с хэшированием в вызывающем потоке (или ожиданием CryptoPool)
+     * @param request Данные, заполненные beginAuthRequest()
+     * @param out_login Ссылка на строку для записи аутентифицированного логина
+     * @param response Ответ клиенту
+     * @return true если клиент аутентифицирован
+     */
+    bool completeAuthRequest(const HashRequest& request, std::string& out_login,
+                             std::string& response);
+    
+    /**
+     * @brief Подключение выдачи билетов возобновления
+     * @param tickets Выдача билетов (nullptr - билеты выключены)
+     */
+    void setTickets(const SessionTickets* tickets) { tickets_ = tickets; }
+    
+    /**
+     * @brief Подключение пула хэширования
+     * @param crypto Пул (nullptr - хэширование в вызывающем потоке)
+     */
+    void setCryptoPool(CryptoPool* crypto) { crypto_ = crypto; }
+    
+    /**
+     * @brief Подключение ограничения частоты попыток входа по логину
+     * @param limiter Ограничитель (nullptr - без ограничения)
+     */
+    void setRateLimiter(RateLimiter* limiter) { limiter_ = limiter; }
+    
     /**
      * @brief Парсинг данных аутентификации
      * @param data Сырые данные от клиента
-     * @param login Ссылка на строку для записи логина
-     * @param salt_hex Ссылка на строку для записи соли в hex
-     * @param hash_hex Ссылка на строку для записи хэша в hex
+     * @param login Логин (часть data)
+     * @param salt_hex Соль в hex (часть data)
+     * @param hash_hex Хэш в hex (часть data)
+     * @param client_hash Буфер для декодированного хэша (HASH_SIZE байт, nullptr - не нужен)
      * @return true если парсинг успешен, false в противном случае
      */
-    bool parseAuthData(const std::string& data, std::string& login, 
-                      std::string& salt_hex, std::string& hash_hex);
+    bool parseAuthData(std::string_view data, std::string_view& login,
+                      std::string_view& salt_hex, std::string_view& hash_hex,
+                      unsigned char* client_hash = nullptr);
     
     /**
      * @brief Проверка хэша пароля
-     * @param login Логин пользователя
      * @param password Пароль из базы данных
      * @param salt_hex Соль в hex формате
-     * @param client_hash_hex Хэш от клиента в hex формате
+     * @param client_hash Хэш от клиента (HASH_SIZE байт, декодирован parseAuthData())
      * @return true если хэши совпадают, false в противном случае
      */
-    bool verifyHash(const std::string& login, const std::string& password,
-                   const std::string& salt_hex, const std::string& client_hash_hex);
+    bool verifyHash(std::string_view password, std::string_view salt_hex,
+                   const unsigned char* client_hash);
     
 private:
     Logger& logger_;   ///< Ссылка на объект логгера
     AuthDB& authDb_;   ///< Ссылка на базу данных аутентификации
+    SocketIo& io_;     ///< Реализация ввода-вывода через сокет
+    BufferedSocketReader* reader_; ///< Буфер чтения соединения (может отсутствовать)
+    const SessionTickets* tickets_ = nullptr; ///< Выдача билетов возобновления (может отсутствовать)
+    CryptoPool* crypto_ = nullptr; ///< Пул хэширования (может отсутствовать)
+    RateLimiter* limiter_ = nullptr; ///< Ограничение попыток входа (может отсутствовать)
     
     /**
      * @brief Отправка ответа клиенту
      * @param client_fd Файловый дескриптор клиентского сокета
+     * @param response Ответ ("OK", "OK" с билетом или "ERR")
      * @param success Результат аутентификации
-     * @return true если отправка успешна, false в противном случае
+     * @return true если аутентификация успешна и ответ отправлен
+     */
+    bool sendResponse(int client_fd, const std::string& response, bool success);
+    
+    /**
+     * @brief Возобновление сеанса по билету
+     * @param ticket Билет от клиента
+     * @param out_login Ссылка на строку для записи логина из билета
+     * @return true если билет действителен
+     */
+    bool resumeSession(std::string_view ticket, std::string& out_login);
+    
+    /**
+     * @brief Разбор данных аутентификации и поиск пароля (шаги 2-3)
+     * @param data Данные аутентификации (логин + 72 hex символа)
+     * @param request Заполняемые данные для хэширования
+     * @return true если данные корректны и логин найден
+     */
+    bool prepareAuthData(std::string_view data, HashRequest& request);
+    
+    /**
+     * @brief Сравнение хэшей и запись логина (шаг 4)
+     * @param request Данные, заполненные prepareAuthData()
+     * @param server_hash Хэш сервера (HASH_SIZE байт)
+     * @param out_login Ссылка на строку для записи аутентифицированного логина
+     * @return true если хэши совпадают
+     */
+    bool finishAuthData(const HashRequest& request, const unsigned char* server_hash,
+                        std::string& out_login);
+    
+    /**
+     * @brief Сравнение хэша сервера с хэшем клиента с записью обоих в лог
+     * @param server_hash Хэш сервера (HASH_SIZE байт)
+     * @param client_hash Хэш клиента (HASH_SIZE байт)
+     * @return true если хэши совпадают
      */
-    bool sendResponse(int client_fd, bool success);
+    bool compareHash(const unsigned char* server_hash, const unsigned char* client_hash);
     
     /**
-     * @brief Вычисление SHA224 хэша
-     * @param data Данные для хэширования
-     * @return Хэш в виде hex строки
+     * @brief Вычисление SHA224(salt_hex || password) в CryptoPool или на месте
+     * @param salt_hex Соль в hex формате
+     * @param password Пароль
+     * @param digest Буфер для хэша (HASH_SIZE байт)
+     */
+    void hashPassword(std::string_view salt_hex, std::string_view password, unsigned char* digest);
+    
+    /**
+     * @brief Вычисление SHA224(salt_hex || password)
+     * @param salt_hex Соль в hex формате
+     * @param password Пароль
+     * @param digest Буфер для хэша (HASH_SIZE байт)
      */
-    std::string computeSHA224(const std::string& data);
+    static void computeSHA224(std::string_view salt_hex, std::string_view password,
+                              unsigned char* digest);
 };
 
 #endif
\ No newline at end of file
@@ -46,4 +46,22 @@ bool AuthDB::findPassword(const std::string& login, std::string& outPassword) co
     if (it == db.end()) return false;
     outPassword = it->second;
     return true;
+}
+
+/**
+ * @brief Ищет пароль по логину, не создавая строк
+ * @details Поиск выполняется по std::string_view (прозрачный хэш), пароль
+ *          возвращается ссылкой на значение в таблице. Используется
+ *          AuthHandler, где проверка учетных данных не выделяет память.
+ * @param login Логин пользователя для поиска
+ * @param outPassword Ссылка на пароль в базе данных
+ * @return true если логин найден в базе данных,
+ *         false если логин отсутствует
+ * @warning outPassword становится недействительной после loadFromFile()
+ */
+bool AuthDB::findPassword(std::string_view login, std::string_view& outPassword) const {
+    auto it = db.find(login);
+    if (it == db.end()) return false;
+    outPassword = it->second;
+    return true;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <functional>
 #include <unordered_map>
 
 /**
@@ -27,7 +29,24 @@ public:
      * @return true если логин найден, false в противном случае
      */
     bool findPassword(const std::string& login, std::string& outPassword) const;
+    
+    /**
+     * @brief Поиск пароля по логину без копирования строк
+     * @param login Логин пользователя
+     * @param outPassword Ссылка на пароль в базе (действительна до следующей загрузки)
+     * @return true если логин найден, false в противном случае
+     */
+    bool findPassword(std::string_view login, std::string_view& outPassword) const;
 
 private:
-    std::unordered_map<std::string,std::string> db; ///< Хэш-таблица для хранения пар логин-пароль
+    /**
+     * @brief Хэш строк, допускающий поиск по std::string_view
+     */
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+    
+    /// Хэш-таблица для хранения пар логин-пароль
+    std::unordered_map<std::string, std::string, StringHash, std::equal_to<>> db;
 };
\ No newline at end of file
@@ -0,0 +1,365 @@
+#include "buffer_pool.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace {
+/// Выравнивание блоков (линия кэша)
+const size_t BUFFER_ALIGN = 64;
+
+/**
+ * @brief Количество классов, кэшируемых в потоке
+ * @return Номер класса THREAD_CACHE_MAX_ELEMS плюс один
+ */
+constexpr size_t threadClasses()
+{
+    size_t cls = 0;
+    while((BufferPool::MIN_CLASS_ELEMS << cls) < BufferPool::THREAD_CACHE_MAX_ELEMS)
+        ++cls;
+    return cls + 1;
+}
+
+/// Количество классов, кэшируемых в потоке
+constexpr size_t THREAD_CLASSES = threadClasses();
+
+/// Наибольшее количество пулов с кэшем в одном потоке
+const size_t THREAD_CACHE_POOLS = 4;
+
+/**
+ * @struct ThreadCache
+ * @brief Кэш потока для одного пула: не больше одного свободного блока каждого класса
+ */
+struct ThreadCache {
+    uint64_t pool = 0;                     ///< Номер пула-владельца
+    BufferStorage blocks[THREAD_CLASSES];  ///< Свободные блоки по классам
+};
+
+/**
+ * @brief Кэши потока по пулам
+ * @details Блоки освобождаются при завершении потока. Кэш пула, к которому
+ *          поток давно не обращался, вытесняется (блоки освобождаются),
+ *          если потоку нужен кэш для нового пула сверх THREAD_CACHE_POOLS.
+ */
+thread_local std::vector<ThreadCache> thread_caches;
+
+/// Счетчик номеров пулов
+std::atomic<uint64_t> next_pool_id{1};
+
+/**
+ * @brief Кэш текущего потока для пула
+ * @details Найденный кэш перемещается в начало списка, поэтому вытесняется
+ *          кэш пула, к которому поток обращался раньше всех.
+ * @param pool Номер пула
+ * @return Блоки кэша по классам
+ */
+BufferStorage* threadCache(uint64_t pool)
+{
+    for(size_t i = 0; i < thread_caches.size(); ++i) {
+        if(thread_caches[i].pool == pool) {
+            if(i != 0)
+                std::swap(thread_caches[0], thread_caches[i]);
+            return thread_caches[0].blocks;
+        }
+    }
+    if(thread_caches.size() == THREAD_CACHE_POOLS)
+        thread_caches.pop_back();
+    thread_caches.insert(thread_caches.begin(), ThreadCache());
+    thread_caches[0].pool = pool;
+    return thread_caches[0].blocks;
+}
+
+/**
+ * @brief Выделяет выровненный неинициализированный блок
+ * @param count Количество элементов
+ * @return Память блока
+ * @throw std::bad_alloc при нехватке памяти
+ */
+BufferStorage allocate(size_t count)
+{
+    size_t bytes = count * sizeof(uint32_t);
+    bytes = (bytes + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+    void* p = std::aligned_alloc(BUFFER_ALIGN, bytes);
+    if(!p)
+        throw std::bad_alloc();
+    return BufferStorage(static_cast<uint32_t*>(p));
+}
+}
+
+void BufferFree::operator()(uint32_t* p) const noexcept
+{
+    std::free(p);
+}
+
+// ====================================================================
+// PooledBuffer
+// ====================================================================
+
+/**
+ * @brief Создает пустой буфер
+ * @param pool Пул, из которого берется и в который возвращается память
+ */
+PooledBuffer::PooledBuffer(BufferPool& pool)
+    : pool_(&pool)
+{
+}
+
+/**
+ * @brief Создает пустой буфер общего пула
+ */
+PooledBuffer::PooledBuffer()
+    : PooledBuffer(BufferPool::shared())
+{
+}
+
+PooledBuffer::~PooledBuffer()
+{
+    release();
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : pool_(other.pool_)
+    , data_(std::move(other.data_))
+    , size_(std::exchange(other.size_, 0))
+    , capacity_(std::exchange(other.capacity_, 0))
+{
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+    if(this != &other) {
+        release();
+        pool_ = other.pool_;
+        data_ = std::move(other.data_);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+/**
+ * @brief Устанавливает размер буфера
+ * @details Пока хватает емкости, меняется только размер: буфер, который
+ *          сеанс держит между векторами, повторно используется без
+ *          обращения к пулу и без заполнения нулями.
+ * @param count Количество элементов
+ * @throw std::bad_alloc при нехватке памяти
+ */
+void PooledBuffer::resize(size_t count)
+{
+    if(count > capacity_) {
+        release();
+        size_t capacity = 0;
+        data_ = pool_->take(count, capacity);
+        capacity_ = capacity;
+    }
+    size_ = count;
+}
+
+/**
+ * @brief Возвращает память в пул
+ */
+void PooledBuffer::release()
+{
+    if(data_)
+        pool_->give(std::move(data_), capacity_);
+    size_ = 0;
+    capacity_ = 0;
+}
+
+// ====================================================================
+// BufferPool
+// ====================================================================
+
+/**
+ * @brief Создает пустой пул
+ * @param max_cached Предел объема блоков в общих списках (байт)
+ */
+BufferPool::BufferPool(size_t max_cached)
+    : id_(next_pool_id.fetch_add(1, std::memory_order_relaxed))
+    , max_cached_(max_cached)
+{
+}
+
+/**
+ * @brief Возвращает общий пул процесса
+ * @details Пул создается при первом обращении и используется всеми
+ *          сеансами; блоки, освобожденные одним сеансом, достаются
+ *          следующим.
+ * @return Ссылка на пул
+ */
+BufferPool& BufferPool::shared()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+/**
+ * @brief Определяет класс размера
+ * @param count Количество элементов
+ * @return Наименьший класс емкостью не меньше count или NUM_CLASSES
+ */
+size_t BufferPool::sizeClass(size_t count)
+{
+    size_t cls = 0;
+    while(cls < NUM_CLASSES && classElems(cls) < count)
+        ++cls;
+    return cls;
+}
+
+/**
+ * @brief Возвращает буфер из пула с установленным размером
+ * @param count Количество элементов
+ * @return Буфер (элементы не инициализированы)
+ * @throw std::bad_alloc при нехватке памяти
+ */
+PooledBuffer BufferPool::acquire(size_t count)
+{
+    PooledBuffer buf(*this);
+    buf.resize(count);
+    return buf;
+}
+
+/**
+ * @brief Берет блок из кэша потока, общего списка или выделяет новый
+ * @param count Количество элементов
+ * @param capacity Фактическая емкость блока
+ * @return Память блока
+ * @throw std::bad_alloc при нехватке памяти
+ */
+BufferStorage BufferPool::take(size_t count, size_t& capacity)
+{
+    size_t cls = sizeClass(count);
+    if(cls == NUM_CLASSES) {
+        capacity = count;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++allocations_;
+        }
+        return allocate(count);
+    }
+
+    capacity = classElems(cls);
+    if(cls < THREAD_CLASSES) {
+        BufferStorage& cached = threadCache(id_)[cls];
+        if(cached)
+            return std::move(cached);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<BufferStorage>& list = free_[cls];
+        if(!list.empty()) {
+            BufferStorage data = std::move(list.back());
+            list.pop_back();
+            cached_bytes_ -= capacity * sizeof(uint32_t);
+            return data;
+        }
+        ++allocations_;
+    }
+    return allocate(capacity);
+}
+
+/**
+ * @brief Возвращает блок
+ * @details Блоки нестандартного размера освобождаются сразу. Блок класса
+ *          сначала занимает свободное место в кэше потока, затем попадает
+ *          в общий список, если тот не превысит max_cached байт; иначе
+ *          освобождается.
+ * @param data Память блока
+ * @param capacity Емкость блока в элементах
+ */
+void BufferPool::give(BufferStorage data, size_t capacity)
+{
+    size_t cls = sizeClass(capacity);
+    if(cls == NUM_CLASSES || classElems(cls) != capacity)
+        return;
+
+    if(cls < THREAD_CLASSES) {
+        BufferStorage& cached = threadCache(id_)[cls];
+        if(!cached) {
+            cached = std::move(data);
+            return;
+        }
+    }
+
+    size_t bytes = capacity * sizeof(uint32_t);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(cached_bytes_ + bytes > max_cached_)
+        return;
+    free_[cls].push_back(std::move(data));
+    cached_bytes_ += bytes;
+}
+
+/**
+ * @brief Освобождает блоки общих списков сверх max_bytes
+ * @details Первыми освобождаются блоки старших классов: они дают
+ *          наибольший объем и реже всего нужны повторно.
+ * @param max_bytes Оставляемый объем (байт)
+ */
+void BufferPool::trim(size_t max_bytes)
+{
+    std::vector<BufferStorage> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(size_t cls = NUM_CLASSES; cls-- > 0 && cached_bytes_ > max_bytes;) {
+            std::vector<BufferStorage>& list = free_[cls];
+            size_t bytes = classElems(cls) * sizeof(uint32_t);
+            while(!list.empty() && cached_bytes_ > max_bytes) {
+                dropped.push_back(std::move(list.back()));
+                list.pop_back();
+                cached_bytes_ -= bytes;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Устанавливает бюджет простоя
+ * @param bytes Объем общих списков, оставляемый trimIdle() (байт)
+ */
+void BufferPool::setIdleBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_budget_ = bytes;
+}
+
+/**
+ * @brief Сбрасывает общие списки до бюджета простоя
+ * @details Вызывается при завершении сеанса: блоки, которые сеанс держал
+ *          для больших векторов, не остаются в процессе до следующего
+ *          такого же сеанса. Пока объем не превышает бюджета, стоит одной
+ *          блокировки мьютекса.
+ */
+void BufferPool::trimIdle()
+{
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(cached_bytes_ <= idle_budget_)
+            return;
+        budget = idle_budget_;
+    }
+    trim(budget);
+}
+
+/**
+ * @brief Возвращает объем блоков в общих списках
+ * @return Объем в байтах
+ */
+size_t BufferPool::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+/**
+ * @brief Возвращает количество выделений памяти у системы
+ * @return Количество выделенных блоков
+ */
+size_t BufferPool::allocations() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocations_;
+}
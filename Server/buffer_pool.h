@@ -0,0 +1,189 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Освобождение памяти, выделенной BufferPool (std::aligned_alloc)
+ */
+struct BufferFree {
+    void operator()(uint32_t* p) const noexcept;
+};
+
+/// Память буфера пула
+using BufferStorage = std::unique_ptr<uint32_t[], BufferFree>;
+
+class BufferPool;
+
+/**
+ * @class PooledBuffer
+ * @brief Буфер элементов вектора, память которого возвращается в пул
+ * @details В отличие от std::vector::resize(), resize() не заполняет
+ *          элементы нулями: данные все равно будут перезаписаны чтением
+ *          из сокета. Содержимое при увеличении емкости не сохраняется.
+ */
+class PooledBuffer {
+public:
+    /**
+     * @brief Пустой буфер
+     * @param pool Пул, из которого берется память
+     */
+    explicit PooledBuffer(BufferPool& pool);
+
+    /**
+     * @brief Пустой буфер общего пула BufferPool::shared()
+     */
+    PooledBuffer();
+
+    /**
+     * @brief Возврат памяти в пул
+     */
+    ~PooledBuffer();
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    /**
+     * @brief Установка размера без инициализации элементов
+     * @param count Новое количество элементов
+     * @note Если емкости не хватает, память заменяется блоком из пула
+     */
+    void resize(size_t count);
+
+    uint32_t* data() { return data_.get(); }
+    const uint32_t* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    BufferPool* pool_;        ///< Пул-владелец памяти
+    BufferStorage data_;      ///< Память буфера
+    size_t size_ = 0;         ///< Количество элементов
+    size_t capacity_ = 0;     ///< Емкость в элементах
+
+    /**
+     * @brief Возврат памяти в пул
+     */
+    void release();
+};
+
+/**
+ * @class BufferPool
+ * @brief Пул памяти для данных векторов
+ * @details Блоки распределены по классам размеров (степени двойки от 4 КБ
+ *          до 64 МБ). Освобожденный блок сначала попадает в кэш потока
+ *          (по одному блоку каждого класса до THREAD_CACHE_MAX_ELEMS
+ *          элементов, без блокировок; у каждого пула свой), затем в общие
+ *          списки свободных блоков под мьютексом. Общие списки ограничены
+ *          max_cached байтами: блоки сверх предела освобождаются, trim()
+ *          сбрасывает кэш до заданного объема, trimIdle() - до бюджета
+ *          простоя (setIdleBudget()) при завершении сеанса. Запросы больше
+ *          старшего класса выделяются и освобождаются напрямую.
+ */
+class BufferPool {
+public:
+    /// Емкость младшего класса в элементах (4 КБ)
+    static constexpr size_t MIN_CLASS_ELEMS = 1024;
+    /// Количество классов размеров (старший - 16M элементов, 64 МБ)
+    static constexpr size_t NUM_CLASSES = 15;
+    /// Старший класс, кэшируемый в потоке (1M элементов, 4 МБ)
+    static constexpr size_t THREAD_CACHE_MAX_ELEMS = 1 << 20;
+    /// Предел общего кэша по умолчанию (256 МБ)
+    static constexpr size_t DEFAULT_MAX_CACHED = 256u << 20;
+    /// Бюджет общего кэша после завершения сеанса по умолчанию (64 МБ)
+    static constexpr size_t DEFAULT_IDLE_BUDGET = 64u << 20;
+
+    /**
+     * @brief Конструктор
+     * @param max_cached Предел объема блоков в общих списках (байт)
+     */
+    explicit BufferPool(size_t max_cached = DEFAULT_MAX_CACHED);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief Буфер из пула с установленным размером
+     * @param count Количество элементов
+     * @return Буфер (элементы не инициализированы)
+     * @throw std::bad_alloc при нехватке памяти
+     */
+    PooledBuffer acquire(size_t count);
+
+    /**
+     * @brief Сброс общих списков до max_bytes (начиная со старших классов)
+     * @param max_bytes Оставляемый объем (0 - освободить все)
+     */
+    void trim(size_t max_bytes = 0);
+
+    /**
+     * @brief Объем общих списков, оставляемый trimIdle()
+     * @param bytes Бюджет (байт)
+     */
+    void setIdleBudget(size_t bytes);
+
+    /**
+     * @brief Сброс общих списков до бюджета простоя (вызывается при завершении сеанса)
+     */
+    void trimIdle();
+
+    /**
+     * @brief Объем блоков в общих списках (байт)
+     */
+    size_t cachedBytes() const;
+
+    /**
+     * @brief Количество выделений памяти у системы (для статистики и тестов)
+     */
+    size_t allocations() const;
+
+    /**
+     * @brief Общий пул процесса
+     */
+    static BufferPool& shared();
+
+    /**
+     * @brief Класс размера для count элементов
+     * @return Номер класса или NUM_CLASSES, если запрос больше старшего класса
+     */
+    static size_t sizeClass(size_t count);
+
+    /**
+     * @brief Емкость класса в элементах
+     */
+    static size_t classElems(size_t cls) { return MIN_CLASS_ELEMS << cls; }
+
+private:
+    friend class PooledBuffer;
+
+    const uint64_t id_;                          ///< Номер пула (ключ кэша потока)
+    mutable std::mutex mutex_;                   ///< Защита общих списков и счетчиков
+    std::vector<BufferStorage> free_[NUM_CLASSES]; ///< Свободные блоки по классам
+    size_t max_cached_;                          ///< Предел объема общих списков
+    size_t idle_budget_ = DEFAULT_IDLE_BUDGET;   ///< Объем общих списков после trimIdle()
+    size_t cached_bytes_ = 0;                    ///< Объем общих списков
+    size_t allocations_ = 0;                     ///< Выделено блоков у системы
+
+    /**
+     * @brief Блок не меньше count элементов
+     * @param count Количество элементов
+     * @param capacity Фактическая емкость блока
+     * @return Память блока
+     */
+    BufferStorage take(size_t count, size_t& capacity);
+
+    /**
+     * @brief Возврат блока в кэш потока, общий список или системе
+     * @param data Память блока
+     * @param capacity Емкость блока в элементах
+     */
+    void give(BufferStorage data, size_t capacity);
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "buffered_socket_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Создает пустой буфер чтения соединения
+ * @param io Реализация ввода-вывода, через которую пополняется буфер
+ * @param capacity Емкость буфера в байтах (не меньше 8)
+ */
+BufferedSocketReader::BufferedSocketReader(SocketIo& io, size_t capacity)
+    : io_(io)
+    , buf_(std::max<size_t>(capacity, 8))
+{
+}
+
+// ====================================================================
+// Чтение
+// ====================================================================
+
+/**
+ * @brief Однократное чтение
+ * @details Если буфер пуст, он пополняется одним вызовом recv(); затем
+ *          выдается не более len байт. Данные сверх len (например, первые
+ *          заголовки векторов, отправленные клиентом сразу после данных
+ *          аутентификации) остаются в буфере для следующих чтений.
+ * @param fd Дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Максимальное количество байт
+ * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t BufferedSocketReader::readSome(int fd, void* buf, size_t len)
+{
+    if(len == 0)
+        return 0;
+    if(buffered() == 0) {
+        ssize_t r = fill(fd, 1);
+        if(r <= 0)
+            return r;
+    }
+    return static_cast<ssize_t>(take(buf, len));
+}
+
+/**
+ * @brief Гарантированное чтение len байт
+ * @details Сначала выдаются данные буфера. Остаток от directReadMin() байт
+ *          читается SocketIo::recvAll() сразу в buf (данные больших векторов
+ *          не копируются дважды), меньший остаток - через пополнение буфера,
+ *          которое заодно забирает следующие заголовки и векторы.
+ * @param fd Дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t BufferedSocketReader::readAll(int fd, void* buf, size_t len)
+{
+    char* p = static_cast<char*>(buf);
+    size_t got = take(p, len);
+
+    while(got < len) {
+        size_t left = len - got;
+        if(left >= directReadMin()) {
+            ssize_t r = io_.recvAll(fd, p + got, left);
+            if(r <= 0)
+                return r;
+            break;
+        }
+        ssize_t r = fill(fd, left);
+        if(r <= 0)
+            return r;
+        got += take(p + got, left);
+    }
+    return static_cast<ssize_t>(len);
+}
+
+/**
+ * @brief Отправляет данные и читает ответ
+ * @details Ответ, уже лежащий в буфере, не требует чтения из сокета.
+ *          Иначе недостающие байты читаются SocketIo::sendThenRecv(), чтобы
+ *          реализация io_uring по-прежнему выполняла отправку и чтение
+ *          одним системным вызовом.
+ * @param fd Дескриптор сокета
+ * @param out Данные для отправки
+ * @param out_len Количество байт для отправки
+ * @param in Буфер для приема данных
+ * @param in_len Количество байт для чтения
+ * @return in_len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t BufferedSocketReader::sendThenRead(int fd, const void* out, size_t out_len,
+                                           void* in, size_t in_len)
+{
+    if(buffered() >= in_len) {
+        if(!io_.sendAll(fd, out, out_len))
+            return -1;
+        take(in, in_len);
+        return static_cast<ssize_t>(in_len);
+    }
+
+    char* p = static_cast<char*>(in);
+    size_t got = take(p, in_len);
+    ssize_t r = io_.sendThenRecv(fd, out, out_len, p + got, in_len - got);
+    if(r <= 0)
+        return r;
+    return static_cast<ssize_t>(in_len);
+}
+
+/**
+ * @brief Отбрасывает len байт входящих данных
+ * @details Данные буфера пропускаются сдвигом позиции, остаток
+ *          отбрасывается SocketIo::discardAll() без копирования.
+ * @param fd Дескриптор сокета
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t BufferedSocketReader::discardAll(int fd, size_t len)
+{
+    size_t skip = std::min(len, buffered());
+    head_ += skip;
+    if(skip < len) {
+        ssize_t r = io_.discardAll(fd, len - skip);
+        if(r <= 0)
+            return r;
+    }
+    return static_cast<ssize_t>(len);
+}
+
+// ====================================================================
+// Буфер
+// ====================================================================
+
+/**
+ * @brief Копирует до len байт из буфера
+ * @param dst Память назначения
+ * @param len Максимальное количество байт
+ * @return Количество скопированных байт
+ */
+size_t BufferedSocketReader::take(void* dst, size_t len)
+{
+    size_t n = std::min(len, buffered());
+    if(n > 0) {
+        std::memcpy(dst, buf_.data() + head_, n);
+        head_ += n;
+    }
+    return n;
+}
+
+/**
+ * @brief Пополняет буфер, пока в нем не окажется need байт
+ * @details Каждый вызов recv() запрашивает все свободное место буфера.
+ *          Перед чтением невыданный остаток (неполный заголовок или хвост
+ *          вектора, всегда меньше need) переносится в начало буфера, если
+ *          после него не хватает места.
+ * @param fd Дескриптор сокета
+ * @param need Требуемое количество байт в буфере
+ * @return Положительное значение при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t BufferedSocketReader::fill(int fd, size_t need)
+{
+    if(buffered() == 0) {
+        head_ = tail_ = 0;
+    } else if(buf_.size() - head_ < need) {
+        std::memmove(buf_.data(), buf_.data() + head_, buffered());
+        tail_ -= head_;
+        head_ = 0;
+    }
+
+    while(buffered() < need) {
+        ssize_t r = io_.recvSome(fd, buf_.data() + tail_, buf_.size() - tail_);
+        if(r <= 0)
+            return r;
+        tail_ += static_cast<size_t>(r);
+        ++refills_;
+    }
+    return static_cast<ssize_t>(buffered());
+}
@@ -0,0 +1,101 @@
+#ifndef BUFFERED_SOCKET_READER_H
+#define BUFFERED_SOCKET_READER_H
+
+#include <cstddef>
+#include <vector>
+#include <sys/types.h>
+#include "socket_io.h"
+
+/**
+ * @class BufferedSocketReader
+ * @brief Буфер входящих данных соединения
+ * @details Заголовки (количество и размеры векторов), данные аутентификации
+ *          и небольшие векторы читаются из буфера, который пополняется одним
+ *          вызовом recv() на все уже пришедшие данные (до емкости буфера).
+ *          Клиент, отправляющий много коротких векторов подряд, обслуживается
+ *          одним чтением на буфер вместо двух чтений (заголовок и данные) на
+ *          каждый вектор. Данные от DIRECT_READ_MIN байт читаются сразу
+ *          в память назначения без промежуточного копирования.
+ * @note Один экземпляр на соединение; все чтения соединения должны идти
+ *       через него, иначе данные, уже забранные в буфер, будут пропущены
+ */
+class BufferedSocketReader {
+public:
+    /// Емкость буфера по умолчанию (байт)
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    /**
+     * @brief Конструктор
+     * @param io Реализация ввода-вывода для чтения из сокета
+     * @param capacity Емкость буфера в байтах
+     */
+    explicit BufferedSocketReader(SocketIo& io, size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Однократное чтение (аналог recv()): данные буфера или одно пополнение
+     * @param fd Дескриптор сокета
+     * @param buf Буфер для приема данных
+     * @param len Максимальное количество байт
+     * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t readSome(int fd, void* buf, size_t len);
+
+    /**
+     * @brief Гарантированное чтение len байт
+     * @param fd Дескриптор сокета
+     * @param buf Буфер для приема данных
+     * @param len Количество байт
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t readAll(int fd, void* buf, size_t len);
+
+    /**
+     * @brief Отправка данных с последующим гарантированным чтением
+     * @details Если ответ уже в буфере, выполняется только отправка;
+     *          иначе недостающая часть читается SocketIo::sendThenRecv().
+     * @return in_len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t sendThenRead(int fd, const void* out, size_t out_len, void* in, size_t in_len);
+
+    /**
+     * @brief Отбрасывание len байт: сначала из буфера, затем SocketIo::discardAll()
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t discardAll(int fd, size_t len);
+
+    /**
+     * @brief Количество прочитанных из сокета, но еще не выданных байт
+     */
+    size_t buffered() const { return tail_ - head_; }
+
+    /**
+     * @brief Порог прямого чтения в память назначения (половина емкости)
+     */
+    size_t directReadMin() const { return buf_.size() / 2; }
+
+    /**
+     * @brief Количество пополнений буфера (для статистики и тестов)
+     */
+    size_t refills() const { return refills_; }
+
+private:
+    SocketIo& io_;            ///< Реализация ввода-вывода
+    std::vector<char> buf_;   ///< Буфер данных
+    size_t head_ = 0;         ///< Начало невыданных данных
+    size_t tail_ = 0;         ///< Конец прочитанных данных
+    size_t refills_ = 0;      ///< Счетчик пополнений
+
+    /**
+     * @brief Выдача до len байт из буфера
+     * @return Количество скопированных байт
+     */
+    size_t take(void* dst, size_t len);
+
+    /**
+     * @brief Пополнение буфера до need байт (need не больше емкости)
+     * @return Положительное значение при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t fill(int fd, size_t need);
+};
+
+#endif
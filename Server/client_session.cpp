@@ -0,0 +1,500 @@
+#include "client_session.h"
+#include "network_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Создает сеанс для принятого клиентского соединения
+ * @param fd Неблокирующий дескриптор клиентского сокета (сеанс становится его владельцем)
+ * @param peer Адрес клиента в формате "IP:PORT"
+ * @param logger Логгер для записи событий
+ * @param authDb База данных аутентификации
+ */
+ClientSession::ClientSession(int fd, const std::string& peer, Logger& logger, AuthDB& authDb)
+    : fd_(fd)
+    , peer_(peer)
+    , logger_(logger)
+    , auth_(logger, authDb)
+    , vectors_(logger)
+{
+}
+
+/**
+ * @brief Закрывает клиентский сокет и логирует отключение клиента
+ */
+ClientSession::~ClientSession()
+{
+    close(fd_);
+    logger_.info("Client disconnected: " + peer_);
+}
+
+/**
+ * @brief Подключает пул буферов векторов сеанса
+ * @param pool Пул буферов
+ */
+void ClientSession::setBufferPool(BufferPool& pool)
+{
+    vectors_.setBufferPool(pool);
+    bulk_payload_ = PooledBuffer(pool);
+}
+
+// ====================================================================
+// Чтение и разбор входящих данных
+// ====================================================================
+
+/**
+ * @brief Обрабатывает готовность сокета к чтению
+ * @details Сокет зарегистрирован в epoll в режиме edge-triggered, поэтому
+ *          чтение выполняется до получения EAGAIN, но не больше READ_BUDGET
+ *          байт за вызов: сеанс, исчерпавший бюджет, отмечается
+ *          readPending(), и EventLoop продолжает его на следующей итерации,
+ *          не давая одному клиенту занять поток. Если неотправленных
+ *          ответов набралось OUT_HIGH_WATER байт и сокет их не принимает,
+ *          чтение приостанавливается до onWritable(). Каждый вызов recv()
+ *          читает ровно столько, сколько нужно текущему состоянию:
+ *          - Auth: одно чтение до 255 байт (как в AuthHandler::authenticate())
+ *            в буфер сеанса; в AuthHashing чтение приостанавливается до
+ *            onAuthHashed()
+ *          - VectorCount/VectorId/VectorSize/VectorOps: оставшиеся байты
+ *            4-байтового заголовка
+ *          - VectorData: данные вектора порциями до STREAM_CHUNK_SIZE байт;
+ *            после насыщения суммы остаток отбрасывается (MSG_TRUNC)
+ *          - BulkTable/BulkPayload: оставшиеся байты таблицы размеров или
+ *            блока данных пакета v2 - прямо в их буферы
+ * @return false если сеанс завершен (ошибка, закрытие соединения клиентом
+ *         или все данные отправлены после завершения протокола)
+ */
+bool ClientSession::onReadable()
+{
+    read_pending_ = false;
+    write_blocked_ = false;
+    size_t budget = READ_BUDGET;
+    while(state_ != State::Closing && state_ != State::AuthHashing) {
+        if(pendingOutput() >= OUT_HIGH_WATER) {
+            if(!flush())
+                return false;
+            if(pendingOutput() >= OUT_HIGH_WATER) {
+                write_blocked_ = true;
+                break;
+            }
+        }
+        if(budget == 0) {
+            read_pending_ = true;
+            break;
+        }
+
+        void* dst = auth_buf_;
+        size_t want = sizeof(auth_buf_);
+
+        if(state_ == State::VectorCount || state_ == State::VectorId ||
+           state_ == State::VectorSize || state_ == State::VectorOps) {
+            dst = header_ + header_got_;
+            want = sizeof(header_) - header_got_;
+        } else if(state_ == State::VectorData) {
+            dst = reinterpret_cast<char*>(chunk_.data()) + chunk_fill_;
+            want = std::min(chunk_.size() * sizeof(uint32_t) - chunk_fill_, data_left_);
+        } else if(state_ == State::BulkTable) {
+            dst = reinterpret_cast<char*>(bulk_raw_.data()) + bulk_got_;
+            want = bulk_raw_.size() * sizeof(uint32_t) - bulk_got_;
+        } else if(state_ == State::BulkPayload) {
+            dst = reinterpret_cast<char*>(bulk_payload_.data()) + bulk_got_;
+            want = bulk_table_.bytes() - bulk_got_;
+        }
+
+        // После насыщения суммы остаток вектора отбрасывается без копирования
+        ssize_t r = (state_ == State::VectorData && sum_.saturated)
+                        ? NetworkUtils::recvDiscard(fd_, data_left_)
+                        : recv(fd_, dst, want, 0);
+        if(r == 0) {
+            // Закрытие между пакетами keep-alive - обычное завершение сеанса
+            if(between_batches_ && header_got_ == 0) {
+                logger_.info("Keep-alive session closed by client");
+                state_ = State::Closing;
+                break;
+            }
+            if(state_ == State::Auth)
+                logger_.error("Failed to read authentication data");
+            else
+                logger_.error("Session error: connection closed by client");
+            return false;
+        }
+        if(r < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if(errno == EINTR)
+                continue;
+            logger_.error(std::string("Session error: recv: ") + std::strerror(errno));
+            return false;
+        }
+
+        budget -= std::min(budget, static_cast<size_t>(r));
+        if(!advance(auth_buf_, static_cast<size_t>(r)))
+            return false;
+    }
+
+    if(!flush())
+        return false;
+    return !(state_ == State::Closing && out_.empty());
+}
+
+/**
+ * @brief Завершает аутентификацию хэшем из CryptoPool
+ * @details Вызывается событийным циклом в потоке сеанса. После ответа
+ *          чтение возобновляется: данные, пришедшие во время хэширования,
+ *          уже не дадут нового фронта edge-triggered epoll.
+ * @param digest SHA224(salt_hex || password), AuthHandler::HASH_SIZE байт
+ * @return false если сеанс завершен и должен быть закрыт
+ */
+bool ClientSession::onAuthHashed(const unsigned char* digest)
+{
+    if(state_ != State::AuthHashing)
+        return true;
+    std::string response;
+    bool ok = auth_.finishAuthRequest(hash_request_, digest, login_, response);
+    finishAuth(ok, response);
+    return onReadable();
+}
+
+/**
+ * @brief Обрабатывает готовность сокета к записи
+ * @details Чтение, приостановленное по OUT_HIGH_WATER, возобновляется:
+ *          данные, пришедшие за это время, не дадут нового фронта
+ *          edge-triggered epoll.
+ * @return false если сеанс завершен или произошла ошибка записи
+ */
+bool ClientSession::onWritable()
+{
+    if(!flush())
+        return false;
+    if(write_blocked_)
+        return onReadable();
+    return !(state_ == State::Closing && out_.empty());
+}
+
+/**
+ * @brief Продвигает конечный автомат после чтения очередной порции данных
+ * @details Переходы состояний:
+ *          - Auth -> VectorCount при успешной аутентификации ("OK"),
+ *            Auth -> Closing при неудаче ("ERR"),
+ *            Auth -> AuthHashing, если хэш пароля считает CryptoPool
+ *            (AuthHashing -> VectorCount/Closing в onAuthHashed())
+ *          - VectorCount -> VectorSize после проверки количества векторов,
+ *            VectorCount -> Closing по слову END_OF_SESSION между пакетами,
+ *            VectorCount -> BulkTable для пакета v2 (BULK_FLAG),
+ *            VectorCount -> VectorId для заданий с идентификаторами (TAGGED_FLAG)
+ *          - VectorId -> VectorSize после чтения идентификатора задания
+ *          - BulkTable -> BulkPayload после проверки таблицы размеров
+ *          - BulkPayload -> Closing (VectorCount для KEEP_ALIVE_FLAG) после
+ *            отправки в очередь всех сумм пакета
+ *          - VectorSize -> VectorData после проверки размера вектора,
+ *            VectorSize -> VectorOps, если за заголовком следует маска операций
+ *          - VectorOps -> VectorData после проверки маски операций
+ *          - VectorData -> VectorSize (VectorId для заданий) после вычисления
+ *            ответа на вектор,
+ *            VectorData -> Closing (VectorCount для KEEP_ALIVE_FLAG) после
+ *            последнего вектора
+ * @param buf Прочитанные данные (используются только в состоянии Auth)
+ * @param len Количество прочитанных байт
+ * @return false при нарушении протокола (сеанс закрывается немедленно)
+ */
+bool ClientSession::advance(const char* buf, size_t len)
+{
+    switch(state_) {
+    case State::Auth: {
+        std::string response;
+        AuthHandler::AuthStep step = auth_.beginAuthRequest(std::string_view(buf, len), login_,
+                                                            response, hash_request_);
+        if(step == AuthHandler::AuthStep::NeedsHash && hash_submit_) {
+            state_ = State::AuthHashing;
+            hash_submit_(hash_request_.salt_hex, hash_request_.password);
+            return true;
+        }
+        bool ok = step == AuthHandler::AuthStep::NeedsHash
+                      ? auth_.completeAuthRequest(hash_request_, login_, response)
+                      : step == AuthHandler::AuthStep::Accepted;
+        finishAuth(ok, response);
+        return true;
+    }
+
+    case State::VectorCount: {
+        header_got_ += len;
+        if(header_got_ < sizeof(header_))
+            return true;
+        header_got_ = 0;
+        if(between_batches_ && headerValue() == VectorHandler::END_OF_SESSION) {
+            logger_.info("Keep-alive session ended by client");
+            state_ = State::Closing;
+            return true;
+        }
+        BatchHeader batch;
+        if(!VectorHandler::parseVectorCount(headerValue(), batch)) {
+            logger_.error("Session error: Invalid vector count: " + std::to_string(batch.count));
+            return false;
+        }
+        vec_count_ = batch.count;
+        keep_alive_ = batch.keep_alive;
+        between_batches_ = false;
+        vectors_.beginBatch(login_, vec_count_);
+        vec_index_ = 0;
+        tagged_ = batch.format == BatchFormat::Tagged;
+        if(batch.format == BatchFormat::Bulk) {
+            bulk_raw_.resize(vec_count_);
+            bulk_got_ = 0;
+            state_ = State::BulkTable;
+        } else {
+            state_ = tagged_ ? State::VectorId : State::VectorSize;
+        }
+        return true;
+    }
+
+    case State::VectorId:
+        header_got_ += len;
+        if(header_got_ < sizeof(header_))
+            return true;
+        header_got_ = 0;
+        vec_id_ = headerValue();
+        state_ = State::VectorSize;
+        return true;
+
+    case State::VectorSize: {
+        header_got_ += len;
+        if(header_got_ < sizeof(header_))
+            return true;
+        header_got_ = 0;
+        uint32_t raw = headerValue();
+        if(!VectorHandler::parseVectorHeader(raw, vec_header_)) {
+            logger_.error(VectorHandler::invalidHeaderMessage(raw));
+            logger_.error("Session error: Failed to read vector " + std::to_string(vec_index_));
+            return false;
+        }
+        if(vec_header_.has_ops)
+            state_ = State::VectorOps;
+        else
+            beginVectorData();
+        return true;
+    }
+
+    case State::VectorOps: {
+        header_got_ += len;
+        if(header_got_ < sizeof(header_))
+            return true;
+        header_got_ = 0;
+        uint32_t raw = headerValue();
+        if(!VectorHandler::parseOperations(raw, vec_header_)) {
+            logger_.error(VectorHandler::invalidOperationsMessage(raw));
+            logger_.error("Session error: Failed to read vector " + std::to_string(vec_index_));
+            return false;
+        }
+        beginVectorData();
+        return true;
+    }
+
+    case State::VectorData: {
+        // Целые элементы сразу добавляются к сумме, остаток неполного
+        // элемента переносится в начало порции; после насыщения данные
+        // уже отброшены onReadable() и только учитываются
+        data_left_ -= len;
+        if(!sum_.saturated) {
+            size_t width = VectorProcessor::elementSize(vec_header_.type);
+            char* bytes = reinterpret_cast<char*>(chunk_.data());
+            chunk_fill_ += len;
+            size_t whole = chunk_fill_ / width;
+            if(vec_header_.ops)
+                VectorProcessor::reduceUpdate(reduce_, bytes, whole);
+            else
+                VectorProcessor::sumUpdateTyped(sum_, vec_header_.type, bytes, whole);
+            chunk_fill_ -= whole * width;
+            if(chunk_fill_ > 0)
+                std::memmove(bytes, bytes + whole * width, chunk_fill_);
+        }
+        if(data_left_ > 0)
+            return true;
+        // Задания обрабатываются по мере чтения, поэтому ответ готов сразу
+        if(tagged_)
+            queue(&vec_id_, sizeof(vec_id_));
+        if(vec_header_.ops) {
+            uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+            queue(values, VectorProcessor::reduceFinish(reduce_, values) * sizeof(uint64_t));
+        } else {
+            int32_t result = VectorProcessor::sumFinish(sum_);
+            queue(&result, sizeof(result));
+        }
+        vectors_.vectorDone(vec_index_, vec_header_.size);
+        if(++vec_index_ == vec_count_) {
+            finishBatch();
+        } else {
+            state_ = tagged_ ? State::VectorId : State::VectorSize;
+        }
+        return true;
+    }
+
+    case State::BulkTable:
+        bulk_got_ += len;
+        if(bulk_got_ < bulk_raw_.size() * sizeof(uint32_t))
+            return true;
+        if(!VectorHandler::parseSizeTable(bulk_raw_.data(), vec_count_, bulk_table_)) {
+            logger_.error(VectorHandler::invalidTableMessage(bulk_raw_.data(), vec_count_));
+            logger_.error("Session error: Invalid size table");
+            return false;
+        }
+        bulk_payload_.resize((bulk_table_.bytes() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+        bulk_got_ = 0;
+        state_ = State::BulkPayload;
+        return true;
+
+    case State::BulkPayload:
+        bulk_got_ += len;
+        if(bulk_got_ < bulk_table_.bytes())
+            return true;
+        finishBulk();
+        return true;
+
+    case State::AuthHashing:
+    case State::Closing:
+        break;
+    }
+    return true;
+}
+
+/**
+ * @brief Ставит ответ аутентификации в очередь
+ * @details Переходы: -> VectorCount при успехе, -> Closing при неудаче.
+ * @param ok Клиент аутентифицирован
+ * @param response Ответ клиенту
+ */
+void ClientSession::finishAuth(bool ok, const std::string& response)
+{
+    queue(response.data(), response.size());
+    logger_.info({"Sent response: ", ok ? "OK" : "ERR"});
+    if(!ok) {
+        logger_.warning("Authentication failed, closing connection");
+        state_ = State::Closing;
+        return;
+    }
+    state_ = State::VectorCount;
+}
+
+/**
+ * @brief Считает суммы пакета v2 и ставит их в очередь одним массивом
+ * @details Блок данных освобождается сразу (возвращается в BufferPool):
+ *          сеанс после пакета только отправляет ответы.
+ */
+void ClientSession::finishBulk()
+{
+    std::vector<int32_t> results(vec_count_);
+    vectors_.computeBulk(bulk_payload_, bulk_table_, results.data());
+    queue(results.data(), results.size() * sizeof(int32_t));
+    bulk_payload_ = PooledBuffer(vectors_.bufferPool());
+    for(uint32_t i = 0; i < vec_count_; ++i)
+        vectors_.vectorDone(i, bulk_table_.headers[i].size);
+    finishBatch();
+}
+
+/**
+ * @brief Завершает пакет векторов
+ * @details Пакет с KEEP_ALIVE_FLAG возвращает автомат к чтению слова
+ *          количества следующего пакета и запоминает время для проверки
+ *          простоя (idleExpired()); иначе сеанс закрывается после
+ *          отправки ответов.
+ */
+void ClientSession::finishBatch()
+{
+    vectors_.endBatch();
+    if(!keep_alive_) {
+        state_ = State::Closing;
+        return;
+    }
+    between_batches_ = true;
+    idle_since_ = std::chrono::steady_clock::now();
+    state_ = State::VectorCount;
+}
+
+/**
+ * @brief Проверяет таймаут простоя между пакетами keep-alive
+ * @details Простоем считается только ожидание следующего пакета после
+ *          пакета с KEEP_ALIVE_FLAG, пока не прочитан ни один байт его
+ *          слова количества; медленная передача внутри пакета не
+ *          ограничивается.
+ * @param now Текущее время
+ * @param timeout Таймаут простоя (не больше нуля - без таймаута)
+ * @return true если сеанс следует закрыть по таймауту
+ */
+bool ClientSession::idleExpired(std::chrono::steady_clock::time_point now,
+                                std::chrono::milliseconds timeout) const
+{
+    return timeout.count() > 0 && between_batches_ && header_got_ == 0 &&
+           state_ == State::VectorCount && now - idle_since_ >= timeout;
+}
+
+/**
+ * @brief Начинает чтение данных вектора
+ * @details Сбрасывает порцию и потоковую сумму или свертку (если
+ *          заголовок содержит маску операций).
+ */
+void ClientSession::beginVectorData()
+{
+    if(chunk_.empty())
+        chunk_.resize(VectorHandler::STREAM_CHUNK_SIZE / sizeof(uint32_t));
+    data_left_ = vec_header_.bytes();
+    chunk_fill_ = 0;
+    VectorProcessor::sumInit(sum_);
+    if(vec_header_.ops)
+        VectorProcessor::reduceInit(reduce_, vec_header_.type, vec_header_.ops);
+    state_ = State::VectorData;
+}
+
+/**
+ * @brief Возвращает значение 4-байтового заголовка из header_
+ * @return Значение заголовка
+ * @note Порядок байт совпадает с NetworkUtils::readNetworkUint32()
+ */
+uint32_t ClientSession::headerValue() const
+{
+    uint32_t value;
+    std::memcpy(&value, header_, sizeof(value));
+    return value;
+}
+
+// ====================================================================
+// Отправка данных
+// ====================================================================
+
+/**
+ * @brief Добавляет данные в буфер исходящих данных
+ * @param data Указатель на данные
+ * @param len Количество байт
+ */
+void ClientSession::queue(const void* data, size_t len)
+{
+    out_.append(static_cast<const char*>(data), len);
+}
+
+/**
+ * @brief Отправляет накопленные данные, пока сокет принимает их
+ * @details При EAGAIN остаток сохраняется в буфере и будет отправлен
+ *          при следующем событии EPOLLOUT.
+ * @return false при ошибке записи в сокет
+ * @note Используется флаг MSG_NOSIGNAL, чтобы разрыв соединения клиентом
+ *       не завершал весь сервер сигналом SIGPIPE
+ */
+bool ClientSession::flush()
+{
+    while(out_pos_ < out_.size()) {
+        ssize_t w = send(fd_, out_.data() + out_pos_, out_.size() - out_pos_, MSG_NOSIGNAL);
+        if(w < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if(errno == EINTR)
+                continue;
+            logger_.error("Failed to send data to client " + peer_);
+            return false;
+        }
+        out_pos_ += static_cast<size_t>(w);
+    }
+    out_.clear();
+    out_pos_ = 0;
+    return true;
+}
@@ -0,0 +1,227 @@
+#ifndef CLIENT_SESSION_H
+#define CLIENT_SESSION_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include "logger.h"
+#include "authdb.h"
+#include "auth_handler.h"
+#include "vector_handler.h"
+
+/**
+ * @class ClientSession
+ * @brief Неблокирующий сеанс клиента в виде конечного автомата
+ * @details Используется событийным циклом (EventLoop): этапы аутентификации
+ *          и обработки векторов продвигаются по мере поступления данных,
+ *          не блокируя поток, обслуживающий остальные соединения.
+ */
+class ClientSession {
+public:
+    /**
+     * @brief Состояния сеанса
+     */
+    enum class State {
+        Auth,        ///< Ожидание данных аутентификации
+        AuthHashing, ///< Ожидание хэша пароля из CryptoPool (чтение приостановлено)
+        VectorCount, ///< Чтение количества векторов
+        VectorId,    ///< Чтение идентификатора задания (TAGGED_FLAG)
+        VectorSize,  ///< Чтение размера очередного вектора
+        VectorOps,   ///< Чтение маски операций вектора (заголовок с OPERATIONS_FLAG)
+        VectorData,  ///< Чтение данных очередного вектора
+        BulkTable,   ///< Чтение таблицы размеров пакета v2
+        BulkPayload, ///< Чтение блока данных пакета v2
+        Closing      ///< Отправка оставшихся данных и закрытие
+    };
+
+    /**
+     * @brief Конструктор сеанса
+     * @param fd Неблокирующий дескриптор клиентского сокета
+     * @param peer Адрес клиента в формате "IP:PORT"
+     * @param logger Логгер для записи событий
+     * @param authDb База данных аутентификации
+     */
+    ClientSession(int fd, const std::string& peer, Logger& logger, AuthDB& authDb);
+
+    /**
+     * @brief Деструктор сеанса, закрывает клиентский сокет
+     */
+    ~ClientSession();
+
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+
+    /// Наибольший объем данных, читаемых за один вызов onReadable(), байт
+    static constexpr size_t READ_BUDGET = 1 << 20;
+    /// Объем неотправленных ответов, при котором чтение приостанавливается, байт
+    static constexpr size_t OUT_HIGH_WATER = 64 * 1024;
+
+    /**
+     * @brief Обработка готовности сокета к чтению
+     * @return false если сеанс завершен и должен быть закрыт
+     */
+    bool onReadable();
+
+    /**
+     * @brief Чтение прервано по READ_BUDGET, и в сокете могут оставаться данные
+     * @return true если onReadable() нужно вызвать снова без нового события epoll
+     */
+    bool readPending() const { return read_pending_; }
+
+    /**
+     * @brief Объем ответов, ожидающих отправки
+     * @return Байт в буфере исходящих данных
+     */
+    size_t pendingOutput() const { return out_.size() - out_pos_; }
+
+    /**
+     * @brief Обработка готовности сокета к записи
+     * @return false если сеанс завершен и должен быть закрыт
+     */
+    bool onWritable();
+
+    /**
+     * @brief Дескриптор клиентского сокета
+     * @return Файловый дескриптор
+     */
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Текущее состояние сеанса
+     * @return Состояние конечного автомата
+     */
+    State state() const { return state_; }
+
+    /**
+     * @brief Подключение выдачи билетов возобновления
+     * @param tickets Выдача билетов (nullptr - билеты выключены)
+     */
+    void setTickets(const SessionTickets* tickets) { auth_.setTickets(tickets); }
+
+    /**
+     * @brief Подключение ограничения частоты попыток входа
+     * @param limiter Ограничитель (nullptr - без ограничения)
+     */
+    void setRateLimiter(RateLimiter* limiter) { auth_.setRateLimiter(limiter); }
+
+    /**
+     * @brief Подключение пула буферов векторов
+     * @param pool Пул (по умолчанию BufferPool::shared(); у шарда - свой)
+     */
+    void setBufferPool(BufferPool& pool);
+
+    /// Постановка SHA224(salt_hex || password) в CryptoPool; результат - через onAuthHashed()
+    using HashSubmit = std::function<void(std::string_view salt_hex, std::string_view password)>;
+
+    /**
+     * @brief Подключение хэширования паролей вне потока сеанса
+     * @param submit Постановка хэширования (пустая функция - хэш считается на месте)
+     */
+    void setHashSubmit(HashSubmit submit) { hash_submit_ = std::move(submit); }
+
+    /**
+     * @brief Завершение аутентификации хэшем, посчитанным CryptoPool
+     * @param digest SHA224(salt_hex || password), AuthHandler::HASH_SIZE байт
+     * @return false если сеанс завершен и должен быть закрыт
+     */
+    bool onAuthHashed(const unsigned char* digest);
+
+    /**
+     * @brief Проверка таймаута простоя между пакетами keep-alive
+     * @param now Текущее время
+     * @param timeout Таймаут простоя (не больше нуля - без таймаута)
+     * @return true если сеанс ждет следующий пакет дольше timeout
+     */
+    bool idleExpired(std::chrono::steady_clock::time_point now,
+                     std::chrono::milliseconds timeout) const;
+
+private:
+    int fd_;                     ///< Дескриптор клиентского сокета
+    std::string peer_;           ///< Адрес клиента для логирования
+    Logger& logger_;             ///< Ссылка на объект логгера
+    AuthHandler auth_;           ///< Проверка учетных данных
+    VectorHandler vectors_;      ///< Вычисления и учет статистики векторов
+    State state_ = State::Auth;  ///< Текущее состояние автомата
+
+    HashSubmit hash_submit_;              ///< Постановка хэширования в CryptoPool (может отсутствовать)
+    char auth_buf_[AuthHandler::MAX_AUTH_DATA_SIZE]; ///< Данные аутентификации (нужны до onAuthHashed())
+    AuthHandler::HashRequest hash_request_; ///< Запрос, ожидающий хэша
+    std::string login_;                   ///< Аутентифицированный логин
+    unsigned char header_[4];             ///< Буфер заголовка (uint32_t)
+    size_t header_got_ = 0;               ///< Прочитано байт заголовка
+    uint32_t vec_count_ = 0;              ///< Количество векторов в пакете
+    uint32_t vec_index_ = 0;              ///< Индекс текущего вектора
+    bool keep_alive_ = false;             ///< Сеанс продолжается после пакета (KEEP_ALIVE_FLAG)
+    bool between_batches_ = false;        ///< Ожидание слова количества следующего пакета
+    std::chrono::steady_clock::time_point idle_since_; ///< Конец последнего пакета keep-alive
+    bool tagged_ = false;                 ///< Задания с идентификаторами (TAGGED_FLAG)
+    uint32_t vec_id_ = 0;                 ///< Идентификатор текущего задания
+    VectorHeader vec_header_;             ///< Заголовок текущего вектора (размер, тип, операции)
+    std::vector<uint32_t> chunk_;         ///< Порция данных вектора (STREAM_CHUNK_SIZE байт)
+    size_t chunk_fill_ = 0;               ///< Байт в chunk_ (остаток неполного элемента)
+    size_t data_left_ = 0;                ///< Осталось прочитать байт данных вектора
+    VectorProcessor::SumState sum_;       ///< Потоковая сумма текущего вектора
+    VectorProcessor::ReduceState reduce_; ///< Потоковая свертка (вектор с маской операций)
+    std::vector<uint32_t> bulk_raw_;      ///< Таблица размеров пакета v2
+    BulkTable bulk_table_;                ///< Разобранная таблица размеров пакета v2
+    PooledBuffer bulk_payload_;           ///< Блок данных пакета v2
+    size_t bulk_got_ = 0;                 ///< Прочитано байт таблицы или блока данных
+    std::string out_;                     ///< Буфер исходящих данных
+    size_t out_pos_ = 0;                  ///< Отправлено байт из out_
+    bool read_pending_ = false;           ///< Чтение прервано по READ_BUDGET
+    bool write_blocked_ = false;          ///< Чтение приостановлено до отправки ответов (OUT_HIGH_WATER)
+
+    /**
+     * @brief Обработка прочитанных данных в текущем состоянии
+     * @param buf Прочитанные данные (для состояния Auth)
+     * @param len Количество прочитанных байт
+     * @return false при ошибке протокола
+     */
+    bool advance(const char* buf, size_t len);
+
+    /**
+     * @brief Постановка ответа аутентификации в очередь и переход состояния
+     * @param ok Клиент аутентифицирован
+     * @param response Ответ клиенту
+     */
+    void finishAuth(bool ok, const std::string& response);
+
+    /**
+     * @brief Переход к чтению данных вектора с разобранным заголовком vec_header_
+     */
+    void beginVectorData();
+
+    /**
+     * @brief Вычисление и постановка в очередь ответов пакета v2
+     */
+    void finishBulk();
+
+    /**
+     * @brief Завершение пакета: ожидание следующего (keep-alive) или закрытие
+     */
+    void finishBatch();
+
+    /**
+     * @brief Постановка данных в очередь на отправку
+     * @param data Указатель на данные
+     * @param len Количество байт
+     */
+    void queue(const void* data, size_t len);
+
+    /**
+     * @brief Отправка накопленных данных без блокировки
+     * @return false при ошибке записи в сокет
+     */
+    bool flush();
+
+    /**
+     * @brief Значение заголовка, прочитанного в header_
+     * @return 32-битное значение заголовка
+     */
+    uint32_t headerValue() const;
+};
+
+#endif
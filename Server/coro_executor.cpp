@@ -0,0 +1,421 @@
+#include "coro_executor.h"
+#include "logger.h"
+#include "network_utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+namespace {
+/// Максимальное число событий, забираемых за один вызов epoll_wait()
+const int MAX_EVENTS = 256;
+/// Таймаут epoll_wait() в мс: период проверки флага running и сроков чтения
+const int WAIT_TIMEOUT_MS = 500;
+}
+
+// ====================================================================
+// Корневые сопрограммы
+// ====================================================================
+
+/**
+ * @brief Тип корневой сопрограммы
+ * @details Начинает выполнение сразу и уничтожает свой кадр по завершении.
+ *          Пока кадр жив, его адрес хранится в CoroExecutor::roots, чтобы
+ *          деструктор исполнителя мог уничтожить незавершенные сеансы.
+ */
+struct CoroExecutor::Root {
+    struct promise_type {
+        CoroExecutor& executor;
+
+        promise_type(CoroExecutor& ex, Task<void>&) : executor(ex) {}
+
+        Root get_return_object() {
+            executor.roots.insert(handle().address());
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+
+        std::suspend_never final_suspend() noexcept {
+            executor.roots.erase(handle().address());
+            return {};
+        }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+
+        std::coroutine_handle<promise_type> handle() {
+            return std::coroutine_handle<promise_type>::from_promise(*this);
+        }
+    };
+};
+
+/**
+ * @brief Тело корневой сопрограммы: ожидает задачу и логирует ее ошибку
+ * @param executor Исполнитель, владеющий сопрограммой
+ * @param task Запускаемая задача
+ */
+CoroExecutor::Root CoroExecutor::runRoot(CoroExecutor& executor, Task<void> task)
+{
+    try {
+        co_await task;
+    } catch(const std::exception& e) {
+        executor.logger.error(std::string("Coroutine error: ") + e.what());
+    }
+}
+
+// ====================================================================
+// Конструктор / деструктор
+// ====================================================================
+
+/**
+ * @brief Создает исполнитель и дескриптор epoll
+ * @param lg Логгер для записи событий
+ * @param running Флаг работы сервера
+ * @throw std::system_error при ошибке epoll_create1()
+ */
+CoroExecutor::CoroExecutor(Logger& lg, const std::atomic<bool>& running)
+    : logger(lg)
+    , running(running)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd == -1)
+        throw std::system_error(errno, std::generic_category(), "epoll_create1");
+}
+
+/**
+ * @brief Уничтожает незавершенные сопрограммы и закрывает epoll
+ * @details Уничтожение корневого кадра уничтожает всю цепочку вложенных
+ *          задач; деструкторы локальных объектов сеансов закрывают сокеты.
+ */
+CoroExecutor::~CoroExecutor()
+{
+    waiters.clear();
+    ready.clear();
+    std::vector<void*> frames(roots.begin(), roots.end());
+    roots.clear();
+    for(void* frame : frames)
+        std::coroutine_handle<>::from_address(frame).destroy();
+    if(epoll_fd != -1)
+        close(epoll_fd);
+}
+
+// ====================================================================
+// Планирование
+// ====================================================================
+
+/**
+ * @brief Запускает задачу как независимую сопрограмму
+ * @details Задача выполняется до первой приостановки прямо в вызове spawn(),
+ *          дальше ее возобновляет run(). Исключение задачи логируется.
+ * @param task Задача
+ */
+void CoroExecutor::spawn(Task<void> task)
+{
+    runRoot(*this, std::move(task));
+}
+
+/**
+ * @brief Запоминает сопрограмму, ожидающую готовности дескриптора
+ * @details Ожидание чтения сбрасывает бюджет чтения дескриптора.
+ * @param h Приостановленная сопрограмма
+ */
+void CoroExecutor::FdAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    Waiters& w = executor.waiters[fd];
+    if(write) {
+        w.writer = h;
+        return;
+    }
+    w.reader = h;
+    w.read_bytes = 0;
+    w.deadline = deadline;
+    w.timed_out = timed_out;
+}
+
+/**
+ * @brief Регистрирует дескриптор в epoll
+ * @details Дескриптор добавляется один раз на чтение и запись в режиме
+ *          edge-triggered. Потерянный фронт не опасен: операции сначала
+ *          выполняют системный вызов и ждут готовности только после EAGAIN.
+ * @param fd Неблокирующий дескриптор
+ * @return false при ошибке epoll_ctl()
+ */
+bool CoroExecutor::watch(int fd)
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+/**
+ * @brief Удаляет дескриптор из epoll и забывает его ожидания
+ * @param fd Дескриптор
+ */
+void CoroExecutor::unwatch(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    waiters.erase(fd);
+}
+
+/**
+ * @brief Запускает цикл ожидания событий
+ * @details Для каждого события возобновляется сопрограмма, ожидающая чтения
+ *          (EPOLLIN, ошибка или закрытие соединения), затем ожидающая записи
+ *          (EPOLLOUT). Дескриптор сопрограммы извлекается из таблицы до
+ *          возобновления, поэтому повторное или ложное пробуждение
+ *          невозможно: после возобновления операция просто повторяет
+ *          системный вызов. Затем возобновляются сопрограммы, уступившие
+ *          поток на прошлой итерации (пока они есть, epoll_wait() не
+ *          ждет), и читающие сопрограммы с истекшим сроком ожидания
+ *          (expireReaders()).
+ * @note Цикл прерывается при сбросе флага running (проверяется не реже
+ *       одного раза за WAIT_TIMEOUT_MS)
+ */
+void CoroExecutor::run()
+{
+    epoll_event events[MAX_EVENTS];
+    std::vector<std::coroutine_handle<>> pending;
+
+    while(running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, ready.empty() ? WAIT_TIMEOUT_MS : 0);
+        if(n == -1) {
+            if(errno == EINTR)
+                continue;
+            logger.error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            break;
+        }
+
+        // Уступившие поток сопрограммы ждут событий этой итерации
+        pending.swap(ready);
+        for(int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+            bool failed = ev & (EPOLLERR | EPOLLHUP);
+
+            if(ev & (EPOLLIN | EPOLLRDHUP) || failed) {
+                auto it = waiters.find(fd);
+                if(it != waiters.end() && it->second.reader)
+                    std::exchange(it->second.reader, nullptr).resume();
+            }
+            if(ev & EPOLLOUT || failed) {
+                auto it = waiters.find(fd);
+                if(it != waiters.end() && it->second.writer)
+                    std::exchange(it->second.writer, nullptr).resume();
+            }
+        }
+
+        for(std::coroutine_handle<> h : pending)
+            h.resume();
+        pending.clear();
+        expireReaders();
+    }
+}
+
+/**
+ * @brief Возобновляет читающие сопрограммы, срок ожидания которых истек
+ * @details Проверка выполняется не чаще раза за WAIT_TIMEOUT_MS, поэтому
+ *          срок может быть превышен не больше чем на этот период.
+ *          Сопрограммы сначала собираются и извлекаются из таблицы:
+ *          возобновленная сопрограмма может изменить waiters.
+ */
+void CoroExecutor::expireReaders()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now - last_expiry_scan < std::chrono::milliseconds(WAIT_TIMEOUT_MS))
+        return;
+    last_expiry_scan = now;
+
+    std::vector<std::coroutine_handle<>> expired;
+    for(auto& entry : waiters) {
+        Waiters& w = entry.second;
+        if(!w.reader || !w.timed_out || now < w.deadline)
+            continue;
+        *w.timed_out = true;
+        w.timed_out = nullptr;
+        expired.push_back(std::exchange(w.reader, nullptr));
+    }
+    for(std::coroutine_handle<> h : expired)
+        h.resume();
+}
+
+/**
+ * @brief Проверяет, исчерпан ли бюджет чтения дескриптора
+ * @param fd Дескриптор
+ * @return true если сопрограмме пора уступить поток (счетчик сброшен)
+ */
+bool CoroExecutor::budgetSpent(int fd)
+{
+    if(read_budget == 0)
+        return false;
+    size_t& spent = waiters[fd].read_bytes;
+    if(spent < read_budget)
+        return false;
+    spent = 0;
+    return true;
+}
+
+/**
+ * @brief Учитывает прочитанные байты в бюджете дескриптора
+ * @param fd Дескриптор
+ * @param bytes Прочитано байт
+ */
+void CoroExecutor::chargeRead(int fd, size_t bytes)
+{
+    if(read_budget != 0)
+        waiters[fd].read_bytes += bytes;
+}
+
+// ====================================================================
+// Операции ввода-вывода
+// ====================================================================
+
+/**
+ * @brief Однократное чтение из неблокирующего сокета
+ * @details Повторяет recv() до получения данных, приостанавливаясь на EAGAIN.
+ *          Если с дескриптора без ожидания прочитано больше бюджета,
+ *          сначала уступает поток (yield()).
+ * @param fd Дескриптор сокета (зарегистрирован через watch())
+ * @param buf Буфер для приема данных
+ * @param len Максимальное количество байт
+ * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+ */
+Task<ssize_t> CoroExecutor::recvSome(int fd, void* buf, size_t len)
+{
+    if(budgetSpent(fd))
+        co_await yield();
+    while(true) {
+        ssize_t r = recv(fd, buf, len, 0);
+        if(r >= 0) {
+            chargeRead(fd, static_cast<size_t>(r));
+            co_return r;
+        }
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            co_return -1;
+        co_await readable(fd);
+    }
+}
+
+/**
+ * @brief Однократное чтение из неблокирующего сокета с таймаутом
+ * @details Как recvSome(), но ожидание готовности ограничено сроком,
+ *          отсчитываемым от вызова.
+ * @param fd Дескриптор сокета (зарегистрирован через watch())
+ * @param buf Буфер для приема данных
+ * @param len Максимальное количество байт
+ * @param timeout_ms Таймаут в мс (не больше нуля - без таймаута)
+ * @param timed_out true если срок истек до прихода данных
+ * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при
+ *         ошибке или истечении срока
+ */
+Task<ssize_t> CoroExecutor::recvSomeFor(int fd, void* buf, size_t len, int timeout_ms, bool& timed_out)
+{
+    timed_out = false;
+    if(timeout_ms <= 0)
+        co_return co_await recvSome(fd, buf, len);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    if(budgetSpent(fd))
+        co_await yield();
+    while(true) {
+        ssize_t r = recv(fd, buf, len, 0);
+        if(r >= 0) {
+            chargeRead(fd, static_cast<size_t>(r));
+            co_return r;
+        }
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            co_return -1;
+        co_await FdAwaiter{*this, fd, false, deadline, &timed_out};
+        if(timed_out)
+            co_return -1;
+    }
+}
+
+/**
+ * @brief Гарантированное чтение из неблокирующего сокета
+ * @param fd Дескриптор сокета (зарегистрирован через watch())
+ * @param buf Буфер для приема данных
+ * @param len Количество байт для чтения
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+Task<ssize_t> CoroExecutor::recvAll(int fd, void* buf, size_t len)
+{
+    char* p = static_cast<char*>(buf);
+    size_t got = 0;
+    while(got < len) {
+        ssize_t r = co_await recvSome(fd, p + got, len - got);
+        if(r <= 0)
+            co_return r;
+        got += static_cast<size_t>(r);
+    }
+    co_return static_cast<ssize_t>(len);
+}
+
+/**
+ * @brief Гарантированная отправка в неблокирующий сокет
+ * @details Повторяет send() с MSG_NOSIGNAL, приостанавливаясь на EAGAIN
+ *          до готовности сокета к записи.
+ * @param fd Дескриптор сокета (зарегистрирован через watch())
+ * @param buf Данные для отправки
+ * @param len Количество байт
+ * @return true если отправлены все данные
+ */
+Task<bool> CoroExecutor::sendAll(int fd, const void* buf, size_t len)
+{
+    const char* p = static_cast<const char*>(buf);
+    while(len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if(w > 0) {
+            p += w;
+            len -= static_cast<size_t>(w);
+            continue;
+        }
+        if(w == -1 && errno == EINTR)
+            continue;
+        if(w == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            co_return false;
+        co_await writable(fd);
+    }
+    co_return true;
+}
+
+/**
+ * @brief Гарантированное отбрасывание входящих данных без копирования
+ * @details Повторяет NetworkUtils::recvDiscard(), приостанавливаясь на EAGAIN;
+ *          отброшенные байты расходуют бюджет чтения, как в recvSome().
+ * @param fd Дескриптор сокета (зарегистрирован через watch())
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+Task<ssize_t> CoroExecutor::discardAll(int fd, size_t len)
+{
+    size_t left = len;
+    while(left > 0) {
+        if(budgetSpent(fd))
+            co_await yield();
+        ssize_t r = NetworkUtils::recvDiscard(fd, left);
+        if(r > 0) {
+            chargeRead(fd, static_cast<size_t>(r));
+            left -= static_cast<size_t>(r);
+            continue;
+        }
+        if(r == 0)
+            co_return 0;
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            co_return -1;
+        co_await readable(fd);
+    }
+    co_return static_cast<ssize_t>(len);
+}
@@ -0,0 +1,195 @@
+#ifndef CORO_EXECUTOR_H
+#define CORO_EXECUTOR_H
+
+#include "coro_task.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+
+class Logger;
+
+/**
+ * @class CoroExecutor
+ * @brief Однопоточный исполнитель сопрограмм на основе epoll
+ * @details Сопрограммы приостанавливаются на готовности неблокирующих
+ *          дескрипторов (co_await readable()/writable()) и возобновляются
+ *          циклом run(), когда epoll сообщает о событии. Операции recvSome(),
+ *          recvAll() и sendAll() повторяют системный вызов до успеха и
+ *          приостанавливаются на EAGAIN, поэтому код сеанса остается
+ *          линейным, а поток не блокируется. Прочитав без ожидания
+ *          больше бюджета (READ_BUDGET, как ClientSession), сопрограмма
+ *          уступает поток: ее возобновит следующая итерация run(), поэтому
+ *          клиент, передающий данные без пауз, не задерживает остальные сеансы.
+ */
+class CoroExecutor {
+public:
+    /**
+     * @brief Ожидатель готовности дескриптора к чтению или записи
+     */
+    struct FdAwaiter {
+        CoroExecutor& executor; ///< Исполнитель, возобновляющий сопрограмму
+        int fd;                 ///< Ожидаемый дескриптор
+        bool write;             ///< true - запись, false - чтение
+        std::chrono::steady_clock::time_point deadline{}; ///< Срок ожидания чтения (по умолчанию - без срока)
+        bool* timed_out = nullptr; ///< Устанавливается в true, если срок истек
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Ожидатель, уступающий поток другим сопрограммам
+     * @details Сопрограмма ставится в очередь ready и возобновляется
+     *          следующей итерацией run() после событий epoll.
+     */
+    struct YieldAwaiter {
+        CoroExecutor& executor; ///< Исполнитель, возобновляющий сопрограмму
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { executor.ready.push_back(h); }
+        void await_resume() const noexcept {}
+    };
+
+    /// Бюджет чтения по умолчанию: байт с одного дескриптора между ожиданиями (как ClientSession::READ_BUDGET)
+    static constexpr size_t READ_BUDGET = 1 << 20;
+
+    /**
+     * @brief Конструктор исполнителя
+     * @param lg Логгер для записи событий
+     * @param running Флаг работы сервера, проверяемый между итерациями
+     * @throw std::system_error при ошибке создания epoll
+     */
+    CoroExecutor(Logger& lg, const std::atomic<bool>& running);
+
+    /**
+     * @brief Деструктор, уничтожает незавершенные сопрограммы и закрывает epoll
+     */
+    ~CoroExecutor();
+
+    CoroExecutor(const CoroExecutor&) = delete;
+    CoroExecutor& operator=(const CoroExecutor&) = delete;
+
+    /**
+     * @brief Запуск независимой сопрограммы (выполняется до первой приостановки)
+     * @param task Задача; исполнитель владеет ею до завершения
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * @brief Цикл ожидания событий и возобновления сопрограмм до сброса running
+     */
+    void run();
+
+    /**
+     * @brief Регистрация неблокирующего дескриптора в epoll (edge-triggered)
+     * @param fd Дескриптор
+     * @return false при ошибке epoll_ctl()
+     */
+    bool watch(int fd);
+
+    /**
+     * @brief Удаление дескриптора из epoll и сброс его ожиданий
+     * @param fd Дескриптор (закрывается вызывающим)
+     */
+    void unwatch(int fd);
+
+    FdAwaiter readable(int fd) { return FdAwaiter{*this, fd, false}; }
+    FdAwaiter writable(int fd) { return FdAwaiter{*this, fd, true}; }
+    YieldAwaiter yield() { return YieldAwaiter{*this}; }
+
+    /**
+     * @brief Установка бюджета чтения
+     * @param bytes Байт, читаемых с дескриптора до уступки потока (0 - без ограничения)
+     */
+    void setReadBudget(size_t bytes) { read_budget = bytes; }
+
+    /**
+     * @brief Однократное чтение с ожиданием готовности
+     * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+     */
+    Task<ssize_t> recvSome(int fd, void* buf, size_t len);
+
+    /**
+     * @brief Однократное чтение с ожиданием готовности не дольше timeout_ms
+     * @param timeout_ms Таймаут в мс (не больше нуля - без таймаута)
+     * @param timed_out true если таймаут истек (тогда возвращается -1)
+     * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+     */
+    Task<ssize_t> recvSomeFor(int fd, void* buf, size_t len, int timeout_ms, bool& timed_out);
+
+    /**
+     * @brief Гарантированное чтение len байт
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    Task<ssize_t> recvAll(int fd, void* buf, size_t len);
+
+    /**
+     * @brief Гарантированная отправка len байт
+     * @return true если отправлены все данные
+     */
+    Task<bool> sendAll(int fd, const void* buf, size_t len);
+
+    /**
+     * @brief Гарантированное отбрасывание len байт без копирования (MSG_TRUNC)
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    Task<ssize_t> discardAll(int fd, size_t len);
+
+    /**
+     * @brief Количество незавершенных сопрограмм, запущенных через spawn()
+     */
+    size_t taskCount() const { return roots.size(); }
+
+private:
+    /**
+     * @brief Корневая сопрограмма-владелец задачи, запущенной через spawn()
+     */
+    struct Root;
+
+    /**
+     * @brief Сопрограммы, ожидающие готовности одного дескриптора
+     */
+    struct Waiters {
+        std::coroutine_handle<> reader; ///< Ожидает чтения
+        std::coroutine_handle<> writer; ///< Ожидает записи
+        std::chrono::steady_clock::time_point deadline{}; ///< Срок ожидания чтения
+        bool* timed_out = nullptr;      ///< Флаг истечения срока читающей сопрограммы
+        size_t read_bytes = 0;          ///< Прочитано байт с последнего ожидания или уступки
+    };
+
+    static Root runRoot(CoroExecutor& executor, Task<void> task);
+
+    /**
+     * @brief Возобновление читающих сопрограмм с истекшим сроком ожидания
+     */
+    void expireReaders();
+
+    /**
+     * @brief Проверка бюджета чтения перед очередным recv()
+     * @param fd Дескриптор
+     * @return true если бюджет исчерпан и сопрограмма должна уступить поток
+     *         (счетчик при этом сбрасывается)
+     */
+    bool budgetSpent(int fd);
+
+    /**
+     * @brief Учет прочитанных байт в бюджете дескриптора
+     */
+    void chargeRead(int fd, size_t bytes);
+
+    int epoll_fd = -1;                              ///< Дескриптор epoll
+    Logger& logger;                                 ///< Ссылка на объект логгера
+    const std::atomic<bool>& running;               ///< Флаг работы сервера
+    std::unordered_map<int, Waiters> waiters;       ///< Ожидания по дескрипторам
+    std::unordered_set<void*> roots;                ///< Кадры незавершенных корневых сопрограмм
+    std::vector<std::coroutine_handle<>> ready;     ///< Уступившие поток сопрограммы (YieldAwaiter)
+    size_t read_budget = READ_BUDGET;               ///< Бюджет чтения с дескриптора, байт
+    std::chrono::steady_clock::time_point last_expiry_scan; ///< Время последней проверки сроков
+};
+
+#endif
@@ -0,0 +1,417 @@
+#include "coro_server.h"
+#include "auth_handler.h"
+#include "vector_handler.h"
+#include "buffer_pool.h"
+#include "network_utils.h"
+#include "crypto_pool.h"
+#include "rate_limiter.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Создает сервер сопрограмм
+ * @param listen_fd Дескриптор слушающего сокета (-1 - только addClient())
+ * @param lg Логгер для записи событий
+ * @param a База данных аутентификации
+ * @param running Флаг работы сервера
+ * @throw std::system_error при ошибке создания epoll
+ */
+CoroServer::CoroServer(int listen_fd, Logger& lg, AuthDB& a, const std::atomic<bool>& running)
+    : listen_fd(listen_fd)
+    , logger(lg)
+    , auth(a)
+    , running(running)
+    , executor(lg, running)
+    , idle_timeout_ms(VectorHandler::DEFAULT_IDLE_TIMEOUT_MS)
+    , buffers(&BufferPool::shared())
+{
+}
+
+/**
+ * @brief Запускает прием подключений и исполнитель
+ * @details Слушающий сокет переводится в неблокирующий режим; сопрограмма
+ *          acceptLoop() запускает по сопрограмме session() на каждого клиента.
+ *          Незавершенные сеансы уничтожаются (с закрытием сокетов) вместе
+ *          с исполнителем.
+ */
+void CoroServer::run()
+{
+    if(listen_fd != -1) {
+        NetworkUtils::setNonBlocking(listen_fd);
+        if(!executor.watch(listen_fd))
+            throw std::runtime_error("Failed to register listening socket in epoll");
+        executor.spawn(acceptLoop());
+    }
+    executor.run();
+}
+
+/**
+ * @brief Запускает сеанс для подключенного клиента
+ * @param fd Дескриптор клиентского сокета
+ * @param client_info Адрес клиента для логирования
+ */
+void CoroServer::addClient(int fd, const std::string& client_info)
+{
+    NetworkUtils::setNonBlocking(fd);
+    if(!executor.watch(fd)) {
+        logger.error("epoll_ctl failed for " + client_info);
+        close(fd);
+        return;
+    }
+    executor.spawn(session(fd, client_info));
+}
+
+// ====================================================================
+// Сопрограммы
+// ====================================================================
+
+/**
+ * @brief Принимает подключения, пока сервер работает
+ * @details Клиентские сокеты создаются сразу неблокирующими (accept4 с
+ *          SOCK_NONBLOCK). При EAGAIN (и при ошибке accept) сопрограмма
+ *          ждет следующей готовности слушающего сокета. Подключение,
+ *          отклоненное RateLimiter, сбрасывается до записи в лог.
+ */
+Task<void> CoroServer::acceptLoop()
+{
+    while(running) {
+        sockaddr_in cli_addr{};
+        socklen_t cli_len = sizeof(cli_addr);
+
+        int client_fd = accept4(listen_fd, (sockaddr*)&cli_addr, &cli_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(client_fd == -1) {
+            if(errno == EINTR)
+                continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK)
+                logger.error("accept failed");
+            co_await executor.readable(listen_fd);
+            continue;
+        }
+        if(limiter && !limiter->admitPeer(cli_addr)) {
+            NetworkUtils::abortConnection(client_fd);
+            continue;
+        }
+
+        std::string client_info = NetworkUtils::sockaddrToString(cli_addr);
+        logger.info("Accepted connection from " + client_info);
+        addClient(client_fd, client_info);
+    }
+}
+
+/**
+ * @brief Сеанс клиента с перехватом ошибок и закрытием сокета
+ * @details Аналог NetworkServer::handleClient(). Сокет закрывается
+ *          объектом-стражем, поэтому он закрывается и тогда, когда
+ *          незавершенный сеанс уничтожается при остановке сервера;
+ *          он же сбрасывает пул буферов сервера до бюджета простоя.
+ * @param fd Дескриптор клиентского сокета
+ * @param client_info Адрес клиента для логирования
+ */
+Task<void> CoroServer::session(int fd, std::string client_info)
+{
+    struct Closer {
+        CoroExecutor& executor;
+        Logger& logger;
+        BufferPool& buffers;
+        int fd;
+        const std::string& info;
+        ~Closer() {
+            executor.unwatch(fd);
+            close(fd);
+            logger.info("Client disconnected: " + info);
+            buffers.trimIdle();
+        }
+    } closer{executor, logger, *buffers, fd, client_info};
+
+    try {
+        co_await serve(fd);
+    } catch(const std::exception& e) {
+        logger.error(std::string("Session error: ") + e.what());
+    }
+}
+
+/**
+ * @brief Этапы сеанса: аутентификация и обработка векторов
+ * @details Порядок шагов и сообщения об ошибках совпадают с
+ *          AuthHandler::authenticate() и VectorHandler::process();
+ *          разбор и проверку выполняют те же обработчики, а каждый
+ *          co_await приостанавливает только этот сеанс. Пакеты с
+ *          KEEP_ALIVE_FLAG обрабатываются в цикле до пакета без флага,
+ *          слова END_OF_SESSION, закрытия соединения или таймаута простоя.
+ * @param fd Дескриптор клиентского сокета
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ */
+Task<void> CoroServer::serve(int fd)
+{
+    // Этап 1: Аутентификация
+    AuthHandler authHandler(logger, auth);
+    authHandler.setTickets(tickets);
+    authHandler.setRateLimiter(limiter);
+    char buf[AuthHandler::MAX_AUTH_DATA_SIZE + 1];
+    ssize_t n = co_await executor.recvSome(fd, buf, AuthHandler::MAX_AUTH_DATA_SIZE);
+    if(n <= 0) {
+        logger.error("Failed to read authentication data");
+        co_return;
+    }
+
+    // Хэш пароля считает CryptoPool (если подключен), сеанс при этом приостановлен
+    std::string login, response;
+    AuthHandler::HashRequest request;
+    AuthHandler::AuthStep step = authHandler.beginAuthRequest(std::string_view(buf, static_cast<size_t>(n)),
+                                                              login, response, request);
+    bool ok = step == AuthHandler::AuthStep::Accepted;
+    if(step == AuthHandler::AuthStep::NeedsHash && crypto) {
+        unsigned char server_hash[AuthHandler::HASH_SIZE];
+        co_await hashPassword(request.salt_hex, request.password, server_hash);
+        ok = authHandler.finishAuthRequest(request, server_hash, login, response);
+    } else if(step == AuthHandler::AuthStep::NeedsHash) {
+        ok = authHandler.completeAuthRequest(request, login, response);
+    }
+    if(!co_await executor.sendAll(fd, response.data(), response.size())) {
+        logger.error("Failed to send auth response");
+        co_return;
+    }
+    logger.info({"Sent response: ", ok ? "OK" : "ERR"});
+    if(!ok) {
+        logger.warning("Authentication failed, closing connection");
+        co_return;
+    }
+
+    // Этап 2: Обработка векторов
+    VectorHandler vectorHandler(logger);
+    vectorHandler.setBufferPool(*buffers);
+    uint32_t raw_count = 0;
+    if(co_await executor.recvAll(fd, &raw_count, sizeof(raw_count)) != static_cast<ssize_t>(sizeof(raw_count)))
+        throw std::runtime_error("Failed to read uint32");
+    for(uint32_t batches = 1;; ++batches) {
+        BatchHeader batch;
+        if(!VectorHandler::parseVectorCount(raw_count, batch))
+            throw std::runtime_error("Invalid vector count: " + std::to_string(batch.count));
+        co_await serveBatch(fd, vectorHandler, login, batch);
+        if(!batch.keep_alive || !co_await readNextBatch(fd, raw_count))
+            co_return;
+        if(raw_count == VectorHandler::END_OF_SESSION) {
+            logger.info("Keep-alive session ended by client after " + std::to_string(batches) + " batches");
+            co_return;
+        }
+    }
+}
+
+/**
+ * @brief Хэширует пароль в CryptoPool, приостанавливая сеанс
+ * @details Обработчик пула копирует хэш в общее с сеансом состояние и
+ *          пишет в его eventfd, зарегистрированный в исполнителе. Состояние
+ *          (и eventfd) живет, пока на него ссылается хотя бы одна сторона:
+ *          сеанс, уничтоженный при остановке сервера, не оставляет
+ *          обработчику закрытый или чужой дескриптор. Если eventfd создать
+ *          не удалось, поток ждет пул синхронно.
+ * @param salt_hex Соль в hex формате
+ * @param password Пароль
+ * @param digest Буфер для хэша (AuthHandler::HASH_SIZE байт)
+ */
+Task<void> CoroServer::hashPassword(std::string_view salt_hex, std::string_view password,
+                                    unsigned char* digest)
+{
+    struct Pending {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        unsigned char digest[AuthHandler::HASH_SIZE];
+        ~Pending() { if(fd != -1) close(fd); }
+    };
+    auto pending = std::make_shared<Pending>();
+    if(pending->fd == -1 || !executor.watch(pending->fd)) {
+        crypto->sha224(salt_hex, password, digest);
+        co_return;
+    }
+    struct Unwatch {
+        CoroExecutor& executor;
+        int fd;
+        ~Unwatch() { executor.unwatch(fd); }
+    } unwatch{executor, pending->fd};
+
+    crypto->submit(salt_hex, password, [pending](const unsigned char* hash) {
+        std::memcpy(pending->digest, hash, sizeof(pending->digest));
+        uint64_t one = 1;
+        (void)!write(pending->fd, &one, sizeof(one));
+    });
+    uint64_t count = 0;
+    while(read(pending->fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count)))
+        co_await executor.readable(pending->fd);
+    std::memcpy(digest, pending->digest, sizeof(pending->digest));
+}
+
+/**
+ * @brief Ожидает слово количества следующего пакета keep-alive
+ * @details Первые байты ожидаются не дольше таймаута простоя
+ *          (CoroExecutor::recvSomeFor()), остаток слова - без таймаута.
+ *          Закрытие соединения клиентом между пакетами - обычное
+ *          завершение сеанса.
+ * @param fd Дескриптор клиентского сокета
+ * @param raw Прочитанное слово
+ * @return false если клиент закрыл соединение или истек таймаут простоя
+ * @throw std::runtime_error при ошибке чтения или неполном слове
+ */
+Task<bool> CoroServer::readNextBatch(int fd, uint32_t& raw)
+{
+    bool timed_out = false;
+    ssize_t n = co_await executor.recvSomeFor(fd, &raw, sizeof(raw), idle_timeout_ms, timed_out);
+    if(timed_out) {
+        logger.info("Keep-alive session idle for " + std::to_string(idle_timeout_ms) + " ms, closing");
+        co_return false;
+    }
+    if(n == 0) {
+        logger.info("Keep-alive session closed by client");
+        co_return false;
+    }
+    char* p = reinterpret_cast<char*>(&raw);
+    size_t rest = sizeof(raw) - static_cast<size_t>(std::max<ssize_t>(n, 0));
+    if(n < 0 || (rest > 0 && co_await executor.recvAll(fd, p + n, rest) != static_cast<ssize_t>(rest)))
+        throw std::runtime_error("Failed to read uint32");
+    co_return true;
+}
+
+/**
+ * @brief Обрабатывает один пакет векторов
+ * @details Пакет v2 передается serveBulk(); остальные векторы читаются
+ *          и суммируются порциями, ответ отправляется сразу (для заданий
+ *          с TAGGED_FLAG - с идентификатором).
+ * @param fd Дескриптор клиентского сокета
+ * @param vectorHandler Обработчик векторов сеанса
+ * @param login Логин клиента
+ * @param batch Разобранное слово количества векторов
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ */
+Task<void> CoroServer::serveBatch(int fd, VectorHandler& vectorHandler, const std::string& login,
+                                  const BatchHeader& batch)
+{
+    const uint32_t count = batch.count;
+    vectorHandler.beginBatch(login, count);
+    if(batch.format == BatchFormat::Bulk) {
+        co_await serveBulk(fd, vectorHandler, count);
+        co_return;
+    }
+    PooledBuffer chunk(vectorHandler.bufferPool());
+    chunk.resize(VectorHandler::STREAM_CHUNK_SIZE / sizeof(uint32_t));
+    const bool tagged = batch.format == BatchFormat::Tagged;
+    for(uint32_t i = 0; i < count; ++i) {
+        // Задание с идентификатором: ответ помечается им же
+        uint32_t id = 0;
+        if(tagged && co_await executor.recvAll(fd, &id, sizeof(id)) != static_cast<ssize_t>(sizeof(id)))
+            throw std::runtime_error("Failed to read vector " + std::to_string(i));
+        uint32_t raw = 0;
+        if(co_await executor.recvAll(fd, &raw, sizeof(raw)) != static_cast<ssize_t>(sizeof(raw)))
+            throw std::runtime_error("Failed to read vector " + std::to_string(i));
+        VectorHeader header;
+        if(!VectorHandler::parseVectorHeader(raw, header)) {
+            logger.error(VectorHandler::invalidHeaderMessage(raw));
+            throw std::runtime_error("Failed to read vector " + std::to_string(i));
+        }
+        if(header.has_ops) {
+            uint32_t ops = 0;
+            if(co_await executor.recvAll(fd, &ops, sizeof(ops)) != static_cast<ssize_t>(sizeof(ops)))
+                throw std::runtime_error("Failed to read vector " + std::to_string(i));
+            if(!VectorHandler::parseOperations(ops, header)) {
+                logger.error(VectorHandler::invalidOperationsMessage(ops));
+                throw std::runtime_error("Failed to read vector " + std::to_string(i));
+            }
+        }
+
+        // Данные суммируются порциями: память сеанса не зависит от размера вектора
+        const size_t width = VectorProcessor::elementSize(header.type);
+        const size_t per_chunk = chunk.size() * sizeof(uint32_t) / width;
+        VectorProcessor::SumState sum;
+        VectorProcessor::sumInit(sum);
+        VectorProcessor::ReduceState reduce;
+        if(header.ops)
+            VectorProcessor::reduceInit(reduce, header.type, header.ops);
+        for(size_t left = header.size; left > 0;) {
+            size_t n = std::min(left, per_chunk);
+            ssize_t bytes = static_cast<ssize_t>(n * width);
+            if(co_await executor.recvAll(fd, chunk.data(), n * width) != bytes) {
+                logger.error("Failed to read vector data");
+                throw std::runtime_error("Failed to read vector " + std::to_string(i));
+            }
+            if(header.ops)
+                VectorProcessor::reduceUpdate(reduce, chunk.data(), n);
+            else
+                VectorProcessor::sumUpdateTyped(sum, header.type, chunk.data(), n);
+            left -= n;
+
+            // Сумма насыщена: остаток отбрасывается без копирования
+            if(sum.saturated && left > 0) {
+                ssize_t rest = static_cast<ssize_t>(left * width);
+                if(co_await executor.discardAll(fd, left * width) != rest) {
+                    logger.error("Failed to read vector data");
+                    throw std::runtime_error("Failed to read vector " + std::to_string(i));
+                }
+                left = 0;
+            }
+        }
+
+        VectorResult result;
+        if(header.ops) {
+            uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+            result.setValues(values, VectorProcessor::reduceFinish(reduce, values));
+        } else {
+            result.setSum(VectorProcessor::sumFinish(sum));
+        }
+        uint32_t frame[VectorHandler::TAGGED_FRAME_WORDS];
+        const void* reply = result.words;
+        size_t reply_bytes = result.bytes();
+        if(tagged) {
+            reply = frame;
+            reply_bytes = VectorHandler::taggedFrame(id, result, frame);
+        }
+        if(!co_await executor.sendAll(fd, reply, reply_bytes))
+            throw std::runtime_error("Failed to send result for vector " + std::to_string(i));
+        vectorHandler.vectorDone(i, header.size);
+    }
+    vectorHandler.endBatch();
+}
+
+/**
+ * @brief Пакет v2: таблица размеров, блок данных и один массив сумм
+ * @details Как VectorHandler::processBulk(): таблица и блок данных
+ *          читаются двумя recvAll(), суммы отправляются одним sendAll().
+ * @param fd Дескриптор клиентского сокета
+ * @param vectorHandler Обработчик векторов сеанса (пакет уже начат)
+ * @param count Количество векторов
+ * @throw std::runtime_error при ошибках чтения/записи или неверной таблице
+ */
+Task<void> CoroServer::serveBulk(int fd, VectorHandler& vectorHandler, uint32_t count)
+{
+    std::vector<uint32_t> raw(count);
+    ssize_t table_bytes = static_cast<ssize_t>(count * sizeof(uint32_t));
+    if(co_await executor.recvAll(fd, raw.data(), raw.size() * sizeof(uint32_t)) != table_bytes)
+        throw std::runtime_error("Failed to read size table");
+    BulkTable table;
+    if(!VectorHandler::parseSizeTable(raw.data(), count, table)) {
+        logger.error(VectorHandler::invalidTableMessage(raw.data(), count));
+        throw std::runtime_error("Invalid size table");
+    }
+
+    PooledBuffer payload(vectorHandler.bufferPool());
+    payload.resize((table.bytes() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    if(co_await executor.recvAll(fd, payload.data(), table.bytes()) != static_cast<ssize_t>(table.bytes())) {
+        logger.error("Failed to read vector data");
+        throw std::runtime_error("Failed to read bulk payload");
+    }
+
+    std::vector<int32_t> results(count);
+    vectorHandler.computeBulk(payload, table, results.data());
+    if(!co_await executor.sendAll(fd, results.data(), results.size() * sizeof(int32_t)))
+        throw std::runtime_error("Failed to send results");
+    for(uint32_t i = 0; i < count; ++i)
+        vectorHandler.vectorDone(i, table.headers[i].size);
+    vectorHandler.endBatch();
+}
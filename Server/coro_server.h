@@ -0,0 +1,161 @@
+#ifndef CORO_SERVER_H
+#define CORO_SERVER_H
+
+#include "coro_executor.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class Logger;
+class AuthDB;
+class VectorHandler;
+class SessionTickets;
+class CryptoPool;
+class RateLimiter;
+class BufferPool;
+struct BatchHeader;
+
+/**
+ * @class CoroServer
+ * @brief Обслуживание клиентов сопрограммами на одном потоке
+ * @details Каждый сеанс - сопрограмма с тем же линейным порядком шагов,
+ *          что и NetworkServer::serveClient() (аутентификация, затем
+ *          векторы), но чтение и отправка приостанавливают сопрограмму
+ *          вместо блокировки потока. Проверка данных аутентификации и
+ *          вычисления выполняются AuthHandler и VectorHandler.
+ */
+class CoroServer {
+public:
+    /**
+     * @brief Конструктор
+     * @param listen_fd Дескриптор слушающего сокета (-1 - без приема подключений)
+     * @param lg Логгер для записи событий
+     * @param a База данных аутентификации
+     * @param running Флаг работы сервера
+     * @throw std::system_error при ошибке создания epoll
+     */
+    CoroServer(int listen_fd, Logger& lg, AuthDB& a, const std::atomic<bool>& running);
+
+    /**
+     * @brief Запуск приема подключений и исполнителя до сброса running
+     */
+    void run();
+
+    /**
+     * @brief Запуск сеанса для уже подключенного клиента
+     * @param fd Дескриптор клиентского сокета (переводится в неблокирующий режим)
+     * @param client_info Адрес клиента для логирования
+     */
+    void addClient(int fd, const std::string& client_info);
+
+    /**
+     * @brief Количество незавершенных сопрограмм (сеансы и цикл приема)
+     */
+    size_t taskCount() const { return executor.taskCount(); }
+
+    /**
+     * @brief Установка таймаута простоя между пакетами keep-alive
+     * @param ms Таймаут в мс (не больше нуля - без таймаута)
+     */
+    void setIdleTimeout(int ms) { idle_timeout_ms = ms; }
+
+    /**
+     * @brief Установка бюджета чтения сеанса до уступки потока
+     * @param bytes Бюджет в байтах (по умолчанию CoroExecutor::READ_BUDGET, 0 - без ограничения)
+     */
+    void setReadBudget(size_t bytes) { executor.setReadBudget(bytes); }
+
+    /**
+     * @brief Подключение выдачи билетов возобновления
+     * @param t Выдача билетов (nullptr - билеты выключены)
+     */
+    void setTickets(const SessionTickets* t) { tickets = t; }
+
+    /**
+     * @brief Подключение пула хэширования паролей
+     * @param pool Пул (nullptr - хэширование в потоке исполнителя)
+     */
+    void setCryptoPool(CryptoPool* pool) { crypto = pool; }
+
+    /**
+     * @brief Подключение отказа злоупотребляющим клиентам
+     * @param l Ограничитель подключений и попыток входа (nullptr - без ограничения)
+     */
+    void setRateLimiter(RateLimiter* l) { limiter = l; }
+
+    /**
+     * @brief Подключение пула буферов векторов сеансов
+     * @param pool Пул (по умолчанию BufferPool::shared(); у шарда - свой)
+     */
+    void setBufferPool(BufferPool& pool) { buffers = &pool; }
+
+private:
+    /**
+     * @brief Сопрограмма приема подключений
+     */
+    Task<void> acceptLoop();
+
+    /**
+     * @brief Сопрограмма сеанса: аутентификация и обработка векторов
+     * @param fd Дескриптор клиентского сокета
+     * @param client_info Адрес клиента для логирования
+     */
+    Task<void> session(int fd, std::string client_info);
+
+    /**
+     * @brief Этапы сеанса (исключения перехватывает session())
+     * @param fd Дескриптор клиентского сокета
+     */
+    Task<void> serve(int fd);
+
+    /**
+     * @brief Хэширование SHA224(salt_hex || password) в CryptoPool
+     * @details Сеанс приостанавливается до готовности хэша, поток
+     *          исполнителя обслуживает остальные сеансы.
+     * @param salt_hex Соль в hex формате
+     * @param password Пароль
+     * @param digest Буфер для хэша (AuthHandler::HASH_SIZE байт)
+     */
+    Task<void> hashPassword(std::string_view salt_hex, std::string_view password,
+                            unsigned char* digest);
+
+    /**
+     * @brief Обработка одного пакета векторов
+     * @param fd Дескриптор клиентского сокета
+     * @param vectorHandler Обработчик векторов сеанса
+     * @param login Логин клиента
+     * @param batch Разобранное слово количества векторов
+     */
+    Task<void> serveBatch(int fd, VectorHandler& vectorHandler, const std::string& login,
+                          const BatchHeader& batch);
+
+    /**
+     * @brief Ожидание слова количества следующего пакета keep-alive
+     * @param fd Дескриптор клиентского сокета
+     * @param raw Прочитанное слово
+     * @return false если клиент закрыл соединение или истек таймаут простоя
+     */
+    Task<bool> readNextBatch(int fd, uint32_t& raw);
+
+    /**
+     * @brief Обработка пакета v2 (количество векторов с BULK_FLAG)
+     * @param fd Дескриптор клиентского сокета
+     * @param vectorHandler Обработчик векторов сеанса
+     * @param count Количество векторов
+     */
+    Task<void> serveBulk(int fd, VectorHandler& vectorHandler, uint32_t count);
+
+    int listen_fd;                      ///< Дескриптор слушающего сокета
+    Logger& logger;                     ///< Ссылка на объект логгера
+    AuthDB& auth;                       ///< Ссылка на базу данных аутентификации
+    const std::atomic<bool>& running;   ///< Флаг работы сервера
+    CoroExecutor executor;              ///< Исполнитель сопрограмм
+    int idle_timeout_ms;                ///< Таймаут простоя между пакетами, мс
+    const SessionTickets* tickets = nullptr; ///< Выдача билетов возобновления (может отсутствовать)
+    CryptoPool* crypto = nullptr;       ///< Пул хэширования паролей (может отсутствовать)
+    RateLimiter* limiter = nullptr;     ///< Ограничение частоты клиентов (может отсутствовать)
+    BufferPool* buffers;                ///< Пул буферов векторов сеансов
+};
+
+#endif
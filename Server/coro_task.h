@@ -0,0 +1,135 @@
+#ifndef CORO_TASK_H
+#define CORO_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/**
+ * @class Task
+ * @brief Ленивая сопрограмма с результатом типа T
+ * @details Тело начинает выполняться при первом co_await на задаче.
+ *          По завершении управление передается ожидающей сопрограмме
+ *          (симметричная передача управления), исключения пробрасываются
+ *          в точку co_await.
+ * @tparam T Тип результата (void - без результата)
+ */
+template <typename T = void>
+class Task;
+
+namespace coro_detail {
+
+/**
+ * @brief Общая часть promise_type для Task<T> и Task<void>
+ */
+struct PromiseBase {
+    std::coroutine_handle<> continuation; ///< Сопрограмма, ожидающая результат
+    std::exception_ptr error;             ///< Исключение из тела задачи
+
+    /**
+     * @brief Ожидатель завершения: возобновляет continuation
+     */
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+/**
+ * @brief promise_type задачи с результатом
+ */
+template <typename T>
+struct Promise : PromiseBase {
+    T value{}; ///< Результат задачи
+
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+
+    T result() {
+        if(error)
+            std::rethrow_exception(error);
+        return std::move(value);
+    }
+};
+
+/**
+ * @brief promise_type задачи без результата
+ */
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() const noexcept {}
+
+    void result() {
+        if(error)
+            std::rethrow_exception(error);
+    }
+};
+
+}
+
+template <typename T>
+class Task {
+public:
+    using promise_type = coro_detail::Promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit Task(handle_type h) : handle(h) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /**
+     * @brief Уничтожает кадр сопрограммы (в том числе незавершенной)
+     */
+    ~Task() {
+        if(handle)
+            handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    /**
+     * @brief Запускает задачу, запомнив ожидающую сопрограмму
+     * @param awaiting Сопрограмма, выполнившая co_await
+     * @return Дескриптор задачи для симметричной передачи управления
+     */
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    /**
+     * @brief Результат задачи (или проброс ее исключения)
+     */
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    handle_type handle; ///< Кадр сопрограммы
+};
+
+namespace coro_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "crypto_pool.h"
+
+#include <cstring>
+
+/**
+ * @brief Создает пул и запускает рабочие потоки
+ * @param threads Количество рабочих потоков; значение 0 заменяется на 1
+ */
+CryptoPool::CryptoPool(size_t threads)
+{
+    if(threads == 0)
+        threads = 1;
+    workers.reserve(threads);
+    for(size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&CryptoPool::workerLoop, this);
+}
+
+/**
+ * @brief Останавливает пул
+ * @details Рабочие потоки досчитывают все задания, уже стоящие в очереди
+ *          (обработчики submit() будут вызваны), после чего присоединяются.
+ */
+CryptoPool::~CryptoPool()
+{
+    {
+        std::lock_guard<std::mutex> g(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for(std::thread& t : workers)
+        t.join();
+}
+
+/**
+ * @brief Хэширует сообщение в пуле и ждет результата
+ * @details Задание размещается на стеке вызывающего и попадает в пакет
+ *          вместе с другими ожидающими: поток, ждущий здесь, не выделяет
+ *          память в куче.
+ * @param prefix Начало сообщения
+ * @param suffix Продолжение сообщения
+ * @param digest Буфер для хэша (ShaKernels::DIGEST_SIZE байт)
+ */
+void CryptoPool::sha224(std::string_view prefix, std::string_view suffix, unsigned char* digest)
+{
+    Job job;
+    job.message = {prefix, suffix};
+    push(&job);
+    std::unique_lock<std::mutex> lk(mtx);
+    done_cv.wait(lk, [&job] { return job.finished; });
+    std::memcpy(digest, job.digest, sizeof(job.digest));
+}
+
+/**
+ * @brief Ставит хэширование в очередь и сразу возвращает управление
+ * @details Данные копируются в задание, поэтому буферы вызывающего можно
+ *          освободить сразу после вызова.
+ * @param prefix Начало сообщения
+ * @param suffix Продолжение сообщения
+ * @param done Обработчик результата; вызывается в рабочем потоке пула и
+ *        не должен блокироваться надолго
+ */
+void CryptoPool::submit(std::string_view prefix, std::string_view suffix, Callback done)
+{
+    Job* job = new Job;
+    job->data.reserve(prefix.size() + suffix.size());
+    job->data.append(prefix).append(suffix);
+    job->message = {std::string_view(job->data), std::string_view()};
+    job->done = std::move(done);
+    push(job);
+}
+
+/**
+ * @brief Добавляет задание в конец очереди и будит один поток
+ * @param job Задание
+ */
+void CryptoPool::push(Job* job)
+{
+    {
+        std::lock_guard<std::mutex> g(mtx);
+        if(tail)
+            tail->next = job;
+        else
+            head = job;
+        tail = job;
+    }
+    cv.notify_one();
+}
+
+/**
+ * @brief Цикл рабочего потока
+ * @details Поток забирает из очереди до MAX_BATCH заданий, хэширует их
+ *          одним вызовом ядра вне блокировки и раздает результаты:
+ *          асинхронным - вызовом обработчика, синхронным - флагом finished
+ *          и уведомлением done_cv.
+ * @note Исключения обработчиков должны перехватываться самими обработчиками
+ */
+void CryptoPool::workerLoop()
+{
+    Job* batch[MAX_BATCH];
+    ShaKernels::Message messages[MAX_BATCH];
+    unsigned char digests[MAX_BATCH * ShaKernels::DIGEST_SIZE];
+
+    while(true) {
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait(lk, [this] { return stopping || head; });
+            if(!head)
+                return;
+            while(head && count < MAX_BATCH) {
+                batch[count++] = head;
+                head = head->next;
+            }
+            if(!head)
+                tail = nullptr;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+            messages[i] = batch[i]->message;
+        ShaKernels::activeKernel()(messages, count, digests);
+        hashed_.fetch_add(count, std::memory_order_relaxed);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+
+        bool waiters = false;
+        for(size_t i = 0; i < count; ++i) {
+            Job* job = batch[i];
+            std::memcpy(job->digest, digests + i * ShaKernels::DIGEST_SIZE, sizeof(job->digest));
+            if(job->done) {
+                job->done(job->digest);
+                delete job;
+                continue;
+            }
+            std::lock_guard<std::mutex> g(mtx);
+            job->finished = true;
+            waiters = true;
+        }
+        if(waiters)
+            done_cv.notify_all();
+    }
+}
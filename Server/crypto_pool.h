@@ -0,0 +1,114 @@
+#ifndef CRYPTO_POOL_H
+#define CRYPTO_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "sha_kernels.h"
+
+/**
+ * @class CryptoPool
+ * @brief Пул потоков проверки паролей с пакетным вычислением SHA-224
+ * @details Потоки ввода-вывода ставят хэширование SHA224(prefix || suffix)
+ *          в общую очередь; рабочий поток забирает сразу до MAX_BATCH
+ *          ожидающих заданий и считает их одним вызовом ядра
+ *          ShaKernels::activeKernel(). При всплеске подключений очередь
+ *          растет, и пакеты заполняются сами, без ожидания по таймеру.
+ */
+class CryptoPool {
+public:
+    /// Наибольшее число заданий в одном вызове ядра
+    static constexpr size_t MAX_BATCH = 16;
+
+    /// Обработчик готового хэша (DIGEST_SIZE байт), вызывается в рабочем потоке
+    using Callback = std::function<void(const unsigned char* digest)>;
+
+    /**
+     * @brief Конструктор пула
+     * @param threads Количество рабочих потоков (не менее 1)
+     */
+    explicit CryptoPool(size_t threads);
+
+    /**
+     * @brief Деструктор, досчитывает поставленные задания и останавливает потоки
+     */
+    ~CryptoPool();
+
+    CryptoPool(const CryptoPool&) = delete;
+    CryptoPool& operator=(const CryptoPool&) = delete;
+
+    /**
+     * @brief Хэширование с ожиданием результата
+     * @param prefix Начало сообщения
+     * @param suffix Продолжение сообщения
+     * @param digest Буфер для хэша (ShaKernels::DIGEST_SIZE байт)
+     */
+    void sha224(std::string_view prefix, std::string_view suffix, unsigned char* digest);
+
+    /**
+     * @brief Постановка хэширования в очередь без ожидания
+     * @param prefix Начало сообщения (копируется)
+     * @param suffix Продолжение сообщения (копируется)
+     * @param done Обработчик результата (вызывается в рабочем потоке)
+     */
+    void submit(std::string_view prefix, std::string_view suffix, Callback done);
+
+    /**
+     * @brief Количество рабочих потоков
+     */
+    size_t threads() const { return workers.size(); }
+
+    /**
+     * @brief Количество посчитанных хэшей
+     */
+    uint64_t hashed() const { return hashed_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Количество вызовов ядра (пакетов)
+     */
+    uint64_t batches() const { return batches_.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief Задание хэширования
+     * @details Синхронное задание живет на стеке вызывающего sha224();
+     *          асинхронное создается submit() и владеет копией данных.
+     */
+    struct Job {
+        ShaKernels::Message message;   ///< Хэшируемое сообщение
+        std::string data;              ///< Копия сообщения (только submit())
+        Callback done;                 ///< Обработчик (только submit())
+        unsigned char digest[ShaKernels::DIGEST_SIZE]; ///< Результат
+        bool finished = false;         ///< Результат готов (только sha224())
+        Job* next = nullptr;           ///< Следующее задание в очереди
+    };
+
+    /**
+     * @brief Постановка задания в конец очереди
+     * @param job Задание
+     */
+    void push(Job* job);
+
+    /**
+     * @brief Цикл рабочего потока: извлечение пакетов и их хэширование
+     */
+    void workerLoop();
+
+    std::vector<std::thread> workers;  ///< Рабочие потоки
+    Job* head = nullptr;               ///< Начало очереди заданий
+    Job* tail = nullptr;               ///< Конец очереди заданий
+    std::mutex mtx;                    ///< Мьютекс очереди и флагов finished
+    std::condition_variable cv;        ///< Уведомление о новых заданиях
+    std::condition_variable done_cv;   ///< Уведомление о готовности синхронных заданий
+    bool stopping = false;             ///< Флаг остановки пула
+    std::atomic<uint64_t> hashed_{0};  ///< Посчитано хэшей
+    std::atomic<uint64_t> batches_{0}; ///< Вызовов ядра
+};
+
+#endif
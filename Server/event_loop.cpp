@@ -0,0 +1,354 @@
+#include "event_loop.h"
+#include "network_utils.h"
+#include "crypto_pool.h"
+#include "rate_limiter.h"
+#include "logger.h"
+#include "authdb.h"
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace {
+/// Максимальное число событий, забираемых за один вызов epoll_wait()
+const int MAX_EVENTS = 256;
+/// Таймаут epoll_wait() в мс: период проверки флага running и простоя сеансов
+const int WAIT_TIMEOUT_MS = 500;
+}
+
+/**
+ * @brief Создает событийный цикл и регистрирует слушающий сокет
+ * @details Слушающий сокет переводится в неблокирующий режим и добавляется
+ *          в epoll как edge-triggered: при событии принимаются все ожидающие
+ *          подключения до получения EAGAIN.
+ * @param listen_fd Дескриптор слушающего сокета
+ * @param lg Логгер для записи событий
+ * @param a База данных аутентификации
+ * @param running Флаг работы сервера
+ * @throw std::system_error при ошибке epoll_create1()/epoll_ctl()
+ */
+EventLoop::EventLoop(int listen_fd, Logger& lg, AuthDB& a, const std::atomic<bool>& running)
+    : listen_fd(listen_fd)
+    , logger(lg)
+    , auth(a)
+    , running(running)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd == -1)
+        throw std::system_error(errno, std::generic_category(), "epoll_create1");
+
+    NetworkUtils::setNonBlocking(listen_fd);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == -1) {
+        int err = errno;
+        close(epoll_fd);
+        throw std::system_error(err, std::generic_category(), "epoll_ctl");
+    }
+}
+
+/**
+ * @brief Закрывает все открытые сеансы и дескриптор epoll
+ * @details Обработчики заданий CryptoPool ссылаются на цикл, поэтому
+ *          сначала дожидаются всех поставленных заданий.
+ */
+EventLoop::~EventLoop()
+{
+    {
+        std::unique_lock<std::mutex> lk(hash_mtx);
+        hash_cv.wait(lk, [this] { return hash_pending == 0; });
+    }
+    sessions.clear();
+    if(hash_fd != -1)
+        close(hash_fd);
+    if(epoll_fd != -1)
+        close(epoll_fd);
+}
+
+/**
+ * @brief Подключает пул хэширования паролей
+ * @details Рабочие потоки пула сообщают о готовых хэшах через eventfd,
+ *          зарегистрированный в epoll: проверка хэша не занимает поток
+ *          цикла, а сеанс ждет в состоянии ClientSession::State::AuthHashing.
+ * @param pool Пул (nullptr - хэширование в потоке цикла)
+ * @throw std::system_error при ошибке eventfd()/epoll_ctl()
+ */
+void EventLoop::setCryptoPool(CryptoPool* pool)
+{
+    crypto = pool;
+    if(!crypto || hash_fd != -1)
+        return;
+    hash_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(hash_fd == -1)
+        throw std::system_error(errno, std::generic_category(), "eventfd");
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = hash_fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, hash_fd, &ev) == -1)
+        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+}
+
+/**
+ * @brief Запускает цикл обработки событий
+ * @details Алгоритм работы:
+ *          1. Ожидание событий epoll_wait() с таймаутом WAIT_TIMEOUT_MS
+ *             (без ожидания, если есть сеансы с прерванным чтением)
+ *          2. Событие слушающего сокета - прием всех ожидающих подключений
+ *          3. Событие клиентского сокета - продвижение сеанса
+ *             (ClientSession::onReadable()/onWritable()); событие hash_fd -
+ *             передача хэшей из CryptoPool (completeHashes())
+ *          4. Сеансы, исчерпавшие бюджет чтения на прошлой итерации,
+ *             читаются дальше (resumeReads()): edge-triggered epoll не
+ *             сообщит о данных, уже лежащих в сокете
+ *          5. Завершенные и ошибочные сеансы закрываются
+ *          6. Не чаще раза за WAIT_TIMEOUT_MS закрываются сеансы keep-alive,
+ *             простаивающие между пакетами дольше таймаута (closeIdleSessions())
+ * @note Цикл прерывается при сбросе флага running (проверяется не реже
+ *       одного раза за WAIT_TIMEOUT_MS)
+ */
+void EventLoop::run()
+{
+    epoll_event events[MAX_EVENTS];
+
+    while(running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, ready.empty() ? WAIT_TIMEOUT_MS : 0);
+        if(n == -1) {
+            if(errno == EINTR)
+                continue;
+            logger.error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            break;
+        }
+        std::vector<int> pending;
+        pending.swap(ready);
+
+        for(int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if(fd == listen_fd) {
+                acceptClients();
+                continue;
+            }
+            if(fd == hash_fd) {
+                completeHashes();
+                continue;
+            }
+
+            auto it = sessions.find(fd);
+            if(it == sessions.end())
+                continue;
+
+            ClientSession& session = *it->second;
+            bool alive = true;
+            if(events[i].events & (EPOLLERR | EPOLLHUP))
+                alive = session.onReadable();
+            else {
+                if(events[i].events & EPOLLIN)
+                    alive = session.onReadable();
+                if(alive && (events[i].events & EPOLLOUT))
+                    alive = session.onWritable();
+            }
+            settle(fd, session, alive);
+        }
+
+        resumeReads(pending);
+        closeIdleSessions();
+    }
+}
+
+/**
+ * @brief Закрывает завершенный сеанс или ставит его в очередь продолжения чтения
+ * @param fd Дескриптор клиентского сокета
+ * @param session Сеанс
+ * @param alive Результат обработчика события сеанса
+ */
+void EventLoop::settle(int fd, const ClientSession& session, bool alive)
+{
+    if(!alive)
+        closeSession(fd);
+    else if(session.readPending() && std::find(ready.begin(), ready.end(), fd) == ready.end())
+        ready.push_back(fd);
+}
+
+/**
+ * @brief Продолжает чтение сеансов, исчерпавших бюджет на прошлой итерации
+ * @details Сеанс, уже прочитанный на этой итерации по событию epoll и снова
+ *          поставленный в очередь, пропускается. Сеанс, закрытый за это
+ *          время, не найден; новый сеанс на том же дескрипторе прочитает
+ *          сокет до EAGAIN, что безопасно.
+ * @param pending Дескрипторы сеансов
+ */
+void EventLoop::resumeReads(const std::vector<int>& pending)
+{
+    for(int fd : pending) {
+        auto it = sessions.find(fd);
+        if(it == sessions.end() || std::find(ready.begin(), ready.end(), fd) != ready.end())
+            continue;
+        ClientSession& session = *it->second;
+        settle(fd, session, session.onReadable());
+    }
+}
+
+/**
+ * @brief Закрывает сеансы, простаивающие между пакетами keep-alive
+ * @details Проход по всем сеансам выполняется не чаще раза за
+ *          WAIT_TIMEOUT_MS, поэтому сеанс закрывается с опозданием
+ *          не больше этого периода.
+ */
+void EventLoop::closeIdleSessions()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(idle_timeout.count() <= 0 || now - last_idle_scan < std::chrono::milliseconds(WAIT_TIMEOUT_MS))
+        return;
+    last_idle_scan = now;
+
+    std::vector<int> expired;
+    for(const auto& entry : sessions) {
+        if(entry.second->idleExpired(now, idle_timeout))
+            expired.push_back(entry.first);
+    }
+    for(int fd : expired) {
+        logger.info("Keep-alive session idle for " + std::to_string(idle_timeout.count()) +
+                    " ms, closing");
+        closeSession(fd);
+    }
+}
+
+/**
+ * @brief Принимает все ожидающие подключения
+ * @details Клиентские сокеты создаются сразу неблокирующими (accept4 с
+ *          SOCK_NONBLOCK) и регистрируются в epoll на чтение и запись
+ *          в режиме edge-triggered. Подключение, отклоненное RateLimiter,
+ *          сбрасывается до форматирования адреса и записи в лог.
+ */
+void EventLoop::acceptClients()
+{
+    while(true) {
+        sockaddr_in cli_addr{};
+        socklen_t cli_len = sizeof(cli_addr);
+
+        int client_fd = accept4(listen_fd, (sockaddr*)&cli_addr, &cli_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(client_fd == -1) {
+            if(errno == EINTR)
+                continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK && running)
+                logger.error("accept failed");
+            return;
+        }
+        if(limiter && !limiter->admitPeer(cli_addr)) {
+            NetworkUtils::abortConnection(client_fd);
+            continue;
+        }
+
+        std::string client_info = NetworkUtils::sockaddrToString(cli_addr);
+        logger.info("Accepted connection from " + client_info);
+
+        // Сеанс владеет дескриптором с момента создания: если вставка в
+        // sessions или регистрация в epoll не удастся, его закроет деструктор
+        std::unique_ptr<ClientSession> session;
+        try {
+            session = std::make_unique<ClientSession>(client_fd, client_info, logger, auth);
+        } catch(...) {
+            close(client_fd);
+            throw;
+        }
+        session->setTickets(tickets);
+        session->setRateLimiter(limiter);
+        session->setBufferPool(*buffers);
+        if(crypto) {
+            session->setHashSubmit([this, client_fd](std::string_view salt_hex, std::string_view password) {
+                submitHash(client_fd, salt_hex, password);
+            });
+        }
+        sessions[client_fd] = std::move(session);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = client_fd;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+            logger.error("epoll_ctl failed for " + client_info);
+            sessions.erase(client_fd);
+        }
+    }
+}
+
+/**
+ * @brief Закрывает сеанс
+ * @param fd Дескриптор клиентского сокета
+ * @note Дескриптор удаляется из epoll до закрытия в деструкторе ClientSession
+ * @note Буферы сеанса возвращаются в пул цикла (setBufferPool()), после
+ *       чего пул сбрасывается до бюджета простоя (BufferPool::trimIdle())
+ */
+void EventLoop::closeSession(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    hashing.erase(fd);
+    sessions.erase(fd);
+    buffers->trimIdle();
+}
+
+/**
+ * @brief Ставит хэширование пароля сеанса в CryptoPool
+ * @details Обработчик выполняется в рабочем потоке пула: кладет хэш в
+ *          hash_done и будит цикл записью в hash_fd. Номер задания
+ *          запоминается в hashing: хэш, пришедший после закрытия сеанса
+ *          (или для нового сеанса на том же fd), отбрасывается.
+ * @param fd Дескриптор клиентского сокета сеанса
+ * @param salt_hex Соль в hex формате
+ * @param password Пароль
+ */
+void EventLoop::submitHash(int fd, std::string_view salt_hex, std::string_view password)
+{
+    uint64_t id = next_hash_id++;
+    hashing[fd] = id;
+    {
+        std::lock_guard<std::mutex> g(hash_mtx);
+        ++hash_pending;
+    }
+    crypto->submit(salt_hex, password, [this, fd, id](const unsigned char* digest) {
+        HashDone done{fd, id, {}};
+        std::memcpy(done.digest, digest, sizeof(done.digest));
+        std::lock_guard<std::mutex> g(hash_mtx);
+        hash_done.push_back(done);
+        uint64_t one = 1;
+        if(write(hash_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+            logger.error(std::string("eventfd write failed: ") + std::strerror(errno));
+        --hash_pending;
+        hash_cv.notify_all();
+    });
+}
+
+/**
+ * @brief Передает готовые хэши ожидающим сеансам
+ * @details Счетчик eventfd сбрасывается до забора очереди, поэтому хэш,
+ *          добавленный во время обработки, разбудит цикл еще раз.
+ */
+void EventLoop::completeHashes()
+{
+    uint64_t count = 0;
+    if(read(hash_fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+        logger.error(std::string("eventfd read failed: ") + std::strerror(errno));
+
+    std::vector<HashDone> ready;
+    {
+        std::lock_guard<std::mutex> g(hash_mtx);
+        ready.swap(hash_done);
+    }
+    for(const HashDone& done : ready) {
+        auto it = hashing.find(done.fd);
+        if(it == hashing.end() || it->second != done.id)
+            continue;
+        hashing.erase(it);
+        auto session = sessions.find(done.fd);
+        if(session != sessions.end())
+            settle(done.fd, *session->second, session->second->onAuthHashed(done.digest));
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "client_session.h"
+
+class Logger;
+class AuthDB;
+class SessionTickets;
+class CryptoPool;
+class RateLimiter;
+
+/**
+ * @class EventLoop
+ * @brief Однопоточный событийный цикл на основе epoll
+ * @details Мультиплексирует множество клиентских сеансов (ClientSession)
+ *          в одном потоке: слушающий и клиентские сокеты работают
+ *          в неблокирующем режиме и регистрируются в epoll как edge-triggered.
+ */
+class EventLoop {
+public:
+    /**
+     * @brief Конструктор событийного цикла
+     * @param listen_fd Дескриптор слушающего сокета
+     * @param lg Логгер для записи событий
+     * @param a База данных аутентификации
+     * @param running Флаг работы сервера, проверяемый между итерациями
+     * @throw std::system_error при ошибке создания epoll
+     */
+    EventLoop(int listen_fd, Logger& lg, AuthDB& a, const std::atomic<bool>& running);
+
+    /**
+     * @brief Деструктор, дожидается заданий CryptoPool, закрывает сеансы и дескриптор epoll
+     */
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Запуск цикла обработки событий до сброса флага running
+     */
+    void run();
+
+    /**
+     * @brief Установка таймаута простоя между пакетами keep-alive
+     * @param ms Таймаут в мс (не больше нуля - без таймаута)
+     */
+    void setIdleTimeout(int ms) { idle_timeout = std::chrono::milliseconds(ms); }
+
+    /**
+     * @brief Подключение выдачи билетов возобновления для новых сеансов
+     * @param t Выдача билетов (nullptr - билеты выключены)
+     */
+    void setTickets(const SessionTickets* t) { tickets = t; }
+
+    /**
+     * @brief Подключение пула хэширования паролей для новых сеансов
+     * @param pool Пул (nullptr - хэширование в потоке цикла)
+     * @throw std::system_error при ошибке создания eventfd
+     */
+    void setCryptoPool(CryptoPool* pool);
+
+    /**
+     * @brief Подключение отказа злоупотребляющим клиентам
+     * @param l Ограничитель подключений и попыток входа (nullptr - без ограничения)
+     */
+    void setRateLimiter(RateLimiter* l) { limiter = l; }
+
+    /**
+     * @brief Подключение пула буферов векторов для новых сеансов
+     * @param pool Пул (по умолчанию BufferPool::shared(); у шарда - свой)
+     */
+    void setBufferPool(BufferPool& pool) { buffers = &pool; }
+
+    /**
+     * @brief Количество открытых сеансов
+     * @return Число клиентов, обслуживаемых циклом
+     */
+    size_t sessionCount() const { return sessions.size(); }
+
+private:
+    /**
+     * @brief Прием всех ожидающих подключений
+     */
+    void acceptClients();
+
+    /**
+     * @brief Закрытие сеанса и удаление его из epoll
+     * @param fd Дескриптор клиентского сокета
+     */
+    void closeSession(int fd);
+
+    /**
+     * @brief Закрытие сеансов, простаивающих между пакетами дольше таймаута
+     */
+    void closeIdleSessions();
+
+    /**
+     * @brief Закрытие завершенного сеанса или постановка в очередь продолжения чтения
+     * @param fd Дескриптор клиентского сокета
+     * @param session Сеанс
+     * @param alive Результат обработчика события сеанса
+     */
+    void settle(int fd, const ClientSession& session, bool alive);
+
+    /**
+     * @brief Продолжение чтения сеансов, исчерпавших бюджет на прошлой итерации
+     * @param pending Дескрипторы сеансов
+     */
+    void resumeReads(const std::vector<int>& pending);
+
+    /**
+     * @brief Постановка хэширования пароля сеанса в CryptoPool
+     * @param fd Дескриптор клиентского сокета сеанса
+     * @param salt_hex Соль в hex формате
+     * @param password Пароль
+     */
+    void submitHash(int fd, std::string_view salt_hex, std::string_view password);
+
+    /**
+     * @brief Передача готовых хэшей сеансам (событие hash_fd)
+     */
+    void completeHashes();
+
+    /**
+     * @brief Хэш, посчитанный CryptoPool для сеанса
+     */
+    struct HashDone {
+        int fd;        ///< Дескриптор сеанса
+        uint64_t id;   ///< Номер задания (отличает сеанс от нового на том же fd)
+        unsigned char digest[AuthHandler::HASH_SIZE]; ///< SHA224(salt_hex || password)
+    };
+
+    int epoll_fd = -1;                  ///< Дескриптор epoll
+    int listen_fd;                      ///< Дескриптор слушающего сокета
+    Logger& logger;                     ///< Ссылка на объект логгера
+    AuthDB& auth;                       ///< Ссылка на базу данных аутентификации
+    const std::atomic<bool>& running;   ///< Флаг работы сервера
+    std::unordered_map<int, std::unique_ptr<ClientSession>> sessions; ///< Открытые сеансы
+    std::vector<int> ready;             ///< Сеансы, прервавшие чтение по бюджету (ClientSession::readPending())
+    std::chrono::milliseconds idle_timeout{VectorHandler::DEFAULT_IDLE_TIMEOUT_MS}; ///< Таймаут простоя
+    std::chrono::steady_clock::time_point last_idle_scan; ///< Время последней проверки простоя
+    const SessionTickets* tickets = nullptr; ///< Выдача билетов возобновления (может отсутствовать)
+    CryptoPool* crypto = nullptr;       ///< Пул хэширования паролей (может отсутствовать)
+    RateLimiter* limiter = nullptr;     ///< Ограничение частоты клиентов (может отсутствовать)
+    BufferPool* buffers = &BufferPool::shared(); ///< Пул буферов векторов сеансов
+    int hash_fd = -1;                   ///< eventfd: готовы хэши из CryptoPool
+    uint64_t next_hash_id = 0;          ///< Номер следующего задания хэширования
+    std::unordered_map<int, uint64_t> hashing; ///< Сеансы, ожидающие хэша: fd -> номер задания
+    std::mutex hash_mtx;                ///< Мьютекс hash_done и hash_pending
+    std::condition_variable hash_cv;    ///< Уведомление о завершении задания (для деструктора)
+    std::vector<HashDone> hash_done;    ///< Готовые хэши, ожидающие передачи сеансам
+    size_t hash_pending = 0;            ///< Заданий в CryptoPool
+};
+
+#endif
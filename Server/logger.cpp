@@ -32,17 +32,24 @@ Logger::~Logger() {
  * @details Формат записи: [YYYY-MM-DD HH:MM:SS] LEVEL: сообщение
  *          Время берется с точностью до секунды.
  *          Метод потокобезопасен благодаря использованию мьютекса.
+ *          Метка времени формируется в буфере на стеке, части сообщения
+ *          пишутся в поток по очереди, поэтому запись не выделяет память
+ *          в куче.
  * @param level Уровень логирования (INFO, ERROR, WARNING)
- * @param msg Текст сообщения для записи
+ * @param parts Части сообщения для записи
  * @note Использует локальную блокировку мьютекса для предотвращения
  *       пересечения записей от разных потоков
  */
-void Logger::write(const std::string& level, const std::string& msg) {
+void Logger::write(std::string_view level, std::initializer_list<std::string_view> parts) {
     std::lock_guard<std::mutex> g(mtx);
     auto now = std::chrono::system_clock::now();
     std::time_t t = std::chrono::system_clock::to_time_t(now);
-    ofs << "[" << std::string(std::ctime(&t)).substr(0,24) << "] "
-        << level << ": " << msg << std::endl;
+    char timebuf[26];
+    ctime_r(&t, timebuf);
+    ofs << "[" << std::string_view(timebuf, 24) << "] " << level << ": ";
+    for(std::string_view part : parts)
+        ofs << part;
+    ofs << std::endl;
 }
 
 /**
@@ -50,18 +57,39 @@ void Logger::write(const std::string& level, const std::string& msg) {
  * @param msg Текст информационного сообщения
  * @note Уровень: INFO
  */
-void Logger::info(const std::string& msg) { write("INFO", msg); }
+void Logger::info(std::string_view msg) { write("INFO", {msg}); }
+
+/**
+ * @brief Записывает информационное сообщение из нескольких частей
+ * @param parts Части сообщения (например, текст и логин)
+ * @note Уровень: INFO
+ */
+void Logger::info(std::initializer_list<std::string_view> parts) { write("INFO", parts); }
 
 /**
  * @brief Записывает сообщение об ошибке в лог
  * @param msg Текст сообщения об ошибке
  * @note Уровень: ERROR
  */
-void Logger::error(const std::string& msg) { write("ERROR", msg); }
+void Logger::error(std::string_view msg) { write("ERROR", {msg}); }
+
+/**
+ * @brief Записывает сообщение об ошибке из нескольких частей
+ * @param parts Части сообщения
+ * @note Уровень: ERROR
+ */
+void Logger::error(std::initializer_list<std::string_view> parts) { write("ERROR", parts); }
 
 /**
  * @brief Записывает предупреждающее сообщение в лог
  * @param msg Текст предупреждающего сообщения
  * @note Уровень: WARNING
  */
-void Logger::warning(const std::string& msg) { write("WARNING", msg); }
\ No newline at end of file
+void Logger::warning(std::string_view msg) { write("WARNING", {msg}); }
+
+/**
+ * @brief Записывает предупреждающее сообщение из нескольких частей
+ * @param parts Части сообщения
+ * @note Уровень: WARNING
+ */
+void Logger::warning(std::initializer_list<std::string_view> parts) { write("WARNING", parts); }
\ No newline at end of file
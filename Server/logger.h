@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <initializer_list>
 #include <mutex>
 #include <fstream>
 
@@ -25,19 +27,37 @@ public:
      * @brief Запись информационного сообщения
      * @param msg Текст сообщения
      */
-    void info(const std::string& msg);
+    void info(std::string_view msg);
+    
+    /**
+     * @brief Запись информационного сообщения, составленного из частей (без сборки строки)
+     * @param parts Части сообщения, записываемые подряд
+     */
+    void info(std::initializer_list<std::string_view> parts);
     
     /**
      * @brief Запись сообщения об ошибке
      * @param msg Текст сообщения
      */
-    void error(const std::string& msg);
+    void error(std::string_view msg);
+    
+    /**
+     * @brief Запись сообщения об ошибке, составленного из частей (без сборки строки)
+     * @param parts Части сообщения, записываемые подряд
+     */
+    void error(std::initializer_list<std::string_view> parts);
     
     /**
      * @brief Запись предупреждающего сообщения
      * @param msg Текст сообщения
      */
-    void warning(const std::string& msg);
+    void warning(std::string_view msg);
+    
+    /**
+     * @brief Запись предупреждающего сообщения, составленного из частей (без сборки строки)
+     * @param parts Части сообщения, записываемые подряд
+     */
+    void warning(std::initializer_list<std::string_view> parts);
 
 private:
     std::mutex mtx;               ///< Мьютекс для синхронизации доступа к файлу
@@ -46,7 +66,7 @@ private:
     /**
      * @brief Основной метод записи в лог
      * @param level Уровень логирования
-     * @param msg Текст сообщения
+     * @param parts Части сообщения
      */
-    void write(const std::string& level, const std::string& msg);
+    void write(std::string_view level, std::initializer_list<std::string_view> parts);
 };
\ No newline at end of file
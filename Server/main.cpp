@@ -30,7 +30,7 @@ int main(int argc, char** argv) {
         logger.info("Loaded clients DB: " + params.clientsDbFile);
         std::cout << "Загружена БД клиентов: " << params.clientsDbFile << std::endl;
 
-        // create and run server (sequential)
+        // create and run server (sequential or epoll event loop)
         NetworkServer server(params, logger, auth);
         server.run();
 
@@ -2,13 +2,36 @@
 #include "auth_handler.h"
 #include "vector_handler.h"
 #include "network_utils.h"
+#include "event_loop.h"
+#include "coro_server.h"
+#include "thread_pool.h"
+#include "socket_io.h"
+#include "buffered_socket_reader.h"
+#include "buffer_pool.h"
+#include "sum_kernels.h"
+#include "parallel_sum.h"
+#include "sum_tuning.h"
+#include "session_tickets.h"
+#include "crypto_pool.h"
+#include "rate_limiter.h"
 
+#include <algorithm>
+#include <chrono>
 #include <arpa/inet.h>
 #include <cstring>
 #include <stdexcept>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
 #include <iostream>
+#include <sstream>
+#include <memory>
+#include <semaphore>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 // ====================================================================
 // Конструктор / деструктор
@@ -30,7 +53,7 @@ NetworkServer::NetworkServer(const ServerParams& p, Logger& lg, AuthDB& a)
 
 /**
  * @brief Деструктор сервера
- * @details Закрывает слушающий сокет, если он был открыт.
+ * @details Закрывает слушающий сокет (и сокеты шардов), если они были открыты.
  *          Гарантирует освобождение системных ресурсов.
  */
 NetworkServer::~NetworkServer()
@@ -39,6 +62,10 @@ NetworkServer::~NetworkServer()
         close(listen_fd);
         listen_fd = -1;
     }
+    for(int fd : shard_fds) {
+        if(fd != -1)
+            close(fd);
+    }
 }
 
 // ====================================================================
@@ -77,32 +104,114 @@ bool NetworkServer::isRunning() const { return running.load(); }
  *          2. Установка опции SO_REUSEADDR для быстрого переиспользования порта
  *          3. Привязка сокета к указанному адресу и порту
  *          4. Перевод сокета в режим прослушивания
+ *          В режиме шардов (--shards N) вместо одного сокета создается N
+ *          сокетов с опцией SO_REUSEPORT на одном адресе и порту: ядро само
+ *          распределяет входящие соединения между ними.
  * @throw std::system_error при ошибках создания/настройки сокета
- * @post listen_fd содержит валидный дескриптор слушающего сокета
+ * @post listen_fd содержит валидный дескриптор слушающего сокета,
+ *       либо shard_fds содержит N дескрипторов в режиме шардов
  * @note Очередь ожидающих соединений установлена в 5 (стандартное значение)
+ *       для последовательного режима и в SOMAXCONN для остальных режимов,
+ *       где одновременно подключаются тысячи клиентов
  */
 void NetworkServer::createSocket()
 {
-    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if(listen_fd == -1)
+    if(params.shards > 0) {
+        for(int i = 0; i < params.shards; ++i) {
+            shard_fds.push_back(-1);
+            openListenSocket(shard_fds.back(), true);
+        }
+        logger.info("Listening on " + params.address + ":" + std::to_string(params.port) +
+                    " with " + std::to_string(params.shards) + " SO_REUSEPORT sockets");
+    } else {
+        openListenSocket(listen_fd, false);
+        logger.info("Listening on " + params.address + ":" + std::to_string(params.port));
+    }
+    std::cout<< "Слушаем " << params.address << ":" << std::to_string(params.port) << std::endl;
+}
+
+/**
+ * @brief Создает один слушающий сокет на адресе и порту из параметров
+ * @param fd Ссылка для записи дескриптора (записывается сразу после socket(),
+ *           чтобы деструктор закрыл сокет даже при ошибке bind/listen)
+ * @param reuse_port Установить опцию SO_REUSEPORT (режим шардов)
+ * @throw std::system_error при ошибках создания/настройки сокета
+ */
+void NetworkServer::openListenSocket(int& fd, bool reuse_port)
+{
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd == -1)
         throw std::system_error(errno, std::generic_category(), "socket");
 
     int opt = 1;
-    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if(reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+        throw std::system_error(errno, std::generic_category(), "setsockopt(SO_REUSEPORT)");
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_port = htons(static_cast<uint16_t>(params.port));
     addr.sin_addr.s_addr = inet_addr(params.address.c_str());
 
-    if(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) == -1)
+    if(bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1)
         throw std::system_error(errno, std::generic_category(), "bind");
 
-    if(listen(listen_fd, 5) == -1)
+    bool concurrent = params.epoll || params.coro || params.workers > 0 || params.shards > 0;
+    if(listen(fd, concurrent ? SOMAXCONN : 5) == -1)
         throw std::system_error(errno, std::generic_category(), "listen");
+}
 
-    logger.info("Listening on " + params.address + ":" + std::to_string(params.port));
-    std::cout<< "Слушаем " << params.address << ":" << std::to_string(params.port) << std::endl;
+// ====================================================================
+// Выбор реализации ввода-вывода
+// ====================================================================
+
+/**
+ * @brief Проверяет доступность выбранной реализации ввода-вывода
+ * @details Пробно создает реализацию SocketIo (--io). Если ядро не
+ *          поддерживает io_uring (или его использование запрещено),
+ *          сервер переключается на posix с предупреждением в логе.
+ * @throw std::invalid_argument при неизвестном имени реализации
+ * @note Реализация используется блокирующими режимами (последовательным
+ *       и пулом потоков); событийный цикл работает с неблокирующими сокетами
+ */
+void NetworkServer::checkIoBackend()
+{
+    try {
+        std::unique_ptr<SocketIo> probe = SocketIo::create(params.ioBackend);
+        logger.info(std::string("I/O backend: ") + probe->name());
+    } catch(const std::system_error& e) {
+        logger.warning(std::string("I/O backend '") + params.ioBackend +
+                       "' unavailable (" + e.what() + "), falling back to posix");
+        params.ioBackend = "posix";
+    }
+}
+
+/**
+ * @brief Возвращает реализацию ввода-вывода текущего потока
+ * @details Экземпляр создается при первом обращении потока и используется
+ *          всеми его последующими клиентами: кольцо io_uring и
+ *          зарегистрированный буфер не пересоздаются на каждое соединение.
+ *          Экземпляры потока хранятся по имени реализации (--io), поэтому
+ *          серверы с разными реализациями в одном процессе не получают
+ *          чужую. Если кольцо потока создать не удалось (RLIMIT_MEMLOCK,
+ *          предел дескрипторов), поток переходит на posix с предупреждением,
+ *          а не завершает сеансы исключением.
+ * @return Ссылка на реализацию SocketIo потока
+ */
+SocketIo& NetworkServer::threadIo()
+{
+    thread_local std::unordered_map<std::string, std::unique_ptr<SocketIo>> cache;
+    std::unique_ptr<SocketIo>& io = cache[params.ioBackend];
+    if(!io) {
+        try {
+            io = SocketIo::create(params.ioBackend);
+        } catch(const std::system_error& e) {
+            logger.warning(std::string("I/O backend '") + params.ioBackend +
+                           "' unavailable for this thread (" + e.what() + "), using posix");
+            io.reset(new PosixSocketIo());
+        }
+    }
+    return *io;
 }
 
 // ====================================================================
@@ -111,22 +220,104 @@ void NetworkServer::createSocket()
 
 /**
  * @brief Запускает основной цикл работы сервера
+ * @details Создает слушающий сокет и выбирает режим работы:
+ *          - последовательный (по умолчанию), см. runSequential()
+ *          - событийный цикл epoll (--epoll), см. runEventLoop()
+ *          - сеансы-сопрограммы (--coro), см. runCoroutines()
+ *          - пул рабочих потоков (--workers N), см. runWorkers()
+ *          - шарды SO_REUSEPORT (--shards N), см. runShards()
+ *          Перед запуском устанавливаются пороги выбора способа
+ *          суммирования (SumTuning::configure(), --tuning FILE),
+ *          создается пул заданий сеансов (последовательный режим и
+ *          --workers), ключ билетов возобновления (--ticket-lifetime),
+ *          пул проверки паролей (--crypto-threads) и ограничитель частоты
+ *          клиентов (--peer-rate, --login-rate, --heavy-hitter).
+ * @throw std::invalid_argument если --workers отрицательно или задан вместе
+ *        с --epoll, --coro или --shards, --epoll вместе с --coro, либо
+ *        --pipeline вместе с --stream или --batch
+ * @note Цикл прерывается при установке флага running в false
+ */
+void NetworkServer::run()
+{
+    if(params.workers < 0)
+        throw std::invalid_argument("--workers must not be negative");
+    if(params.workers > 0 && (params.epoll || params.coro || params.shards > 0))
+        throw std::invalid_argument("--workers is mutually exclusive with --epoll, --coro and --shards");
+    if(params.epoll && params.coro)
+        throw std::invalid_argument("--epoll and --coro are mutually exclusive");
+    if(params.pipeline && (params.stream || params.batchResults > 0))
+        throw std::invalid_argument("--pipeline is mutually exclusive with --stream and --batch");
+
+    checkIoBackend();
+    createSocket();
+    logger.info(std::string("Sum kernel: ") + SumKernels::name(SumKernels::active()));
+    if(params.computeThreads > 0) {
+        compute.reset(new ParallelSum(static_cast<size_t>(params.computeThreads)));
+        logger.info("Compute threads: " + std::to_string(params.computeThreads));
+    }
+    SumTuning::configure(params.tuningFile, compute.get(), logger);
+    BufferPool::shared().setIdleBudget(static_cast<size_t>(std::max(params.bufferCache, 0)) << 20);
+    if(!params.epoll && !params.coro && params.shards <= 0) {
+        // По потоку на сеанс для конвейера и TAGGED_COMPUTE_THREADS для заданий с идентификаторами
+        size_t threads = VectorHandler::TAGGED_COMPUTE_THREADS;
+        if(params.pipeline)
+            threads += static_cast<size_t>(std::max(params.workers, 1));
+        jobs.reset(new ThreadPool(threads));
+        taggedSlots.reset(new std::counting_semaphore<>(VectorHandler::TAGGED_MAX_IN_FLIGHT_TOTAL));
+    }
+    if(params.ticketLifetime > 0) {
+        tickets.reset(new SessionTickets(std::chrono::seconds(params.ticketLifetime)));
+        logger.info("Session tickets: lifetime " + std::to_string(params.ticketLifetime) + " s");
+    }
+    if(params.cryptoThreads > 0) {
+        crypto.reset(new CryptoPool(static_cast<size_t>(params.cryptoThreads)));
+        logger.info("Crypto threads: " + std::to_string(params.cryptoThreads) + ", SHA-224 kernel: " +
+                    ShaKernels::name(ShaKernels::active()));
+    }
+    if(params.peerRate > 0 || params.loginRate > 0 || params.heavyHitter > 0) {
+        limiter.reset(new RateLimiter(params.peerRate, params.loginRate,
+                                      static_cast<uint32_t>(std::max(params.heavyHitter, 0))));
+        std::ostringstream ss;
+        ss << "Rate limits: " << params.peerRate << " connections/s per peer, " << params.loginRate
+           << " logins/s per login, heavy hitter " << params.heavyHitter << " per "
+           << RateLimiter::HEAVY_WINDOW_MS / 1000 << " s";
+        logger.info(ss.str());
+    }
+
+    if(params.shards > 0)
+        runShards();
+    else if(params.epoll)
+        runEventLoop();
+    else if(params.coro)
+        runCoroutines();
+    else if(params.workers > 0)
+        runWorkers(static_cast<size_t>(params.workers));
+    else
+        runSequential();
+
+    if(limiter) {
+        logger.info("Rate limits rejected: " + std::to_string(limiter->rejectedPeers()) + " connections (" +
+                    std::to_string(limiter->rejectedHeavy()) + " heavy hitters), " +
+                    std::to_string(limiter->rejectedLogins()) + " logins");
+    }
+    logger.info("Server loop exited.");
+}
+
+/**
+ * @brief Последовательный цикл работы сервера
  * @details Алгоритм работы:
- *          1. Создание слушающего сокета
- *          2. Цикл while(running):
+ *          1. Цикл while(running):
  *             a. Ожидание подключения клиента (accept)
- *             b. Принятие соединения
+ *             b. Принятие соединения (клиент, отклоненный RateLimiter,
+ *                сбрасывается без чтения данных и записи в лог)
  *             c. Обработка клиента в serveClient()
  *             d. Закрытие клиентского сокета
- *          3. Логирование завершения работы
- * @note Сервер работает в однопоточном (последовательном) режиме
- * @note Цикл прерывается при установке флага running в false
+ * @note Сервер работает в однопоточном (последовательном) режиме:
+ *       пока обслуживается один клиент, остальные ждут в очереди
  * @see serveClient()
  */
-void NetworkServer::run()
+void NetworkServer::runSequential()
 {
-    createSocket();
-
     while(running) {
         logger.info("Waiting for client...");
         std::cout << "Ожидание клиента.." << std::endl;
@@ -143,29 +334,224 @@ void NetworkServer::run()
             logger.error("accept failed");
             continue;
         }
+        if(limiter && !limiter->admitPeer(cli_addr)) {
+            NetworkUtils::abortConnection(client_fd);
+            continue;
+        }
 
         std::string client_info = NetworkUtils::sockaddrToString(cli_addr);
         logger.info("Accepted connection from " + client_info);
         std::cout << "Принято соединение от: " << client_info << std::endl;
 
-        try {
-            serveClient(client_fd);
-        } catch(const std::exception& e) {
-            logger.error(std::string("Session error: ") + e.what());
+        handleClient(client_fd, client_info);
+    }
+}
+
+/**
+ * @brief Цикл работы сервера с пулом рабочих потоков
+ * @details Поток run() только принимает соединения и передает дескрипторы
+ *          клиентов в очередь пула; рабочие потоки обслуживают клиентов
+ *          параллельно через handleClient(). Общие объекты безопасны для
+ *          параллельного доступа: Logger защищен мьютексом, AuthDB после
+ *          loadFromFile() используется только для чтения.
+ * @param workers Количество рабочих потоков
+ * @note При остановке сервера уже принятые клиенты обслуживаются до конца
+ *       (деструктор ThreadPool дожидается выполнения очереди)
+ * @see handleClient()
+ */
+void NetworkServer::runWorkers(size_t workers)
+{
+    logger.info("Worker pool mode: " + std::to_string(workers) + " threads");
+    std::cout << "Режим пула потоков: " << workers << std::endl;
+
+    ThreadPool pool(workers);
+
+    while(running) {
+        sockaddr_in cli_addr{};
+        socklen_t cli_len = sizeof(cli_addr);
+
+        int client_fd = accept(listen_fd, (sockaddr*)&cli_addr, &cli_len);
+
+        if(!running) {
+            if(client_fd != -1)
+                close(client_fd);
+            break;
+        }
+
+        if(client_fd == -1) {
+            logger.error("accept failed");
+            continue;
+        }
+        if(limiter && !limiter->admitPeer(cli_addr)) {
+            NetworkUtils::abortConnection(client_fd);
+            continue;
         }
 
-        close(client_fd);
-        logger.info("Client disconnected: " + client_info);
-        std::cout << "Клиент отключен: " << client_info << std::endl;
+        std::string client_info = NetworkUtils::sockaddrToString(cli_addr);
+        logger.info("Accepted connection from " + client_info);
+
+        pool.submit([this, client_fd, client_info] {
+            handleClient(client_fd, client_info);
+        });
     }
+}
 
-    logger.info("Server loop exited.");
+/**
+ * @brief Событийный цикл работы сервера на основе epoll
+ * @details Все клиенты обслуживаются одним потоком: этапы аутентификации
+ *          и обработки векторов выполняются конечными автоматами
+ *          ClientSession по мере готовности сокетов, поэтому медленный
+ *          клиент или большой вектор не задерживают остальные сеансы.
+ * @see EventLoop, ClientSession
+ */
+void NetworkServer::runEventLoop()
+{
+    logger.info("Event loop mode (epoll)");
+    std::cout << "Режим событийного цикла (epoll)" << std::endl;
+
+    EventLoop loop(listen_fd, logger, auth, running);
+    loop.setIdleTimeout(idleTimeoutMs());
+    loop.setTickets(tickets.get());
+    loop.setCryptoPool(crypto.get());
+    loop.setRateLimiter(limiter.get());
+    loop.run();
+}
+
+/**
+ * @brief Цикл работы сервера на сопрограммах
+ * @details Как и в runEventLoop(), все клиенты обслуживаются одним потоком,
+ *          но каждый сеанс записан линейно (аутентификация, затем векторы,
+ *          как в serveClient()): чтение и отправка приостанавливают
+ *          сопрограмму до готовности сокета вместо блокировки потока.
+ * @see CoroServer, CoroExecutor
+ */
+void NetworkServer::runCoroutines()
+{
+    logger.info("Coroutine mode (epoll executor)");
+    std::cout << "Режим сопрограмм (epoll)" << std::endl;
+
+    CoroServer server(listen_fd, logger, auth, running);
+    server.setIdleTimeout(idleTimeoutMs());
+    server.setTickets(tickets.get());
+    server.setCryptoPool(crypto.get());
+    server.setRateLimiter(limiter.get());
+    server.run();
+}
+
+/**
+ * @brief Цикл работы сервера с шардами SO_REUSEPORT
+ * @details Для каждого слушающего сокета из shard_fds запускается поток
+ *          runShard(). У каждого шарда свой сокет, свой цикл accept/epoll,
+ *          своя таблица сеансов, свой BufferPool и свой экземпляр Logger.
+ *          Общими остаются AuthDB, которая после загрузки используется
+ *          только для чтения, и SessionTickets с неизменяемым ключом;
+ *          намеренно общее изменяемое состояние перечислено в runShard().
+ * @note Поток run() дожидается завершения всех шардов
+ * @see runShard()
+ */
+void NetworkServer::runShards()
+{
+    logger.info("Shard mode: " + std::to_string(shard_fds.size()) + " SO_REUSEPORT listeners");
+    std::cout << "Режим шардов SO_REUSEPORT: " << shard_fds.size() << std::endl;
+
+    std::vector<std::thread> shards;
+    shards.reserve(shard_fds.size());
+    for(size_t i = 0; i < shard_fds.size(); ++i)
+        shards.emplace_back(&NetworkServer::runShard, this, i, shard_fds[i]);
+
+    for(std::thread& t : shards)
+        t.join();
+}
+
+/**
+ * @brief Тело потока одного шарда
+ * @details Поток закрепляется за ядром (index по модулю числа ядер),
+ *          открывает собственный Logger на том же файле логов и запускает
+ *          на своем сокете независимый EventLoop (CoroServer при --coro).
+ *          Файл логов открыт в режиме добавления, поэтому строки разных
+ *          шардов дописываются ядром без общей блокировки в процессе.
+ *          Буферы векторов сеансы шарда берут из собственного BufferPool
+ *          с долей бюджета --buffer-cache: выделение, возврат и trimIdle()
+ *          при закрытии сеанса не трогают мьютекс общего пула.
+ *          Намеренно общими остаются:
+ *          - очередь CryptoPool (--crypto-threads): проверки паролей всех
+ *            шардов собираются в общие пакеты хэширования;
+ *          - RateLimiter (--peer-rate, --heavy-hitter, --login-rate):
+ *            атомарные таблицы без блокировок, иначе лимит на адрес или
+ *            логин делился бы между шардами.
+ * @param index Номер шарда
+ * @param fd Слушающий сокет шарда (SO_REUSEPORT)
+ */
+void NetworkServer::runShard(size_t index, int fd)
+{
+    Logger shard_logger(params.logFile);
+    std::string name = "Shard " + std::to_string(index);
+
+    unsigned cpus = std::thread::hardware_concurrency();
+    if(cpus > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            shard_logger.warning(name + ": failed to pin to CPU " + std::to_string(index % cpus));
+        else
+            shard_logger.info(name + ": pinned to CPU " + std::to_string(index % cpus));
+    }
+
+    BufferPool buffers;
+    buffers.setIdleBudget((static_cast<size_t>(std::max(params.bufferCache, 0)) << 20) / shard_fds.size());
+
+    try {
+        if(params.coro) {
+            CoroServer server(fd, shard_logger, auth, running);
+            server.setIdleTimeout(idleTimeoutMs());
+            server.setTickets(tickets.get());
+            server.setCryptoPool(crypto.get());
+            server.setRateLimiter(limiter.get());
+            server.setBufferPool(buffers);
+            server.run();
+        } else {
+            EventLoop loop(fd, shard_logger, auth, running);
+            loop.setIdleTimeout(idleTimeoutMs());
+            loop.setTickets(tickets.get());
+            loop.setCryptoPool(crypto.get());
+            loop.setRateLimiter(limiter.get());
+            loop.setBufferPool(buffers);
+            loop.run();
+        }
+    } catch(const std::exception& e) {
+        shard_logger.error(name + " error: " + e.what());
+    }
+    shard_logger.info(name + " exited.");
 }
 
 // ====================================================================
 // Обслуживание одного клиента
 // ====================================================================
 
+/**
+ * @brief Обслуживает клиента и закрывает соединение
+ * @details Вызывает serveClient(), перехватывая исключения сеанса, затем
+ *          закрывает клиентский сокет, сбрасывает BufferPool до бюджета
+ *          простоя (--buffer-cache) и логирует отключение.
+ *          Используется последовательным режимом и рабочими потоками пула.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param client_info Адрес клиента в формате "IP:PORT" для логирования
+ */
+void NetworkServer::handleClient(int client_fd, const std::string& client_info)
+{
+    try {
+        serveClient(client_fd);
+    } catch(const std::exception& e) {
+        logger.error(std::string("Session error: ") + e.what());
+    }
+
+    close(client_fd);
+    BufferPool::shared().trimIdle();
+    logger.info("Client disconnected: " + client_info);
+    std::cout << "Клиент отключен: " << client_info << std::endl;
+}
+
 /**
  * @brief Обслуживает подключенного клиента
  * @details Процесс обслуживания состоит из двух этапов:
@@ -179,13 +565,33 @@ void NetworkServer::run()
  *             - Отправка результатов клиенту
  * @param client_fd Файловый дескриптор клиентского сокета
  * @throw Может генерировать исключения из AuthHandler и VectorHandler
- * @note Оба этапа выполняются в одном потоке последовательно
+ * @note Оба этапа выполняются в одном потоке последовательно; с --pipeline
+ *       суммирование больших векторов выполняется в общем пуле заданий
+ *       параллельно с чтением следующего (VectorHandler::setPipeline()),
+ *       с --stream векторы суммируются порциями по мере чтения
+ *       (VectorHandler::setStreaming()), с --batch N результаты отправляются
+ *       пакетами (VectorHandler::setBatching()), с --compute-threads N
+ *       векторы от 1M элементов суммируются общим пулом вычислительных
+ *       потоков (VectorHandler::setParallelSum()), с --crypto-threads N
+ *       хэш пароля считается пулом CryptoPool вместе с проверками других
+ *       клиентов (AuthHandler::setCryptoPool())
+ * @note Оба обработчика читают через общий BufferedSocketReader: данные,
+ *       забранные из сокета при аутентификации, не теряются
+ * @note Может вызываться одновременно из нескольких рабочих потоков:
+ *       обработчики создаются заново для каждого клиента, а реализация
+ *       ввода-вывода у каждого потока своя (threadIo())
  * @note При ошибке на любом этапе соединение закрывается
  */
 void NetworkServer::serveClient(int client_fd)
 {
+    SocketIo& io = threadIo();
+    BufferedSocketReader reader(io);
+
     // Этап 1: Аутентификация
-    AuthHandler authHandler(logger, auth);
+    AuthHandler authHandler(logger, auth, &io, &reader);
+    authHandler.setTickets(tickets.get());
+    authHandler.setCryptoPool(crypto.get());
+    authHandler.setRateLimiter(limiter.get());
     std::string login;
     
     if(!authHandler.authenticate(client_fd, login)) {
@@ -194,6 +600,25 @@ void NetworkServer::serveClient(int client_fd)
     }
     
     // Этап 2: Обработка векторов
-    VectorHandler vectorHandler(logger);
+    VectorHandler vectorHandler(logger, &io, &reader);
+    vectorHandler.setPipeline(params.pipeline);
+    vectorHandler.setStreaming(params.stream);
+    vectorHandler.setParallelSum(compute.get());
+    vectorHandler.setJobPool(jobs.get(), taggedSlots.get());
+    
+    FlushPolicy policy;
+    policy.max_results = static_cast<size_t>(std::max(params.batchResults, 0));
+    policy.max_delay_us = static_cast<unsigned>(std::max(params.batchDelayUs, 0));
+    vectorHandler.setBatching(policy);
+    vectorHandler.setIdleTimeout(idleTimeoutMs());
     vectorHandler.process(client_fd, login);
+}
+
+/**
+ * @brief Таймаут простоя сеанса keep-alive между пакетами
+ * @return Таймаут в мс (0 - без таймаута)
+ */
+int NetworkServer::idleTimeoutMs() const
+{
+    return std::max(params.idleTimeout, 0) * 1000;
 }
\ No newline at end of file
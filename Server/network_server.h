@@ -4,9 +4,19 @@
 #include "server_params.h"
 #include <atomic>
 #include <cstdint>
+#include <memory>
+#include <semaphore>
+#include <string>
+#include <vector>
 
 class Logger;
 class AuthDB;
+class SocketIo;
+class ParallelSum;
+class ThreadPool;
+class SessionTickets;
+class CryptoPool;
+class RateLimiter;
 
 /**
  * @class NetworkServer
@@ -51,17 +61,91 @@ private:
      */
     void createSocket();
     
+    /**
+     * @brief Проверка реализации ввода-вывода с откатом на posix
+     * @throw std::invalid_argument при неизвестном имени реализации
+     */
+    void checkIoBackend();
+    
+    /**
+     * @brief Реализация ввода-вывода текущего потока
+     * @return Ссылка на экземпляр SocketIo, созданный для потока
+     */
+    SocketIo& threadIo();
+    
+    /**
+     * @brief Создание одного слушающего сокета
+     * @param fd Ссылка для записи дескриптора
+     * @param reuse_port Установить SO_REUSEPORT
+     * @throw std::system_error при ошибках создания сокета
+     */
+    void openListenSocket(int& fd, bool reuse_port);
+    
+    /**
+     * @brief Последовательный цикл: прием и обслуживание клиентов по одному
+     */
+    void runSequential();
+    
+    /**
+     * @brief Событийный цикл epoll: все клиенты в одном потоке без блокировок
+     */
+    void runEventLoop();
+    
+    /**
+     * @brief Сопрограммы: сеансы приостанавливаются на готовности сокетов
+     */
+    void runCoroutines();
+    
+    /**
+     * @brief Пул потоков: цикл accept передает клиентов рабочим потокам
+     * @param workers Количество рабочих потоков
+     */
+    void runWorkers(size_t workers);
+    
+    /**
+     * @brief Шарды SO_REUSEPORT: по потоку с собственным циклом epoll на сокет
+     *        (EventLoop или CoroServer при --coro)
+     */
+    void runShards();
+    
+    /**
+     * @brief Тело потока шарда
+     * @param index Номер шарда (определяет ядро для закрепления)
+     * @param fd Слушающий сокет шарда
+     */
+    void runShard(size_t index, int fd);
+    
+    /**
+     * @brief Обслуживание клиента с перехватом ошибок и закрытием сокета
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param client_info Адрес клиента для логирования
+     */
+    void handleClient(int client_fd, const std::string& client_info);
+    
     /**
      * @brief Обслуживание подключенного клиента
      * @param client_fd Файловый дескриптор клиентского сокета
      */
     void serveClient(int client_fd);
 
+    /**
+     * @brief Таймаут простоя сеанса keep-alive между пакетами (--idle-timeout)
+     * @return Таймаут в мс (0 - без таймаута)
+     */
+    int idleTimeoutMs() const;
+
     int listen_fd = -1;              ///< Файловый дескриптор слушающего сокета
+    std::vector<int> shard_fds;      ///< Слушающие сокеты шардов (SO_REUSEPORT)
     ServerParams params;             ///< Параметры конфигурации сервера
     Logger& logger;                  ///< Ссылка на объект логгера
     AuthDB& auth;                    ///< Ссылка на базу данных аутентификации
     std::atomic<bool> running{true}; ///< Флаг работы сервера
+    std::unique_ptr<ParallelSum> compute; ///< Пул параллельного суммирования (--compute-threads)
+    std::unique_ptr<std::counting_semaphore<>> taggedSlots; ///< Места больших заданий с идентификаторами всех сеансов
+    std::unique_ptr<ThreadPool> jobs; ///< Пул заданий сеансов (--pipeline, задания с идентификаторами)
+    std::unique_ptr<SessionTickets> tickets; ///< Билеты возобновления сеанса (--ticket-lifetime)
+    std::unique_ptr<CryptoPool> crypto; ///< Пул проверки паролей (--crypto-threads)
+    std::unique_ptr<RateLimiter> limiter; ///< Отказ злоупотребляющим клиентам (--peer-rate, --login-rate, --heavy-hitter)
 };
 
 #endif
\ No newline at end of file
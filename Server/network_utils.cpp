@@ -1,10 +1,323 @@
 #include "network_utils.h"
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <cerrno>
 #include <cstring>
-#include <iomanip>
-#include <sstream>
+#include <stdexcept>
 #include <unistd.h>
+#include <fcntl.h>
 #include <algorithm>
+#include <atomic>
+#include <immintrin.h>
+
+namespace {
+
+// ====================================================================
+// Шестнадцатеричный кодек: реализации
+// ====================================================================
+
+/// Значение в таблице для символа, не являющегося шестнадцатеричной цифрой
+const unsigned char HEX_INVALID = 0xFF;
+
+/**
+ * @brief Таблица значений шестнадцатеричных цифр по коду символа
+ */
+struct HexTable {
+    unsigned char value[256];
+    
+    constexpr HexTable() : value() {
+        for(int c = 0; c < 256; ++c) {
+            if(c >= '0' && c <= '9')
+                value[c] = static_cast<unsigned char>(c - '0');
+            else if(c >= 'a' && c <= 'f')
+                value[c] = static_cast<unsigned char>(10 + c - 'a');
+            else if(c >= 'A' && c <= 'F')
+                value[c] = static_cast<unsigned char>(10 + c - 'A');
+            else
+                value[c] = HEX_INVALID;
+        }
+    }
+};
+
+constexpr HexTable HEX_TABLE;
+
+/// Цифры для кодирования (верхний регистр)
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/**
+ * @brief Скалярное кодирование: по две цифры на байт
+ * @param data Байты
+ * @param length Количество байт
+ * @param out Буфер (length * 2 символов)
+ */
+void encodeScalar(const unsigned char* data, size_t length, char* out)
+{
+    for(size_t i = 0; i < length; ++i) {
+        out[i * 2] = HEX_DIGITS[data[i] >> 4];
+        out[i * 2 + 1] = HEX_DIGITS[data[i] & 0x0F];
+    }
+}
+
+/**
+ * @brief Скалярное декодирование с проверкой по таблице
+ * @details Недопустимые символы накапливаются в одном флаге без ветвления
+ *          на каждом символе.
+ * @param hex Символы (length * 2)
+ * @param length Количество байт результата
+ * @param out Буфер результата
+ * @return false если встретился недопустимый символ
+ */
+bool decodeScalar(const char* hex, size_t length, unsigned char* out)
+{
+    unsigned char bad = 0;
+    for(size_t i = 0; i < length; ++i) {
+        unsigned char high = HEX_TABLE.value[static_cast<unsigned char>(hex[i * 2])];
+        unsigned char low = HEX_TABLE.value[static_cast<unsigned char>(hex[i * 2 + 1])];
+        bad |= high | low;
+        out[i] = static_cast<unsigned char>((high << 4) | (low & 0x0F));
+    }
+    return (bad & 0xF0) == 0;
+}
+
+/**
+ * @brief Скалярная проверка по таблице
+ * @param str Символы
+ * @param length Количество символов
+ * @return true если все символы - шестнадцатеричные цифры
+ */
+bool validateScalar(const char* str, size_t length)
+{
+    unsigned char bad = 0;
+    for(size_t i = 0; i < length; ++i)
+        bad |= HEX_TABLE.value[static_cast<unsigned char>(str[i])];
+    return (bad & 0xF0) == 0;
+}
+
+/**
+ * @brief Значения 16 шестнадцатеричных цифр и маска допустимых символов
+ * @details Цифра: c - '0' < 10; буква: (c | 0x20) - 'a' < 6 (беззнаковые
+ *          сравнения через PMINUB). Для недопустимых символов значение
+ *          не определено.
+ * @param c Символы
+ * @param valid Маска: 0xFF для допустимых символов
+ * @return Значения цифр (0-15)
+ */
+__attribute__((target("ssse3")))
+inline __m128i hexValuesSsse3(__m128i c, __m128i& valid)
+{
+    const __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+    valid = _mm_or_si128(isDigit, isLetter);
+    return _mm_or_si128(_mm_and_si128(isDigit, d),
+                        _mm_andnot_si128(isDigit, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+/**
+ * @brief Кодирование SSSE3: 16 байт за шаг, цифры выбираются PSHUFB по полубайтам
+ * @param data Байты
+ * @param length Количество байт
+ * @param out Буфер (length * 2 символов)
+ */
+__attribute__((target("ssse3")))
+void encodeSsse3(const unsigned char* data, size_t length, char* out)
+{
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HEX_DIGITS));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for(; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(v, nibble));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+    encodeScalar(data + i, length - i, out + i * 2);
+}
+
+/**
+ * @brief Проверка с декодированием SSSE3: 32 символа (16 байт) за шаг
+ * @details Пары цифр объединяются PMADDUBSW с весами (16, 1), слова
+ *          упаковываются в байты PACKUSWB.
+ * @param hex Символы (length * 2)
+ * @param length Количество байт результата
+ * @param out Буфер результата
+ * @return false если встретился недопустимый символ
+ */
+__attribute__((target("ssse3")))
+bool decodeSsse3(const char* hex, size_t length, unsigned char* out)
+{
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 16 <= length; i += 16) {
+        __m128i ok0, ok1;
+        __m128i v0 = hexValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i * 2)), ok0);
+        __m128i v1 = hexValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i * 2 + 16)), ok1);
+        valid = _mm_and_si128(valid, _mm_and_si128(ok0, ok1));
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(v0, weights), _mm_maddubs_epi16(v1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    if(_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+    return decodeScalar(hex + i * 2, length - i, out + i);
+}
+
+/**
+ * @brief Проверка SSSE3: 16 символов за шаг
+ * @param str Символы
+ * @param length Количество символов
+ * @return true если все символы - шестнадцатеричные цифры
+ */
+__attribute__((target("ssse3")))
+bool validateSsse3(const char* str, size_t length)
+{
+    __m128i valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 16 <= length; i += 16) {
+        __m128i ok;
+        hexValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)), ok);
+        valid = _mm_and_si128(valid, ok);
+    }
+    if(_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+    return validateScalar(str + i, length - i);
+}
+
+/**
+ * @brief Значения 32 шестнадцатеричных цифр и маска допустимых символов (AVX2)
+ * @param c Символы
+ * @param valid Маска: 0xFF для допустимых символов
+ * @return Значения цифр (0-15)
+ * @see hexValuesSsse3()
+ */
+__attribute__((target("avx2")))
+inline __m256i hexValuesAvx2(__m256i c, __m256i& valid)
+{
+    const __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+    valid = _mm256_or_si256(isDigit, isLetter);
+    return _mm256_or_si256(_mm256_and_si256(isDigit, d),
+                           _mm256_andnot_si256(isDigit, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+/**
+ * @brief Кодирование AVX2: 32 байта за шаг, остаток - encodeSsse3()
+ * @details PUNPCKLBW/PUNPCKHBW работают внутри 128-битных половин,
+ *          поэтому половины результата переставляются VPERM2I128.
+ * @param data Байты
+ * @param length Количество байт
+ * @param out Буфер (length * 2 символов)
+ */
+__attribute__((target("avx2")))
+void encodeAvx2(const unsigned char* data, size_t length, char* out)
+{
+    const __m256i digits = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(HEX_DIGITS)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for(; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, nibble));
+        __m256i lo = _mm256_unpacklo_epi8(high, low);
+        __m256i hi = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    encodeSsse3(data + i, length - i, out + i * 2);
+}
+
+/**
+ * @brief Проверка с декодированием AVX2: 64 символа (32 байта) за шаг
+ * @details PACKUSWB упаковывает внутри 128-битных половин; порядок
+ *          восстанавливается VPERMQ. Остаток - decodeSsse3().
+ * @param hex Символы (length * 2)
+ * @param length Количество байт результата
+ * @param out Буфер результата
+ * @return false если встретился недопустимый символ
+ */
+__attribute__((target("avx2")))
+bool decodeAvx2(const char* hex, size_t length, unsigned char* out)
+{
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    __m256i valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 32 <= length; i += 32) {
+        __m256i ok0, ok1;
+        __m256i v0 = hexValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i * 2)), ok0);
+        __m256i v1 = hexValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i * 2 + 32)), ok1);
+        valid = _mm256_and_si256(valid, _mm256_and_si256(ok0, ok1));
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(v0, weights), _mm256_maddubs_epi16(v1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(bytes, 0xD8));
+    }
+    if(_mm256_movemask_epi8(valid) != -1)
+        return false;
+    return decodeSsse3(hex + i * 2, length - i, out + i);
+}
+
+/**
+ * @brief Проверка AVX2: 32 символа за шаг, остаток - validateSsse3()
+ * @param str Символы
+ * @param length Количество символов
+ * @return true если все символы - шестнадцатеричные цифры
+ */
+__attribute__((target("avx2")))
+bool validateAvx2(const char* str, size_t length)
+{
+    __m256i valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 32 <= length; i += 32) {
+        __m256i ok;
+        hexValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i)), ok);
+        valid = _mm256_and_si256(valid, ok);
+    }
+    if(_mm256_movemask_epi8(valid) != -1)
+        return false;
+    return validateSsse3(str + i, length - i);
+}
+
+/**
+ * @brief Реализации кодека одного уровня
+ */
+struct HexCodec {
+    void (*encode)(const unsigned char* data, size_t length, char* out);
+    bool (*decode)(const char* hex, size_t length, unsigned char* out);
+    bool (*validate)(const char* str, size_t length);
+};
+
+const HexCodec SCALAR_CODEC = {encodeScalar, decodeScalar, validateScalar};
+const HexCodec SSSE3_CODEC = {encodeSsse3, decodeSsse3, validateSsse3};
+const HexCodec AVX2_CODEC = {encodeAvx2, decodeAvx2, validateAvx2};
+
+/**
+ * @brief Текущий уровень кодека (инициализируется detectHexLevel() при первом обращении)
+ * @return Ссылка на атомарный уровень
+ */
+std::atomic<NetworkUtils::HexLevel>& currentHexLevel()
+{
+    static std::atomic<NetworkUtils::HexLevel> level{NetworkUtils::detectHexLevel()};
+    return level;
+}
+
+/**
+ * @brief Реализации текущего уровня
+ * @return Ссылка на набор функций
+ */
+const HexCodec& activeCodec()
+{
+    switch(currentHexLevel().load(std::memory_order_relaxed)) {
+    case NetworkUtils::HexLevel::Avx2:  return AVX2_CODEC;
+    case NetworkUtils::HexLevel::Ssse3: return SSSE3_CODEC;
+    case NetworkUtils::HexLevel::Scalar: break;
+    }
+    return SCALAR_CODEC;
+}
+
+}
 
 namespace NetworkUtils {
 
@@ -35,11 +348,52 @@ ssize_t recvAll(int fd, void* buf, size_t len) {
     return static_cast<ssize_t>(len);
 }
 
+/**
+ * @brief Читает и отбрасывает входящие данные без копирования в память процесса
+ * @details Для TCP recv() с флагом MSG_TRUNC удаляет данные из очереди сокета,
+ *          не копируя их в пользовательский буфер. Остальные потоковые сокеты
+ *          (например, AF_UNIX) флаг не поддерживают и возвращают EFAULT, не
+ *          потребляя данных, - для них данные читаются во временный буфер.
+ * @param fd Файловый дескриптор сокета
+ * @param len Максимальное количество байт
+ * @param flags Дополнительные флаги recv() (например, MSG_WAITALL)
+ * @return Количество отброшенных байт, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t recvDiscard(int fd, size_t len, int flags) {
+    ssize_t r = recv(fd, nullptr, len, MSG_TRUNC | flags);
+    if(r == -1 && errno == EFAULT) {
+        thread_local char scratch[64 * 1024];
+        r = recv(fd, scratch, std::min(len, sizeof(scratch)), flags);
+    }
+    return r;
+}
+
+/**
+ * @brief Гарантированно отбрасывает len байт входящих данных
+ * @details Аналог recvAll() для данных, значение которых уже не нужно
+ *          (например, остаток вектора, сумма которого достигла INT32_MAX).
+ * @param fd Файловый дескриптор сокета
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t discardAll(int fd, size_t len) {
+    size_t rem = len;
+    
+    while(rem > 0) {
+        ssize_t r = recvDiscard(fd, rem, MSG_WAITALL);
+        if(r <= 0)
+            return r;
+        rem -= r;
+    }
+    return static_cast<ssize_t>(len);
+}
+
 /**
  * @brief Преобразует массив байт в шестнадцатеричную строку в верхнем регистре
  * @details Каждый байт преобразуется в два шестнадцатеричных символа.
  *          Используется для удобного отображения бинарных данных в логах
  *          и для передачи хэшей в текстовом формате.
+ *          Реализация выбирается по hexLevel().
  * @param data Указатель на массив байт
  * @param length Количество байт для преобразования
  * @return Строка, содержащая шестнадцатеричное представление данных
@@ -47,51 +401,31 @@ ssize_t recvAll(int fd, void* buf, size_t len) {
  *   bytesToHex({0xDE, 0xAD, 0xBE, 0xEF}, 4) -> "DEADBEEF"
  */
 std::string bytesToHex(const unsigned char* data, size_t length) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0') << std::uppercase;
-    for(size_t i = 0; i < length; ++i) {
-        ss << std::setw(2) << static_cast<int>(data[i]);
-    }
-    return ss.str();
+    std::string hex(length * 2, '\0');
+    activeCodec().encode(data, length, hex.data());
+    return hex;
 }
 
 /**
  * @brief Преобразует шестнадцатеричную строку в массив байт
- * @details Выполняет обратное преобразование bytesToHex(). Проверяет корректность
- *          входной строки и соответствие длины выходного буфера.
+ * @details Выполняет обратное преобразование bytesToHex(). Проверка символов
+ *          и декодирование выполняются за один проход по строке, поэтому
+ *          отдельный вызов isValidHex() перед декодированием не нужен.
+ *          Реализация выбирается по hexLevel().
  * @param hex Строка в шестнадцатеричном формате (только символы 0-9, A-F, a-f)
  * @param output Указатель на буфер для записи результата
  * @param output_len Ожидаемая длина выходного буфера в байтах
  * @return true если преобразование успешно выполнено,
  *         false если строка имеет неверный формат или длину
  * @pre Длина hex должна быть равна output_len * 2
- * @post В буфере output будут записаны преобразованные байты
+ * @post В буфере output будут записаны преобразованные байты; при
+ *       неверном символе содержимое output не определено
  */
-bool hexToBytes(const std::string& hex, unsigned char* output, size_t output_len) {
+bool hexToBytes(std::string_view hex, unsigned char* output, size_t output_len) {
     if(hex.length() != output_len * 2) {
         return false;
     }
-    
-    auto hexCharToByte = [](char c) -> unsigned char {
-        if(c >= '0' && c <= '9')
-            return c - '0';
-        if(c >= 'a' && c <= 'f')
-            return 10 + (c - 'a');
-        if(c >= 'A' && c <= 'F')
-            return 10 + (c - 'A');
-        return 0xFF;
-    };
-    
-    for(size_t i = 0; i < output_len; i++) {
-        unsigned char high = hexCharToByte(hex[i * 2]);
-        unsigned char low = hexCharToByte(hex[i * 2 + 1]);
-        if(high == 0xFF || low == 0xFF) {
-            return false;
-        }
-        output[i] = (high << 4) | low;
-    }
-    
-    return true;
+    return activeCodec().decode(hex.data(), output_len, output);
 }
 
 /**
@@ -111,18 +445,15 @@ std::string sockaddrToString(const sockaddr_in& addr) {
 /**
  * @brief Проверяет, является ли строка корректной шестнадцатеричной записью
  * @details Проверяет каждый символ строки на принадлежность к набору
- *          шестнадцатеричных символов (0-9, a-f, A-F).
+ *          шестнадцатеричных символов (0-9, a-f, A-F). Реализация
+ *          выбирается по hexLevel().
  * @param str Проверяемая строка
  * @return true если все символы строки являются шестнадцатеричными,
  *         false в противном случае
  * @note Не проверяет длину строки, только содержание
  */
-bool isValidHex(const std::string& str) {
-    return std::all_of(str.begin(), str.end(), [](char c) {
-        return (c >= '0' && c <= '9') || 
-               (c >= 'a' && c <= 'f') || 
-               (c >= 'A' && c <= 'F');
-    });
+bool isValidHex(std::string_view str) {
+    return activeCodec().validate(str.data(), str.size());
 }
 
 /**
@@ -155,4 +486,65 @@ bool sendNetworkUint32(int fd, uint32_t value) {
     return send(fd, &value, 4, 0) == 4;
 }
 
-} 
\ No newline at end of file
+/**
+ * @brief Переводит сокет в неблокирующий режим
+ * @details Добавляет флаг O_NONBLOCK к флагам файлового дескриптора.
+ *          Используется событийным циклом, где операции чтения и записи
+ *          не должны блокировать поток, обслуживающий множество сеансов.
+ * @param fd Файловый дескриптор сокета
+ * @return true если флаг установлен, false при ошибке fcntl()
+ */
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if(flags == -1)
+        return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+/**
+ * @brief Сбрасывает соединение и закрывает сокет
+ * @details SO_LINGER с нулевым таймаутом: close() отправляет RST вместо
+ *          FIN, сокет не остается в TIME_WAIT. Используется для отказа
+ *          клиенту сразу после accept(), без чтения его данных.
+ * @param fd Файловый дескриптор клиентского сокета
+ */
+void abortConnection(int fd) {
+    linger lg{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(fd);
+}
+
+/**
+ * @brief Определяет старший уровень кодека, поддерживаемый процессором
+ * @return Уровень
+ */
+HexLevel detectHexLevel() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return HexLevel::Avx2;
+    if(__builtin_cpu_supports("ssse3"))
+        return HexLevel::Ssse3;
+    return HexLevel::Scalar;
+}
+
+/**
+ * @brief Возвращает текущий уровень кодека
+ * @return Уровень
+ */
+HexLevel hexLevel() {
+    return currentHexLevel().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Выбирает уровень кодека
+ * @param level Уровень
+ * @return false если уровень не поддерживается процессором
+ */
+bool selectHexLevel(HexLevel level) {
+    if(static_cast<int>(level) > static_cast<int>(detectHexLevel()))
+        return false;
+    currentHexLevel().store(level, std::memory_order_relaxed);
+    return true;
+}
+
+}
\ No newline at end of file
@@ -2,11 +2,23 @@
 #define NETWORK_UTILS_H
 
 #include <string>
+#include <string_view>
 #include <cstddef>
 #include <cstdint>
 #include <netinet/in.h>
 
 namespace NetworkUtils {
+    /**
+     * @brief Уровень набора инструкций шестнадцатеричного кодека
+     * @details Используется bytesToHex(), hexToBytes() и isValidHex();
+     *          выбирается по CPUID при первом обращении.
+     */
+    enum class HexLevel {
+        Scalar, ///< Таблица значений символов
+        Ssse3,  ///< SSSE3 (16 байт за шаг)
+        Avx2    ///< AVX2 (32 байта за шаг)
+    };
+    
     /**
      * @brief Гарантированное чтение всех запрошенных данных из сокета
      * @param fd Файловый дескриптор сокета
@@ -16,6 +28,23 @@ namespace NetworkUtils {
      */
     ssize_t recvAll(int fd, void* buf, size_t len);
     
+    /**
+     * @brief Однократное чтение с отбрасыванием данных без копирования (MSG_TRUNC)
+     * @param fd Файловый дескриптор сокета
+     * @param len Максимальное количество байт
+     * @param flags Дополнительные флаги recv()
+     * @return Количество отброшенных байт, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t recvDiscard(int fd, size_t len, int flags = 0);
+    
+    /**
+     * @brief Гарантированное отбрасывание len байт входящих данных
+     * @param fd Файловый дескриптор сокета
+     * @param len Количество байт
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t discardAll(int fd, size_t len);
+    
     /**
      * @brief Преобразование массива байт в шестнадцатеричную строку
      * @param data Указатель на массив байт
@@ -25,13 +54,13 @@ namespace NetworkUtils {
     std::string bytesToHex(const unsigned char* data, size_t length);
     
     /**
-     * @brief Преобразование шестнадцатеричной строки в массив байт
+     * @brief Преобразование шестнадцатеричной строки в массив байт (проверка и декодирование за один проход)
      * @param hex Строка в шестнадцатеричном формате
      * @param output Указатель на буфер для записи результата
      * @param output_len Ожидаемая длина выходного буфера в байтах
      * @return true если преобразование успешно, false в противном случае
      */
-    bool hexToBytes(const std::string& hex, unsigned char* output, size_t output_len);
+    bool hexToBytes(std::string_view hex, unsigned char* output, size_t output_len);
     
     /**
      * @brief Преобразование структуры sockaddr_in в строку формата "IP:PORT"
@@ -45,7 +74,7 @@ namespace NetworkUtils {
      * @param str Проверяемая строка
      * @return true если строка содержит только шестнадцатеричные символы, false в противном случае
      */
-    bool isValidHex(const std::string& str);
+    bool isValidHex(std::string_view str);
     
     /**
      * @brief Чтение 32-битного беззнакового целого в сетевом порядке байт
@@ -62,6 +91,36 @@ namespace NetworkUtils {
      * @return true если отправлено успешно, false в противном случае
      */
     bool sendNetworkUint32(int fd, uint32_t value);
+    
+    /**
+     * @brief Перевод сокета в неблокирующий режим
+     * @param fd Файловый дескриптор сокета
+     * @return true если режим установлен, false в противном случае
+     */
+    bool setNonBlocking(int fd);
+    
+    /**
+     * @brief Сброс соединения (RST) и закрытие сокета
+     * @param fd Файловый дескриптор клиентского сокета
+     */
+    void abortConnection(int fd);
+    
+    /**
+     * @brief Старший уровень кодека, поддерживаемый процессором
+     */
+    HexLevel detectHexLevel();
+    
+    /**
+     * @brief Текущий уровень кодека (по умолчанию detectHexLevel())
+     */
+    HexLevel hexLevel();
+    
+    /**
+     * @brief Принудительный выбор уровня кодека (для тестов и сравнения реализаций)
+     * @param level Уровень
+     * @return false если уровень не поддерживается (выбор не меняется)
+     */
+    bool selectHexLevel(HexLevel level);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "parallel_sum.h"
+#include "vector_processor.h"
+#include "sum_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Создает пул вычислительных потоков
+ * @param threads Количество потоков (не менее 1)
+ */
+ParallelSum::ParallelSum(size_t threads)
+    : pool(threads)
+{
+}
+
+/**
+ * @brief Суммирует вектор с ограничением, при необходимости параллельно
+ * @details Векторы короче SumThresholds::parallel_min суммируются
+ *          в вызывающем потоке (VectorProcessor::sumClamp()).
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма в диапазоне [0, 2^31-1]
+ */
+int32_t ParallelSum::sumClamp(const uint32_t* data, size_t count)
+{
+    if(VectorProcessor::strategy(count, true) != SumStrategy::Parallel)
+        return VectorProcessor::sumClamp(data, count);
+    return sumParallel(data, count);
+}
+
+/**
+ * @brief Суммирует вектор с ограничением на всех потоках пула
+ * @details Диапазоны выровнены по VectorProcessor::SUM_BLOCK; последний
+ *          диапазон суммирует вызывающий поток, остальные - потоки пула.
+ *          После каждого блока его сумма добавляется к общему итогу;
+ *          поток, чей вклад перевел итог через INT32_MAX, поднимает флаг
+ *          остановки, который остальные проверяют перед следующим блоком.
+ *          Итог 64-битный: сумма 10^7 элементов uint32_t не переполняет его.
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма в диапазоне [0, 2^31-1]
+ */
+int32_t ParallelSum::sumParallel(const uint32_t* data, size_t count)
+{
+    const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int32_t>::max());
+    const size_t block = VectorProcessor::SUM_BLOCK;
+    const size_t parts = pool.size() + 1;
+    const size_t blocks = (count + block - 1) / block;
+    const size_t per_part = (blocks + parts - 1) / parts * block;
+
+    std::atomic<uint64_t> total{0};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> summed{0};
+    SumKernels::Kernel kernel = SumKernels::activeKernel();
+
+    auto sumRange = [&](size_t begin, size_t end) {
+        size_t done = 0;
+        for(size_t i = begin; i < end && !stop.load(std::memory_order_relaxed); i += block) {
+            uint64_t part = kernel(data + i, std::min(block, end - i));
+            ++done;
+            if(total.fetch_add(part, std::memory_order_relaxed) + part > limit) {
+                stop.store(true, std::memory_order_relaxed);
+                break;
+            }
+        }
+        summed.fetch_add(done, std::memory_order_relaxed);
+    };
+
+    std::vector<std::future<void>> helpers;
+    for(size_t p = 0; p + 1 < parts && p * per_part < count; ++p) {
+        size_t begin = p * per_part;
+        size_t end = std::min(begin + per_part, count);
+        auto task = std::make_shared<std::packaged_task<void()>>([&sumRange, begin, end] {
+            sumRange(begin, end);
+        });
+        helpers.push_back(task->get_future());
+        pool.submit([task] { (*task)(); });
+    }
+
+    size_t own = (parts - 1) * per_part;
+    if(own < count)
+        sumRange(own, count);
+    for(auto& f : helpers)
+        f.get();
+
+    last_blocks.store(summed.load(), std::memory_order_relaxed);
+    uint64_t sum = total.load();
+    return sum > limit ? std::numeric_limits<int32_t>::max() : static_cast<int32_t>(sum);
+}
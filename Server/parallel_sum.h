@@ -0,0 +1,66 @@
+#ifndef PARALLEL_SUM_H
+#define PARALLEL_SUM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "thread_pool.h"
+
+/**
+ * @class ParallelSum
+ * @brief Параллельное суммирование больших векторов на пуле вычислительных потоков
+ * @details Вектор от порога SumThresholds::parallel_min (по умолчанию 1M
+ *          элементов, уточняется калибровкой SumTuning) делится на диапазоны по
+ *          числу потоков (плюс вызывающий поток). Каждый диапазон
+ *          суммируется блоками VectorProcessor::SUM_BLOCK; частичные суммы
+ *          блоков добавляются в общий атомарный итог. Как только итог
+ *          превышает INT32_MAX, результат известен (элементы
+ *          неотрицательны) и все потоки прекращают работу после текущего
+ *          блока. Векторы меньше порога суммируются в вызывающем потоке.
+ * @note Пул может использоваться несколькими сеансами одновременно: задачи
+ *       не ждут друг друга, поэтому взаимоблокировка невозможна
+ */
+class ParallelSum {
+public:
+    /**
+     * @brief Конструктор
+     * @param threads Количество вычислительных потоков (не менее 1)
+     */
+    explicit ParallelSum(size_t threads);
+
+    ParallelSum(const ParallelSum&) = delete;
+    ParallelSum& operator=(const ParallelSum&) = delete;
+
+    /**
+     * @brief Сумма с ограничением (результат совпадает с VectorProcessor::sumClamp())
+     * @param data Элементы
+     * @param count Количество элементов
+     * @return Сумма в диапазоне [0, 2^31-1]
+     */
+    int32_t sumClamp(const uint32_t* data, size_t count);
+
+    /**
+     * @brief Параллельное суммирование без проверки порога (для калибровки)
+     * @param data Элементы
+     * @param count Количество элементов
+     * @return Сумма в диапазоне [0, 2^31-1]
+     */
+    int32_t sumParallel(const uint32_t* data, size_t count);
+
+    /**
+     * @brief Количество вычислительных потоков
+     */
+    size_t threads() const { return pool.size(); }
+
+    /**
+     * @brief Количество блоков, просуммированных последним вызовом sumClamp()
+     *        (для проверки досрочной остановки)
+     */
+    size_t lastBlocks() const { return last_blocks.load(std::memory_order_relaxed); }
+
+private:
+    ThreadPool pool;                    ///< Вычислительные потоки
+    std::atomic<size_t> last_blocks{0}; ///< Блоков в последнем параллельном суммировании
+};
+
+#endif
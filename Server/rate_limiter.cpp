@@ -0,0 +1,300 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace {
+
+/// Бит TAT в слове корзины
+const unsigned TAT_BITS = 64 - TokenBuckets::TAG_BITS;
+/// Маска TAT в слове корзины
+const uint64_t TAT_MASK = (uint64_t(1) << TAT_BITS) - 1;
+
+/**
+ * @brief Перемешивание 64-битного значения (финализатор splitmix64)
+ * @param x Исходное значение
+ * @return Хэш
+ */
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Хэш строки словами по 8 байт
+ * @param data Строка
+ * @param seed Начальное значение
+ * @return Хэш
+ */
+uint64_t hashBytes(std::string_view data, uint64_t seed) {
+    uint64_t h = seed ^ (data.size() * 0x9E3779B97F4A7C15ULL);
+    size_t i = 0;
+    for(; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = mix64(h ^ word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data.data() + i, data.size() - i);
+    return mix64(h ^ tail);
+}
+
+/**
+ * @brief Время в мкс от начала отсчета
+ * @param epoch Начало отсчета
+ * @param now Текущее время
+ * @return Мкс (0, если now раньше epoch)
+ */
+uint64_t micros(std::chrono::steady_clock::time_point epoch, std::chrono::steady_clock::time_point now) {
+    if(now <= epoch)
+        return 0;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - epoch).count());
+}
+
+/**
+ * @brief Округление вверх до степени двойки
+ * @param n Значение
+ * @return Степень двойки не меньше n (не меньше 1)
+ */
+size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+}
+
+// ====================================================================
+// TokenBuckets
+// ====================================================================
+
+/**
+ * @brief Создает таблицу со свободными корзинами
+ * @param rate Пополнение корзины, попыток в секунду
+ * @param burst Емкость корзины, попыток
+ * @param sets Количество наборов
+ */
+TokenBuckets::TokenBuckets(double rate, double burst, size_t sets)
+    : epoch_(Clock::now())
+    , interval_(std::max<uint64_t>(1, static_cast<uint64_t>(1e6 / rate)))
+    , tolerance_(static_cast<uint64_t>(static_cast<double>(interval_) * (std::max(burst, 1.0) - 1.0)))
+    , mask_(roundUpPow2(sets) - 1)
+    , sets_(new Set[mask_ + 1])
+{
+    for(size_t s = 0; s <= mask_; ++s)
+        for(std::atomic<uint64_t>& slot : sets_[s].slot)
+            slot.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Берет маркер из корзины ключа
+ * @details Набор просматривается целиком: корзина с тегом ключа, иначе
+ *          свободное слово или корзина с наименьшим TAT. Обновление - один
+ *          compare_exchange; при гонке с другим потоком набор
+ *          просматривается заново.
+ * @param key Хэш ключа
+ * @param now Текущее время
+ * @return true если маркер взят
+ */
+bool TokenBuckets::admit(uint64_t key, Clock::time_point now)
+{
+    uint64_t t = micros(epoch_, now);
+    Set& set = sets_[key & mask_];
+    uint64_t tag = key >> TAT_BITS;
+    if(tag == 0)
+        tag = 1;
+
+    while(true) {
+        size_t slot = 0;
+        uint64_t expected = 0;
+        uint64_t tat = std::numeric_limits<uint64_t>::max();
+        bool found = false;
+        for(size_t i = 0; i < WAYS; ++i) {
+            uint64_t word = set.slot[i].load(std::memory_order_acquire);
+            if((word >> TAT_BITS) == tag) {
+                slot = i;
+                expected = word;
+                tat = word & TAT_MASK;
+                found = true;
+                break;
+            }
+            uint64_t word_tat = word == 0 ? 0 : (word & TAT_MASK);
+            if(word_tat < tat) {
+                slot = i;
+                expected = word;
+                tat = word_tat;
+            }
+        }
+        if(!found)
+            tat = 0;
+        else if(tat > t + tolerance_)
+            return false;
+
+        uint64_t next = std::max(tat, t) + interval_;
+        if(set.slot[slot].compare_exchange_weak(expected, (tag << TAT_BITS) | (next & TAT_MASK),
+                                                std::memory_order_acq_rel, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+// ====================================================================
+// CountMinSketch
+// ====================================================================
+
+/**
+ * @brief Создает счетчик с нулевыми счетчиками
+ * @param width Счетчиков в строке
+ * @param window Период деления счетчиков пополам
+ */
+CountMinSketch::CountMinSketch(size_t width, std::chrono::milliseconds window)
+    : epoch_(Clock::now())
+    , window_(std::chrono::duration_cast<std::chrono::microseconds>(window).count())
+    , width_(roundUpPow2(width))
+    , counters_(new std::atomic<uint32_t>[DEPTH * width_])
+    , next_decay_(window_)
+{
+    for(size_t i = 0; i < DEPTH * width_; ++i)
+        counters_[i].store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Номер счетчика ключа в строке
+ * @details Двойное хэширование: половины хэша ключа дают начало и шаг,
+ *          строка row использует h1 + row * h2.
+ * @param key Хэш ключа
+ * @param row Номер строки
+ * @return Индекс в counters_
+ */
+size_t CountMinSketch::index(uint64_t key, size_t row) const
+{
+    uint32_t h1 = static_cast<uint32_t>(key);
+    uint32_t h2 = static_cast<uint32_t>(key >> 32) | 1;
+    return row * width_ + ((h1 + row * h2) & (width_ - 1));
+}
+
+/**
+ * @brief Учитывает событие ключа
+ * @param key Хэш ключа
+ * @param now Текущее время
+ * @return Минимум увеличенных счетчиков
+ */
+uint32_t CountMinSketch::add(uint64_t key, Clock::time_point now)
+{
+    decay(now);
+    uint32_t estimate = std::numeric_limits<uint32_t>::max();
+    for(size_t row = 0; row < DEPTH; ++row) {
+        uint32_t value = counters_[index(key, row)].fetch_add(1, std::memory_order_relaxed) + 1;
+        estimate = std::min(estimate, value);
+    }
+    return estimate;
+}
+
+/**
+ * @brief Оценивает число событий ключа
+ * @param key Хэш ключа
+ * @return Минимум счетчиков ключа
+ */
+uint32_t CountMinSketch::estimate(uint64_t key) const
+{
+    uint32_t estimate = std::numeric_limits<uint32_t>::max();
+    for(size_t row = 0; row < DEPTH; ++row)
+        estimate = std::min(estimate, counters_[index(key, row)].load(std::memory_order_relaxed));
+    return estimate;
+}
+
+/**
+ * @brief Делит счетчики пополам за каждое истекшее окно
+ * @details После простоя в k окон счетчики сдвигаются вправо на k бит
+ *          (при k >= 32 обнуляются), как если бы деление выполнялось в
+ *          каждом окне. Деление выполняет один поток - выигравший
+ *          compare_exchange времени следующего деления. Счетчик уменьшается
+ *          вычитанием, поэтому события, учтенные во время прохода, не теряются.
+ * @param now Текущее время
+ */
+void CountMinSketch::decay(Clock::time_point now)
+{
+    int64_t t = static_cast<int64_t>(micros(epoch_, now));
+    int64_t next = next_decay_.load(std::memory_order_relaxed);
+    if(t < next)
+        return;
+    int64_t windows = 1 + (t - next) / window_;
+    if(!next_decay_.compare_exchange_strong(next, next + windows * window_, std::memory_order_relaxed))
+        return;
+    unsigned shift = static_cast<unsigned>(std::min<int64_t>(windows, 32));
+    for(size_t i = 0; i < DEPTH * width_; ++i) {
+        uint32_t value = counters_[i].load(std::memory_order_relaxed);
+        if(value != 0)
+            counters_[i].fetch_sub(value - (shift >= 32 ? 0 : value >> shift), std::memory_order_relaxed);
+    }
+}
+
+// ====================================================================
+// RateLimiter
+// ====================================================================
+
+/**
+ * @brief Создает включенные проверки
+ * @details Емкость корзины - BURST_SECONDS секунд пополнения, но не меньше
+ *          одной попытки. Хэш ключей начинается со случайного значения:
+ *          клиент не может подобрать адреса или логины, попадающие
+ *          в один набор корзин или в одни счетчики.
+ * @param peer_rate Подключений в секунду с адреса (0 - без ограничения)
+ * @param login_rate Попыток входа в секунду на логин (0 - без ограничения)
+ * @param heavy_hitter Порог частого адреса за окно (0 - без ограничения)
+ */
+RateLimiter::RateLimiter(double peer_rate, double login_rate, uint32_t heavy_hitter)
+    : heavy_hitter_(heavy_hitter)
+{
+    std::random_device rd;
+    seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+    if(peer_rate > 0)
+        peers_.reset(new TokenBuckets(peer_rate, std::max(1.0, peer_rate * BURST_SECONDS), BUCKET_SETS));
+    if(login_rate > 0)
+        logins_.reset(new TokenBuckets(login_rate, std::max(1.0, login_rate * BURST_SECONDS), BUCKET_SETS));
+    if(heavy_hitter > 0)
+        heavy_.reset(new CountMinSketch(SKETCH_WIDTH, std::chrono::milliseconds(HEAVY_WINDOW_MS)));
+}
+
+/**
+ * @brief Проверяет подключение по адресу клиента
+ * @details Частота адреса учитывается и для отклоненных подключений:
+ *          клиент, продолжающий попытки, остается частым.
+ * @param addr Адрес клиента из accept()
+ * @param now Текущее время
+ * @return true если подключение допускается
+ */
+bool RateLimiter::admitPeer(const sockaddr_in& addr, Clock::time_point now)
+{
+    if(!peers_ && !heavy_)
+        return true;
+    uint64_t key = mix64(seed_ ^ addr.sin_addr.s_addr);
+    if(heavy_ && heavy_->add(key, now) > heavy_hitter_) {
+        rejected_heavy_.fetch_add(1, std::memory_order_relaxed);
+        rejected_peers_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if(peers_ && !peers_->admit(key, now)) {
+        rejected_peers_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Проверяет попытку входа по логину
+ * @param login Логин из данных аутентификации
+ * @param now Текущее время
+ * @return true если попытка допускается
+ */
+bool RateLimiter::admitLogin(std::string_view login, Clock::time_point now)
+{
+    if(!logins_ || logins_->admit(hashBytes(login, seed_), now))
+        return true;
+    rejected_logins_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
@@ -0,0 +1,206 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <netinet/in.h>
+
+/**
+ * @class TokenBuckets
+ * @brief Таблица корзин маркеров по ключам без блокировок
+ * @details Корзина хранится в форме GCRA: одно 64-битное слово с тегом ключа
+ *          (TAG_BITS) и теоретическим временем прибытия TAT в мкс от
+ *          создания таблицы. Попытка допускается, если now >= TAT - tau,
+ *          где T = 1 / rate - интервал пополнения, tau = T * (burst - 1) -
+ *          допуск всплеска; новое TAT = max(TAT, now) + T записывается
+ *          через compare_exchange. Отклоненная попытка корзину не тратит.
+ *          Ключ попадает в набор из WAYS слов одной строки кэша; при
+ *          переполнении набора вытесняется корзина с наименьшим TAT
+ *          (давно наполненная корзина неотличима от новой).
+ */
+class TokenBuckets {
+public:
+    /// Корзин в наборе (одна строка кэша)
+    static constexpr size_t WAYS = 8;
+    /// Бит тега ключа в слове корзины (остальные - TAT в мкс, около 8 лет)
+    static constexpr unsigned TAG_BITS = 16;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Конструктор таблицы
+     * @param rate Пополнение корзины, попыток в секунду (больше нуля)
+     * @param burst Емкость корзины, попыток (не меньше 1)
+     * @param sets Количество наборов (округляется вверх до степени двойки)
+     */
+    TokenBuckets(double rate, double burst, size_t sets);
+
+    TokenBuckets(const TokenBuckets&) = delete;
+    TokenBuckets& operator=(const TokenBuckets&) = delete;
+
+    /**
+     * @brief Попытка взять маркер из корзины ключа
+     * @param key Хэш ключа
+     * @param now Текущее время
+     * @return true если маркер взят, false если корзина пуста
+     */
+    bool admit(uint64_t key, Clock::time_point now = Clock::now());
+
+private:
+    /**
+     * @brief Набор корзин в одной строке кэша
+     */
+    struct alignas(64) Set {
+        std::atomic<uint64_t> slot[WAYS]; ///< Слова корзин (0 - свободно)
+    };
+
+    Clock::time_point epoch_;     ///< Начало отсчета TAT
+    uint64_t interval_;           ///< Интервал пополнения T, мкс
+    uint64_t tolerance_;          ///< Допуск всплеска tau, мкс
+    size_t mask_;                 ///< Маска номера набора
+    std::unique_ptr<Set[]> sets_; ///< Наборы корзин
+};
+
+/**
+ * @class CountMinSketch
+ * @brief Счетчик частых ключей (count-min sketch) без блокировок
+ * @details DEPTH строк по width атомарных счетчиков; ключ увеличивает по
+ *          одному счетчику в каждой строке, оценка - минимум из них (не
+ *          меньше истинного числа событий). Раз в окно счетчики делятся
+ *          пополам потоком, выигравшим compare_exchange времени следующего
+ *          деления, поэтому оценка отражает недавнюю частоту.
+ */
+class CountMinSketch {
+public:
+    /// Строк счетчиков
+    static constexpr size_t DEPTH = 4;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Конструктор счетчика
+     * @param width Счетчиков в строке (округляется вверх до степени двойки)
+     * @param window Период деления счетчиков пополам
+     */
+    CountMinSketch(size_t width, std::chrono::milliseconds window);
+
+    CountMinSketch(const CountMinSketch&) = delete;
+    CountMinSketch& operator=(const CountMinSketch&) = delete;
+
+    /**
+     * @brief Учет события ключа
+     * @param key Хэш ключа
+     * @param now Текущее время
+     * @return Оценка числа событий ключа с учетом этого
+     */
+    uint32_t add(uint64_t key, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Оценка числа событий ключа
+     * @param key Хэш ключа
+     * @return Минимум счетчиков ключа
+     */
+    uint32_t estimate(uint64_t key) const;
+
+private:
+    /**
+     * @brief Деление счетчиков пополам за каждое истекшее окно
+     * @param now Текущее время
+     */
+    void decay(Clock::time_point now);
+
+    /**
+     * @brief Номер счетчика ключа в строке
+     * @param key Хэш ключа
+     * @param row Номер строки
+     * @return Индекс в counters_
+     */
+    size_t index(uint64_t key, size_t row) const;
+
+    Clock::time_point epoch_;          ///< Начало отсчета времени деления
+    int64_t window_;                   ///< Период деления, мкс
+    size_t width_;                     ///< Счетчиков в строке
+    std::unique_ptr<std::atomic<uint32_t>[]> counters_; ///< DEPTH * width_ счетчиков
+    std::atomic<int64_t> next_decay_;  ///< Время следующего деления, мкс от epoch_
+};
+
+/**
+ * @class RateLimiter
+ * @brief Отказ злоупотребляющим клиентам до чтения и хэширования
+ * @details Подключение проверяется сразу после accept(), по адресу из
+ *          sockaddr_in (без порта и без форматирования строки): сначала
+ *          счетчик частых адресов CountMinSketch, затем корзина адреса.
+ *          Попытка входа проверяется корзиной логина после разбора данных
+ *          аутентификации, до поиска в AuthDB и SHA224. Один объект
+ *          используется всеми потоками сервера; отказы не логируются
+ *          по одному, а только считаются.
+ */
+class RateLimiter {
+public:
+    /// Наборов в таблицах корзин (по TokenBuckets::WAYS корзин)
+    static constexpr size_t BUCKET_SETS = 4096;
+    /// Счетчиков в строке CountMinSketch
+    static constexpr size_t SKETCH_WIDTH = 2048;
+    /// Окно счетчика частых адресов, мс
+    static constexpr int HEAVY_WINDOW_MS = 10000;
+    /// Емкость корзины в секундах пополнения (не меньше одной попытки)
+    static constexpr double BURST_SECONDS = 2.0;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Конструктор
+     * @param peer_rate Подключений в секунду с адреса (0 - без ограничения)
+     * @param login_rate Попыток входа в секунду на логин (0 - без ограничения)
+     * @param heavy_hitter Подключений с адреса за окно HEAVY_WINDOW_MS,
+     *        после которых адрес отклоняется (0 - без ограничения)
+     */
+    RateLimiter(double peer_rate, double login_rate, uint32_t heavy_hitter);
+
+    /**
+     * @brief Проверка подключения
+     * @param addr Адрес клиента из accept()
+     * @param now Текущее время
+     * @return true если подключение допускается
+     */
+    bool admitPeer(const sockaddr_in& addr, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Проверка попытки входа
+     * @param login Логин из данных аутентификации
+     * @param now Текущее время
+     * @return true если попытка допускается
+     */
+    bool admitLogin(std::string_view login, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Отклонено подключений (всего, включая частые адреса)
+     */
+    uint64_t rejectedPeers() const { return rejected_peers_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Отклонено подключений частых адресов
+     */
+    uint64_t rejectedHeavy() const { return rejected_heavy_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Отклонено попыток входа
+     */
+    uint64_t rejectedLogins() const { return rejected_logins_.load(std::memory_order_relaxed); }
+
+private:
+    uint64_t seed_;                         ///< Случайное начало хэша ключей
+    uint32_t heavy_hitter_;                 ///< Порог частого адреса (0 - выключен)
+    std::unique_ptr<TokenBuckets> peers_;   ///< Корзины адресов (может отсутствовать)
+    std::unique_ptr<TokenBuckets> logins_;  ///< Корзины логинов (может отсутствовать)
+    std::unique_ptr<CountMinSketch> heavy_; ///< Счетчик частых адресов (может отсутствовать)
+    std::atomic<uint64_t> rejected_peers_{0};  ///< Отклонено подключений
+    std::atomic<uint64_t> rejected_heavy_{0};  ///< Отклонено подключений частых адресов
+    std::atomic<uint64_t> rejected_logins_{0}; ///< Отклонено попыток входа
+};
+
+#endif
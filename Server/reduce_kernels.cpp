@@ -0,0 +1,399 @@
+#include "reduce_kernels.h"
+
+#include <algorithm>
+#include <immintrin.h>
+
+using ReduceKernels::Stats;
+using ReduceKernels::DotSums;
+using ReduceKernels::HISTOGRAM_BINS;
+
+namespace {
+
+// ====================================================================
+// Статистика: сумма, минимум, максимум, нули
+// ====================================================================
+
+/**
+ * @brief Скалярное ядро статистики
+ * @param keys Ключи
+ * @param count Количество ключей
+ * @param zero Ключ, соответствующий нулевому элементу
+ * @param acc Накопители
+ */
+void statsScalar(const uint32_t* keys, size_t count, uint32_t zero, Stats& acc)
+{
+    uint64_t sum = 0, zeros = 0;
+    uint32_t lo = acc.min, hi = acc.max;
+    for(size_t i = 0; i < count; ++i) {
+        uint32_t k = keys[i];
+        sum += k;
+        lo = std::min(lo, k);
+        hi = std::max(hi, k);
+        zeros += k == zero;
+    }
+    acc.sum += sum;
+    acc.min = lo;
+    acc.max = hi;
+    acc.zeros += zeros;
+}
+
+/**
+ * @brief Свертка линий минимума, максимума и счетчика нулей
+ * @param mins Минимумы линий
+ * @param maxs Максимумы линий
+ * @param zeros Счетчики нулей линий
+ * @param lanes Количество линий
+ * @param acc Накопители
+ */
+void mergeLanes(const uint32_t* mins, const uint32_t* maxs, const uint32_t* zeros,
+                size_t lanes, Stats& acc)
+{
+    for(size_t l = 0; l < lanes; ++l) {
+        acc.min = std::min(acc.min, mins[l]);
+        acc.max = std::max(acc.max, maxs[l]);
+        acc.zeros += zeros[l];
+    }
+}
+
+/**
+ * @brief Ядро статистики SSE4.2: по 4 ключа
+ * @details Сумма - как в SumKernels (расширение до 64 бит чередованием
+ *          с нулями), минимум и максимум - PMINUD/PMAXUD, нули считаются
+ *          вычитанием маски сравнения (-1) из 32-битных счетчиков линий.
+ * @param keys Ключи (меньше 2^34 штук)
+ * @param count Количество ключей
+ * @param zero Ключ, соответствующий нулевому элементу
+ * @param acc Накопители
+ */
+__attribute__((target("sse4.2")))
+void statsSse42(const uint32_t* keys, size_t count, uint32_t zero, Stats& acc)
+{
+    const __m128i nil = _mm_setzero_si128();
+    const __m128i z = _mm_set1_epi32(static_cast<int>(zero));
+    __m128i sum0 = nil, sum1 = nil, zeros = nil;
+    __m128i lo = _mm_set1_epi32(-1), hi = nil;
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        sum0 = _mm_add_epi64(sum0, _mm_unpacklo_epi32(v, nil));
+        sum1 = _mm_add_epi64(sum1, _mm_unpackhi_epi32(v, nil));
+        lo = _mm_min_epu32(lo, v);
+        hi = _mm_max_epu32(hi, v);
+        zeros = _mm_sub_epi32(zeros, _mm_cmpeq_epi32(v, z));
+    }
+    __m128i sum = _mm_add_epi64(sum0, sum1);
+    acc.sum += static_cast<uint64_t>(_mm_cvtsi128_si64(sum)) +
+               static_cast<uint64_t>(_mm_extract_epi64(sum, 1));
+    alignas(16) uint32_t mins[4], maxs[4], counts[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), lo);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), hi);
+    _mm_store_si128(reinterpret_cast<__m128i*>(counts), zeros);
+    if(i > 0)
+        mergeLanes(mins, maxs, counts, 4, acc);
+    statsScalar(keys + i, count - i, zero, acc);
+}
+
+/**
+ * @brief Ядро статистики AVX2: по 8 ключей
+ * @param keys Ключи (меньше 2^35 штук)
+ * @param count Количество ключей
+ * @param zero Ключ, соответствующий нулевому элементу
+ * @param acc Накопители
+ */
+__attribute__((target("avx2")))
+void statsAvx2(const uint32_t* keys, size_t count, uint32_t zero, Stats& acc)
+{
+    const __m256i nil = _mm256_setzero_si256();
+    const __m256i z = _mm256_set1_epi32(static_cast<int>(zero));
+    __m256i sum0 = nil, sum1 = nil, zeros = nil;
+    __m256i lo = _mm256_set1_epi32(-1), hi = nil;
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        sum0 = _mm256_add_epi64(sum0, _mm256_unpacklo_epi32(v, nil));
+        sum1 = _mm256_add_epi64(sum1, _mm256_unpackhi_epi32(v, nil));
+        lo = _mm256_min_epu32(lo, v);
+        hi = _mm256_max_epu32(hi, v);
+        zeros = _mm256_sub_epi32(zeros, _mm256_cmpeq_epi32(v, z));
+    }
+    __m256i sum = _mm256_add_epi64(sum0, sum1);
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    acc.sum += static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+               static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    alignas(32) uint32_t mins[8], maxs[8], counts[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), hi);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(counts), zeros);
+    if(i > 0)
+        mergeLanes(mins, maxs, counts, 8, acc);
+    statsScalar(keys + i, count - i, zero, acc);
+}
+
+/**
+ * @brief Ядро статистики AVX-512F: по 16 ключей
+ * @details Нули считаются по маске сравнения (POPCNT). Как и в SumKernels,
+ *          используются формы с полной маской.
+ * @param keys Ключи
+ * @param count Количество ключей
+ * @param zero Ключ, соответствующий нулевому элементу
+ * @param acc Накопители
+ */
+__attribute__((target("avx512f,popcnt")))
+void statsAvx512(const uint32_t* keys, size_t count, uint32_t zero, Stats& acc)
+{
+    const __mmask16 ALL_LANES = 0xFFFF;
+    const __m512i nil = _mm512_setzero_si512();
+    const __m512i z = _mm512_set1_epi32(static_cast<int>(zero));
+    __m512i sum0 = nil, sum1 = nil;
+    __m512i lo = _mm512_set1_epi32(-1), hi = nil;
+    uint64_t zeros = 0;
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m512i v = _mm512_loadu_si512(keys + i);
+        sum0 = _mm512_add_epi64(sum0, _mm512_maskz_unpacklo_epi32(ALL_LANES, v, nil));
+        sum1 = _mm512_add_epi64(sum1, _mm512_maskz_unpackhi_epi32(ALL_LANES, v, nil));
+        lo = _mm512_maskz_min_epu32(ALL_LANES, lo, v);
+        hi = _mm512_maskz_max_epu32(ALL_LANES, hi, v);
+        zeros += static_cast<uint64_t>(__builtin_popcount(_mm512_cmpeq_epu32_mask(v, z)));
+    }
+    alignas(64) uint64_t sums[8];
+    _mm512_store_si512(sums, _mm512_add_epi64(sum0, sum1));
+    for(uint64_t s : sums)
+        acc.sum += s;
+    alignas(64) uint32_t mins[16], maxs[16];
+    const uint32_t counts[16] = {};
+    _mm512_store_si512(mins, lo);
+    _mm512_store_si512(maxs, hi);
+    if(i > 0) {
+        mergeLanes(mins, maxs, counts, 16, acc);
+        acc.zeros += zeros;
+    }
+    statsScalar(keys + i, count - i, zero, acc);
+}
+
+// ====================================================================
+// Скалярное произведение пар
+// ====================================================================
+
+/// Младшие 32 бита 64-битной линии
+const uint64_t LOW_HALF = 0xFFFFFFFFu;
+
+/**
+ * @brief Скалярное ядро скалярного произведения
+ * @param keys Пары ключей подряд
+ * @param pairs Количество пар
+ * @param acc Накопители
+ */
+void dotScalar(const uint32_t* keys, size_t pairs, DotSums& acc)
+{
+    for(size_t i = 0; i < pairs; ++i) {
+        uint64_t a = keys[2 * i], b = keys[2 * i + 1];
+        uint64_t p = a * b;
+        acc.lo += p & LOW_HALF;
+        acc.hi += p >> 32;
+        acc.even += a;
+        acc.odd += b;
+    }
+}
+
+/**
+ * @brief Ядро скалярного произведения SSE4.2: по 2 пары
+ * @details Пара занимает 64-битную линию: первый элемент - младшая
+ *          половина, второй - старшая. PMULUDQ перемножает младшие
+ *          половины линий, поэтому произведение пары - один PMULUDQ
+ *          ключей на те же ключи, сдвинутые на 32 бита.
+ * @param keys Пары ключей подряд
+ * @param pairs Количество пар
+ * @param acc Накопители
+ */
+__attribute__((target("sse4.2")))
+void dotSse42(const uint32_t* keys, size_t pairs, DotSums& acc)
+{
+    const __m128i low = _mm_set1_epi64x(static_cast<long long>(LOW_HALF));
+    __m128i lo = _mm_setzero_si128(), hi = lo, even = lo, odd = lo;
+    size_t i = 0;
+    for(; i + 2 <= pairs; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + 2 * i));
+        __m128i b = _mm_srli_epi64(v, 32);
+        __m128i p = _mm_mul_epu32(v, b);
+        lo = _mm_add_epi64(lo, _mm_and_si128(p, low));
+        hi = _mm_add_epi64(hi, _mm_srli_epi64(p, 32));
+        even = _mm_add_epi64(even, _mm_and_si128(v, low));
+        odd = _mm_add_epi64(odd, b);
+    }
+    alignas(16) uint64_t lanes[4][2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), lo);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), hi);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), even);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[3]), odd);
+    acc.lo += lanes[0][0] + lanes[0][1];
+    acc.hi += lanes[1][0] + lanes[1][1];
+    acc.even += lanes[2][0] + lanes[2][1];
+    acc.odd += lanes[3][0] + lanes[3][1];
+    dotScalar(keys + 2 * i, pairs - i, acc);
+}
+
+/**
+ * @brief Ядро скалярного произведения AVX2: по 4 пары
+ * @param keys Пары ключей подряд
+ * @param pairs Количество пар
+ * @param acc Накопители
+ */
+__attribute__((target("avx2")))
+void dotAvx2(const uint32_t* keys, size_t pairs, DotSums& acc)
+{
+    const __m256i low = _mm256_set1_epi64x(static_cast<long long>(LOW_HALF));
+    __m256i lo = _mm256_setzero_si256(), hi = lo, even = lo, odd = lo;
+    size_t i = 0;
+    for(; i + 4 <= pairs; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + 2 * i));
+        __m256i b = _mm256_srli_epi64(v, 32);
+        __m256i p = _mm256_mul_epu32(v, b);
+        lo = _mm256_add_epi64(lo, _mm256_and_si256(p, low));
+        hi = _mm256_add_epi64(hi, _mm256_srli_epi64(p, 32));
+        even = _mm256_add_epi64(even, _mm256_and_si256(v, low));
+        odd = _mm256_add_epi64(odd, b);
+    }
+    alignas(32) uint64_t lanes[4][4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), hi);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), even);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), odd);
+    for(size_t l = 0; l < 4; ++l) {
+        acc.lo += lanes[0][l];
+        acc.hi += lanes[1][l];
+        acc.even += lanes[2][l];
+        acc.odd += lanes[3][l];
+    }
+    dotScalar(keys + 2 * i, pairs - i, acc);
+}
+
+/**
+ * @brief Ядро скалярного произведения AVX-512F: по 8 пар
+ * @param keys Пары ключей подряд
+ * @param pairs Количество пар
+ * @param acc Накопители
+ */
+__attribute__((target("avx512f")))
+void dotAvx512(const uint32_t* keys, size_t pairs, DotSums& acc)
+{
+    const __mmask8 ALL_LANES = 0xFF;
+    const __m512i low = _mm512_set1_epi64(static_cast<long long>(LOW_HALF));
+    __m512i lo = _mm512_setzero_si512(), hi = lo, even = lo, odd = lo;
+    size_t i = 0;
+    for(; i + 8 <= pairs; i += 8) {
+        __m512i v = _mm512_loadu_si512(keys + 2 * i);
+        __m512i b = _mm512_maskz_srli_epi64(ALL_LANES, v, 32);
+        __m512i p = _mm512_maskz_mul_epu32(ALL_LANES, v, b);
+        lo = _mm512_add_epi64(lo, _mm512_and_si512(p, low));
+        hi = _mm512_add_epi64(hi, _mm512_maskz_srli_epi64(ALL_LANES, p, 32));
+        even = _mm512_add_epi64(even, _mm512_and_si512(v, low));
+        odd = _mm512_add_epi64(odd, b);
+    }
+    alignas(64) uint64_t lanes[4][8];
+    _mm512_store_si512(lanes[0], lo);
+    _mm512_store_si512(lanes[1], hi);
+    _mm512_store_si512(lanes[2], even);
+    _mm512_store_si512(lanes[3], odd);
+    for(size_t l = 0; l < 8; ++l) {
+        acc.lo += lanes[0][l];
+        acc.hi += lanes[1][l];
+        acc.even += lanes[2][l];
+        acc.odd += lanes[3][l];
+    }
+    dotScalar(keys + 2 * i, pairs - i, acc);
+}
+
+// ====================================================================
+// Гистограмма
+// ====================================================================
+
+/// Копий счетчиков скалярного ядра (соседние ключи не ждут друг друга)
+const size_t HISTOGRAM_COPIES = 4;
+
+/**
+ * @brief Скалярное ядро гистограммы
+ * @details Соседние ключи считаются в разных копиях счетчиков: подряд
+ *          идущие одинаковые корзины не образуют цепочку зависимостей
+ *          "загрузка - инкремент - запись" через память.
+ * @param keys Ключи
+ * @param count Количество ключей
+ * @param shift Сдвиг ключа до номера корзины
+ * @param bins Счетчики корзин
+ */
+void histogramScalar(const uint32_t* keys, size_t count, unsigned shift, uint64_t* bins)
+{
+    uint64_t counts[HISTOGRAM_COPIES][HISTOGRAM_BINS] = {};
+    size_t i = 0;
+    for(; i + HISTOGRAM_COPIES <= count; i += HISTOGRAM_COPIES) {
+        for(size_t c = 0; c < HISTOGRAM_COPIES; ++c)
+            ++counts[c][keys[i + c] >> shift];
+    }
+    for(; i < count; ++i)
+        ++counts[0][keys[i] >> shift];
+    for(size_t b = 0; b < HISTOGRAM_BINS; ++b) {
+        for(size_t c = 0; c < HISTOGRAM_COPIES; ++c)
+            bins[b] += counts[c][b];
+    }
+}
+
+/**
+ * @brief Ядро гистограммы AVX-512F: по 16 ключей
+ * @details Вместо записи в корзины считается, сколько ключей не меньше
+ *          каждой из 15 границ (сравнение в маску и POPCNT, границы
+ *          остаются в регистрах); корзина - разность соседних количеств.
+ * @param keys Ключи
+ * @param count Количество ключей
+ * @param shift Сдвиг ключа до номера корзины
+ * @param bins Счетчики корзин
+ */
+__attribute__((target("avx512f,popcnt")))
+void histogramAvx512(const uint32_t* keys, size_t count, unsigned shift, uint64_t* bins)
+{
+    __m512i bounds[HISTOGRAM_BINS];
+    for(size_t b = 1; b < HISTOGRAM_BINS; ++b)
+        bounds[b] = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(b) << shift));
+    uint64_t at_least[HISTOGRAM_BINS + 1] = {};
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m512i v = _mm512_loadu_si512(keys + i);
+        for(size_t b = 1; b < HISTOGRAM_BINS; ++b)
+            at_least[b] += static_cast<uint64_t>(
+                __builtin_popcount(_mm512_cmpge_epu32_mask(v, bounds[b])));
+    }
+    at_least[0] = i;
+    for(size_t b = 0; b < HISTOGRAM_BINS; ++b)
+        bins[b] += at_least[b] - at_least[b + 1];
+    histogramScalar(keys + i, count - i, shift, bins);
+}
+
+}
+
+// ====================================================================
+// Выбор реализации
+// ====================================================================
+
+/**
+ * @brief Возвращает ядра уровня
+ * @param level Уровень
+ * @return Набор ядер
+ */
+ReduceKernels::Set ReduceKernels::kernels(SumKernels::Level level)
+{
+    switch(level) {
+    case SumKernels::Level::Avx512: return {statsAvx512, dotAvx512, histogramAvx512};
+    case SumKernels::Level::Avx2:   return {statsAvx2, dotAvx2, histogramScalar};
+    case SumKernels::Level::Sse42:  return {statsSse42, dotSse42, histogramScalar};
+    case SumKernels::Level::Scalar: break;
+    }
+    return {statsScalar, dotScalar, histogramScalar};
+}
+
+/**
+ * @brief Возвращает ядра текущего уровня
+ * @return Набор ядер
+ */
+ReduceKernels::Set ReduceKernels::activeKernels()
+{
+    return kernels(SumKernels::active());
+}
@@ -0,0 +1,77 @@
+#ifndef REDUCE_KERNELS_H
+#define REDUCE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sum_kernels.h"
+
+/**
+ * @brief Ядра свертки блока ключей uint32_t (операции ReduceOp)
+ * @details Элементы ElementType (кроме uint64_t, которые VectorProcessor
+ *          сворачивает скалярным 64-битным проходом) приводятся к ключам
+ *          uint32_t с сохранением порядка (int32_t - со смещением 2^31),
+ *          поэтому на каждом уровне достаточно трех ядер: статистики
+ *          (сумма, минимум, максимум, нули за один проход), скалярного
+ *          произведения пар и гистограммы. Уровень тот же, что у SumKernels.
+ */
+namespace ReduceKernels {
+    /// Количество корзин гистограммы
+    constexpr size_t HISTOGRAM_BINS = 16;
+
+    /**
+     * @struct Stats
+     * @brief Накопители ядра статистики
+     */
+    struct Stats {
+        uint64_t sum = 0;         ///< Сумма ключей
+        uint32_t min = UINT32_MAX; ///< Наименьший ключ
+        uint32_t max = 0;         ///< Наибольший ключ
+        uint64_t zeros = 0;       ///< Количество ключей, равных нулевому
+    };
+
+    /**
+     * @struct DotSums
+     * @brief Накопители ядра скалярного произведения пар (a, b)
+     * @details Произведение a*b < 2^64 делится на младшие и старшие 32 бита,
+     *          которые суммируются отдельно: точное значение - hi*2^32 + lo.
+     */
+    struct DotSums {
+        uint64_t lo = 0;   ///< Сумма младших половин произведений
+        uint64_t hi = 0;   ///< Сумма старших половин произведений
+        uint64_t even = 0; ///< Сумма первых элементов пар
+        uint64_t odd = 0;  ///< Сумма вторых элементов пар
+    };
+
+    /// Ядро статистики: count ключей добавляются к acc; zero - нулевой ключ
+    using StatsKernel = void (*)(const uint32_t* keys, size_t count, uint32_t zero, Stats& acc);
+
+    /// Ядро скалярного произведения: pairs пар (keys[2i], keys[2i+1]) добавляются к acc
+    using DotKernel = void (*)(const uint32_t* keys, size_t pairs, DotSums& acc);
+
+    /// Ядро гистограммы: bins[key >> shift] += 1 для count ключей (все ключи меньше 16 << shift)
+    using HistogramKernel = void (*)(const uint32_t* keys, size_t count, unsigned shift,
+                                     uint64_t* bins);
+
+    /**
+     * @struct Set
+     * @brief Ядра одного уровня
+     */
+    struct Set {
+        StatsKernel stats;         ///< Статистика
+        DotKernel dot;             ///< Скалярное произведение пар
+        HistogramKernel histogram; ///< Гистограмма
+    };
+
+    /**
+     * @brief Ядра заданного уровня (гистограмма на SSE4.2 и AVX2 - скалярная)
+     * @param level Уровень (должен поддерживаться процессором)
+     */
+    Set kernels(SumKernels::Level level);
+
+    /**
+     * @brief Ядра текущего уровня SumKernels::active()
+     */
+    Set activeKernels();
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "result_batcher.h"
+
+#include <algorithm>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Создает выключенный буфер результатов
+ * @param io Реализация ввода-вывода, через которую отправляется буфер
+ */
+ResultBatcher::ResultBatcher(SocketIo& io)
+    : io_(io)
+{
+}
+
+/**
+ * @brief Устанавливает политику отправки
+ * @details Порог max_results ограничивается емкостью буфера CAPACITY.
+ * @param policy Политика отправки
+ */
+void ResultBatcher::setPolicy(const FlushPolicy& policy)
+{
+    limit_ = std::min(policy.max_results, CAPACITY);
+    delay_ = std::chrono::microseconds(policy.max_delay_us);
+    if(limit_ > 0)
+        buffer_.reserve(limit_);
+}
+
+/**
+ * @brief Готовит сокет к отправке пакетами
+ * @details Результаты уже объединяются в буфере, поэтому алгоритм Нейгла
+ *          только задержал бы отправленный пакет до подтверждения
+ *          предыдущего: устанавливается TCP_NODELAY. TCP_CORK не нужен -
+ *          каждый пакет уходит одним вызовом send(). Для сокетов не TCP
+ *          (например, AF_UNIX) ошибка setsockopt() игнорируется.
+ * @param fd Дескриптор клиентского сокета
+ */
+void ResultBatcher::begin(int fd)
+{
+    buffer_.clear();
+    if(!enabled())
+        return;
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+/**
+ * @brief Добавляет результат и отправляет буфер по политике
+ * @param fd Дескриптор клиентского сокета
+ * @param result Результат вектора
+ * @return false при ошибке отправки
+ */
+bool ResultBatcher::add(int fd, int32_t result)
+{
+    if(!enabled())
+        return io_.sendAll(fd, &result, sizeof(result));
+
+    if(buffer_.empty())
+        first_ = std::chrono::steady_clock::now();
+    buffer_.push_back(result);
+
+    if(buffer_.size() >= limit_)
+        return flush(fd);
+    if(delay_.count() > 0 && std::chrono::steady_clock::now() - first_ >= delay_)
+        return flush(fd);
+    return true;
+}
+
+/**
+ * @brief Отправляет буфер, если следующее чтение заблокирует поток
+ * @details Количество уже полученных байт определяется ioctl(FIONREAD).
+ *          Если их меньше need, поток будет ждать клиента - а клиент может
+ *          ждать ответов, поэтому буфер отправляется до чтения.
+ * @param fd Дескриптор клиентского сокета
+ * @param need Количество байт, которое будет прочитано
+ * @return false при ошибке отправки
+ */
+bool ResultBatcher::flushBeforeRead(int fd, size_t need)
+{
+    if(buffer_.empty())
+        return true;
+    int avail = 0;
+    if(ioctl(fd, FIONREAD, &avail) == 0 && static_cast<size_t>(avail) >= need)
+        return true;
+    return flush(fd);
+}
+
+/**
+ * @brief Отправляет все накопленные результаты одним вызовом
+ * @param fd Дескриптор клиентского сокета
+ * @return false при ошибке отправки
+ */
+bool ResultBatcher::flush(int fd)
+{
+    if(buffer_.empty())
+        return true;
+    bool ok = io_.sendAll(fd, buffer_.data(), buffer_.size() * sizeof(int32_t));
+    buffer_.clear();
+    ++flushes_;
+    return ok;
+}
@@ -0,0 +1,101 @@
+#ifndef RESULT_BATCHER_H
+#define RESULT_BATCHER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "socket_io.h"
+
+/**
+ * @struct FlushPolicy
+ * @brief Политика отправки накопленных результатов
+ */
+struct FlushPolicy {
+    size_t max_results = 0;   ///< Отправка после N результатов (0 - накопление выключено)
+    unsigned max_delay_us = 0; ///< Предельная задержка первого накопленного результата, мкс (0 - без ограничения)
+};
+
+/**
+ * @class ResultBatcher
+ * @brief Буфер исходящих результатов соединения
+ * @details Накапливает 4-байтовые результаты векторов и отправляет их одним
+ *          вызовом send() вместо вызова на каждый результат. Формат данных
+ *          на проводе не меняется: клиент получает те же int32_t подряд.
+ *          Буфер отправляется, когда:
+ *          - накоплено max_results результатов или буфер заполнен;
+ *          - первый накопленный результат ждет дольше max_delay_us;
+ *          - следующее чтение из сокета заблокирует поток (flushBeforeRead()),
+ *            поэтому клиент, ждущий ответ перед отправкой данных, не зависает.
+ */
+class ResultBatcher {
+public:
+    /// Емкость буфера в результатах (4 КБ)
+    static constexpr size_t CAPACITY = 1024;
+
+    /**
+     * @brief Конструктор
+     * @param io Реализация ввода-вывода для отправки
+     */
+    explicit ResultBatcher(SocketIo& io);
+
+    /**
+     * @brief Установка политики отправки
+     * @param policy Политика; max_results == 0 выключает накопление
+     */
+    void setPolicy(const FlushPolicy& policy);
+
+    /**
+     * @brief Включено ли накопление результатов
+     */
+    bool enabled() const { return limit_ > 0; }
+
+    /**
+     * @brief Подготовка сокета: TCP_NODELAY (накопление выполняет сам буфер)
+     * @param fd Дескриптор клиентского сокета
+     */
+    void begin(int fd);
+
+    /**
+     * @brief Добавление результата с отправкой по политике
+     * @param fd Дескриптор клиентского сокета
+     * @param result Результат вектора
+     * @return false при ошибке отправки
+     */
+    bool add(int fd, int32_t result);
+
+    /**
+     * @brief Отправка буфера, если чтения need байт придется ждать
+     * @param fd Дескриптор клиентского сокета
+     * @param need Количество байт, которое будет прочитано
+     * @return false при ошибке отправки
+     */
+    bool flushBeforeRead(int fd, size_t need);
+
+    /**
+     * @brief Отправка всех накопленных результатов
+     * @param fd Дескриптор клиентского сокета
+     * @return false при ошибке отправки
+     */
+    bool flush(int fd);
+
+    /**
+     * @brief Количество накопленных, еще не отправленных результатов
+     */
+    size_t pending() const { return buffer_.size(); }
+
+    /**
+     * @brief Количество выполненных отправок (для статистики и тестов)
+     */
+    size_t flushes() const { return flushes_; }
+
+private:
+    SocketIo& io_;                 ///< Реализация ввода-вывода
+    size_t limit_ = 0;             ///< Порог отправки в результатах
+    std::chrono::microseconds delay_{0}; ///< Предельная задержка результата
+    std::vector<int32_t> buffer_;  ///< Накопленные результаты
+    std::chrono::steady_clock::time_point first_; ///< Время первого накопленного результата
+    size_t flushes_ = 0;           ///< Счетчик отправок
+};
+
+#endif
@@ -18,7 +18,58 @@ struct ServerInterface::Impl {
             ("address,a", po::value<std::string>(&params.address)->default_value("127.0.0.1"), "Bind address")
             ("log,l", po::value<std::string>(&params.logFile)->default_value("server.log"), "Log file path")
             ("clients-db,d", po::value<std::string>(&params.clientsDbFile)->default_value("clients.db"),
-                 "Clients DB file (format: login:password per line)");
+                 "Clients DB file (format: login:password per line)")
+            ("epoll,e", po::bool_switch(&params.epoll),
+                 "Serve all clients from one epoll event loop (non-blocking)")
+            ("coro,c", po::bool_switch(&params.coro),
+                 "Serve all clients as C++20 coroutine sessions on one epoll executor "
+                 "(with --shards: one executor per shard)")
+            ("workers,w", po::value<int>(&params.workers)->default_value(0),
+                 "Serve clients concurrently on N worker threads (0 - sequential)")
+            ("shards,s", po::value<int>(&params.shards)->default_value(0),
+                 "Open N SO_REUSEPORT listeners, each with its own pinned epoll thread "
+                 "(usually one per CPU core; 0 - off)")
+            ("pipeline", po::bool_switch(&params.pipeline),
+                 "Sum each large vector on a helper thread while the next one is received "
+                 "(sequential and --workers modes)")
+            ("stream", po::bool_switch(&params.stream),
+                 "Sum vectors in 64 KB chunks as they arrive instead of buffering whole vectors "
+                 "(sequential and --workers modes; epoll/coro sessions always stream)")
+            ("batch", po::value<int>(&params.batchResults)->default_value(0),
+                 "Coalesce up to N vector results per send (flushed before any read that would block; "
+                 "0 - send each result)")
+            ("batch-us", po::value<int>(&params.batchDelayUs)->default_value(200),
+                 "Maximum time a batched result may wait, microseconds (0 - no limit)")
+            ("compute-threads", po::value<int>(&params.computeThreads)->default_value(0),
+                 "Sum large vectors (1M+ elements unless calibrated otherwise) on N shared compute "
+                 "threads plus the session thread (sequential and --workers modes without --stream; 0 - off)")
+            ("tuning", po::value<std::string>(&params.tuningFile)->default_value(""),
+                 "Sum strategy thresholds file: loaded if it matches this CPU and --compute-threads, "
+                 "otherwise calibrated at startup and written there (empty - calibrate every start)")
+            ("io", po::value<std::string>(&params.ioBackend)->default_value("posix"),
+                 "Socket I/O backend for blocking modes: posix or uring (io_uring)")
+            ("buffer-cache", po::value<int>(&params.bufferCache)->default_value(64),
+                 "Keep at most this many MB of free vector buffers after a session ends "
+                 "(0 - release all)")
+            ("idle-timeout", po::value<int>(&params.idleTimeout)->default_value(30),
+                 "Close a keep-alive session idle between batches for this many seconds (0 - never)")
+            ("ticket-lifetime", po::value<int>(&params.ticketLifetime)->default_value(600),
+                 "Lifetime of session resumption tickets issued on request after a full login, "
+                 "seconds (0 - tickets disabled)")
+            ("crypto-threads", po::value<int>(&params.cryptoThreads)->default_value(0),
+                 "Verify password hashes on N crypto threads that batch pending logins into "
+                 "multi-buffer SHA-224 kernels (epoll/coro sessions wait without blocking; "
+                 "0 - hash on the session thread)")
+            ("peer-rate", po::value<double>(&params.peerRate)->default_value(0),
+                 "Accept at most this many connections per second from one IPv4 address, with a "
+                 "burst of two seconds' worth; excess connections are reset right after accept() "
+                 "(0 - no limit)")
+            ("login-rate", po::value<double>(&params.loginRate)->default_value(0),
+                 "Check at most this many login attempts per second for one login; excess attempts "
+                 "get ERR before the AuthDB lookup and hashing (0 - no limit)")
+            ("heavy-hitter", po::value<int>(&params.heavyHitter)->default_value(0),
+                 "Reset connections from an address that made more than N connections in a 10 s "
+                 "window (approximate count-min sketch count; 0 - off)");
     }
 };
 
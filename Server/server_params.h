@@ -12,6 +12,24 @@ struct ServerParams {
     std::string address = "127.0.0.1";    ///< IP-адрес для привязки
     std::string logFile = "server.log";   ///< Путь к файлу логов
     std::string clientsDbFile = "clients.db"; ///< Путь к файлу базы данных клиентов
+    bool epoll = false;                   ///< Режим событийного цикла epoll вместо последовательного
+    bool coro = false;                    ///< Сеансы-сопрограммы на исполнителе epoll вместо последовательного режима
+    int workers = 0;                      ///< Количество рабочих потоков (0 - последовательный режим)
+    int shards = 0;                       ///< Количество шардов SO_REUSEPORT (0 - один слушающий сокет)
+    bool pipeline = false;                ///< Суммирование вектора параллельно с чтением следующего (блокирующие режимы)
+    bool stream = false;                  ///< Суммирование векторов порциями по мере чтения (блокирующие режимы)
+    int batchResults = 0;                 ///< Отправка результатов пакетами по N (0 - каждый результат сразу)
+    int batchDelayUs = 200;               ///< Предельная задержка результата в пакете, мкс
+    int computeThreads = 0;               ///< Потоки параллельного суммирования больших векторов (0 - выключено)
+    std::string tuningFile;               ///< Файл порогов суммирования ("" - калибровка при каждом запуске)
+    std::string ioBackend = "posix";      ///< Реализация ввода-вывода: posix или uring
+    int idleTimeout = 30;                 ///< Таймаут простоя сеанса keep-alive между пакетами, с (0 - без таймаута)
+    int ticketLifetime = 600;             ///< Срок действия билетов возобновления сеанса, с (0 - билеты выключены)
+    int cryptoThreads = 0;                ///< Потоки пакетной проверки паролей (0 - хэширование в потоке сеанса)
+    double peerRate = 0;                  ///< Подключений в секунду с одного адреса (0 - без ограничения)
+    double loginRate = 0;                 ///< Попыток входа в секунду на логин (0 - без ограничения)
+    int heavyHitter = 0;                  ///< Подключений с адреса за окно до отказа (0 - без ограничения)
+    int bufferCache = 64;                 ///< Объем пула буферов векторов после завершения сеанса, МБ
     bool help = false;                    ///< Флаг запроса справки
 };
 
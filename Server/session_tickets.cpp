@@ -0,0 +1,121 @@
+#include "session_tickets.h"
+#include <cryptopp/hmac.h>
+#include <cryptopp/sha.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/misc.h>
+#include <cstring>
+
+namespace {
+/// Версия формата билета (первый байт)
+const unsigned char TICKET_VERSION = 1;
+}
+
+/**
+ * @brief Создает выдачу билетов со случайным ключом
+ * @details Ключ живет только в памяти процесса: после перезапуска сервера
+ *          ранее выданные билеты не принимаются, и клиент проходит полную
+ *          аутентификацию.
+ * @param lifetime Срок действия выдаваемых билетов
+ */
+SessionTickets::SessionTickets(std::chrono::seconds lifetime)
+    : lifetime_(lifetime)
+    , key_(KEY_SIZE)
+{
+    CryptoPP::AutoSeededRandomPool rng;
+    rng.GenerateBlock(key_.data(), key_.size());
+}
+
+/**
+ * @brief Создает выдачу билетов с заданным ключом
+ * @param lifetime Срок действия выдаваемых билетов
+ * @param key Ключ HMAC (KEY_SIZE байт)
+ */
+SessionTickets::SessionTickets(std::chrono::seconds lifetime, const unsigned char* key)
+    : lifetime_(lifetime)
+    , key_(KEY_SIZE)
+{
+    std::memcpy(key_.data(), key, KEY_SIZE);
+}
+
+/**
+ * @brief Выдает билет возобновления сеанса
+ * @details Формат билета (байты):
+ *          - версия формата (1)
+ *          - срок действия: секунды Unix, int64_t little-endian (8)
+ *          - длина логина (1) и логин
+ *          - MAC: первые MAC_SIZE байт HMAC-SHA256 от всего предыдущего
+ * @param login Аутентифицированный логин
+ * @param now Текущее время
+ * @return Билет (FIXED_SIZE + длина логина байт) или пустая строка,
+ *         если логин длиннее MAX_LOGIN
+ */
+std::string SessionTickets::issue(const std::string& login, Clock::time_point now) const
+{
+    if(login.size() > MAX_LOGIN)
+        return std::string();
+
+    int64_t expires = std::chrono::duration_cast<std::chrono::seconds>(
+        (now + lifetime_).time_since_epoch()).count();
+    std::string ticket(FIXED_SIZE + login.size(), '\0');
+    unsigned char* p = reinterpret_cast<unsigned char*>(&ticket[0]);
+    p[0] = TICKET_VERSION;
+    for(int i = 0; i < 8; ++i)
+        p[1 + i] = static_cast<unsigned char>(static_cast<uint64_t>(expires) >> (8 * i));
+    p[9] = static_cast<unsigned char>(login.size());
+    std::memcpy(p + 10, login.data(), login.size());
+    sign(p, 10 + login.size(), p + 10 + login.size());
+    return ticket;
+}
+
+/**
+ * @brief Проверяет билет возобновления сеанса
+ * @details Сначала проверяются длина и версия, затем MAC (сравнение за
+ *          постоянное время), и только после этого - срок действия:
+ *          поля неподписанного билета не используются.
+ * @param ticket Билет от клиента
+ * @param login Логин из билета (меняется только при успехе)
+ * @param now Текущее время
+ * @return true если билет выдан этим ключом и срок не истек
+ */
+bool SessionTickets::verify(std::string_view ticket, std::string& login, Clock::time_point now) const
+{
+    if(ticket.size() < FIXED_SIZE)
+        return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(ticket.data());
+    size_t login_len = p[9];
+    if(p[0] != TICKET_VERSION || ticket.size() != FIXED_SIZE + login_len)
+        return false;
+
+    unsigned char mac[MAC_SIZE];
+    sign(p, 10 + login_len, mac);
+    if(!CryptoPP::VerifyBufsEqual(mac, p + 10 + login_len, MAC_SIZE))
+        return false;
+
+    uint64_t expires = 0;
+    for(int i = 0; i < 8; ++i)
+        expires |= static_cast<uint64_t>(p[1 + i]) << (8 * i);
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    if(seconds >= static_cast<int64_t>(expires))
+        return false;
+
+    login.assign(ticket.substr(10, login_len));
+    return true;
+}
+
+/**
+ * @brief Вычисляет MAC билета
+ * @details HMAC-SHA256 усекается до MAC_SIZE байт. Объект HMAC создается
+ *          на каждый вызов, поэтому методы можно вызывать из нескольких
+ *          потоков одновременно.
+ * @param data Подписываемая часть билета
+ * @param len Длина подписываемой части
+ * @param mac Результат (MAC_SIZE байт)
+ */
+void SessionTickets::sign(const unsigned char* data, size_t len, unsigned char* mac) const
+{
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac(key_.data(), key_.size());
+    unsigned char digest[CryptoPP::SHA256::DIGESTSIZE];
+    hmac.Update(data, len);
+    hmac.Final(digest);
+    std::memcpy(mac, digest, MAC_SIZE);
+}
@@ -0,0 +1,84 @@
+#ifndef SESSION_TICKETS_H
+#define SESSION_TICKETS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <cryptopp/secblock.h>
+
+/**
+ * @class SessionTickets
+ * @brief Выдача и проверка билетов возобновления сеанса
+ * @details После полной аутентификации клиент может получить билет:
+ *          логин и срок действия, подписанные HMAC-SHA256 на ключе,
+ *          известном только серверу. С билетом повторное подключение
+ *          принимается одной проверкой MAC, без поиска в AuthDB и SHA224.
+ *          Методы константны, поэтому один объект используется всеми
+ *          потоками сервера.
+ */
+class SessionTickets {
+public:
+    /// Размер ключа HMAC, байт
+    static constexpr size_t KEY_SIZE = 32;
+    /// Размер MAC в билете (усеченный HMAC-SHA256), байт
+    static constexpr size_t MAC_SIZE = 16;
+    /// Размер билета без логина: версия, срок, длина логина, MAC
+    static constexpr size_t FIXED_SIZE = 1 + 8 + 1 + MAC_SIZE;
+    /// Наибольшая длина логина: запрос возобновления умещается в одно чтение аутентификации
+    static constexpr size_t MAX_LOGIN = 227;
+    /// Срок действия билета по умолчанию, с
+    static constexpr int DEFAULT_LIFETIME_SEC = 600;
+
+    using Clock = std::chrono::system_clock;
+
+    /**
+     * @brief Конструктор со случайным ключом
+     * @param lifetime Срок действия выдаваемых билетов
+     */
+    explicit SessionTickets(std::chrono::seconds lifetime);
+
+    /**
+     * @brief Конструктор с заданным ключом
+     * @param lifetime Срок действия выдаваемых билетов
+     * @param key Ключ HMAC (KEY_SIZE байт)
+     */
+    SessionTickets(std::chrono::seconds lifetime, const unsigned char* key);
+
+    /**
+     * @brief Выдача билета
+     * @param login Аутентифицированный логин
+     * @param now Текущее время
+     * @return Билет или пустая строка, если логин длиннее MAX_LOGIN
+     */
+    std::string issue(const std::string& login, Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief Проверка билета
+     * @param ticket Билет от клиента
+     * @param login Логин из билета
+     * @param now Текущее время
+     * @return true если билет выдан этим сервером и не истек
+     */
+    bool verify(std::string_view ticket, std::string& login, Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief Срок действия выдаваемых билетов
+     */
+    std::chrono::seconds lifetime() const { return lifetime_; }
+
+private:
+    std::chrono::seconds lifetime_; ///< Срок действия билетов
+    CryptoPP::SecByteBlock key_;    ///< Ключ HMAC
+
+    /**
+     * @brief Вычисление MAC билета
+     * @param data Подписываемая часть билета
+     * @param len Длина подписываемой части
+     * @param mac Результат (MAC_SIZE байт)
+     */
+    void sign(const unsigned char* data, size_t len, unsigned char* mac) const;
+};
+
+#endif
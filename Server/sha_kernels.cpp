@@ -0,0 +1,440 @@
+#include "sha_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cpuid.h>
+#include <immintrin.h>
+#include <cryptopp/sha.h>
+
+namespace {
+
+using ShaKernels::DIGEST_SIZE;
+using ShaKernels::LANES;
+using ShaKernels::Message;
+
+/// Размер блока SHA-256/224, байт
+constexpr size_t BLOCK_SIZE = 64;
+
+/// Начальное состояние SHA-224 (FIPS 180-4, 5.3.2)
+constexpr uint32_t H224[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+/// Константы раундов SHA-256/224
+alignas(16) constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// ====================================================================
+// Дополнение сообщений
+// ====================================================================
+
+/**
+ * @brief Число блоков дополненного сообщения
+ * @details Сообщение дополняется байтом 0x80, нулями и 64-битной длиной
+ *          в битах так, чтобы длина стала кратна BLOCK_SIZE.
+ * @param length Длина сообщения, байт
+ * @return Количество блоков
+ */
+size_t paddedBlocks(size_t length)
+{
+    return (length + 8) / BLOCK_SIZE + 1;
+}
+
+/**
+ * @brief Копирует в block пересечение части сообщения с блоком
+ * @param part Часть сообщения
+ * @param offset Смещение части в сообщении
+ * @param start Смещение блока в сообщении
+ * @param block Блок
+ */
+void copyPart(std::string_view part, size_t offset, size_t start, unsigned char* block)
+{
+    size_t first = std::max(offset, start);
+    size_t last = std::min(offset + part.size(), start + BLOCK_SIZE);
+    if(first < last)
+        std::memcpy(block + (first - start), part.data() + (first - offset), last - first);
+}
+
+/**
+ * @brief Формирует блок index дополненного сообщения
+ * @param message Сообщение
+ * @param index Номер блока (меньше paddedBlocks())
+ * @param block Выход: BLOCK_SIZE байт
+ */
+void loadBlock(const Message& message, size_t index, unsigned char* block)
+{
+    const size_t length = message.prefix.size() + message.suffix.size();
+    const size_t start = index * BLOCK_SIZE;
+    std::memset(block, 0, BLOCK_SIZE);
+    copyPart(message.prefix, 0, start, block);
+    copyPart(message.suffix, message.prefix.size(), start, block);
+    if(length >= start && length < start + BLOCK_SIZE)
+        block[length - start] = 0x80;
+    if(index + 1 == paddedBlocks(length)) {
+        uint64_t bits = static_cast<uint64_t>(length) * 8;
+        for(int i = 0; i < 8; ++i)
+            block[BLOCK_SIZE - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+}
+
+/**
+ * @brief Читает 32-битное слово big-endian
+ */
+uint32_t loadBigEndian(const unsigned char* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+/**
+ * @brief Записывает 32-битное слово big-endian
+ */
+void storeBigEndian(uint32_t value, unsigned char* p)
+{
+    p[0] = static_cast<unsigned char>(value >> 24);
+    p[1] = static_cast<unsigned char>(value >> 16);
+    p[2] = static_cast<unsigned char>(value >> 8);
+    p[3] = static_cast<unsigned char>(value);
+}
+
+// ====================================================================
+// Реализации
+// ====================================================================
+
+/**
+ * @brief Скалярное ядро: Crypto++ по одному сообщению
+ * @param messages Сообщения
+ * @param count Количество сообщений
+ * @param digests Выход: count * DIGEST_SIZE байт
+ */
+void sha224Scalar(const Message* messages, size_t count, unsigned char* digests)
+{
+    for(size_t i = 0; i < count; ++i) {
+        CryptoPP::SHA224 hash;
+        hash.Update(reinterpret_cast<const unsigned char*>(messages[i].prefix.data()),
+                    messages[i].prefix.size());
+        hash.Update(reinterpret_cast<const unsigned char*>(messages[i].suffix.data()),
+                    messages[i].suffix.size());
+        hash.Final(digests + i * DIGEST_SIZE);
+    }
+}
+
+/**
+ * @brief Циклический сдвиг вправо 32-битных линий
+ * @tparam N Величина сдвига
+ */
+template <int N>
+__attribute__((target("avx2")))
+inline __m256i rotr(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+/**
+ * @brief Сжатие одного блока в LANES линиях AVX2
+ * @details Линии с нулевой маской (сообщение уже закончилось) проходят
+ *          раунды вхолостую, их состояние не меняется (VPBLENDVB).
+ * @param state Состояние: 8 слов по LANES линий
+ * @param words Слова блока: 16 слов по LANES линий
+ * @param active Маска активных линий (все единицы или нули в линии)
+ */
+__attribute__((target("avx2")))
+void compressAvx2(__m256i* state, const uint32_t (*words)[LANES], __m256i active)
+{
+    __m256i w[16];
+    for(int t = 0; t < 16; ++t)
+        w[t] = _mm256_load_si256(reinterpret_cast<const __m256i*>(words[t]));
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for(int t = 0; t < 64; ++t) {
+        if(t >= 16) {
+            __m256i w2 = w[(t - 2) & 15];
+            __m256i w15 = w[(t - 15) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr<7>(w15), rotr<18>(w15)),
+                                          _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr<17>(w2), rotr<19>(w2)),
+                                          _mm256_srli_epi32(w2, 10));
+            w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                                         _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+        __m256i sum1 = _mm256_xor_si256(_mm256_xor_si256(rotr<6>(e), rotr<11>(e)), rotr<25>(e));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sum1),
+                                      _mm256_add_epi32(ch, _mm256_add_epi32(w[t & 15],
+                                          _mm256_set1_epi32(static_cast<int>(K[t])))));
+        __m256i sum0 = _mm256_xor_si256(_mm256_xor_si256(rotr<2>(a), rotr<13>(a)), rotr<22>(a));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, _mm256_add_epi32(sum0, maj));
+    }
+
+    const __m256i next[8] = {a, b, c, d, e, f, g, h};
+    for(int j = 0; j < 8; ++j)
+        state[j] = _mm256_blendv_epi8(state[j], _mm256_add_epi32(state[j], next[j]), active);
+}
+
+/**
+ * @brief Ядро AVX2: группы по LANES сообщений (multi-buffer)
+ * @details Слова блоков сообщений группы транспонируются так, что линия i
+ *          регистра несет сообщение i. Группа проходит столько блоков,
+ *          сколько у самого длинного сообщения; короткие маскируются.
+ * @param messages Сообщения
+ * @param count Количество сообщений
+ * @param digests Выход: count * DIGEST_SIZE байт
+ */
+__attribute__((target("avx2")))
+void sha224Avx2(const Message* messages, size_t count, unsigned char* digests)
+{
+    alignas(32) uint32_t words[16][LANES];
+    alignas(32) uint32_t lanes[8][LANES];
+    alignas(32) int32_t mask[LANES];
+    unsigned char block[BLOCK_SIZE];
+
+    for(size_t base = 0; base < count; base += LANES) {
+        const size_t group = std::min(LANES, count - base);
+        size_t blocks[LANES] = {};
+        size_t maxBlocks = 0;
+        for(size_t lane = 0; lane < group; ++lane) {
+            const Message& m = messages[base + lane];
+            blocks[lane] = paddedBlocks(m.prefix.size() + m.suffix.size());
+            maxBlocks = std::max(maxBlocks, blocks[lane]);
+        }
+
+        __m256i state[8];
+        for(int j = 0; j < 8; ++j)
+            state[j] = _mm256_set1_epi32(static_cast<int>(H224[j]));
+
+        for(size_t index = 0; index < maxBlocks; ++index) {
+            for(size_t lane = 0; lane < LANES; ++lane) {
+                bool live = lane < group && index < blocks[lane];
+                mask[lane] = live ? -1 : 0;
+                if(live)
+                    loadBlock(messages[base + lane], index, block);
+                for(int t = 0; t < 16; ++t)
+                    words[t][lane] = live ? loadBigEndian(block + 4 * t) : 0;
+            }
+            compressAvx2(state, words, _mm256_load_si256(reinterpret_cast<const __m256i*>(mask)));
+        }
+
+        for(int j = 0; j < 8; ++j)
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[j]), state[j]);
+        for(size_t lane = 0; lane < group; ++lane) {
+            unsigned char* digest = digests + (base + lane) * DIGEST_SIZE;
+            for(size_t j = 0; j < DIGEST_SIZE / 4; ++j)
+                storeBigEndian(lanes[j][lane], digest + 4 * j);
+        }
+    }
+}
+
+/**
+ * @brief Сжатие одного блока инструкциями SHA
+ * @details Состояние хранится в порядке инструкций: ABEF и CDGH. Каждая
+ *          SHA256RNDS2 выполняет два раунда; слова расписания считаются
+ *          по четыре (SHA256MSG1/SHA256MSG2).
+ * @param abef Состояние A, B, E, F
+ * @param cdgh Состояние C, D, G, H
+ * @param block Блок, BLOCK_SIZE байт
+ */
+__attribute__((target("sha,sse4.1")))
+void compressShaNi(__m128i& abef, __m128i& cdgh, const unsigned char* block)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const __m128i abefSaved = abef;
+    const __m128i cdghSaved = cdgh;
+    __m128i w[4];
+    for(int i = 0; i < 16; ++i) {
+        __m128i next;
+        if(i < 4) {
+            next = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i)),
+                                    byteSwap);
+        } else {
+            __m128i sigma0 = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+            __m128i w7 = _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4);
+            next = _mm_sha256msg2_epu32(_mm_add_epi32(sigma0, w7), w[(i + 3) & 3]);
+        }
+        w[i & 3] = next;
+        __m128i msg = _mm_add_epi32(next, _mm_load_si128(reinterpret_cast<const __m128i*>(K + 4 * i)));
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E));
+    }
+    abef = _mm_add_epi32(abef, abefSaved);
+    cdgh = _mm_add_epi32(cdgh, cdghSaved);
+}
+
+/**
+ * @brief Ядро SHA-NI: сообщения по одному
+ * @param messages Сообщения
+ * @param count Количество сообщений
+ * @param digests Выход: count * DIGEST_SIZE байт
+ */
+__attribute__((target("sha,sse4.1")))
+void sha224ShaNi(const Message* messages, size_t count, unsigned char* digests)
+{
+    unsigned char block[BLOCK_SIZE];
+    alignas(16) uint32_t words[8];
+    for(size_t i = 0; i < count; ++i) {
+        // A B C D / E F G H -> A B E F / C D G H (старшее слово первым)
+        __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(H224));
+        __m128i efgh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(H224 + 4));
+        __m128i abef = _mm_unpackhi_epi64(_mm_shuffle_epi32(efgh, 0x1B), _mm_shuffle_epi32(abcd, 0x1B));
+        __m128i cdgh = _mm_unpacklo_epi64(_mm_shuffle_epi32(efgh, 0x1B), _mm_shuffle_epi32(abcd, 0x1B));
+
+        const Message& m = messages[i];
+        const size_t blocks = paddedBlocks(m.prefix.size() + m.suffix.size());
+        for(size_t index = 0; index < blocks; ++index) {
+            loadBlock(m, index, block);
+            compressShaNi(abef, cdgh, block);
+        }
+
+        abcd = _mm_shuffle_epi32(_mm_unpackhi_epi64(cdgh, abef), 0x1B);
+        efgh = _mm_shuffle_epi32(_mm_unpacklo_epi64(cdgh, abef), 0x1B);
+        _mm_store_si128(reinterpret_cast<__m128i*>(words), abcd);
+        _mm_store_si128(reinterpret_cast<__m128i*>(words + 4), efgh);
+        for(size_t j = 0; j < DIGEST_SIZE / 4; ++j)
+            storeBigEndian(words[j], digests + i * DIGEST_SIZE + 4 * j);
+    }
+}
+
+/**
+ * @brief Проверяет наличие инструкций SHA
+ * @details Бит SHA (CPUID.7.0:EBX[29]) читается напрямую: в
+ *          __builtin_cpu_supports() он есть не во всех версиях GCC.
+ * @return true если поддерживаются SHA и SSE4.1
+ */
+bool hasShaNi()
+{
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return false;
+    __builtin_cpu_init();
+    return (ebx & bit_SHA) != 0 && __builtin_cpu_supports("sse4.1");
+}
+
+/**
+ * @brief Текущий уровень (инициализируется detect() при первом обращении)
+ * @return Ссылка на атомарный уровень
+ */
+std::atomic<ShaKernels::Level>& current()
+{
+    static std::atomic<ShaKernels::Level> level{ShaKernels::detect()};
+    return level;
+}
+
+}
+
+// ====================================================================
+// Выбор реализации
+// ====================================================================
+
+/**
+ * @brief Определяет старший поддерживаемый уровень
+ * @details SHA-NI предпочитается AVX2: одно сообщение на SHA256RNDS2
+ *          обрабатывается быстрее, чем восемь в линиях AVX2.
+ * @return Уровень
+ */
+ShaKernels::Level ShaKernels::detect()
+{
+    if(supported(Level::ShaNi))
+        return Level::ShaNi;
+    if(supported(Level::Avx2))
+        return Level::Avx2;
+    return Level::Scalar;
+}
+
+/**
+ * @brief Проверяет поддержку уровня процессором
+ * @details Уровни не вложены: SHA-NI встречается и без AVX2 (Goldmont).
+ * @param level Уровень
+ * @return true если инструкции уровня поддерживаются
+ */
+bool ShaKernels::supported(Level level)
+{
+    switch(level) {
+    case Level::ShaNi:
+        return hasShaNi();
+    case Level::Avx2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case Level::Scalar:
+        break;
+    }
+    return true;
+}
+
+/**
+ * @brief Возвращает ядро уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+ShaKernels::Kernel ShaKernels::kernel(Level level)
+{
+    switch(level) {
+    case Level::ShaNi:  return sha224ShaNi;
+    case Level::Avx2:   return sha224Avx2;
+    case Level::Scalar: break;
+    }
+    return sha224Scalar;
+}
+
+/**
+ * @brief Возвращает название уровня
+ * @param level Уровень
+ * @return Строка для логирования
+ */
+const char* ShaKernels::name(Level level)
+{
+    switch(level) {
+    case Level::ShaNi:  return "sha-ni";
+    case Level::Avx2:   return "avx2";
+    case Level::Scalar: break;
+    }
+    return "scalar";
+}
+
+/**
+ * @brief Возвращает текущий уровень
+ * @return Уровень
+ */
+ShaKernels::Level ShaKernels::active()
+{
+    return current().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает ядро текущего уровня
+ * @return Указатель на функцию ядра
+ */
+ShaKernels::Kernel ShaKernels::activeKernel()
+{
+    return kernel(active());
+}
+
+/**
+ * @brief Выбирает уровень
+ * @param level Уровень
+ * @return false если уровень не поддерживается процессором
+ */
+bool ShaKernels::select(Level level)
+{
+    if(!supported(level))
+        return false;
+    current().store(level, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef SHA_KERNELS_H
+#define SHA_KERNELS_H
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief Ядра пакетного вычисления SHA-224
+ * @details Хэшируются сразу несколько сообщений (проверки паролей,
+ *          накопленные пулом CryptoPool). Уровень выбирается один раз по
+ *          CPUID при первом обращении:
+ *          - SHA-NI: инструкции SHA (SHA256RNDS2), сообщения по одному;
+ *          - AVX2: по LANES сообщений в линиях 256-битных регистров
+ *            (multi-buffer), сообщения разной длины идут в одной группе;
+ *          - скалярный: Crypto++ по одному сообщению.
+ */
+namespace ShaKernels {
+    /**
+     * @brief Уровень набора инструкций
+     */
+    enum class Level {
+        Scalar, ///< Crypto++ по одному сообщению
+        Avx2,   ///< AVX2, LANES сообщений за проход
+        ShaNi   ///< Инструкции SHA (SHA-NI), по одному сообщению
+    };
+
+    /// Размер хэша SHA-224, байт
+    constexpr size_t DIGEST_SIZE = 28;
+    /// Сообщений в одной группе ядра AVX2
+    constexpr size_t LANES = 8;
+
+    /**
+     * @brief Сообщение из двух частей: prefix || suffix
+     * @details Соль и пароль хэшируются без сборки общей строки.
+     */
+    struct Message {
+        std::string_view prefix; ///< Начало сообщения
+        std::string_view suffix; ///< Продолжение сообщения
+    };
+
+    /// Ядро: digests[i * DIGEST_SIZE] = SHA224(messages[i]) для count сообщений
+    using Kernel = void (*)(const Message* messages, size_t count, unsigned char* digests);
+
+    /**
+     * @brief Старший уровень, поддерживаемый процессором
+     */
+    Level detect();
+
+    /**
+     * @brief Поддерживается ли уровень процессором
+     * @param level Уровень
+     */
+    bool supported(Level level);
+
+    /**
+     * @brief Ядро заданного уровня
+     * @param level Уровень (должен поддерживаться процессором)
+     */
+    Kernel kernel(Level level);
+
+    /**
+     * @brief Название уровня для логирования ("scalar", "avx2", "sha-ni")
+     * @param level Уровень
+     */
+    const char* name(Level level);
+
+    /**
+     * @brief Текущий уровень (по умолчанию detect())
+     */
+    Level active();
+
+    /**
+     * @brief Ядро текущего уровня
+     */
+    Kernel activeKernel();
+
+    /**
+     * @brief Принудительный выбор уровня (для тестов и сравнения ядер)
+     * @param level Уровень
+     * @return false если уровень не поддерживается (выбор не меняется)
+     */
+    bool select(Level level);
+}
+
+#endif
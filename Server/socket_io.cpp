@@ -0,0 +1,115 @@
+#include "socket_io.h"
+#include "network_utils.h"
+#include "uring_socket_io.h"
+
+#include <stdexcept>
+#include <sys/socket.h>
+
+/**
+ * @brief Отправляет данные и затем читает ответ заданной длины
+ * @details Реализация по умолчанию выполняет sendAll() и recvAll()
+ *          последовательно. UringSocketIo переопределяет метод, чтобы
+ *          отправить обе операции в ядро одним вызовом io_uring_enter().
+ * @param fd Файловый дескриптор сокета
+ * @param out Данные для отправки
+ * @param out_len Количество байт для отправки
+ * @param in Буфер для приема данных
+ * @param in_len Количество байт для чтения
+ * @return in_len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t SocketIo::sendThenRecv(int fd, const void* out, size_t out_len, void* in, size_t in_len)
+{
+    if(!sendAll(fd, out, out_len))
+        return -1;
+    return recvAll(fd, in, in_len);
+}
+
+/**
+ * @brief Отбрасывает входящие данные без копирования
+ * @details Реализация по умолчанию вызывает NetworkUtils::discardAll()
+ *          (recv() с MSG_TRUNC). Используется и UringSocketIo: между
+ *          операциями кольцо не держит незавершенных запросов к сокету,
+ *          поэтому прямой вызов recv() не нарушает порядок данных.
+ * @param fd Файловый дескриптор сокета
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t SocketIo::discardAll(int fd, size_t len)
+{
+    return NetworkUtils::discardAll(fd, len);
+}
+
+/**
+ * @brief Создает реализацию SocketIo по имени
+ * @param backend "posix" (recv/send) или "uring" (io_uring)
+ * @return Новый экземпляр реализации
+ * @throw std::invalid_argument при неизвестном имени реализации
+ * @throw std::system_error если io_uring не поддерживается ядром
+ */
+std::unique_ptr<SocketIo> SocketIo::create(const std::string& backend)
+{
+    if(backend == "posix")
+        return std::unique_ptr<SocketIo>(new PosixSocketIo());
+    if(backend == "uring")
+        return std::unique_ptr<SocketIo>(new UringSocketIo());
+    throw std::invalid_argument("Unknown I/O backend: " + backend);
+}
+
+/**
+ * @brief Возвращает общий экземпляр PosixSocketIo
+ * @details Используется обработчиками, которым не передана реализация явно.
+ *          PosixSocketIo не имеет состояния, поэтому экземпляр безопасно
+ *          использовать из нескольких потоков.
+ * @return Ссылка на экземпляр по умолчанию
+ */
+SocketIo& SocketIo::posix()
+{
+    static PosixSocketIo instance;
+    return instance;
+}
+
+/**
+ * @brief Однократное чтение через recv()
+ * @param fd Файловый дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Максимальное количество байт
+ * @return Результат recv()
+ */
+ssize_t PosixSocketIo::recvSome(int fd, void* buf, size_t len)
+{
+    return recv(fd, buf, len, 0);
+}
+
+/**
+ * @brief Гарантированное чтение через NetworkUtils::recvAll()
+ * @param fd Файловый дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Количество байт для чтения
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t PosixSocketIo::recvAll(int fd, void* buf, size_t len)
+{
+    return NetworkUtils::recvAll(fd, buf, len);
+}
+
+/**
+ * @brief Гарантированная отправка через send()
+ * @param fd Файловый дескриптор сокета
+ * @param buf Данные для отправки
+ * @param len Количество байт
+ * @return true если отправлены все данные
+ * @note Используется MSG_NOSIGNAL: разрыв соединения клиентом возвращает
+ *       ошибку вместо завершения сервера сигналом SIGPIPE
+ */
+bool PosixSocketIo::sendAll(int fd, const void* buf, size_t len)
+{
+    const char* p = static_cast<const char*>(buf);
+    while(len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if(w <= 0)
+            return false;
+        p += w;
+        len -= static_cast<size_t>(w);
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @class SocketIo
+ * @brief Абстракция блокирующего ввода-вывода через сокет
+ * @details Позволяет AuthHandler и VectorHandler работать с разными
+ *          реализациями системных вызовов: обычными recv()/send()
+ *          (PosixSocketIo) или io_uring (UringSocketIo).
+ *          Экземпляр не является потокобезопасным: каждый поток использует
+ *          собственный экземпляр.
+ */
+class SocketIo {
+public:
+    virtual ~SocketIo() = default;
+
+    /**
+     * @brief Название реализации (для логирования)
+     * @return "posix" или "uring"
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Однократное чтение из сокета (аналог recv())
+     * @param fd Файловый дескриптор сокета
+     * @param buf Буфер для приема данных
+     * @param len Максимальное количество байт
+     * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+     */
+    virtual ssize_t recvSome(int fd, void* buf, size_t len) = 0;
+
+    /**
+     * @brief Гарантированное чтение всех запрошенных данных
+     * @param fd Файловый дескриптор сокета
+     * @param buf Буфер для приема данных
+     * @param len Количество байт для чтения
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    virtual ssize_t recvAll(int fd, void* buf, size_t len) = 0;
+
+    /**
+     * @brief Гарантированная отправка всех данных
+     * @param fd Файловый дескриптор сокета
+     * @param buf Данные для отправки
+     * @param len Количество байт
+     * @return true если отправлены все данные, false в противном случае
+     */
+    virtual bool sendAll(int fd, const void* buf, size_t len) = 0;
+
+    /**
+     * @brief Отправка данных с последующим гарантированным чтением ответа
+     * @details Реализация может выполнить обе операции одним системным вызовом.
+     * @param fd Файловый дескриптор сокета
+     * @param out Данные для отправки
+     * @param out_len Количество байт для отправки
+     * @param in Буфер для приема данных
+     * @param in_len Количество байт для чтения
+     * @return in_len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    virtual ssize_t sendThenRecv(int fd, const void* out, size_t out_len, void* in, size_t in_len);
+
+    /**
+     * @brief Отбрасывание len байт входящих данных без копирования
+     * @param fd Файловый дескриптор сокета
+     * @param len Количество байт
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    virtual ssize_t discardAll(int fd, size_t len);
+
+    /**
+     * @brief Создание реализации по имени
+     * @param backend "posix" или "uring"
+     * @return Новый экземпляр реализации
+     * @throw std::invalid_argument при неизвестном имени
+     * @throw std::system_error если io_uring недоступен в ядре
+     */
+    static std::unique_ptr<SocketIo> create(const std::string& backend);
+
+    /**
+     * @brief Общий экземпляр PosixSocketIo (не имеет состояния)
+     * @return Ссылка на экземпляр по умолчанию
+     */
+    static SocketIo& posix();
+};
+
+/**
+ * @class PosixSocketIo
+ * @brief Реализация SocketIo на обычных вызовах recv()/send()
+ */
+class PosixSocketIo : public SocketIo {
+public:
+    const char* name() const override { return "posix"; }
+    ssize_t recvSome(int fd, void* buf, size_t len) override;
+    ssize_t recvAll(int fd, void* buf, size_t len) override;
+    bool sendAll(int fd, const void* buf, size_t len) override;
+};
+
+#endif
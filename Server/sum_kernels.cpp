@@ -0,0 +1,745 @@
+#include "sum_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <immintrin.h>
+
+namespace {
+
+// ====================================================================
+// Реализации
+// ====================================================================
+
+/**
+ * @brief Скалярное ядро
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+uint64_t sumScalar(const uint32_t* data, size_t count)
+{
+    uint64_t acc = 0;
+    for(size_t i = 0; i < count; ++i)
+        acc += data[i];
+    return acc;
+}
+
+/**
+ * @brief Ядро SSE4.2: по 4 элемента, расширение в две пары 64-битных линий
+ * @details Элементы расширяются чередованием с нулями (PUNPCKLDQ/PUNPCKHDQ):
+ *          порядок линий для суммы не важен.
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("sse4.2")))
+uint64_t sumSse42(const uint32_t* data, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+    }
+    __m128i acc = _mm_add_epi64(acc0, acc1);
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return sum + sumScalar(data + i, count - i);
+}
+
+/**
+ * @brief Ядро AVX2: по 8 элементов, расширение в две четверки 64-битных линий
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx2")))
+uint64_t sumAvx2(const uint32_t* data, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+    }
+    __m256i acc = _mm256_add_epi64(acc0, acc1);
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    return sum + sumScalar(data + i, count - i);
+}
+
+/**
+ * @brief Ядро AVX-512F: по 16 элементов, расширение в две восьмерки 64-битных линий
+ * @details Используются формы с маской (полной): немаскированные
+ *          интринсики GCC 12 дают ложные предупреждения -Wmaybe-uninitialized.
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx512f")))
+uint64_t sumAvx512(const uint32_t* data, size_t count)
+{
+    const __mmask16 ALL_LANES = 0xFFFF;
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i acc0 = _mm512_setzero_si512();
+    __m512i acc1 = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m512i v = _mm512_loadu_si512(data + i);
+        acc0 = _mm512_add_epi64(acc0, _mm512_maskz_unpacklo_epi32(ALL_LANES, v, zero));
+        acc1 = _mm512_add_epi64(acc1, _mm512_maskz_unpackhi_epi32(ALL_LANES, v, zero));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, _mm512_add_epi64(acc0, acc1));
+    uint64_t sum = 0;
+    for(uint64_t lane : lanes)
+        sum += lane;
+    return sum + sumScalar(data + i, count - i);
+}
+
+// ====================================================================
+// Ядра других типов элементов
+// ====================================================================
+
+/// Предел, которым ограничиваются элементы uint64_t (больше INT32_MAX)
+const uint64_t U64_CAP = uint64_t(1) << 31;
+
+/// Элементов uint16_t, после которых 32-битные линии расширяются до 64 бит
+const size_t U16_CHUNK = size_t(1) << 16;
+
+/**
+ * @brief Скалярное ядро для элементов типа T
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+template <typename T>
+SumKernels::KernelSum<T> sumScalarOf(const T* data, size_t count)
+{
+    SumKernels::KernelSum<T> acc = 0;
+    for(size_t i = 0; i < count; ++i)
+        acc += data[i];
+    return acc;
+}
+
+/**
+ * @brief Скалярное ядро uint64_t: элементы больше 2^31 считаются равными 2^31
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма ограниченных элементов
+ */
+uint64_t sumScalarU64(const uint64_t* data, size_t count)
+{
+    uint64_t acc = 0;
+    for(size_t i = 0; i < count; ++i)
+        acc += data[i] < U64_CAP ? data[i] : U64_CAP;
+    return acc;
+}
+
+/**
+ * @brief Ядро uint8_t SSE4.2: PSADBW против нуля суммирует по 8 байт в 64-битную линию
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("sse4.2")))
+uint64_t sumU8Sse42(const uint8_t* data, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    }
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint8_t AVX2: по 32 байта (VPSADBW)
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx2")))
+uint64_t sumU8Avx2(const uint8_t* data, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint8_t AVX-512BW: по 64 байта (VPSADBW)
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx512f,avx512bw")))
+uint64_t sumU8Avx512(const uint8_t* data, size_t count)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 64 <= count; i += 64) {
+        __m512i v = _mm512_loadu_si512(data + i);
+        acc = _mm512_add_epi64(acc, _mm512_sad_epu8(v, zero));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    uint64_t sum = 0;
+    for(uint64_t lane : lanes)
+        sum += lane;
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint16_t SSE4.2: расширение до 32-битных линий
+ * @details 32-битные линии расширяются до 64 бит каждые U16_CHUNK элементов,
+ *          до переполнения (линия получает не больше 2^14 элементов).
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("sse4.2")))
+uint64_t sumU16Sse42(const uint16_t* data, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    while(i + 8 <= count) {
+        size_t end = i + std::min(U16_CHUNK, (count - i) / 8 * 8);
+        __m128i acc32 = _mm_setzero_si128();
+        for(; i < end; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            acc32 = _mm_add_epi32(acc32, _mm_add_epi32(_mm_unpacklo_epi16(v, zero),
+                                                       _mm_unpackhi_epi16(v, zero)));
+        }
+        acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_unpacklo_epi32(acc32, zero),
+                                               _mm_unpackhi_epi32(acc32, zero)));
+    }
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint16_t AVX2: по 16 элементов в 32-битные линии
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx2")))
+uint64_t sumU16Avx2(const uint16_t* data, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    while(i + 16 <= count) {
+        size_t end = i + std::min(U16_CHUNK, (count - i) / 16 * 16);
+        __m256i acc32 = _mm256_setzero_si256();
+        for(; i < end; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            acc32 = _mm256_add_epi32(acc32, _mm256_add_epi32(_mm256_unpacklo_epi16(v, zero),
+                                                             _mm256_unpackhi_epi16(v, zero)));
+        }
+        acc = _mm256_add_epi64(acc, _mm256_add_epi64(_mm256_unpacklo_epi32(acc32, zero),
+                                                     _mm256_unpackhi_epi32(acc32, zero)));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint16_t AVX-512F: по 16 элементов (VPMOVZXWD) в 32-битные линии
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx512f")))
+uint64_t sumU16Avx512(const uint16_t* data, size_t count)
+{
+    const __mmask16 ALL_LANES = 0xFFFF;
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    while(i + 16 <= count) {
+        size_t end = i + std::min(U16_CHUNK, (count - i) / 16 * 16);
+        __m512i acc32 = _mm512_setzero_si512();
+        for(; i < end; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            acc32 = _mm512_add_epi32(acc32, _mm512_maskz_cvtepu16_epi32(ALL_LANES, v));
+        }
+        acc = _mm512_add_epi64(acc, _mm512_maskz_unpacklo_epi32(ALL_LANES, acc32, zero));
+        acc = _mm512_add_epi64(acc, _mm512_maskz_unpackhi_epi32(ALL_LANES, acc32, zero));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    uint64_t sum = 0;
+    for(uint64_t lane : lanes)
+        sum += lane;
+    return sum + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint64_t SSE4.2: элементы от 2^31 заменяются на 2^31 без ветвлений
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма ограниченных элементов
+ */
+__attribute__((target("sse4.2")))
+uint64_t sumU64Sse42(const uint64_t* data, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cap = _mm_set1_epi64x(static_cast<long long>(U64_CAP));
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i small = _mm_cmpeq_epi64(_mm_srli_epi64(v, 31), zero);
+        acc = _mm_add_epi64(acc, _mm_blendv_epi8(cap, v, small));
+    }
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return sum + sumScalarU64(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint64_t AVX2: по 4 элемента
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма ограниченных элементов
+ */
+__attribute__((target("avx2")))
+uint64_t sumU64Avx2(const uint64_t* data, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cap = _mm256_set1_epi64x(static_cast<long long>(U64_CAP));
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i small = _mm256_cmpeq_epi64(_mm256_srli_epi64(v, 31), zero);
+        acc = _mm256_add_epi64(acc, _mm256_blendv_epi8(cap, v, small));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    return sum + sumScalarU64(data + i, count - i);
+}
+
+/**
+ * @brief Ядро uint64_t AVX-512F: по 8 элементов (VPMINUQ)
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма ограниченных элементов
+ */
+__attribute__((target("avx512f")))
+uint64_t sumU64Avx512(const uint64_t* data, size_t count)
+{
+    const __mmask8 ALL_LANES = 0xFF;
+    const __m512i cap = _mm512_set1_epi64(static_cast<long long>(U64_CAP));
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m512i v = _mm512_loadu_si512(data + i);
+        acc = _mm512_add_epi64(acc, _mm512_maskz_min_epu64(ALL_LANES, v, cap));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    uint64_t sum = 0;
+    for(uint64_t lane : lanes)
+        sum += lane;
+    return sum + sumScalarU64(data + i, count - i);
+}
+
+/**
+ * @brief Ядро int32_t SSE4.2: знаковое расширение (PMOVSXDQ) до 64-битных линий
+ * @details Линии складываются по модулю 2^64, итог приводится к int64_t:
+ *          знаковая сумма вектора до 10^7 элементов в него помещается.
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("sse4.2")))
+int64_t sumI32Sse42(const int32_t* data, size_t count)
+{
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(acc, 1));
+    return static_cast<int64_t>(sum) + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро int32_t AVX2: по 8 элементов
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx2")))
+int64_t sumI32Avx2(const int32_t* data, size_t count)
+{
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 4));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(lo));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(hi));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+    return static_cast<int64_t>(sum) + sumScalarOf(data + i, count - i);
+}
+
+/**
+ * @brief Ядро int32_t AVX-512F: по 16 элементов
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов
+ */
+__attribute__((target("avx512f")))
+int64_t sumI32Avx512(const int32_t* data, size_t count)
+{
+    const __mmask8 ALL_LANES = 0xFF;
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 8));
+        acc = _mm512_add_epi64(acc, _mm512_maskz_cvtepi32_epi64(ALL_LANES, lo));
+        acc = _mm512_add_epi64(acc, _mm512_maskz_cvtepi32_epi64(ALL_LANES, hi));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    uint64_t sum = 0;
+    for(uint64_t lane : lanes)
+        sum += lane;
+    return static_cast<int64_t>(sum) + sumScalarOf(data + i, count - i);
+}
+
+// ====================================================================
+// Ядра отрезков
+// ====================================================================
+
+/// Предел суммы отрезка
+const uint64_t SEGMENT_LIMIT = static_cast<uint64_t>(std::numeric_limits<int32_t>::max());
+
+/**
+ * @brief Скалярное ядро отрезков
+ * @param prefix Префиксные суммы
+ * @param offsets Границы отрезков
+ * @param segments Количество отрезков
+ * @param results Суммы отрезков с ограничением
+ */
+void clampSegmentsScalar(const uint64_t* prefix, const uint32_t* offsets,
+                         size_t segments, int32_t* results)
+{
+    for(size_t i = 0; i < segments; ++i) {
+        uint64_t sum = prefix[offsets[i + 1]] - prefix[offsets[i]];
+        results[i] = static_cast<int32_t>(sum < SEGMENT_LIMIT ? sum : SEGMENT_LIMIT);
+    }
+}
+
+/**
+ * @brief Ядро отрезков AVX2: по 4 отрезка
+ * @details Начала и концы отрезков читаются из префиксных сумм двумя
+ *          gather, разность ограничивается без ветвлений (сравнение и
+ *          blend; разность меньше 2^63, поэтому знаковое сравнение
+ *          корректно), младшие половины 64-битных линий собираются
+ *          перестановкой в 4 результата.
+ * @param prefix Префиксные суммы
+ * @param offsets Границы отрезков
+ * @param segments Количество отрезков
+ * @param results Суммы отрезков с ограничением
+ */
+__attribute__((target("avx2")))
+void clampSegmentsAvx2(const uint64_t* prefix, const uint32_t* offsets,
+                       size_t segments, int32_t* results)
+{
+    const long long* base = reinterpret_cast<const long long*>(prefix);
+    const __m256i limit = _mm256_set1_epi64x(static_cast<long long>(SEGMENT_LIMIT));
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    size_t i = 0;
+    for(; i + 4 <= segments; i += 4) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + i));
+        __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + i + 1));
+        __m256i sum = _mm256_sub_epi64(_mm256_i32gather_epi64(base, last, 8),
+                                       _mm256_i32gather_epi64(base, first, 8));
+        sum = _mm256_blendv_epi8(sum, limit, _mm256_cmpgt_epi64(sum, limit));
+        __m256i packed = _mm256_permutevar8x32_epi32(sum, low_halves);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i), _mm256_castsi256_si128(packed));
+    }
+    clampSegmentsScalar(prefix, offsets + i, segments - i, results + i);
+}
+
+/**
+ * @brief Ядро отрезков AVX-512F: по 8 отрезков
+ * @details Как и в sumAvx512(), используются формы с полной маской.
+ * @param prefix Префиксные суммы
+ * @param offsets Границы отрезков
+ * @param segments Количество отрезков
+ * @param results Суммы отрезков с ограничением
+ */
+__attribute__((target("avx512f")))
+void clampSegmentsAvx512(const uint64_t* prefix, const uint32_t* offsets,
+                         size_t segments, int32_t* results)
+{
+    const __mmask8 ALL_LANES = 0xFF;
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i limit = _mm512_set1_epi64(static_cast<long long>(SEGMENT_LIMIT));
+    size_t i = 0;
+    for(; i + 8 <= segments; i += 8) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i));
+        __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i + 1));
+        __m512i sum = _mm512_sub_epi64(_mm512_mask_i32gather_epi64(zero, ALL_LANES, last, prefix, 8),
+                                       _mm512_mask_i32gather_epi64(zero, ALL_LANES, first, prefix, 8));
+        sum = _mm512_maskz_min_epu64(ALL_LANES, sum, limit);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i),
+                            _mm512_maskz_cvtepi64_epi32(ALL_LANES, sum));
+    }
+    clampSegmentsScalar(prefix, offsets + i, segments - i, results + i);
+}
+
+/**
+ * @brief Текущий уровень (инициализируется detect() при первом обращении)
+ * @return Ссылка на атомарный уровень
+ */
+std::atomic<SumKernels::Level>& current()
+{
+    static std::atomic<SumKernels::Level> level{SumKernels::detect()};
+    return level;
+}
+
+}
+
+// ====================================================================
+// Выбор реализации
+// ====================================================================
+
+/**
+ * @brief Определяет старший поддерживаемый уровень
+ * @details __builtin_cpu_supports() читает результаты CPUID (и XGETBV для
+ *          проверки сохранения регистров ОС), полученные при запуске.
+ * @return Уровень
+ */
+SumKernels::Level SumKernels::detect()
+{
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return Level::Avx512;
+    if(__builtin_cpu_supports("avx2"))
+        return Level::Avx2;
+    if(__builtin_cpu_supports("sse4.2"))
+        return Level::Sse42;
+    return Level::Scalar;
+}
+
+/**
+ * @brief Проверяет поддержку уровня процессором
+ * @param level Уровень
+ * @return true если уровень не выше detect()
+ */
+bool SumKernels::supported(Level level)
+{
+    return static_cast<int>(level) <= static_cast<int>(detect());
+}
+
+/**
+ * @brief Возвращает ядро уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+SumKernels::Kernel SumKernels::kernel(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return sumAvx512;
+    case Level::Avx2:   return sumAvx2;
+    case Level::Sse42:  return sumSse42;
+    case Level::Scalar: break;
+    }
+    return sumScalar;
+}
+
+/**
+ * @brief Возвращает ядро uint8_t уровня
+ * @details Ядро AVX-512 использует AVX-512BW (VPSADBW на 512 битах); без
+ *          него на уровне Avx512 используется ядро AVX2.
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+template <>
+SumKernels::KernelOf<uint8_t> SumKernels::kernelFor<uint8_t>(Level level)
+{
+    switch(level) {
+    case Level::Avx512:
+        if(__builtin_cpu_supports("avx512bw"))
+            return sumU8Avx512;
+        return sumU8Avx2;
+    case Level::Avx2:   return sumU8Avx2;
+    case Level::Sse42:  return sumU8Sse42;
+    case Level::Scalar: break;
+    }
+    return sumScalarOf<uint8_t>;
+}
+
+/**
+ * @brief Возвращает ядро uint16_t уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+template <>
+SumKernels::KernelOf<uint16_t> SumKernels::kernelFor<uint16_t>(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return sumU16Avx512;
+    case Level::Avx2:   return sumU16Avx2;
+    case Level::Sse42:  return sumU16Sse42;
+    case Level::Scalar: break;
+    }
+    return sumScalarOf<uint16_t>;
+}
+
+/**
+ * @brief Возвращает ядро uint32_t уровня (то же, что kernel())
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+template <>
+SumKernels::KernelOf<uint32_t> SumKernels::kernelFor<uint32_t>(Level level)
+{
+    return kernel(level);
+}
+
+/**
+ * @brief Возвращает ядро uint64_t уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+template <>
+SumKernels::KernelOf<uint64_t> SumKernels::kernelFor<uint64_t>(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return sumU64Avx512;
+    case Level::Avx2:   return sumU64Avx2;
+    case Level::Sse42:  return sumU64Sse42;
+    case Level::Scalar: break;
+    }
+    return sumScalarU64;
+}
+
+/**
+ * @brief Возвращает ядро int32_t уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+template <>
+SumKernels::KernelOf<int32_t> SumKernels::kernelFor<int32_t>(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return sumI32Avx512;
+    case Level::Avx2:   return sumI32Avx2;
+    case Level::Sse42:  return sumI32Sse42;
+    case Level::Scalar: break;
+    }
+    return sumScalarOf<int32_t>;
+}
+
+/**
+ * @brief Возвращает ядро отрезков уровня
+ * @param level Уровень
+ * @return Указатель на функцию ядра
+ */
+SumKernels::SegmentKernel SumKernels::segmentKernel(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return clampSegmentsAvx512;
+    case Level::Avx2:   return clampSegmentsAvx2;
+    case Level::Sse42:
+    case Level::Scalar: break;
+    }
+    return clampSegmentsScalar;
+}
+
+/**
+ * @brief Возвращает название уровня
+ * @param level Уровень
+ * @return Строка для логирования
+ */
+const char* SumKernels::name(Level level)
+{
+    switch(level) {
+    case Level::Avx512: return "avx512";
+    case Level::Avx2:   return "avx2";
+    case Level::Sse42:  return "sse4.2";
+    case Level::Scalar: break;
+    }
+    return "scalar";
+}
+
+/**
+ * @brief Возвращает текущий уровень
+ * @return Уровень
+ */
+SumKernels::Level SumKernels::active()
+{
+    return current().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает ядро текущего уровня
+ * @return Указатель на функцию ядра
+ */
+SumKernels::Kernel SumKernels::activeKernel()
+{
+    return kernel(active());
+}
+
+/**
+ * @brief Возвращает ядро отрезков текущего уровня
+ * @return Указатель на функцию ядра
+ */
+SumKernels::SegmentKernel SumKernels::activeSegmentKernel()
+{
+    return segmentKernel(active());
+}
+
+/**
+ * @brief Выбирает уровень
+ * @param level Уровень
+ * @return false если уровень не поддерживается процессором
+ */
+bool SumKernels::select(Level level)
+{
+    if(!supported(level))
+        return false;
+    current().store(level, std::memory_order_relaxed);
+    return true;
+}
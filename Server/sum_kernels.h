@@ -0,0 +1,114 @@
+#ifndef SUM_KERNELS_H
+#define SUM_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Ядра суммирования блока uint32_t в 64-битный результат
+ * @details Векторные реализации расширяют элементы до uint64_t в линиях
+ *          регистров, поэтому переполнение внутри блока невозможно
+ *          (блок до 2^32 элементов). Реализация выбирается один раз по
+ *          CPUID (__builtin_cpu_supports) при первом обращении.
+ */
+namespace SumKernels {
+    /**
+     * @brief Уровень набора инструкций
+     */
+    enum class Level {
+        Scalar, ///< Обычный цикл
+        Sse42,  ///< SSE4.2 (128 бит)
+        Avx2,   ///< AVX2 (256 бит)
+        Avx512  ///< AVX-512F (512 бит)
+    };
+
+    /// Ядро: сумма count элементов
+    using Kernel = uint64_t (*)(const uint32_t* data, size_t count);
+
+    /// Тип суммы ядра для элементов T: int64_t для знаковых, иначе uint64_t
+    template <typename T>
+    using KernelSum = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+
+    /**
+     * @brief Ядро для элементов типа T (uint8_t, uint16_t, uint32_t, uint64_t, int32_t)
+     * @details Ядро uint64_t считает элементы больше 2^31 равными 2^31: сумма
+     *          блока не переполняется, а сумма с ограничением INT32_MAX та же.
+     */
+    template <typename T>
+    using KernelOf = KernelSum<T> (*)(const T* data, size_t count);
+
+    /**
+     * @brief Ядро отрезков: results[i] = min(prefix[offsets[i+1]] - prefix[offsets[i]], INT32_MAX)
+     * @details prefix - префиксные суммы полезной нагрузки, offsets - границы
+     *          segments отрезков (segments + 1 значение, меньше 2^31).
+     */
+    using SegmentKernel = void (*)(const uint64_t* prefix, const uint32_t* offsets,
+                                   size_t segments, int32_t* results);
+
+    /**
+     * @brief Старший уровень, поддерживаемый процессором
+     */
+    Level detect();
+
+    /**
+     * @brief Поддерживается ли уровень процессором
+     * @param level Уровень
+     */
+    bool supported(Level level);
+
+    /**
+     * @brief Ядро заданного уровня
+     * @param level Уровень (должен поддерживаться процессором)
+     */
+    Kernel kernel(Level level);
+
+    /**
+     * @brief Ядро отрезков заданного уровня (SSE4.2 - скалярное: нет gather)
+     * @param level Уровень (должен поддерживаться процессором)
+     */
+    SegmentKernel segmentKernel(Level level);
+
+    /**
+     * @brief Ядро для элементов типа T заданного уровня
+     * @param level Уровень (должен поддерживаться процессором)
+     */
+    template <typename T>
+    KernelOf<T> kernelFor(Level level);
+
+    template <> KernelOf<uint8_t> kernelFor<uint8_t>(Level level);
+    template <> KernelOf<uint16_t> kernelFor<uint16_t>(Level level);
+    template <> KernelOf<uint32_t> kernelFor<uint32_t>(Level level);
+    template <> KernelOf<uint64_t> kernelFor<uint64_t>(Level level);
+    template <> KernelOf<int32_t> kernelFor<int32_t>(Level level);
+
+    /**
+     * @brief Название уровня для логирования ("scalar", "sse4.2", "avx2", "avx512")
+     * @param level Уровень
+     */
+    const char* name(Level level);
+
+    /**
+     * @brief Текущий уровень (по умолчанию detect())
+     */
+    Level active();
+
+    /**
+     * @brief Ядро текущего уровня
+     */
+    Kernel activeKernel();
+
+    /**
+     * @brief Ядро отрезков текущего уровня
+     */
+    SegmentKernel activeSegmentKernel();
+
+    /**
+     * @brief Принудительный выбор уровня (для тестов и сравнения ядер)
+     * @param level Уровень
+     * @return false если уровень не поддерживается (выбор не меняется)
+     */
+    bool select(Level level);
+}
+
+#endif
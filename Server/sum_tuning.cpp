@@ -0,0 +1,294 @@
+#include "sum_tuning.h"
+#include "sum_kernels.h"
+#include "parallel_sum.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// ====================================================================
+// Замеры
+// ====================================================================
+
+/// Размеры (элементов) для сравнения скалярного и векторного ядра: 1..4096
+const size_t SIMD_SIZES[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+/// Размеры (элементов) для сравнения однопоточного и параллельного суммирования
+const size_t PARALLEL_SIZES[] = {16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20};
+
+/// Элементов, суммируемых ядром за один замер (вызовы повторяются до этого объема)
+const size_t KERNEL_TRIAL_ELEMS = 64 << 10;
+
+/// Повторов каждого замера (берется наименьшее время)
+const int TRIALS = 5;
+
+/// Приемник результатов, чтобы компилятор не выбросил замеряемые вызовы
+volatile uint64_t sink;
+
+/**
+ * @brief Наименьшее время выполнения функции за TRIALS повторов
+ * @param fn Замеряемая функция
+ * @return Время в наносекундах
+ */
+template <typename Fn>
+int64_t bestTime(Fn fn)
+{
+    int64_t best = -1;
+    for(int t = 0; t < TRIALS; ++t) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if(best < 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+/**
+ * @brief Время суммирования KERNEL_TRIAL_ELEMS элементов вызовами ядра по size
+ * @param kernel Ядро
+ * @param data Элементы (не меньше size)
+ * @param size Элементов в вызове
+ * @return Время в наносекундах
+ */
+int64_t kernelTime(SumKernels::Kernel kernel, const uint32_t* data, size_t size)
+{
+    size_t calls = std::max<size_t>(KERNEL_TRIAL_ELEMS / size, 1);
+    return bestTime([&] {
+        uint64_t acc = 0;
+        for(size_t c = 0; c < calls; ++c)
+            acc += kernel(data, size);
+        sink = acc;
+    });
+}
+
+/**
+ * @brief Порог по результатам замеров
+ * @details Порог - наименьший размер, начиная с которого более сложный
+ *          способ выигрывает на всех замеренных размерах. Если он
+ *          выигрывает уже на первом размере, порог равен first.
+ * @param sizes Размеры по возрастанию
+ * @param wins Выигрывает ли способ на каждом размере
+ * @param first Порог при выигрыше на всех размерах
+ * @return Порог или SumTuning::THRESHOLD_OFF
+ */
+size_t crossover(const std::vector<size_t>& sizes, const std::vector<bool>& wins, size_t first)
+{
+    size_t threshold = SumTuning::THRESHOLD_OFF;
+    for(size_t i = sizes.size(); i-- > 0 && wins[i];)
+        threshold = i == 0 ? first : sizes[i];
+    return threshold;
+}
+
+// ====================================================================
+// Файл настройки
+// ====================================================================
+
+/**
+ * @brief Разбирает значение порога
+ * @param text Число или "off"
+ * @param out Порог
+ * @return false если значение некорректно
+ */
+bool parseThreshold(const std::string& text, size_t& out)
+{
+    if(text == "off") {
+        out = SumTuning::THRESHOLD_OFF;
+        return true;
+    }
+    if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    std::istringstream ss(text);
+    return static_cast<bool>(ss >> out);
+}
+
+/**
+ * @brief Форматирует значение порога
+ * @param value Порог
+ * @return Число или "off"
+ */
+std::string formatThreshold(size_t value)
+{
+    return value == SumTuning::THRESHOLD_OFF ? "off" : std::to_string(value);
+}
+
+/**
+ * @brief Число вычислительных потоков для сверки файла настройки
+ * @param parallel Пул или nullptr
+ * @return Количество потоков (0 без пула)
+ */
+size_t tuningThreads(ParallelSum* parallel)
+{
+    return parallel ? parallel->threads() : 0;
+}
+
+}
+
+// ====================================================================
+// Калибровка
+// ====================================================================
+
+/**
+ * @brief Измеряет пороги выбора способа суммирования
+ * @details 1. Скалярное и текущее векторное ядро SumKernels суммируют
+ *             одинаковый объем вызовами по 1..4096 элементов; simd_min -
+ *             наименьший размер, начиная с которого векторное ядро быстрее.
+ *          2. При заданном пуле VectorProcessor::sumClamp() и
+ *             ParallelSum::sumParallel() суммируют векторы 16K..4M элементов;
+ *             parallel_min - наименьший размер, начиная с которого
+ *             параллельное суммирование быстрее (THRESHOLD_OFF, если оно
+ *             не выигрывает и на 4M, например на одном ядре).
+ *          Каждый замер повторяется TRIALS раз, берется наименьшее время.
+ *          Элементы равны 1, поэтому насыщение не прерывает суммирование.
+ * @param parallel Пул параллельного суммирования или nullptr
+ * @return Пороги (текущие пороги VectorProcessor не меняются)
+ */
+SumThresholds SumTuning::calibrate(ParallelSum* parallel)
+{
+    SumThresholds t;
+
+    std::vector<uint32_t> small(SIMD_SIZES[std::size(SIMD_SIZES) - 1], 1);
+    SumKernels::Kernel scalar = SumKernels::kernel(SumKernels::Level::Scalar);
+    SumKernels::Kernel simd = SumKernels::activeKernel();
+    if(simd != scalar) {
+        std::vector<size_t> sizes(std::begin(SIMD_SIZES), std::end(SIMD_SIZES));
+        std::vector<bool> wins;
+        for(size_t size : sizes)
+            wins.push_back(kernelTime(simd, small.data(), size) < kernelTime(scalar, small.data(), size));
+        t.simd_min = crossover(sizes, wins, 0);
+    }
+
+    if(parallel) {
+        std::vector<uint32_t> large(PARALLEL_SIZES[std::size(PARALLEL_SIZES) - 1], 1);
+        std::vector<size_t> sizes(std::begin(PARALLEL_SIZES), std::end(PARALLEL_SIZES));
+        std::vector<bool> wins;
+        for(size_t size : sizes) {
+            int64_t single = bestTime([&] { sink = VectorProcessor::sumClamp(large.data(), size); });
+            int64_t multi = bestTime([&] { sink = parallel->sumParallel(large.data(), size); });
+            wins.push_back(multi < single);
+        }
+        t.parallel_min = crossover(sizes, wins, sizes.front());
+    }
+    return t;
+}
+
+// ====================================================================
+// Файл настройки
+// ====================================================================
+
+/**
+ * @brief Загружает пороги из файла настройки
+ * @details Файл принимается, только если в нем указаны текущее ядро
+ *          SumKernels и то же число вычислительных потоков, а оба порога
+ *          присутствуют и корректны. Неизвестные ключи игнорируются.
+ * @param path Путь к файлу
+ * @param parallel Пул параллельного суммирования или nullptr
+ * @param out Загруженные пороги (меняются только при успехе)
+ * @return true если пороги загружены
+ */
+bool SumTuning::load(const std::string& path, ParallelSum* parallel, SumThresholds& out)
+{
+    std::ifstream ifs(path);
+    if(!ifs.is_open())
+        return false;
+
+    std::string kernel, threads;
+    bool has_simd = false, has_parallel = false;
+    SumThresholds t;
+    std::string line;
+    while(std::getline(ifs, line)) {
+        if(line.empty() || line[0] == '#')
+            continue;
+        size_t eq = line.find('=');
+        if(eq == std::string::npos)
+            return false;
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+        if(key == "kernel")
+            kernel = value;
+        else if(key == "threads")
+            threads = value;
+        else if(key == "simd_min")
+            has_simd = parseThreshold(value, t.simd_min);
+        else if(key == "parallel_min")
+            has_parallel = parseThreshold(value, t.parallel_min);
+    }
+
+    if(kernel != SumKernels::name(SumKernels::active()) ||
+       threads != std::to_string(tuningThreads(parallel)) ||
+       !has_simd || !has_parallel)
+        return false;
+    out = t;
+    return true;
+}
+
+/**
+ * @brief Сохраняет пороги в файл настройки
+ * @param path Путь к файлу
+ * @param parallel Пул параллельного суммирования или nullptr
+ * @param t Пороги
+ * @return false если файл не удалось открыть или записать
+ */
+bool SumTuning::save(const std::string& path, ParallelSum* parallel, const SumThresholds& t)
+{
+    std::ofstream ofs(path, std::ios::trunc);
+    if(!ofs.is_open())
+        return false;
+    ofs << "# Sum strategy thresholds (elements), written by the server calibration\n"
+        << "kernel=" << SumKernels::name(SumKernels::active()) << "\n"
+        << "threads=" << tuningThreads(parallel) << "\n"
+        << "simd_min=" << formatThreshold(t.simd_min) << "\n"
+        << "parallel_min=" << formatThreshold(t.parallel_min) << "\n";
+    return static_cast<bool>(ofs.flush());
+}
+
+// ====================================================================
+// Настройка при запуске
+// ====================================================================
+
+/**
+ * @brief Загружает или измеряет пороги и устанавливает их
+ * @details Если файл настройки задан и подходит (load()), пороги берутся
+ *          из него. Иначе выполняется calibrate(), и при заданном пути
+ *          результат записывается в файл для следующих запусков; ошибка
+ *          записи только логируется.
+ * @param path Файл настройки ("" - калибровка при каждом запуске)
+ * @param parallel Пул параллельного суммирования или nullptr
+ * @param logger Логгер
+ * @return Установленные пороги
+ */
+SumThresholds SumTuning::configure(const std::string& path, ParallelSum* parallel, Logger& logger)
+{
+    SumThresholds t;
+    if(!path.empty() && load(path, parallel, t)) {
+        logger.info("Sum thresholds loaded from " + path + ": " + describe(t));
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        t = calibrate(parallel);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        logger.info("Sum thresholds calibrated in " + std::to_string(ms) + " ms: " + describe(t));
+        if(!path.empty() && !save(path, parallel, t))
+            logger.warning("Cannot write tuning file: " + path);
+    }
+    VectorProcessor::setThresholds(t);
+    return t;
+}
+
+/**
+ * @brief Форматирует пороги для лога
+ * @param t Пороги
+ * @return Строка вида "simd_min=16 parallel_min=1048576"
+ */
+std::string SumTuning::describe(const SumThresholds& t)
+{
+    return "simd_min=" + formatThreshold(t.simd_min) +
+           " parallel_min=" + formatThreshold(t.parallel_min);
+}
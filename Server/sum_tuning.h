@@ -0,0 +1,70 @@
+#ifndef SUM_TUNING_H
+#define SUM_TUNING_H
+
+#include <string>
+#include "vector_processor.h"
+
+class ParallelSum;
+class Logger;
+
+/**
+ * @class SumTuning
+ * @brief Калибровка порогов выбора способа суммирования (SumThresholds)
+ * @details Пороги зависят от поколения процессора, поэтому при запуске
+ *          сервера измеряется, с какого размера векторное ядро обгоняет
+ *          скалярное, а параллельное суммирование - однопоточное.
+ *          Результат можно сохранить в файл настройки и загружать при
+ *          следующих запусках; файл привязан к ядру SumKernels и числу
+ *          вычислительных потоков и пересчитывается при их изменении.
+ *          Формат файла: строки "ключ=значение" (kernel, threads, simd_min,
+ *          parallel_min), строки с '#' - комментарии.
+ */
+class SumTuning {
+public:
+    /// Порог, при котором способ не используется ни для какого размера ("off" в файле)
+    static constexpr size_t THRESHOLD_OFF = static_cast<size_t>(-1);
+
+    /**
+     * @brief Короткий замер (порядка десятков миллисекунд)
+     * @param parallel Пул параллельного суммирования (nullptr - parallel_min
+     *        остается по умолчанию)
+     * @return Пороги
+     */
+    static SumThresholds calibrate(ParallelSum* parallel);
+
+    /**
+     * @brief Загрузка порогов из файла настройки
+     * @param path Путь к файлу
+     * @param parallel Пул (для сверки числа потоков)
+     * @param out Загруженные пороги
+     * @return false если файла нет, он поврежден или снят на другом ядре/числе потоков
+     */
+    static bool load(const std::string& path, ParallelSum* parallel, SumThresholds& out);
+
+    /**
+     * @brief Сохранение порогов в файл настройки
+     * @param path Путь к файлу
+     * @param parallel Пул (число потоков записывается в файл)
+     * @param t Пороги
+     * @return false если файл не удалось записать
+     */
+    static bool save(const std::string& path, ParallelSum* parallel, const SumThresholds& t);
+
+    /**
+     * @brief Настройка при запуске сервера: загрузка или калибровка,
+     *        установка (VectorProcessor::setThresholds()) и запись в лог
+     * @param path Файл настройки ("" - калибровать без файла)
+     * @param parallel Пул параллельного суммирования или nullptr
+     * @param logger Логгер
+     * @return Установленные пороги
+     */
+    static SumThresholds configure(const std::string& path, ParallelSum* parallel, Logger& logger);
+
+    /**
+     * @brief Текстовое представление порогов для лога
+     * @param t Пороги
+     */
+    static std::string describe(const SumThresholds& t);
+};
+
+#endif
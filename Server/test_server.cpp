@@ -1,11 +1,27 @@
 #include <UnitTest++/UnitTest++.h>
 #include "serverInterface.h"
 #include "vector_processor.h"
+#include "sum_kernels.h"
+#include "reduce_kernels.h"
 #include "vector_handler.h"
 #include "logger.h"
 #include "network_utils.h"
 #include "authdb.h"
 #include "auth_handler.h"
+#include "client_session.h"
+#include "coro_server.h"
+#include "thread_pool.h"
+#include "parallel_sum.h"
+#include "sum_tuning.h"
+#include "socket_io.h"
+#include "result_batcher.h"
+#include "buffered_socket_reader.h"
+#include "buffer_pool.h"
+#include "uring_socket_io.h"
+#include "session_tickets.h"
+#include "sha_kernels.h"
+#include "crypto_pool.h"
+#include "rate_limiter.h"
 
 #include <string>
 #include <vector>
@@ -15,11 +31,48 @@
 #include <memory>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
 #include <arpa/inet.h>
 #include <sstream>
 #include <stdexcept>
 #include <cstdio>
 #include <regex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <semaphore>
+#include <system_error>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cryptopp/sha.h>
+#include <new>
+#include <cstdlib>
+
+// ============================================================
+// Подсчет выделений памяти (замена глобального operator new)
+// ============================================================
+
+static std::atomic<bool> g_countAllocations{false}; ///< Включен ли подсчет
+static std::atomic<size_t> g_allocations{0};        ///< Число выделений при включенном подсчете
+
+// Пара malloc()/free() согласована, но GCC видит free() на месте delete-выражений
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    if(g_countAllocations.load(std::memory_order_relaxed))
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#pragma GCC diagnostic pop
 
 TEST(TestServerInterface_HelpOptions) {
     // Тест 1.1: -h
@@ -388,6 +441,191 @@ TEST(TestServerInterface_EmptyStrings) {
     }
 }
 
+TEST(TestServerInterface_EpollOption) {
+    // По умолчанию используется последовательный режим
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "-p", "8080"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(false, iface.getParams().epoll);
+    }
+    
+    // --epoll включает событийный цикл
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--epoll"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(true, iface.getParams().epoll);
+    }
+    
+    // -e (короткая форма)
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "-e", "-p", "9090"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(true, iface.getParams().epoll);
+        CHECK_EQUAL(9090, iface.getParams().port);
+    }
+}
+
+TEST(TestServerInterface_CoroOption) {
+    // По умолчанию сопрограммы не используются
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(false, iface.getParams().coro);
+    }
+    
+    // -c (короткая форма) совместно с шардами
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "-c", "--shards", "2"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(true, iface.getParams().coro);
+        CHECK_EQUAL(2, iface.getParams().shards);
+    }
+}
+
+TEST(TestServerInterface_ComputeThreadsOption) {
+    // По умолчанию параллельное суммирование выключено
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(0, iface.getParams().computeThreads);
+    }
+    
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--compute-threads", "4", "-w", "8"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(4, iface.getParams().computeThreads);
+        CHECK_EQUAL(8, iface.getParams().workers);
+    }
+}
+
+TEST(TestServerInterface_TuningOption) {
+    // По умолчанию файла настройки нет - калибровка при каждом запуске
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK(iface.getParams().tuningFile.empty());
+    }
+    
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--tuning", "sum.tuning"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL("sum.tuning", iface.getParams().tuningFile);
+    }
+}
+
+TEST(TestServerInterface_WorkersOption) {
+    // По умолчанию пул потоков не используется
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(0, iface.getParams().workers);
+    }
+    
+    // --workers 32
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--workers", "32"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(32, iface.getParams().workers);
+    }
+    
+    // -w без значения
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "-w"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(!iface.parse(argc, const_cast<char**>(argv)));
+    }
+}
+
+TEST(TestServerInterface_ShardsOption) {
+    // По умолчанию шарды не используются
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(0, iface.getParams().shards);
+    }
+    
+    // --shards 32 -e
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--shards", "32", "-e"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL(32, iface.getParams().shards);
+        CHECK_EQUAL(true, iface.getParams().epoll);
+    }
+    
+    // -s не число
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "-s", "all"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(!iface.parse(argc, const_cast<char**>(argv)));
+    }
+}
+
+TEST(TestServerInterface_IoOption) {
+    // По умолчанию - posix
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL("posix", iface.getParams().ioBackend);
+    }
+    
+    // --io uring
+    {
+        ServerInterface iface;
+        const char* argv[] = {"program", "--io", "uring", "-w", "4"};
+        int argc = sizeof(argv)/sizeof(argv[0]);
+        
+        CHECK(iface.parse(argc, const_cast<char**>(argv)));
+        CHECK_EQUAL("uring", iface.getParams().ioBackend);
+        CHECK_EQUAL(4, iface.getParams().workers);
+    }
+}
+
 TEST(TestServerInterface_GetDescription) {
     ServerInterface iface;
     std::string desc = iface.getDescription();
@@ -399,6 +637,16 @@ TEST(TestServerInterface_GetDescription) {
     CHECK(desc.find("--address") != std::string::npos);
     CHECK(desc.find("--log") != std::string::npos);
     CHECK(desc.find("--clients-db") != std::string::npos);
+    CHECK(desc.find("--epoll") != std::string::npos);
+    CHECK(desc.find("--coro") != std::string::npos);
+    CHECK(desc.find("--workers") != std::string::npos);
+    CHECK(desc.find("--shards") != std::string::npos);
+    CHECK(desc.find("--io") != std::string::npos);
+    CHECK(desc.find("--pipeline") != std::string::npos);
+    CHECK(desc.find("--stream") != std::string::npos);
+    CHECK(desc.find("--batch") != std::string::npos);
+    CHECK(desc.find("--compute-threads") != std::string::npos);
+    CHECK(desc.find("--tuning") != std::string::npos);
 }
 
 
@@ -484,6 +732,434 @@ SUITE(VectorProcessorTests)
         std::vector<uint32_t> v3(10000000, 1u);
         CHECK_EQUAL(10000000, VectorProcessor::sumClamp(v3)); // Ограничено max int32
     }
+    
+    TEST(Streaming_MatchesSumClampForAnySplit) {
+        std::vector<std::vector<uint32_t>> cases = {
+            {1, 2, 3, 4, 5, 6, 7},
+            {2147483647u, 1u, 5u},
+            {1000000000u, 1000000000u, 1000000000u, 7u},
+            {4294967295u, 4294967295u},
+            std::vector<uint32_t>(1000, 3000000u)
+        };
+        for(const std::vector<uint32_t>& v : cases) {
+            for(size_t step = 1; step <= v.size(); ++step) {
+                VectorProcessor::SumState st;
+                VectorProcessor::sumInit(st);
+                for(size_t pos = 0; pos < v.size(); pos += step)
+                    VectorProcessor::sumUpdate(st, v.data() + pos, std::min(step, v.size() - pos));
+                CHECK_EQUAL(VectorProcessor::sumClamp(v), VectorProcessor::sumFinish(st));
+            }
+        }
+    }
+    
+    TEST(Streaming_SaturationIsSticky) {
+        VectorProcessor::SumState st;
+        VectorProcessor::sumInit(st);
+        uint32_t big[] = {2147483647u, 1u};
+        VectorProcessor::sumUpdate(st, big, 2);
+        CHECK(st.saturated);
+        
+        uint32_t more[] = {5u};
+        VectorProcessor::sumUpdate(st, more, 1);
+        CHECK_EQUAL(2147483647, VectorProcessor::sumFinish(st));
+        
+        // sumInit() сбрасывает состояние для следующего вектора
+        VectorProcessor::sumInit(st);
+        VectorProcessor::sumUpdate(st, more, 1);
+        CHECK_EQUAL(5, VectorProcessor::sumFinish(st));
+    }
+    
+    TEST(Kernels_MatchScalarReference) {
+        const SumKernels::Level levels[] = {SumKernels::Level::Sse42, SumKernels::Level::Avx2,
+                                            SumKernels::Level::Avx512};
+        std::vector<uint32_t> data(5000);
+        uint32_t seed = 12345;
+        for(auto& x : data) {
+            seed = seed * 1103515245u + 12345u;
+            x = seed;  // полный диапазон uint32_t
+        }
+        SumKernels::Kernel reference = SumKernels::kernel(SumKernels::Level::Scalar);
+        for(SumKernels::Level level : levels) {
+            if(!SumKernels::supported(level))
+                continue;
+            SumKernels::Kernel k = SumKernels::kernel(level);
+            // Все длины хвоста и невыровненные начала
+            for(size_t off = 0; off < 16; ++off)
+                for(size_t n = 0; n < 70; ++n)
+                    CHECK_EQUAL(reference(data.data() + off, n), k(data.data() + off, n));
+            CHECK_EQUAL(reference(data.data() + 3, 4997), k(data.data() + 3, 4997));
+        }
+    }
+    
+    TEST(Strategy_FollowsThresholds) {
+        const SumThresholds saved = VectorProcessor::thresholds();
+        SumThresholds t;
+        t.simd_min = 32;
+        t.parallel_min = 100000;
+        VectorProcessor::setThresholds(t);
+        
+        CHECK(SumStrategy::Scalar == VectorProcessor::strategy(31, true));
+        CHECK(SumStrategy::Simd == VectorProcessor::strategy(32, true));
+        CHECK(SumStrategy::Simd == VectorProcessor::strategy(99999, true));
+        CHECK(SumStrategy::Parallel == VectorProcessor::strategy(100000, true));
+        // Без пула параллельное суммирование не выбирается
+        CHECK(SumStrategy::Simd == VectorProcessor::strategy(100000, false));
+        
+        // Результат не зависит от выбранного способа
+        std::vector<uint32_t> v(30, 100000000);
+        CHECK_EQUAL(2147483647, VectorProcessor::sumClamp(v));
+        v.resize(40);
+        CHECK_EQUAL(2147483647, VectorProcessor::sumClamp(v));
+        
+        VectorProcessor::setThresholds(saved);
+    }
+    
+    TEST(TypedKernels_MatchReferenceForEveryLevel) {
+        const SumKernels::Level levels[] = {SumKernels::Level::Scalar, SumKernels::Level::Sse42,
+                                            SumKernels::Level::Avx2, SumKernels::Level::Avx512};
+        const SumKernels::Level saved = SumKernels::active();
+        uint64_t seed = 5;
+        auto next = [&seed] { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed; };
+        // Эталон: точная сумма с ограничением [0, 2^31-1]
+        auto clamp = [](long double sum) {
+            return sum < 0 ? 0 : sum > 2147483647.0L ? 2147483647 : static_cast<int32_t>(sum);
+        };
+        // Эталон int32_t: ограничение на каждом элементе, как в sumClamp()
+        auto running = [](const std::vector<int32_t>& v) {
+            int64_t acc = 0;
+            for(int32_t x : v) {
+                acc = std::max<int64_t>(acc + x, 0);
+                if(acc > 2147483647)
+                    return 2147483647;
+            }
+            return static_cast<int32_t>(acc);
+        };
+        
+        // Размеры вокруг границ векторных итераций и блока; для uint16_t -
+        // больше 2^16 элементов (расширение 32-битных линий)
+        for(size_t size : {size_t(1), size_t(63), size_t(4097), size_t(70001)}) {
+            std::vector<uint8_t> u8(size);
+            std::vector<uint16_t> u16(size);
+            std::vector<uint64_t> u64(size), u64_big(size);
+            std::vector<int32_t> i32(size);
+            long double s8 = 0, s16 = 0, s64 = 0, s64_big = 0;
+            for(size_t k = 0; k < size; ++k) {
+                u8[k] = static_cast<uint8_t>(next() >> 56);
+                u16[k] = static_cast<uint16_t>(next() >> 48);
+                u64[k] = next() >> 52;
+                u64_big[k] = k == size / 2 ? (uint64_t(1) << 63) : next() >> 52;
+                i32[k] = static_cast<int32_t>(next() >> 32);
+                s8 += u8[k];
+                s16 += u16[k];
+                s64 += u64[k];
+                s64_big += u64_big[k];
+            }
+            // Отрицательный первый элемент обнуляется ограничением и не вычитается
+            std::vector<int32_t> i32_pos(size, 1000);
+            i32_pos[0] = -500;
+            
+            for(SumKernels::Level level : levels) {
+                if(!SumKernels::select(level))
+                    continue;
+                CHECK_EQUAL(clamp(s8), VectorProcessor::sumClampAs(u8.data(), size));
+                CHECK_EQUAL(clamp(s16), VectorProcessor::sumClampAs(u16.data(), size));
+                CHECK_EQUAL(clamp(s64), VectorProcessor::sumClampAs(u64.data(), size));
+                CHECK_EQUAL(clamp(s64_big), VectorProcessor::sumClampAs(u64_big.data(), size));
+                CHECK_EQUAL(running(i32), VectorProcessor::sumClampAs(i32.data(), size));
+                CHECK_EQUAL(clamp(1000.0L * (size - 1)), VectorProcessor::sumClampAs(i32_pos.data(), size));
+                CHECK_EQUAL(clamp(s16), VectorProcessor::sumClampTyped(ElementType::U16, u16.data(), size));
+            }
+        }
+        SumKernels::select(saved);
+    }
+    
+    TEST(SignedSum_ClampsAtEveryElement) {
+        const int32_t max = std::numeric_limits<int32_t>::max();
+        // Частичная сумма ниже 0 обнуляется, превышение 2^31-1 насыщает сумму
+        const int32_t floor_case[] = {-5, 3};
+        const int32_t saturate_case[] = {max, 10, -20};
+        CHECK_EQUAL(3, VectorProcessor::sumClampAs(floor_case, 2));
+        CHECK_EQUAL(max, VectorProcessor::sumClampAs(saturate_case, 3));
+        CHECK_EQUAL(3, VectorProcessor::sumClampTyped(ElementType::I32, floor_case, 2));
+        
+        // Ограничение срабатывает в середине второго блока; порции не влияют на результат
+        std::vector<int32_t> v(3 * VectorProcessor::SUM_BLOCK, 1);
+        v[VectorProcessor::SUM_BLOCK + 100] = -1000000;
+        int32_t expected = static_cast<int32_t>(v.size() - (VectorProcessor::SUM_BLOCK + 101));
+        CHECK_EQUAL(expected, VectorProcessor::sumClampAs(v.data(), v.size()));
+        VectorProcessor::SumState st;
+        VectorProcessor::sumInit(st);
+        for(size_t i = 0; i < v.size(); i += 1000)
+            VectorProcessor::sumUpdateAs(st, v.data() + i, std::min<size_t>(1000, v.size() - i));
+        CHECK_EQUAL(expected, VectorProcessor::sumFinish(st));
+        
+        // ReduceOp::Sum совпадает с sumClamp()
+        uint64_t value = 0;
+        CHECK_EQUAL(1u, VectorProcessor::reduce(ElementType::I32, static_cast<uint32_t>(ReduceOp::Sum),
+                                                floor_case, 2, &value));
+        CHECK_EQUAL(3u, value);
+        VectorProcessor::reduce(ElementType::I32, static_cast<uint32_t>(ReduceOp::Sum), saturate_case, 3, &value);
+        CHECK_EQUAL(static_cast<uint64_t>(max), value);
+    }
+    
+    TEST(ReduceOperations_MatchReferenceForEveryLevel) {
+        const SumKernels::Level levels[] = {SumKernels::Level::Scalar, SumKernels::Level::Sse42,
+                                            SumKernels::Level::Avx2, SumKernels::Level::Avx512};
+        const SumKernels::Level saved = SumKernels::active();
+        const uint32_t all_ops = 0x7F;
+        uint64_t seed = 9;
+        auto next = [&seed] { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed; };
+        
+        // Эталон по значениям элементов: sum, min, max, nonzero, mean, dot,
+        // 16 корзин (uint64_t - в ReduceOperations_U64FullRange)
+        auto reference = [](const std::vector<int64_t>& v, unsigned bits, bool is_signed) {
+            std::vector<uint64_t> r(VectorProcessor::REDUCE_MAX_VALUES, 0);
+            int64_t sum = 0, lo = v[0], hi = v[0], clamped = 0;
+            __int128 dot = 0;
+            for(size_t i = 0; i < v.size(); ++i) {
+                sum += v[i];
+                // Сумма ограничивается на каждом элементе, как в sumClamp()
+                if(clamped <= 2147483647)
+                    clamped = std::max<int64_t>(clamped + v[i], 0);
+                lo = std::min(lo, v[i]);
+                hi = std::max(hi, v[i]);
+                r[3] += v[i] != 0;
+                if(i % 2)
+                    dot += static_cast<__int128>(v[i - 1]) * v[i];
+                uint32_t key = is_signed ? static_cast<uint32_t>(v[i]) ^ 0x80000000u
+                                         : static_cast<uint32_t>(v[i]);
+                ++r[6 + (key >> (bits - 4))];
+            }
+            r[0] = static_cast<uint64_t>(std::min<int64_t>(clamped, 2147483647));
+            r[1] = static_cast<uint64_t>(lo);
+            r[2] = static_cast<uint64_t>(hi);
+            double mean = static_cast<double>(sum) / static_cast<double>(v.size());
+            double product = static_cast<double>(dot);
+            std::memcpy(&r[4], &mean, sizeof(mean));
+            std::memcpy(&r[5], &product, sizeof(product));
+            return r;
+        };
+        
+        for(size_t size : {size_t(2), size_t(64), size_t(4098), size_t(20002)}) {
+            std::vector<uint32_t> u32(size);
+            std::vector<uint8_t> u8(size);
+            std::vector<uint16_t> u16(size);
+            std::vector<int32_t> i32(size);
+            std::vector<int64_t> v32, v8, v16, vi32;
+            for(size_t k = 0; k < size; ++k) {
+                u32[k] = k % 5 == 0 ? 0 : static_cast<uint32_t>(next() >> 32);
+                u8[k] = static_cast<uint8_t>(k % 7 == 0 ? 0 : next() >> 56);
+                u16[k] = static_cast<uint16_t>(next() >> 48);
+                i32[k] = k % 4 == 0 ? 0 : static_cast<int32_t>(next() >> 32);
+                v32.push_back(u32[k]);
+                v8.push_back(u8[k]);
+                v16.push_back(u16[k]);
+                vi32.push_back(i32[k]);
+            }
+            struct Case { ElementType type; const void* data; std::vector<uint64_t> expected; size_t width; };
+            const Case cases[] = {
+                {ElementType::U32, u32.data(), reference(v32, 32, false), 4},
+                {ElementType::U8, u8.data(), reference(v8, 8, false), 1},
+                {ElementType::U16, u16.data(), reference(v16, 16, false), 2},
+                {ElementType::I32, i32.data(), reference(vi32, 32, true), 4},
+            };
+            
+            for(SumKernels::Level level : levels) {
+                if(!SumKernels::select(level))
+                    continue;
+                for(const Case& c : cases) {
+                    // Целиком и порциями по 7 элементов (пары Dot разрываются)
+                    for(size_t chunk : {size, size_t(7)}) {
+                        VectorProcessor::ReduceState st;
+                        VectorProcessor::reduceInit(st, c.type, all_ops);
+                        const char* bytes = static_cast<const char*>(c.data);
+                        for(size_t i = 0; i < size; i += chunk)
+                            VectorProcessor::reduceUpdate(st, bytes + i * c.width, std::min(chunk, size - i));
+                        uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+                        CHECK_EQUAL(VectorProcessor::REDUCE_MAX_VALUES, VectorProcessor::reduceFinish(st, values));
+                        CHECK_ARRAY_EQUAL(c.expected.data(), values, 4);
+                        double mean, expected_mean, dot, expected_dot;
+                        std::memcpy(&mean, &values[4], sizeof(mean));
+                        std::memcpy(&expected_mean, &c.expected[4], sizeof(mean));
+                        std::memcpy(&dot, &values[5], sizeof(dot));
+                        std::memcpy(&expected_dot, &c.expected[5], sizeof(dot));
+                        CHECK_CLOSE(expected_mean, mean, 1e-6 * std::max(1.0, std::abs(expected_mean)));
+                        CHECK_EQUAL(expected_dot, dot);
+                        CHECK_ARRAY_EQUAL(c.expected.data() + 6, values + 6, ReduceKernels::HISTOGRAM_BINS);
+                    }
+                }
+            }
+        }
+        SumKernels::select(saved);
+    }
+    
+    TEST(ReduceOperations_U64FullRange) {
+        const uint32_t all_ops = 0x7F;
+        // Каждая операция на элементах больше 2^31
+        const uint64_t data[] = {5000000000ull, 3000000000ull, 0, uint64_t(1) << 63, 7, uint64_t(1) << 40};
+        uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+        CHECK_EQUAL(VectorProcessor::REDUCE_MAX_VALUES,
+                    VectorProcessor::reduce(ElementType::U64, all_ops, data, 6, values));
+        CHECK_EQUAL(2147483647u, values[0]);                 // сумма по-прежнему ограничена
+        CHECK_EQUAL(0u, values[1]);
+        CHECK_EQUAL(uint64_t(1) << 63, values[2]);
+        CHECK_EQUAL(5u, values[3]);
+        double mean, dot;
+        std::memcpy(&mean, &values[4], sizeof(mean));
+        std::memcpy(&dot, &values[5], sizeof(dot));
+        CHECK_CLOSE((8000000007.0 + std::ldexp(1.0, 63) + std::ldexp(1.0, 40)) / 6, mean, 1.0);
+        CHECK_CLOSE(15e18 + 7 * std::ldexp(1.0, 40), dot, 1e4);
+        uint64_t bins[ReduceKernels::HISTOGRAM_BINS] = {};
+        bins[0] = 5;
+        bins[8] = 1;
+        CHECK_ARRAY_EQUAL(bins, values + 6, ReduceKernels::HISTOGRAM_BINS);
+        
+        const uint64_t single[] = {5000000000ull};
+        VectorProcessor::reduce(ElementType::U64, static_cast<uint32_t>(ReduceOp::Max), single, 1, values);
+        CHECK_EQUAL(5000000000u, values[0]);
+        
+        // Случайные значения всего диапазона: целиком и порциями по 7
+        // элементов с невыровненным началом (пары Dot разрываются)
+        uint64_t seed = 13;
+        auto next = [&seed] { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed; };
+        const size_t size = 4098;
+        std::vector<uint64_t> v(size);
+        unsigned __int128 sum = 0;
+        long double product = 0;
+        uint64_t lo = UINT64_MAX, hi = 0, nonzero = 0;
+        uint64_t expected_bins[ReduceKernels::HISTOGRAM_BINS] = {};
+        for(size_t k = 0; k < size; ++k) {
+            v[k] = k % 5 == 0 ? 0 : k % 3 == 0 ? next() >> 20 : next();
+            sum += v[k];
+            lo = std::min(lo, v[k]);
+            hi = std::max(hi, v[k]);
+            nonzero += v[k] != 0;
+            if(k % 2)
+                product += static_cast<long double>(v[k - 1]) * v[k];
+            ++expected_bins[v[k] >> 60];
+        }
+        std::vector<char> unaligned(size * 8 + 1);
+        std::memcpy(unaligned.data() + 1, v.data(), size * 8);
+        for(size_t chunk : {size, size_t(7)}) {
+            VectorProcessor::ReduceState st;
+            VectorProcessor::reduceInit(st, ElementType::U64, all_ops);
+            for(size_t i = 0; i < size; i += chunk)
+                VectorProcessor::reduceUpdate(st, unaligned.data() + 1 + i * 8, std::min(chunk, size - i));
+            VectorProcessor::reduceFinish(st, values);
+            CHECK_EQUAL(2147483647u, values[0]);
+            CHECK_EQUAL(lo, values[1]);
+            CHECK_EQUAL(hi, values[2]);
+            CHECK_EQUAL(nonzero, values[3]);
+            std::memcpy(&mean, &values[4], sizeof(mean));
+            std::memcpy(&dot, &values[5], sizeof(dot));
+            double expected_mean = static_cast<double>(sum) / size;
+            CHECK_CLOSE(expected_mean, mean, 1e-9 * expected_mean);
+            CHECK_CLOSE(static_cast<double>(product), dot, 1e-9 * static_cast<double>(product));
+            CHECK_ARRAY_EQUAL(expected_bins, values + 6, ReduceKernels::HISTOGRAM_BINS);
+        }
+    }
+    
+    TEST(ReduceOperations_RegistryAndValidation) {
+        const auto& ops = VectorProcessor::operations();
+        CHECK_EQUAL(7u, ops.size());
+        for(size_t i = 1; i < ops.size(); ++i)
+            CHECK(static_cast<uint32_t>(ops[i - 1].op) < static_cast<uint32_t>(ops[i].op));
+        
+        const uint32_t sum = static_cast<uint32_t>(ReduceOp::Sum);
+        const uint32_t max = static_cast<uint32_t>(ReduceOp::Max);
+        const uint32_t dot = static_cast<uint32_t>(ReduceOp::Dot);
+        const uint32_t hist = static_cast<uint32_t>(ReduceOp::Histogram);
+        CHECK(!VectorProcessor::validOperations(0, 4));        // пустая маска
+        CHECK(!VectorProcessor::validOperations(1u << 7, 4));  // неизвестная операция
+        CHECK(!VectorProcessor::validOperations(dot, 3));      // нечетное количество для Dot
+        CHECK(VectorProcessor::validOperations(dot | sum, 4));
+        CHECK_EQUAL(17u, VectorProcessor::reduceValues(sum | hist));
+        
+        // Значения идут в порядке битов маски, а не в порядке запроса
+        const uint32_t data[] = {3, 9, 1};
+        uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+        CHECK_EQUAL(2u, VectorProcessor::reduce(ElementType::U32, max | sum, data, 3, values));
+        CHECK_EQUAL(13u, values[0]);
+        CHECK_EQUAL(9u, values[1]);
+        
+        // Сумма ограничена как у sumClamp(), минимум int32_t - со знаком
+        const int32_t negative[] = {-5, -7};
+        VectorProcessor::reduce(ElementType::I32, sum | static_cast<uint32_t>(ReduceOp::Min), negative, 2, values);
+        CHECK_EQUAL(0u, values[0]);
+        CHECK_EQUAL(-7, static_cast<int64_t>(values[1]));
+    }
+    
+    TEST(SumClampSegments_MatchesSumClampForEveryKernel) {
+        const SumKernels::Level levels[] = {SumKernels::Level::Scalar, SumKernels::Level::Sse42,
+                                            SumKernels::Level::Avx2, SumKernels::Level::Avx512};
+        const SumKernels::Level saved = SumKernels::active();
+        
+        // Векторы 0..16 элементов; часть насыщается, количество не кратно 8
+        std::vector<uint32_t> data;
+        std::vector<uint32_t> offsets = {0};
+        uint32_t seed = 11;
+        auto next = [&seed] { seed = seed * 1664525u + 1013904223u; return seed; };
+        for(size_t i = 0; i < 1003; ++i) {
+            size_t size = next() % 17;
+            uint32_t shift = i % 3 == 0 ? 0 : 8;
+            for(size_t k = 0; k < size; ++k)
+                data.push_back(next() >> shift);
+            offsets.push_back(static_cast<uint32_t>(data.size()));
+        }
+        
+        for(SumKernels::Level level : levels) {
+            if(!SumKernels::select(level))
+                continue;
+            std::vector<int32_t> results(offsets.size() - 1, -1);
+            VectorProcessor::sumClampSegments(data.data(), offsets.data(), results.size(), results.data());
+            for(size_t i = 0; i < results.size(); ++i) {
+                CHECK_EQUAL(VectorProcessor::sumClamp(data.data() + offsets[i], offsets[i + 1] - offsets[i]),
+                            results[i]);
+            }
+        }
+        SumKernels::select(saved);
+    }
+    
+    TEST(SumUpdate_MatchesScalarReferenceForEveryKernel) {
+        const SumKernels::Level levels[] = {SumKernels::Level::Scalar, SumKernels::Level::Sse42,
+                                            SumKernels::Level::Avx2, SumKernels::Level::Avx512};
+        const SumKernels::Level saved = SumKernels::active();
+        
+        // Векторы без насыщения, с насыщением в разных местах и 10M элементов
+        std::vector<std::vector<uint32_t>> cases;
+        uint32_t seed = 7;
+        auto next = [&seed] { seed = seed * 1664525u + 1013904223u; return seed; };
+        for(uint32_t shift : {24u, 20u, 12u, 0u}) {
+            for(size_t size : {1u, 15u, 4095u, 4096u, 4097u, 20000u}) {
+                std::vector<uint32_t> v(size);
+                for(auto& x : v)
+                    x = next() >> shift;
+                cases.push_back(v);
+            }
+        }
+        cases.push_back(std::vector<uint32_t>(10000000, 200));
+        cases.push_back(std::vector<uint32_t>(10000000, 215));
+        
+        for(SumKernels::Level level : levels) {
+            if(!SumKernels::select(level))
+                continue;
+            for(const auto& v : cases) {
+                for(size_t chunk : {size_t(7), size_t(5000), v.size()}) {
+                    VectorProcessor::SumState fast, ref;
+                    VectorProcessor::sumInit(fast);
+                    VectorProcessor::sumInit(ref);
+                    for(size_t i = 0; i < v.size(); i += chunk) {
+                        size_t n = std::min(chunk, v.size() - i);
+                        VectorProcessor::sumUpdate(fast, v.data() + i, n);
+                        VectorProcessor::sumUpdateScalar(ref, v.data() + i, n);
+                    }
+                    CHECK_EQUAL(ref.saturated, fast.saturated);
+                    CHECK_EQUAL(VectorProcessor::sumFinish(ref), VectorProcessor::sumFinish(fast));
+                }
+            }
+        }
+        SumKernels::select(saved);
+    }
 }
 
 SUITE(VectorHandlerTests)
@@ -511,6 +1187,147 @@ SUITE(VectorHandlerTests)
         remove(logfile);
     }
     
+    TEST(ParseVectorHeader_ElementTypes) {
+        VectorHeader h;
+        // Исходный протокол: код типа 0
+        CHECK(VectorHandler::parseVectorHeader(5, h));
+        CHECK_EQUAL(5u, h.size);
+        CHECK(h.type == ElementType::U32);
+        CHECK_EQUAL(20u, h.bytes());
+        
+        CHECK(VectorHandler::parseVectorHeader((1u << 24) | 5, h));
+        CHECK(h.type == ElementType::U8);
+        CHECK_EQUAL(5u, h.bytes());
+        CHECK(VectorHandler::parseVectorHeader((3u << 24) | 10000000, h));
+        CHECK(h.type == ElementType::U64);
+        CHECK_EQUAL(80000000u, h.bytes());
+        
+        CHECK(!VectorHandler::parseVectorHeader(5u << 24 | 5, h));   // неизвестный тип
+        CHECK(!VectorHandler::parseVectorHeader(2u << 24, h));       // пустой вектор
+        CHECK(!VectorHandler::parseVectorHeader(10000001, h));       // слишком большой
+    }
+    
+    TEST(ParseVectorHeader_OperationsFlag) {
+        VectorHeader h;
+        uint32_t raw = VectorHandler::OPERATIONS_FLAG |
+                       static_cast<uint32_t>(ElementType::I32) << VectorHandler::ELEMENT_TYPE_SHIFT | 6;
+        CHECK(VectorHandler::parseVectorHeader(raw, h));
+        CHECK(h.has_ops);
+        CHECK(h.type == ElementType::I32);
+        CHECK_EQUAL(6u, h.size);
+        CHECK_EQUAL(0u, h.ops);
+        
+        CHECK(VectorHandler::parseOperations(static_cast<uint32_t>(ReduceOp::Dot), h));
+        CHECK_EQUAL(static_cast<uint32_t>(ReduceOp::Dot), h.ops);
+        CHECK(!VectorHandler::parseOperations(0, h));
+        CHECK(!VectorHandler::parseOperations(0x80, h));
+        
+        // Заголовок без флага сбрасывает маску
+        CHECK(VectorHandler::parseVectorHeader(6, h));
+        CHECK(!h.has_ops);
+        CHECK_EQUAL(0u, h.ops);
+    }
+    
+    TEST(ParseSizeTable_BulkCountOffsetsAndLimits) {
+        BatchHeader batch;
+        CHECK(VectorHandler::parseVectorCount(5, batch));
+        CHECK(batch.format == BatchFormat::Lockstep);
+        CHECK(!batch.keep_alive);
+        CHECK_EQUAL(5u, batch.count);
+        CHECK(VectorHandler::parseVectorCount(VectorHandler::BULK_FLAG | 5, batch));
+        CHECK(batch.format == BatchFormat::Bulk);
+        CHECK_EQUAL(5u, batch.count);
+        CHECK(VectorHandler::parseVectorCount(VectorHandler::TAGGED_FLAG | 7, batch));
+        CHECK(batch.format == BatchFormat::Tagged);
+        CHECK_EQUAL(7u, batch.count);
+        CHECK(!VectorHandler::parseVectorCount(VectorHandler::BULK_FLAG, batch));
+        CHECK(!VectorHandler::parseVectorCount(VectorHandler::BULK_FLAG | 100001, batch));
+        CHECK(!VectorHandler::parseVectorCount(VectorHandler::BULK_FLAG | VectorHandler::TAGGED_FLAG | 5,
+                                               batch));
+        
+        // KEEP_ALIVE_FLAG сочетается с любым форматом; слово конца сеанса - не пакет
+        CHECK(VectorHandler::parseVectorCount(VectorHandler::KEEP_ALIVE_FLAG | VectorHandler::BULK_FLAG | 4,
+                                              batch));
+        CHECK(batch.keep_alive);
+        CHECK(batch.format == BatchFormat::Bulk);
+        CHECK_EQUAL(4u, batch.count);
+        CHECK(!VectorHandler::parseVectorCount(VectorHandler::END_OF_SESSION, batch));
+        CHECK(!VectorHandler::parseVectorCount(VectorHandler::KEEP_ALIVE_FLAG, batch));
+        
+        // Данные векторов лежат вплотную, без выравнивания
+        const uint32_t shift = VectorHandler::ELEMENT_TYPE_SHIFT;
+        uint32_t raw[] = {3, static_cast<uint32_t>(ElementType::U8) << shift | 5,
+                          static_cast<uint32_t>(ElementType::U64) << shift | 2};
+        BulkTable table;
+        CHECK(VectorHandler::parseSizeTable(raw, 3, table));
+        size_t offsets[] = {0, 12, 17, 33};
+        CHECK_ARRAY_EQUAL(offsets, table.offsets.data(), 4);
+        CHECK_EQUAL(33u, table.bytes());
+        CHECK(table.headers[1].type == ElementType::U8);
+        
+        // Маски операций, недопустимые заголовки и слишком большой блок
+        raw[1] |= VectorHandler::OPERATIONS_FLAG;
+        CHECK(!VectorHandler::parseSizeTable(raw, 3, table));
+        CHECK(VectorHandler::invalidTableMessage(raw, 3).find("entry 1") != std::string::npos);
+        raw[1] = 0;
+        CHECK(!VectorHandler::parseSizeTable(raw, 3, table));
+        CHECK(VectorHandler::invalidTableMessage(raw, 3).find("Invalid vector size: 0") != std::string::npos);
+        uint32_t huge[] = {static_cast<uint32_t>(ElementType::U64) << shift | 10000000, 1};
+        CHECK(VectorHandler::parseSizeTable(huge, 1, table));
+        CHECK(!VectorHandler::parseSizeTable(huge, 2, table));
+        CHECK(VectorHandler::invalidTableMessage(huge, 2).find("too large") != std::string::npos);
+    }
+    
+    TEST(ComputeBulk_UnalignedOffsets) {
+        const char* logfile = "test_bulk_unaligned.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // После uint8_t каждый следующий вектор начинается с нечетного смещения
+        const uint32_t shift = VectorHandler::ELEMENT_TYPE_SHIFT;
+        std::vector<uint16_t> u16 = {1, 65535, 2};
+        std::vector<uint64_t> u64 = {5000000000ull, 7};
+        std::vector<int32_t> i32 = {-4, 10};
+        std::vector<uint32_t> run = {1, 2, 3, 4, 5};
+        std::vector<uint32_t> big(70000, 3);
+        uint32_t raw[] = {static_cast<uint32_t>(ElementType::U8) << shift | 1,
+                          static_cast<uint32_t>(ElementType::U16) << shift | 3,
+                          static_cast<uint32_t>(ElementType::U8) << shift | 2,
+                          static_cast<uint32_t>(ElementType::U64) << shift | 2,
+                          static_cast<uint32_t>(ElementType::U8) << shift | 1,
+                          static_cast<uint32_t>(ElementType::I32) << shift | 2,
+                          2, 3,
+                          static_cast<uint32_t>(big.size())};
+        BulkTable table;
+        CHECK(VectorHandler::parseSizeTable(raw, 9, table));
+        
+        std::string block;
+        auto put = [&block](const void* p, size_t n) { block.append(static_cast<const char*>(p), n); };
+        uint8_t byte = 9;
+        put(&byte, 1);
+        put(u16.data(), 6);
+        put(&byte, 1);
+        put(&byte, 1);
+        put(u64.data(), 16);
+        put(&byte, 1);
+        put(i32.data(), 8);
+        put(run.data(), 20);
+        put(big.data(), big.size() * 4);
+        CHECK_EQUAL(table.bytes(), block.size());
+        CHECK(table.offsets[3] % 8 != 0);
+        CHECK(table.offsets[6] % 4 != 0);
+        
+        PooledBuffer payload;
+        payload.resize((block.size() + 3) / 4);
+        std::memcpy(payload.data(), block.data(), block.size());
+        VectorHandler handler(logger);
+        int32_t results[9] = {};
+        handler.computeBulk(payload, table, results);
+        const int32_t expected[] = {9, 65538, 18, 2147483647, 9, 10, 3, 12, 210000};
+        CHECK_ARRAY_EQUAL(expected, results, 9);
+        remove(logfile);
+    }
+    
     TEST(ProcessVector_EdgeCases) {
         const char* logfile = "test_vector_edge.log";
         std::ofstream(logfile, std::ios::trunc).close();
@@ -782,6 +1599,82 @@ SUITE(NetworkUtilsTests)
         std::string longInvalid = longValid + "G";
         CHECK(!NetworkUtils::isValidHex(longInvalid));
     }
+    
+    TEST(discardAll_KeepsFollowingData) {
+        // AF_UNIX не поддерживает MSG_TRUNC: используется временный буфер
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        std::vector<char> payload(100000, 'x');
+        payload.push_back('!');
+        std::thread writer([&] { send(sv[1], payload.data(), payload.size(), 0); });
+        
+        CHECK_EQUAL(100000, NetworkUtils::discardAll(sv[0], 100000));
+        char c = 0;
+        CHECK_EQUAL(1, recv(sv[0], &c, 1, 0));
+        CHECK_EQUAL('!', c);
+        
+        writer.join();
+        close(sv[1]);
+        CHECK_EQUAL(0, NetworkUtils::discardAll(sv[0], 10)); // Соединение закрыто
+        close(sv[0]);
+    }
+    
+    TEST(HexCodec_AllLevelsMatchScalar) {
+        // Векторные уровни сверяются со скалярным на тех же значениях, что и тесты выше
+        const NetworkUtils::HexLevel levels[] = {NetworkUtils::HexLevel::Scalar,
+                                                 NetworkUtils::HexLevel::Ssse3,
+                                                 NetworkUtils::HexLevel::Avx2};
+        const NetworkUtils::HexLevel saved = NetworkUtils::hexLevel();
+        std::vector<unsigned char> bytes(300);
+        for(size_t i = 0; i < bytes.size(); ++i)
+            bytes[i] = static_cast<unsigned char>(i * 167 + 13);
+        
+        CHECK(NetworkUtils::selectHexLevel(NetworkUtils::HexLevel::Scalar));
+        std::string reference = NetworkUtils::bytesToHex(bytes.data(), bytes.size());
+        
+        for(NetworkUtils::HexLevel level : levels) {
+            if(!NetworkUtils::selectHexLevel(level))
+                continue;
+            unsigned char deadbeef[] = {0xDE, 0xAD, 0xBE, 0xEF};
+            CHECK_EQUAL("DEADBEEF", NetworkUtils::bytesToHex(deadbeef, 4));
+            unsigned char out4[4];
+            CHECK(NetworkUtils::hexToBytes("DeAdBeEF", out4, 4));
+            CHECK_ARRAY_EQUAL(deadbeef, out4, 4);
+            CHECK(!NetworkUtils::hexToBytes("123", out4, 1));
+            CHECK(NetworkUtils::isValidHex(""));
+            CHECK(!NetworkUtils::isValidHex("AB:CD"));
+            
+            // Все длины (хвосты после векторных шагов) и смещения
+            for(size_t off = 0; off < 4; ++off) {
+                for(size_t n = 0; off + n <= 100; ++n) {
+                    std::string hex = NetworkUtils::bytesToHex(bytes.data() + off, n);
+                    CHECK_EQUAL(reference.substr(off * 2, n * 2), hex);
+                    
+                    std::string lower = hex;
+                    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+                    std::vector<unsigned char> out(n + 1);
+                    CHECK(NetworkUtils::hexToBytes(lower, out.data(), n));
+                    CHECK(std::equal(out.begin(), out.begin() + n, bytes.begin() + off));
+                    CHECK(NetworkUtils::isValidHex(lower));
+                }
+            }
+            
+            // Недопустимый символ в любой позиции 72-символьной строки аутентификации
+            std::string auth = reference.substr(0, 72);
+            const char bad[] = {'G', 'g', '/', ':', '@', '`', ' ', '\0', '\x80', '\xC6'};
+            unsigned char out36[36];
+            for(size_t pos = 0; pos < auth.size(); ++pos) {
+                for(char c : bad) {
+                    std::string broken = auth;
+                    broken[pos] = c;
+                    CHECK(!NetworkUtils::isValidHex(broken));
+                    CHECK(!NetworkUtils::hexToBytes(broken, out36, 36));
+                }
+            }
+        }
+        
+        NetworkUtils::selectHexLevel(saved);
+    }
 }
 
 
@@ -1120,7 +2013,7 @@ SUITE(AuthHandlerParseTests)
         AuthHandler handler(logger, db);
         
         // Тест 1.1: Корректные данные
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         // 72 hex символа
         std::string hex_part = "0011223344556677" // 16 символов salt
@@ -1149,7 +2042,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         // Только 71 символ
         std::string auth_data = "user" + std::string(67, 'A'); // 4 + 67 = 71
@@ -1171,7 +2064,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         // Последние 72 символа содержат не-hex
         std::string hex_part = "0011223344556677" // salt
@@ -1196,7 +2089,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         std::string hex_part = "0011223344556677"
                               "8899AABBCCDDEEFF00112233445566778899AABBCCDDEEFF00112233";
@@ -1224,7 +2117,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         std::string hex_part = "0011223344556677"
                               "8899AABBCCDDEEFF00112233445566778899AABBCCDDEEFF00112233";
@@ -1252,7 +2145,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         std::string hex_part = "0011223344556677"
                               "8899AABBCCDDEEFF00112233445566778899AABBCCDDEEFF00112233";
@@ -1281,7 +2174,7 @@ SUITE(AuthHandlerParseTests)
         AuthDB db;
         AuthHandler handler(logger, db);
         
-        std::string login, salt_hex, hash_hex;
+        std::string_view login, salt_hex, hash_hex;
         
         // Ровно 72 hex символа, без логина
         std::string auth_data = "00112233445566778899AABBCCDDEEFF00112233445566778899AABBCCDDEEFF00112233";
@@ -1302,6 +2195,2894 @@ SUITE(AuthHandlerParseTests)
 
 
 
+// ============================================================
+// Вспомогательные функции для тестов сеансов
+// ============================================================
+
+/**
+ * @brief Формирует данные аутентификации клиента: login + salt_hex + SHA224(salt_hex + password)
+ */
+static std::string makeAuthData(const std::string& login, const std::string& password,
+                                const std::string& salt_hex = "0011223344556677") {
+    std::string data = salt_hex + password;
+    CryptoPP::SHA224 sha224;
+    unsigned char digest[28];
+    sha224.Update((const unsigned char*)data.data(), data.size());
+    sha224.Final(digest);
+    return login + salt_hex + NetworkUtils::bytesToHex(digest, sizeof(digest));
+}
+
+/**
+ * @brief Читает из сокета все доступные без блокировки данные
+ */
+static std::string readAvailable(int fd) {
+    std::string out;
+    char buf[4096];
+    ssize_t r;
+    while((r = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        out.append(buf, r);
+    return out;
+}
+
+/**
+ * @brief Отправляет 32-битное значение в порядке байт протокола
+ */
+static void sendUint32(int fd, uint32_t value) {
+    send(fd, &value, sizeof(value), 0);
+}
+
+SUITE(ClientSessionTests)
+{
+    TEST(FullSession_AuthAndVectors) {
+        const char* logfile = "test_session.log";
+        const char* dbfile = "test_session.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            
+            // Нет данных - сеанс ждет аутентификации
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::Auth);
+            
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            CHECK(session.state() == ClientSession::State::VectorCount);
+            
+            // Первый вектор приходит частями: сеанс не блокируется
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 3);
+            sendUint32(sv[1], 1);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorData);
+            CHECK_EQUAL("", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 3);
+            CHECK(session.onReadable());
+            
+            // Второй вектор с переполнением
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 2147483647u);
+            sendUint32(sv[1], 1);
+            CHECK(!session.onReadable()); // Все векторы обработаны - сеанс завершен
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(8u, results.size());
+            int32_t r[2];
+            std::memcpy(r, results.data(), sizeof(r));
+            CHECK_EQUAL(6, r[0]);
+            CHECK_EQUAL(2147483647, r[1]);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(AuthFailure_SendsErrAndCloses) {
+        const char* logfile = "test_session_err.log";
+        const char* dbfile = "test_session_err.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "wrong");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(!session.onReadable());
+            CHECK(session.state() == ClientSession::State::Closing);
+            CHECK_EQUAL("ERR", readAvailable(sv[1]));
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(VectorData_SplitInsideElements) {
+        const char* logfile = "test_session_split.log";
+        const char* dbfile = "test_session_split.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 3);
+            CHECK(session.onReadable());
+            
+            // Данные приходят кусками, разрезающими элементы
+            uint32_t data[] = {0x01020304u, 0x10000000u, 5u};
+            const char* bytes = reinterpret_cast<const char*>(data);
+            size_t parts[] = {3, 6, 2, 1};
+            size_t pos = 0;
+            for(size_t part : parts) {
+                send(sv[1], bytes + pos, part, 0);
+                pos += part;
+                bool alive = session.onReadable();
+                CHECK_EQUAL(pos < sizeof(data), alive);
+            }
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(4u, results.size());
+            int32_t r;
+            std::memcpy(&r, results.data(), sizeof(r));
+            CHECK_EQUAL(static_cast<int32_t>(0x01020304u + 0x10000000u + 5u), r);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(TypedVector_U16SplitInsideElements) {
+        const char* logfile = "test_session_u16.log";
+        const char* dbfile = "test_session_u16.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], static_cast<uint32_t>(ElementType::U16) << VectorHandler::ELEMENT_TYPE_SHIFT | 3);
+            CHECK(session.onReadable());
+            
+            // Элементы uint16_t приходят по одному байту
+            uint16_t data[] = {0x0102, 0xFFFF, 7};
+            const char* bytes = reinterpret_cast<const char*>(data);
+            for(size_t pos = 0; pos < sizeof(data); ++pos) {
+                send(sv[1], bytes + pos, 1, 0);
+                CHECK_EQUAL(pos + 1 < sizeof(data), session.onReadable());
+            }
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(4u, results.size());
+            int32_t r;
+            std::memcpy(&r, results.data(), sizeof(r));
+            CHECK_EQUAL(0x0102 + 0xFFFF + 7, r);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(ReduceOperations_MaskAndPairsSplitAcrossReads) {
+        const char* logfile = "test_session_reduce.log";
+        const char* dbfile = "test_session_reduce.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], VectorHandler::OPERATIONS_FLAG |
+                              static_cast<uint32_t>(ElementType::I32) << VectorHandler::ELEMENT_TYPE_SHIFT | 4);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorOps);
+            
+            // Маска и элементы приходят по одному байту: пары Dot и элементы разрываются
+            std::string rest;
+            uint32_t ops = static_cast<uint32_t>(ReduceOp::Dot) | static_cast<uint32_t>(ReduceOp::Max);
+            rest.append(reinterpret_cast<const char*>(&ops), sizeof(ops));
+            int32_t data[] = {-3, 4, 100000, 100000};
+            rest.append(reinterpret_cast<const char*>(data), sizeof(data));
+            for(size_t pos = 0; pos < rest.size(); ++pos) {
+                send(sv[1], rest.data() + pos, 1, 0);
+                CHECK_EQUAL(pos + 1 < rest.size(), session.onReadable());
+            }
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(16u, results.size());
+            int64_t max;
+            double dot;
+            std::memcpy(&max, results.data(), sizeof(max));
+            std::memcpy(&dot, results.data() + 8, sizeof(dot));
+            CHECK_EQUAL(100000, max);
+            CHECK_EQUAL(-12.0 + 1e10, dot);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(BulkBatch_TableAndPayloadSplitAcrossReads) {
+        const char* logfile = "test_session_bulk.log";
+        const char* dbfile = "test_session_bulk.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], VectorHandler::BULK_FLAG | 3);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::BulkTable);
+            
+            // Таблица приходит по одному байту, блок данных - двумя частями
+            uint32_t table[] = {2, static_cast<uint32_t>(ElementType::U16) << VectorHandler::ELEMENT_TYPE_SHIFT | 3, 1};
+            const char* t = reinterpret_cast<const char*>(table);
+            for(size_t pos = 0; pos < sizeof(table); ++pos) {
+                send(sv[1], t + pos, 1, 0);
+                CHECK(session.onReadable());
+            }
+            CHECK(session.state() == ClientSession::State::BulkPayload);
+            CHECK_EQUAL("", readAvailable(sv[1]));
+            
+            std::string payload;
+            uint32_t a[] = {7, 8};
+            uint16_t b[] = {1, 2, 65535};
+            uint32_t c = 2147483647u;
+            payload.append(reinterpret_cast<const char*>(a), sizeof(a));
+            payload.append(reinterpret_cast<const char*>(b), sizeof(b));
+            payload.append(reinterpret_cast<const char*>(&c), sizeof(c));
+            send(sv[1], payload.data(), 9, 0);
+            CHECK(session.onReadable());
+            send(sv[1], payload.data() + 9, payload.size() - 9, 0);
+            CHECK(!session.onReadable()); // Пакет обработан - сеанс завершен
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(12u, results.size());
+            int32_t r[3];
+            std::memcpy(r, results.data(), sizeof(r));
+            CHECK_EQUAL(15, r[0]);
+            CHECK_EQUAL(65538, r[1]);
+            CHECK_EQUAL(2147483647, r[2]);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(TaggedJobs_RepliesCarryIds) {
+        const char* logfile = "test_session_tagged.log";
+        const char* dbfile = "test_session_tagged.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            sendUint32(sv[1], VectorHandler::TAGGED_FLAG | 2);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorId);
+            
+            // Первое задание отвечается, не дожидаясь второго
+            sendUint32(sv[1], 77);
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 5);
+            sendUint32(sv[1], 6);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorId);
+            std::string first = readAvailable(sv[1]);
+            CHECK_EQUAL(8u, first.size());
+            uint32_t r[2];
+            std::memcpy(r, first.data(), sizeof(r));
+            CHECK_EQUAL(77u, r[0]);
+            CHECK_EQUAL(11u, r[1]);
+            
+            sendUint32(sv[1], 78);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 4);
+            CHECK(!session.onReadable());
+            std::string second = readAvailable(sv[1]);
+            CHECK_EQUAL(8u, second.size());
+            std::memcpy(r, second.data(), sizeof(r));
+            CHECK_EQUAL(78u, r[0]);
+            CHECK_EQUAL(4u, r[1]);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(ReadPausesAtOutputHighWater) {
+        const char* logfile = "test_session_highwater.log";
+        const char* dbfile = "test_session_highwater.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        // Клиент отправляет задания, не читая ответы: их больше, чем
+        // вмещают буферы сокета и OUT_HIGH_WATER вместе
+        const uint32_t jobs = 60000;
+        std::vector<uint32_t> words = {VectorHandler::TAGGED_FLAG | jobs};
+        for(uint32_t j = 0; j < jobs; ++j) {
+            words.push_back(j);
+            words.push_back(1);
+            words.push_back(j % 7);
+        }
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            std::thread client([&] { SocketIo::posix().sendAll(sv[1], words.data(), words.size() * 4); });
+            bool alive = true;
+            for(int i = 0; i < 5000 && alive && session.pendingOutput() < ClientSession::OUT_HIGH_WATER; ++i) {
+                alive = session.onReadable();
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            CHECK(alive);
+            
+            // Чтение остановлено: ответы не растут дальше одного задания сверх порога
+            size_t pending = session.pendingOutput();
+            CHECK(pending >= ClientSession::OUT_HIGH_WATER);
+            CHECK(pending < ClientSession::OUT_HIGH_WATER + 8);
+            CHECK(session.onReadable());
+            CHECK_EQUAL(pending, session.pendingOutput());
+            
+            // Клиент читает ответы: onWritable() возобновляет чтение
+            std::string received;
+            char buf[16384];
+            for(int idle = 0; received.size() < 8u * jobs && idle < 5000;) {
+                ssize_t r = recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT);
+                if(r > 0)
+                    received.append(buf, static_cast<size_t>(r));
+                if(alive)
+                    alive = session.onWritable();
+                if(r <= 0) {
+                    ++idle;
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+            client.join();
+            CHECK(!alive);
+            CHECK_EQUAL(8u * jobs, received.size());
+            std::vector<uint32_t> replies(received.size() / 4);
+            std::memcpy(replies.data(), received.data(), replies.size() * 4);
+            bool ordered = true;
+            for(uint32_t j = 0; j < jobs && j < replies.size() / 2; ++j)
+                ordered &= replies[2 * j] == j && replies[2 * j + 1] == j % 7;
+            CHECK(ordered);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(KeepAlive_BatchesUntilEndFrame) {
+        const char* logfile = "test_session_keepalive.log";
+        const char* dbfile = "test_session_keepalive.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            // После пакета с KEEP_ALIVE_FLAG сеанс ждет следующий без повторной аутентификации
+            sendUint32(sv[1], VectorHandler::KEEP_ALIVE_FLAG | 1);
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 5);
+            sendUint32(sv[1], 6);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorCount);
+            std::string first = readAvailable(sv[1]);
+            CHECK_EQUAL(4u, first.size());
+            
+            auto now = std::chrono::steady_clock::now();
+            CHECK(!session.idleExpired(now, std::chrono::milliseconds(1000)));
+            CHECK(session.idleExpired(now + std::chrono::seconds(2), std::chrono::milliseconds(1000)));
+            CHECK(!session.idleExpired(now + std::chrono::seconds(2), std::chrono::milliseconds(0)));
+            
+            sendUint32(sv[1], VectorHandler::KEEP_ALIVE_FLAG | VectorHandler::BULK_FLAG | 2);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 7);
+            sendUint32(sv[1], 8);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::VectorCount);
+            std::string second = readAvailable(sv[1]);
+            CHECK_EQUAL(8u, second.size());
+            int32_t r[2];
+            std::memcpy(r, second.data(), sizeof(r));
+            CHECK_EQUAL(7, r[0]);
+            CHECK_EQUAL(8, r[1]);
+            
+            sendUint32(sv[1], VectorHandler::END_OF_SESSION);
+            CHECK(!session.onReadable());
+            CHECK(session.state() == ClientSession::State::Closing);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(SaturatedVector_RestIsDiscarded) {
+        const char* logfile = "test_session_sat.log";
+        const char* dbfile = "test_session_sat.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK_EQUAL("OK", readAvailable(sv[1]));
+            
+            // Первый вектор насыщается на втором элементе, затем второй вектор
+            sendUint32(sv[1], 2);
+            sendUint32(sv[1], 5);
+            uint32_t first[] = {0x7FFFFFFFu, 1u, 9u, 9u, 9u};
+            send(sv[1], first, 2 * sizeof(uint32_t), 0);
+            CHECK(session.onReadable());
+            send(sv[1], first + 2, 3 * sizeof(uint32_t), 0);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 42);
+            CHECK(!session.onReadable());
+            
+            std::string results = readAvailable(sv[1]);
+            CHECK_EQUAL(8u, results.size());
+            int32_t r[2];
+            std::memcpy(r, results.data(), sizeof(r));
+            CHECK_EQUAL(2147483647, r[0]);
+            CHECK_EQUAL(42, r[1]);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(InvalidVectorCount_ClosesSession) {
+        const char* logfile = "test_session_count.log";
+        const char* dbfile = "test_session_count.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            readAvailable(sv[1]);
+            
+            sendUint32(sv[1], 0); // Недопустимое количество векторов
+            CHECK(!session.onReadable());
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
+
+SUITE(VectorPipelineTests)
+{
+    /**
+     * @brief Отправляет вектор (размер и данные) через блокирующий сокет
+     */
+    static void sendVector(int fd, const std::vector<uint32_t>& v) {
+        sendUint32(fd, static_cast<uint32_t>(v.size()));
+        SocketIo::posix().sendAll(fd, v.data(), v.size() * sizeof(uint32_t));
+    }
+    
+    TEST(Pipelined_LockstepClient) {
+        const char* logfile = "test_pipeline.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        bool ok = true;
+        std::thread server([&] {
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setPipeline(true);
+            handler.setJobPool(&jobs);
+            try {
+                handler.process(sv[0], "user");
+            } catch(const std::exception&) {
+                ok = false;
+            }
+        });
+        
+        // Клиент ждет ответ на каждый вектор до отправки следующего:
+        // результат большого вектора не должен ждать чтения следующего
+        std::vector<std::vector<uint32_t>> vectors = {
+            std::vector<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE, 1),
+            {1, 2, 3},
+            std::vector<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE * 2, 3),
+            std::vector<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE, 0xFFFFFFFFu)
+        };
+        int32_t expected[] = {65536, 6, 393216, 2147483647};
+        
+        sendUint32(sv[1], static_cast<uint32_t>(vectors.size()));
+        for(size_t i = 0; i < vectors.size(); ++i) {
+            sendVector(sv[1], vectors[i]);
+            int32_t r = 0;
+            CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(expected[i], r);
+        }
+        
+        server.join();
+        CHECK(ok);
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(Streaming_ChunkedVectors) {
+        const char* logfile = "test_stream.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        std::thread server([&] {
+            VectorHandler handler(logger);
+            handler.setStreaming(true);
+            handler.process(sv[0], "user");
+        });
+        
+        // Векторы больше, меньше и не кратные размеру порции
+        const size_t chunk = VectorHandler::STREAM_CHUNK_SIZE / sizeof(uint32_t);
+        std::vector<std::vector<uint32_t>> vectors = {
+            std::vector<uint32_t>(chunk * 3 + 5, 2),
+            {7},
+            std::vector<uint32_t>(chunk, 0xFFFFFFFFu)
+        };
+        sendUint32(sv[1], static_cast<uint32_t>(vectors.size()));
+        for(const std::vector<uint32_t>& v : vectors)
+            sendVector(sv[1], v);
+        
+        for(const std::vector<uint32_t>& v : vectors) {
+            int32_t r = 0;
+            CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(VectorProcessor::sumClamp(v), r);
+        }
+        
+        server.join();
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(SetBufferPool_VectorsUseSessionPool) {
+        const char* logfile = "test_session_pool.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        // Пул шарда: блоки векторов берутся из него, а не из общего пула
+        BufferPool pool;
+        const size_t shared_before = BufferPool::shared().allocations();
+        std::thread server([&] {
+            VectorHandler handler(logger);
+            handler.setBufferPool(pool);
+            handler.process(sv[0], "user");
+        });
+        
+        std::vector<uint32_t> v(size_t(2) << 20, 1);
+        sendUint32(sv[1], 1);
+        sendVector(sv[1], v);
+        int32_t r = 0;
+        CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(static_cast<int32_t>(v.size()), r);
+        server.join();
+        
+        CHECK(pool.allocations() > 0);
+        CHECK_EQUAL(v.size() * sizeof(uint32_t), pool.cachedBytes());
+        CHECK_EQUAL(shared_before, BufferPool::shared().allocations());
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(Streaming_SaturatedVectorIsDiscarded) {
+        const char* logfile = "test_stream_drain.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // TCP через loopback: остаток отбрасывается recv() с MSG_TRUNC
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        CHECK_EQUAL(0, bind(listener, (sockaddr*)&addr, sizeof(addr)));
+        CHECK_EQUAL(0, getsockname(listener, (sockaddr*)&addr, &len));
+        CHECK_EQUAL(0, listen(listener, 1));
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK_EQUAL(0, connect(client, (sockaddr*)&addr, sizeof(addr)));
+        int server_fd = accept(listener, nullptr, nullptr);
+        close(listener);
+        
+        std::thread server([&] {
+            VectorHandler handler(logger);
+            handler.setStreaming(true);
+            handler.process(server_fd, "user");
+        });
+        
+        // Насыщение в первой порции; следующий вектор читается с верной позиции
+        std::vector<uint32_t> saturating(1000000, 7);
+        saturating[0] = 0xFFFFFFFFu;
+        sendUint32(client, 2);
+        sendVector(client, saturating);
+        sendVector(client, {1, 2, 3});
+        
+        int32_t r[2] = {0, 0};
+        CHECK_EQUAL(8, recv(client, r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(2147483647, r[0]);
+        CHECK_EQUAL(6, r[1]);
+        
+        server.join();
+        close(server_fd);
+        close(client);
+        remove(logfile);
+    }
+    
+    TEST(Pipelined_BurstClient_PreservesOrder) {
+        const char* logfile = "test_pipeline_burst.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        std::thread server([&] {
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setPipeline(true);
+            handler.setJobPool(&jobs);
+            handler.process(sv[0], "user");
+        });
+        
+        // Все векторы отправляются подряд, результаты читаются в конце
+        const uint32_t count = 6;
+        sendUint32(sv[1], count);
+        for(uint32_t i = 0; i < count; ++i)
+            sendVector(sv[1], std::vector<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE + i, i));
+        
+        for(uint32_t i = 0; i < count; ++i) {
+            int32_t r = 0;
+            CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(static_cast<int32_t>((VectorHandler::PIPELINE_MIN_SIZE + i) * i), r);
+        }
+        
+        server.join();
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(TypedVectors_AllBlockingModes) {
+        const char* logfile = "test_typed.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // u8 (нечетный размер), u16, u64 с насыщением, i32 с отрицательными, u32
+        std::string request;
+        auto put = [&request](const void* p, size_t n) { request.append(static_cast<const char*>(p), n); };
+        auto header = [&put](ElementType type, uint32_t size) {
+            uint32_t raw = static_cast<uint32_t>(type) << VectorHandler::ELEMENT_TYPE_SHIFT | size;
+            put(&raw, sizeof(raw));
+        };
+        uint32_t count = 5;
+        put(&count, sizeof(count));
+        std::vector<uint8_t> u8(100001, 255);
+        header(ElementType::U8, static_cast<uint32_t>(u8.size()));
+        put(u8.data(), u8.size());
+        std::vector<uint16_t> u16 = {1, 2, 65535};
+        header(ElementType::U16, 3);
+        put(u16.data(), 6);
+        std::vector<uint64_t> u64 = {1, uint64_t(1) << 40, 7};
+        header(ElementType::U64, 3);
+        put(u64.data(), 24);
+        std::vector<int32_t> i32(20000, -3);
+        i32[0] = 100000;
+        header(ElementType::I32, static_cast<uint32_t>(i32.size()));
+        put(i32.data(), i32.size() * 4);
+        std::vector<uint32_t> u32 = {10, 20};
+        header(ElementType::U32, 2);
+        put(u32.data(), 8);
+        const int32_t expected[] = {25500255, 65538, 2147483647, 100000 - 3 * 19999, 30};
+        
+        for(int mode = 0; mode < 3; ++mode) {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread client([&] { SocketIo::posix().sendAll(sv[1], request.data(), request.size()); });
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setStreaming(mode == 1);
+            handler.setPipeline(mode == 2);
+            handler.setJobPool(&jobs);
+            handler.process(sv[0], "user");
+            client.join();
+            
+            for(int32_t e : expected) {
+                int32_t r = -1;
+                CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+                CHECK_EQUAL(e, r);
+            }
+            close(sv[0]);
+            close(sv[1]);
+        }
+        remove(logfile);
+    }
+    
+    TEST(ReduceOperations_AllBlockingModes) {
+        const char* logfile = "test_reduce_modes.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        const uint32_t sum = static_cast<uint32_t>(ReduceOp::Sum);
+        const uint32_t min = static_cast<uint32_t>(ReduceOp::Min);
+        const uint32_t max = static_cast<uint32_t>(ReduceOp::Max);
+        const uint32_t nonzero = static_cast<uint32_t>(ReduceOp::CountNonzero);
+        const uint32_t hist = static_cast<uint32_t>(ReduceOp::Histogram);
+        
+        // Большой вектор с операциями (конвейер суммирует его отдельно),
+        // короткий вектор исходного протокола, uint8_t с гистограммой
+        std::string request;
+        auto put = [&request](const void* p, size_t n) { request.append(static_cast<const char*>(p), n); };
+        auto put32 = [&put](uint32_t v) { put(&v, sizeof(v)); };
+        put32(3);
+        std::vector<uint32_t> big(70000, 5);
+        big[123] = 0;
+        big[456] = 900;
+        put32(VectorHandler::OPERATIONS_FLAG | static_cast<uint32_t>(big.size()));
+        put32(sum | min | max | nonzero);
+        put(big.data(), big.size() * 4);
+        put32(2);
+        put32(40);
+        put32(2);
+        std::vector<uint8_t> u8 = {0, 15, 16, 255, 255};
+        put32(VectorHandler::OPERATIONS_FLAG |
+              static_cast<uint32_t>(ElementType::U8) << VectorHandler::ELEMENT_TYPE_SHIFT | 5);
+        put32(hist);
+        put(u8.data(), u8.size());
+        
+        std::vector<uint64_t> expected = {5 * 69998 + 900, 0, 900, 69999};
+        std::vector<uint64_t> bins(ReduceKernels::HISTOGRAM_BINS, 0);
+        bins[0] = 2;
+        bins[1] = 1;
+        bins[15] = 2;
+        
+        for(int mode = 0; mode < 4; ++mode) {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread client([&] { SocketIo::posix().sendAll(sv[1], request.data(), request.size()); });
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setStreaming(mode == 1);
+            handler.setPipeline(mode == 2);
+            handler.setJobPool(&jobs);
+            FlushPolicy policy;
+            policy.max_results = mode == 3 ? 8 : 0;
+            handler.setBatching(policy);
+            handler.process(sv[0], "user");
+            client.join();
+            
+            std::vector<uint64_t> values(4);
+            CHECK_EQUAL(32, recv(sv[1], values.data(), 32, MSG_WAITALL));
+            CHECK_ARRAY_EQUAL(expected.data(), values.data(), 4);
+            int32_t r = -1;
+            CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(42, r);
+            std::vector<uint64_t> got(bins.size());
+            CHECK_EQUAL(128, recv(sv[1], got.data(), 128, MSG_WAITALL));
+            CHECK_ARRAY_EQUAL(bins.data(), got.data(), bins.size());
+            close(sv[0]);
+            close(sv[1]);
+        }
+        remove(logfile);
+    }
+    
+    TEST(BulkBatch_AllBlockingModes) {
+        const char* logfile = "test_bulk_modes.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // Серии коротких векторов uint32_t разделены большим вектором
+        // и вектором uint8_t (следующие данные не выровнены)
+        const uint32_t shift = VectorHandler::ELEMENT_TYPE_SHIFT;
+        std::vector<uint32_t> big(70000, 2);
+        std::vector<uint8_t> u8 = {0, 15, 16, 255, 255};
+        std::vector<int32_t> i32 = {-5, 10, 3, -1};
+        std::vector<uint32_t> table = {2, 3, static_cast<uint32_t>(big.size()),
+                                       static_cast<uint32_t>(ElementType::U8) << shift | 5, 2,
+                                       static_cast<uint32_t>(ElementType::I32) << shift | 4};
+        std::string request;
+        auto put = [&request](const void* p, size_t n) { request.append(static_cast<const char*>(p), n); };
+        uint32_t count = VectorHandler::BULK_FLAG | static_cast<uint32_t>(table.size());
+        put(&count, sizeof(count));
+        put(table.data(), table.size() * 4);
+        uint32_t small[] = {1, 2, 3, 4, 5};
+        put(small, sizeof(small));
+        put(big.data(), big.size() * 4);
+        put(u8.data(), u8.size());
+        uint32_t saturated[] = {2147483647u, 1};
+        put(saturated, sizeof(saturated));
+        put(i32.data(), i32.size() * 4);
+        
+        const int32_t expected[] = {3, 12, 140000, 541, 2147483647, 12};
+        ParallelSum parallel(2);
+        for(int mode = 0; mode < 5; ++mode) {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread client([&] { SocketIo::posix().sendAll(sv[1], request.data(), request.size()); });
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setStreaming(mode == 1);
+            handler.setPipeline(mode == 2);
+            handler.setJobPool(&jobs);
+            FlushPolicy policy;
+            policy.max_results = mode == 3 ? 8 : 0;
+            handler.setBatching(policy);
+            handler.setParallelSum(mode == 4 ? &parallel : nullptr);
+            handler.process(sv[0], "user");
+            client.join();
+            close(sv[0]);
+            
+            // Ответ - один массив сумм и ничего больше
+            int32_t r[7] = {};
+            CHECK_EQUAL(24, recv(sv[1], r, sizeof(r), MSG_WAITALL));
+            CHECK_ARRAY_EQUAL(expected, r, 6);
+            close(sv[1]);
+        }
+        remove(logfile);
+    }
+    
+    TEST(Tagged_SmallJobsOvertakeLargeOne) {
+        const char* logfile = "test_tagged.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // Большое задание со всеми операциями считается в пуле сеанса;
+        // короткие задания после него отвечаются раньше
+        const uint32_t all_ops = 0x7F & ~static_cast<uint32_t>(ReduceOp::Dot);
+        std::vector<uint32_t> big(10000000, 1);
+        std::string request;
+        auto put = [&request](const void* p, size_t n) { request.append(static_cast<const char*>(p), n); };
+        auto put32 = [&put](uint32_t v) { put(&v, sizeof(v)); };
+        put32(VectorHandler::TAGGED_FLAG | 3);
+        put32(1000);
+        put32(VectorHandler::OPERATIONS_FLAG | static_cast<uint32_t>(big.size()));
+        put32(all_ops);
+        put(big.data(), big.size() * 4);
+        put32(7);
+        put32(2);
+        put32(20);
+        put32(22);
+        put32(0xFFFFFFFFu);
+        put32(VectorHandler::OPERATIONS_FLAG | 3);
+        put32(static_cast<uint32_t>(ReduceOp::Max));
+        put32(4);
+        put32(9);
+        put32(1);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        std::thread client([&] { SocketIo::posix().sendAll(sv[1], request.data(), request.size()); });
+        ThreadPool jobs(VectorHandler::TAGGED_COMPUTE_THREADS);
+        VectorHandler handler(logger);
+        handler.setJobPool(&jobs);
+        handler.process(sv[0], "user");
+        client.join();
+        close(sv[0]);
+        
+        uint32_t frame[VectorHandler::TAGGED_FRAME_WORDS];
+        CHECK_EQUAL(8, recv(sv[1], frame, 8, MSG_WAITALL));
+        CHECK_EQUAL(7u, frame[0]);
+        CHECK_EQUAL(42u, frame[1]);
+        CHECK_EQUAL(12, recv(sv[1], frame, 12, MSG_WAITALL));
+        CHECK_EQUAL(0xFFFFFFFFu, frame[0]);
+        uint64_t max;
+        std::memcpy(&max, frame + 1, sizeof(max));
+        CHECK_EQUAL(9u, max);
+        
+        // Сумма, минимум, максимум, ненулевые, среднее, 16 корзин гистограммы
+        const size_t values = VectorProcessor::reduceValues(all_ops);
+        CHECK_EQUAL(4 + 8 * values, static_cast<size_t>(recv(sv[1], frame, 4 + 8 * values, MSG_WAITALL)));
+        CHECK_EQUAL(1000u, frame[0]);
+        uint64_t sum, nonzero;
+        std::memcpy(&sum, frame + 1, sizeof(sum));
+        std::memcpy(&nonzero, frame + 7, sizeof(nonzero));
+        CHECK_EQUAL(10000000u, sum);
+        CHECK_EQUAL(10000000u, nonzero);
+        char end;
+        CHECK_EQUAL(0, recv(sv[1], &end, 1, 0));
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(Tagged_SessionsShareJobPoolAndSlots) {
+        const char* logfile = "test_tagged_shared.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // Два сеанса по три больших задания на общем пуле с одним местом:
+        // задания выполняются по одному, место возвращается после каждого
+        const uint32_t jobs_per_session = 3;
+        std::vector<uint32_t> words = {VectorHandler::TAGGED_FLAG | jobs_per_session};
+        for(uint32_t j = 0; j < jobs_per_session; ++j) {
+            words.push_back(100 + j);
+            words.push_back(static_cast<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE));
+            words.insert(words.end(), VectorHandler::PIPELINE_MIN_SIZE, j + 1);
+        }
+        
+        ThreadPool jobs(2);
+        std::counting_semaphore<> slots(1);
+        int sv[2][2];
+        std::thread clients[2];
+        std::thread sessions[2];
+        for(int k = 0; k < 2; ++k) {
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv[k]));
+            clients[k] = std::thread([&, k] { SocketIo::posix().sendAll(sv[k][1], words.data(), words.size() * 4); });
+            sessions[k] = std::thread([&, k] {
+                VectorHandler handler(logger);
+                handler.setJobPool(&jobs, &slots);
+                handler.process(sv[k][0], "user");
+            });
+        }
+        for(int k = 0; k < 2; ++k) {
+            clients[k].join();
+            sessions[k].join();
+            close(sv[k][0]);
+            
+            uint32_t frame[2 * jobs_per_session];
+            CHECK_EQUAL(static_cast<ssize_t>(sizeof(frame)), recv(sv[k][1], frame, sizeof(frame), MSG_WAITALL));
+            for(uint32_t j = 0; j < jobs_per_session; ++j) {
+                CHECK_EQUAL(100 + j, frame[2 * j]);
+                CHECK_EQUAL((j + 1) * VectorHandler::PIPELINE_MIN_SIZE, frame[2 * j + 1]);
+            }
+            close(sv[k][1]);
+        }
+        CHECK(slots.try_acquire());
+        CHECK(!slots.try_acquire());
+        remove(logfile);
+    }
+    
+    TEST(Tagged_ReplyWaitingClientAndStalledReader) {
+        const char* logfile = "test_tagged_stalled.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        const uint32_t big = static_cast<uint32_t>(VectorHandler::PIPELINE_MIN_SIZE);
+        std::vector<uint32_t> data(big, 1);
+        auto sendJob = [&data, big](int fd, uint32_t id) {
+            uint32_t head[] = {id, big};
+            SocketIo::posix().sendAll(fd, head, sizeof(head));
+            SocketIo::posix().sendAll(fd, data.data(), data.size() * 4);
+        };
+        ThreadPool jobs(1);
+        std::counting_semaphore<> slots(1);
+        
+        // Клиент ждет ответа на большое задание перед отправкой следующего:
+        // сеанс отправляет ответ, не дожидаясь данных следующего задания
+        {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread session([&] {
+                VectorHandler handler(logger);
+                handler.setJobPool(&jobs, &slots);
+                handler.process(sv[0], "user");
+            });
+            uint32_t count = VectorHandler::TAGGED_FLAG | 2;
+            SocketIo::posix().sendAll(sv[1], &count, sizeof(count));
+            for(uint32_t id : {7u, 8u}) {
+                sendJob(sv[1], id);
+                pollfd pfd = {sv[1], POLLIN, 0};
+                CHECK_EQUAL(1, poll(&pfd, 1, 10000));
+                uint32_t frame[2] = {};
+                CHECK_EQUAL(8, recv(sv[1], frame, sizeof(frame), MSG_WAITALL));
+                CHECK_EQUAL(id, frame[0]);
+                CHECK_EQUAL(big, frame[1]);
+            }
+            session.join();
+            close(sv[0]);
+            close(sv[1]);
+        }
+        
+        // Клиент A не читает ответы, и его сокет заполнен: поток пула и
+        // общее место не ждут send(), поэтому задание сеанса B выполняется
+        int a[2], b[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, a));
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, b));
+        int flags = fcntl(a[0], F_GETFL);
+        fcntl(a[0], F_SETFL, flags | O_NONBLOCK);
+        size_t junk = 0;
+        char filler[4096] = {};
+        for(ssize_t w; (w = send(a[0], filler, sizeof(filler), 0)) > 0;)
+            junk += static_cast<size_t>(w);
+        fcntl(a[0], F_SETFL, flags);
+        
+        std::thread session_a([&] {
+            VectorHandler handler(logger);
+            handler.setJobPool(&jobs, &slots);
+            handler.process(a[0], "a");
+        });
+        uint32_t count_a = VectorHandler::TAGGED_FLAG | 2;
+        SocketIo::posix().sendAll(a[1], &count_a, sizeof(count_a));
+        sendJob(a[1], 1);
+        sendJob(a[1], 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        
+        std::thread session_b([&] {
+            VectorHandler handler(logger);
+            handler.setJobPool(&jobs, &slots);
+            handler.process(b[0], "b");
+        });
+        uint32_t count_b = VectorHandler::TAGGED_FLAG | 1;
+        SocketIo::posix().sendAll(b[1], &count_b, sizeof(count_b));
+        sendJob(b[1], 3);
+        pollfd pfd = {b[1], POLLIN, 0};
+        CHECK_EQUAL(1, poll(&pfd, 1, 10000));
+        uint32_t frame[2] = {};
+        CHECK_EQUAL(8, recv(b[1], frame, sizeof(frame), MSG_DONTWAIT));
+        CHECK_EQUAL(3u, frame[0]);
+        session_b.join();
+        
+        // Клиент A дочитывает сокет: оба ответа приходят после заполнителя
+        std::vector<char> rest(junk + 16);
+        CHECK_EQUAL(static_cast<ssize_t>(rest.size()), recv(a[1], rest.data(), rest.size(), MSG_WAITALL));
+        uint32_t frames[4];
+        std::memcpy(frames, rest.data() + junk, sizeof(frames));
+        CHECK(frames[0] == 1u || frames[0] == 2u);
+        CHECK_EQUAL(3u, frames[0] + frames[2]);
+        session_a.join();
+        for(int fd : {a[0], a[1], b[0], b[1]})
+            close(fd);
+        CHECK(slots.try_acquire());
+        remove(logfile);
+    }
+    
+    TEST(KeepAlive_BatchesAndIdleTimeout) {
+        const char* logfile = "test_keepalive.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // Три пакета разных форматов в одном сеансе, затем слово конца сеанса
+        std::vector<uint32_t> words = {VectorHandler::KEEP_ALIVE_FLAG | 1, 2, 5, 6,
+                                       VectorHandler::KEEP_ALIVE_FLAG | VectorHandler::BULK_FLAG | 2, 1, 2, 3, 4, 5,
+                                       VectorHandler::KEEP_ALIVE_FLAG | VectorHandler::TAGGED_FLAG | 1, 42, 1, 9,
+                                       VectorHandler::END_OF_SESSION};
+        const int32_t expected[] = {11, 3, 9, 42, 9};
+        for(int mode = 0; mode < 3; ++mode) {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread client([&] { SocketIo::posix().sendAll(sv[1], words.data(), words.size() * 4); });
+            ThreadPool jobs(1);
+            VectorHandler handler(logger);
+            handler.setStreaming(mode == 1);
+            handler.setPipeline(mode == 2);
+            handler.setJobPool(&jobs);
+            handler.process(sv[0], "user");
+            client.join();
+            close(sv[0]);
+            
+            int32_t r[6] = {};
+            CHECK_EQUAL(20, recv(sv[1], r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(expected[0], r[0]);
+            CHECK_ARRAY_EQUAL(expected + 1, r + 1, 2);
+            CHECK_EQUAL(42, r[3]);
+            CHECK_EQUAL(9, r[4]);
+            close(sv[1]);
+        }
+        
+        // Клиент молчит после пакета: сеанс закрывается по таймауту простоя
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        uint32_t batch[] = {VectorHandler::KEEP_ALIVE_FLAG | 1, 1, 4};
+        send(sv[1], batch, sizeof(batch), 0);
+        VectorHandler handler(logger);
+        handler.setIdleTimeout(50);
+        auto start = std::chrono::steady_clock::now();
+        handler.process(sv[0], "user");
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+        int32_t r = 0;
+        CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), 0));
+        CHECK_EQUAL(4, r);
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+    
+    TEST(SmallVectorRuns_MixedBurstAndLockstep) {
+        const char* logfile = "test_small_runs.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        
+        // Все векторы отправлены сразу: короткие (в том числе с насыщением)
+        // вперемешку с векторами длиннее SMALL_VECTOR_MAX_SIZE
+        {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::vector<std::vector<uint32_t>> vectors;
+            for(uint32_t i = 0; i < 300; ++i) {
+                uint32_t size = i % 40 == 39 ? VectorHandler::SMALL_VECTOR_MAX_SIZE + 5 : i % 16 + 1;
+                std::vector<uint32_t> v(size, i);
+                if(i % 50 == 7)
+                    v[0] = 0xFFFFFFFFu;
+                vectors.push_back(v);
+            }
+            std::thread client([&] {
+                sendUint32(sv[1], static_cast<uint32_t>(vectors.size()));
+                for(const auto& v : vectors)
+                    sendVector(sv[1], v);
+            });
+            VectorHandler handler(logger);
+            handler.process(sv[0], "user");
+            client.join();
+            
+            for(const auto& v : vectors) {
+                int32_t r = -1;
+                CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+                CHECK_EQUAL(VectorProcessor::sumClamp(v), r);
+            }
+            close(sv[0]);
+            close(sv[1]);
+        }
+        
+        // Клиент ждет ответ на каждый короткий вектор: серия не ждет следующих
+        {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread server([&] {
+                VectorHandler handler(logger);
+                handler.process(sv[0], "user");
+            });
+            sendUint32(sv[1], 4);
+            for(uint32_t i = 0; i < 4; ++i) {
+                sendVector(sv[1], {i, i, i});
+                int32_t r = -1;
+                CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+                CHECK_EQUAL(static_cast<int32_t>(3 * i), r);
+            }
+            server.join();
+            close(sv[0]);
+            close(sv[1]);
+        }
+        remove(logfile);
+    }
+}
+
+SUITE(ResultBatcherTests)
+{
+    TEST(Disabled_SendsEachResult) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        ResultBatcher out(SocketIo::posix());
+        CHECK(!out.enabled());
+        CHECK(out.add(sv[0], 7));
+        CHECK_EQUAL(0u, out.pending());
+        CHECK_EQUAL(4u, readAvailable(sv[1]).size());
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(FlushesAfterMaxResults) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        ResultBatcher out(SocketIo::posix());
+        FlushPolicy policy;
+        policy.max_results = 3;
+        out.setPolicy(policy);
+        out.begin(sv[0]);
+        
+        CHECK(out.add(sv[0], 1));
+        CHECK(out.add(sv[0], 2));
+        CHECK_EQUAL("", readAvailable(sv[1]));
+        CHECK(out.add(sv[0], 3));
+        CHECK_EQUAL(0u, out.pending());
+        CHECK_EQUAL(1u, out.flushes());
+        
+        std::string data = readAvailable(sv[1]);
+        CHECK_EQUAL(12u, data.size());
+        int32_t r[3];
+        std::memcpy(r, data.data(), sizeof(r));
+        CHECK_EQUAL(1, r[0]);
+        CHECK_EQUAL(2, r[1]);
+        CHECK_EQUAL(3, r[2]);
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(FlushBeforeRead_OnlyWhenReadWouldBlock) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        ResultBatcher out(SocketIo::posix());
+        FlushPolicy policy;
+        policy.max_results = 100;
+        out.setPolicy(policy);
+        out.begin(sv[0]);
+        CHECK(out.add(sv[0], 5));
+        
+        // Заголовок уже получен - отправка откладывается
+        sendUint32(sv[1], 1);
+        CHECK(out.flushBeforeRead(sv[0], 4));
+        CHECK_EQUAL(1u, out.pending());
+        
+        // Данных меньше, чем нужно, - чтение заблокирует, буфер отправляется
+        CHECK(out.flushBeforeRead(sv[0], 8));
+        CHECK_EQUAL(0u, out.pending());
+        CHECK_EQUAL(4u, readAvailable(sv[1]).size());
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(FlushesAfterDelay) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        ResultBatcher out(SocketIo::posix());
+        FlushPolicy policy;
+        policy.max_results = 100;
+        policy.max_delay_us = 1000;
+        out.setPolicy(policy);
+        out.begin(sv[0]);
+        
+        CHECK(out.add(sv[0], 1));
+        CHECK_EQUAL(1u, out.pending());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CHECK(out.add(sv[0], 2));
+        CHECK_EQUAL(0u, out.pending());
+        CHECK_EQUAL(8u, readAvailable(sv[1]).size());
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(VectorHandler_BatchedBurstAndLockstep) {
+        const char* logfile = "test_batch.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        FlushPolicy policy;
+        policy.max_results = 64;
+        
+        // Клиент отправляет все векторы сразу
+        {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            const uint32_t count = 500;
+            std::vector<uint32_t> request = {count};
+            for(uint32_t i = 0; i < count; ++i) {
+                request.push_back(1);
+                request.push_back(i);
+            }
+            SocketIo::posix().sendAll(sv[1], request.data(), request.size() * sizeof(uint32_t));
+            VectorHandler handler(logger);
+            handler.setBatching(policy);
+            handler.process(sv[0], "user");
+            
+            std::string data = readAvailable(sv[1]);
+            CHECK_EQUAL(count * 4, data.size());
+            std::vector<int32_t> r(count);
+            std::memcpy(r.data(), data.data(), data.size());
+            for(uint32_t i = 0; i < count; ++i)
+                CHECK_EQUAL(static_cast<int32_t>(i), r[i]);
+            close(sv[0]);
+            close(sv[1]);
+        }
+        
+        // Клиент ждет каждый ответ: накопление не должно приводить к зависанию
+        {
+            int sv[2];
+            CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            std::thread server([&] {
+                VectorHandler handler(logger);
+                handler.setBatching(policy);
+                handler.process(sv[0], "user");
+            });
+            sendUint32(sv[1], 3);
+            for(uint32_t i = 0; i < 3; ++i) {
+                sendUint32(sv[1], 2);
+                sendUint32(sv[1], i);
+                sendUint32(sv[1], i);
+                int32_t r = -1;
+                CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+                CHECK_EQUAL(static_cast<int32_t>(2 * i), r);
+            }
+            server.join();
+            close(sv[0]);
+            close(sv[1]);
+        }
+        remove(logfile);
+    }
+}
+
+SUITE(BufferedSocketReaderTests)
+{
+    TEST(Headers_OneRefillForBurst) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        uint32_t request[] = {3, 1, 10, 2, 20, 30};
+        SocketIo::posix().sendAll(sv[1], request, sizeof(request));
+        
+        BufferedSocketReader reader(SocketIo::posix());
+        uint32_t v[6];
+        CHECK_EQUAL(4, reader.readAll(sv[0], &v[0], 4));
+        CHECK_EQUAL(20u, reader.buffered());
+        CHECK_EQUAL(4, reader.readAll(sv[0], &v[1], 4));
+        CHECK_EQUAL(4, reader.readAll(sv[0], &v[2], 4));
+        CHECK_EQUAL(12, reader.readAll(sv[0], &v[3], 12));
+        for(size_t i = 0; i < 6; ++i)
+            CHECK_EQUAL(request[i], v[i]);
+        CHECK_EQUAL(1u, reader.refills());
+        CHECK_EQUAL(0u, reader.buffered());
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(LargePayload_ReadsIntoDestination) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        std::vector<uint32_t> request = {64};
+        for(uint32_t i = 0; i < 64; ++i)
+            request.push_back(i);
+        request.push_back(777);
+        SocketIo::posix().sendAll(sv[1], request.data(), request.size() * sizeof(uint32_t));
+        
+        // Буфер 32 байта: данные вектора (256 байт) читаются мимо буфера
+        BufferedSocketReader reader(SocketIo::posix(), 32);
+        uint32_t size = 0;
+        CHECK_EQUAL(4, reader.readAll(sv[0], &size, 4));
+        CHECK_EQUAL(64u, size);
+        std::vector<uint32_t> data(size);
+        CHECK_EQUAL(256, reader.readAll(sv[0], data.data(), 256));
+        for(uint32_t i = 0; i < size; ++i)
+            CHECK_EQUAL(i, data[i]);
+        CHECK_EQUAL(1u, reader.refills());
+        
+        uint32_t tail = 0;
+        CHECK_EQUAL(4, reader.readAll(sv[0], &tail, 4));
+        CHECK_EQUAL(777u, tail);
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(ReadSomeAndDiscard_UseBufferedBytesFirst) {
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        std::string request = "login" + std::string(20, 'x') + "tail";
+        SocketIo::posix().sendAll(sv[1], request.data(), request.size());
+        
+        BufferedSocketReader reader(SocketIo::posix());
+        char buf[5];
+        CHECK_EQUAL(5, reader.readSome(sv[0], buf, sizeof(buf)));
+        CHECK_EQUAL("login", std::string(buf, 5));
+        CHECK_EQUAL(20, reader.discardAll(sv[0], 20));
+        CHECK_EQUAL(4, reader.readSome(sv[0], buf, sizeof(buf)));
+        CHECK_EQUAL("tail", std::string(buf, 4));
+        CHECK_EQUAL(1u, reader.refills());
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(VectorHandler_BurstOfSmallVectors_FewReads) {
+        const char* logfile = "test_reader.log";
+        std::ofstream(logfile, std::ios::trunc).close();
+        Logger logger(logfile);
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        const uint32_t count = 200;
+        std::vector<uint32_t> request = {count};
+        for(uint32_t i = 0; i < count; ++i) {
+            request.push_back(2);
+            request.push_back(i);
+            request.push_back(1);
+        }
+        SocketIo::posix().sendAll(sv[1], request.data(), request.size() * sizeof(uint32_t));
+        
+        // Без буфера - 2 чтения на вектор; с буфером весь запрос (2404 байта)
+        // забирается одним recv()
+        BufferedSocketReader reader(SocketIo::posix());
+        VectorHandler handler(logger, nullptr, &reader);
+        handler.process(sv[0], "user");
+        CHECK_EQUAL(1u, reader.refills());
+        
+        std::string data = readAvailable(sv[1]);
+        CHECK_EQUAL(count * 4, data.size());
+        std::vector<int32_t> r(count);
+        std::memcpy(r.data(), data.data(), data.size());
+        for(uint32_t i = 0; i < count; ++i)
+            CHECK_EQUAL(static_cast<int32_t>(i + 1), r[i]);
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+    }
+}
+
+SUITE(BufferPoolTests)
+{
+    TEST(SizeClasses) {
+        CHECK_EQUAL(0u, BufferPool::sizeClass(1));
+        CHECK_EQUAL(0u, BufferPool::sizeClass(BufferPool::MIN_CLASS_ELEMS));
+        CHECK_EQUAL(1u, BufferPool::sizeClass(BufferPool::MIN_CLASS_ELEMS + 1));
+        CHECK_EQUAL(14u, BufferPool::sizeClass(10000000));
+        CHECK_EQUAL(BufferPool::NUM_CLASSES, BufferPool::sizeClass((1u << 24) + 1));
+        CHECK_EQUAL(8192u, BufferPool::classElems(3));
+    }
+    
+    TEST(Resize_KeepsMemoryWhileCapacityAllows) {
+        BufferPool pool;
+        PooledBuffer buf(pool);
+        buf.resize(1000);
+        CHECK_EQUAL(1000u, buf.size());
+        CHECK_EQUAL(1024u, buf.capacity());
+        const uint32_t* p = buf.data();
+        CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(p) % 64);
+        
+        buf.resize(10);
+        buf.resize(1024);
+        CHECK(p == buf.data());
+        buf.resize(1025);
+        CHECK_EQUAL(2048u, buf.capacity());
+    }
+    
+    TEST(ReleasedBlockIsReused) {
+        // Класс 8 МБ не кэшируется в потоке и попадает в общий список
+        const size_t big = size_t(2) << 20;
+        BufferPool pool;
+        {
+            PooledBuffer buf = pool.acquire(big);
+            buf.data()[big - 1] = 1;
+        }
+        CHECK_EQUAL(1u, pool.allocations());
+        CHECK_EQUAL(big * sizeof(uint32_t), pool.cachedBytes());
+        
+        PooledBuffer again = pool.acquire(big - 5);
+        CHECK_EQUAL(1u, pool.allocations());
+        CHECK_EQUAL(0u, pool.cachedBytes());
+        CHECK_EQUAL(big, again.capacity());
+    }
+    
+    TEST(CacheLimitAndTrim) {
+        const size_t big = size_t(2) << 20;
+        const size_t bytes = big * sizeof(uint32_t);
+        BufferPool pool(bytes);
+        {
+            PooledBuffer a = pool.acquire(big);
+            PooledBuffer b = pool.acquire(big);
+        }
+        // Второй блок превысил бы предел и освобожден сразу
+        CHECK_EQUAL(2u, pool.allocations());
+        CHECK_EQUAL(bytes, pool.cachedBytes());
+        
+        pool.trim();
+        CHECK_EQUAL(0u, pool.cachedBytes());
+    }
+    
+    TEST(ThreadCache_ReusesSmallBlocks) {
+        BufferPool pool;
+        std::thread worker([&] {
+            for(int i = 0; i < 100; ++i) {
+                PooledBuffer buf = pool.acquire(4096);
+                buf.data()[0] = static_cast<uint32_t>(i);
+            }
+        });
+        worker.join();
+        CHECK_EQUAL(1u, pool.allocations());
+        CHECK_EQUAL(0u, pool.cachedBytes());
+    }
+    
+    TEST(ThreadCache_SeparatePerPool) {
+        // Блок, освобожденный в кэш потока одного пула, не достается другому
+        BufferPool first;
+        BufferPool second;
+        const uint32_t* p;
+        {
+            PooledBuffer buf = first.acquire(4096);
+            p = buf.data();
+        }
+        {
+            PooledBuffer buf = second.acquire(4096);
+            CHECK(p != buf.data());
+        }
+        CHECK_EQUAL(1u, second.allocations());
+        
+        PooledBuffer again = first.acquire(4096);
+        CHECK(p == again.data());
+        CHECK_EQUAL(1u, first.allocations());
+    }
+    
+    TEST(TrimIdle_KeepsBudget) {
+        const size_t big = size_t(2) << 20;
+        const size_t bytes = big * sizeof(uint32_t);
+        BufferPool pool;
+        pool.setIdleBudget(bytes);
+        {
+            PooledBuffer a = pool.acquire(big);
+            PooledBuffer b = pool.acquire(big);
+            PooledBuffer c = pool.acquire(big);
+        }
+        CHECK_EQUAL(3 * bytes, pool.cachedBytes());
+        
+        pool.trimIdle();
+        CHECK_EQUAL(bytes, pool.cachedBytes());
+        pool.trimIdle();
+        CHECK_EQUAL(bytes, pool.cachedBytes());
+        
+        pool.setIdleBudget(0);
+        pool.trimIdle();
+        CHECK_EQUAL(0u, pool.cachedBytes());
+    }
+}
+
+SUITE(CoroServerTests)
+{
+    TEST(Auth_SuspendsUntilVectorCount) {
+        const char* logfile = "test_coro.log";
+        const char* dbfile = "test_coro.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        
+        // Аутентификация ждет ответа, поэтому векторы отправляются после нее
+        std::string auth = makeAuthData("user", "P@ssW0rd");
+        send(sv[1], auth.data(), auth.size(), 0);
+        
+        CoroServer server(-1, logger, db, running);
+        server.addClient(sv[0], "test");
+        CHECK_EQUAL(1u, server.taskCount()); // Ждет количество векторов
+        CHECK_EQUAL("OK", readAvailable(sv[1]));
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(AuthFailure_SendsErrAndCloses) {
+        const char* logfile = "test_coro_err.log";
+        const char* dbfile = "test_coro_err.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        std::string auth = makeAuthData("user", "wrong");
+        send(sv[1], auth.data(), auth.size(), 0);
+        
+        CoroServer server(-1, logger, db, running);
+        server.addClient(sv[0], "test");
+        CHECK_EQUAL(0u, server.taskCount()); // Сеанс завершился без приостановки
+        
+        char buf[8];
+        CHECK_EQUAL(3, recv(sv[1], buf, sizeof(buf), 0));
+        CHECK_EQUAL("ERR", std::string(buf, 3));
+        CHECK_EQUAL(0, recv(sv[1], buf, sizeof(buf), 0)); // Сокет сервера закрыт
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(Destruction_ClosesSuspendedSessions) {
+        const char* logfile = "test_coro_stop.log";
+        const char* dbfile = "test_coro_stop.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        {
+            CoroServer server(-1, logger, db, running);
+            server.addClient(sv[0], "test");
+            CHECK_EQUAL(1u, server.taskCount()); // Ждет данные аутентификации
+        }
+        
+        char buf[8];
+        CHECK_EQUAL(0, recv(sv[1], buf, sizeof(buf), 0));
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(BulkBatch_OneResultArray) {
+        const char* logfile = "test_coro_bulk.log";
+        const char* dbfile = "test_coro_bulk.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        CoroServer server(-1, logger, db, running);
+        server.addClient(sv[0], "test");
+        std::thread loop([&server] { server.run(); });
+        
+        std::string auth = makeAuthData("user", "P@ssW0rd");
+        char buf[8];
+        send(sv[1], auth.data(), auth.size(), 0);
+        CHECK_EQUAL(2, recv(sv[1], buf, sizeof(buf), 0));
+        
+        sendUint32(sv[1], VectorHandler::BULK_FLAG | 2);
+        sendUint32(sv[1], 1);
+        sendUint32(sv[1], 3);
+        sendUint32(sv[1], 4);
+        sendUint32(sv[1], 5);
+        sendUint32(sv[1], 6);
+        sendUint32(sv[1], 7);
+        
+        int32_t r[2] = {};
+        CHECK_EQUAL(8, recv(sv[1], r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(4, r[0]);
+        CHECK_EQUAL(18, r[1]);
+        CHECK_EQUAL(0, recv(sv[1], buf, sizeof(buf), 0));
+        
+        running = false;
+        loop.join();
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(KeepAlive_IdleSessionClosed) {
+        const char* logfile = "test_coro_keepalive.log";
+        const char* dbfile = "test_coro_keepalive.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        CoroServer server(-1, logger, db, running);
+        server.setIdleTimeout(50);
+        server.addClient(sv[0], "test");
+        std::thread loop([&server] { server.run(); });
+        
+        std::string auth = makeAuthData("user", "P@ssW0rd");
+        char buf[8];
+        send(sv[1], auth.data(), auth.size(), 0);
+        CHECK_EQUAL(2, recv(sv[1], buf, sizeof(buf), 0));
+        
+        // Два пакета в одном сеансе; после второго клиент молчит
+        int32_t r = 0;
+        sendUint32(sv[1], VectorHandler::KEEP_ALIVE_FLAG | 1);
+        sendUint32(sv[1], 1);
+        sendUint32(sv[1], 5);
+        CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(5, r);
+        sendUint32(sv[1], VectorHandler::KEEP_ALIVE_FLAG | 1);
+        sendUint32(sv[1], 1);
+        sendUint32(sv[1], 6);
+        CHECK_EQUAL(4, recv(sv[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(6, r);
+        CHECK_EQUAL(0, recv(sv[1], buf, sizeof(buf), 0));
+        
+        running = false;
+        loop.join();
+        CHECK_EQUAL(0u, server.taskCount());
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(Run_InterleavesSessions) {
+        const char* logfile = "test_coro_run.log";
+        const char* dbfile = "test_coro_run.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        
+        int a[2], b[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, a));
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, b));
+        
+        CoroServer server(-1, logger, db, running);
+        server.addClient(a[0], "a");
+        server.addClient(b[0], "b");
+        std::thread loop([&server] { server.run(); });
+        
+        // Клиенты проходят этапы поочередно: ни один сеанс не блокирует поток
+        std::string auth = makeAuthData("user", "P@ssW0rd");
+        char buf[8];
+        send(a[1], auth.data(), auth.size(), 0);
+        CHECK_EQUAL(2, recv(a[1], buf, sizeof(buf), 0));
+        send(b[1], auth.data(), auth.size(), 0);
+        CHECK_EQUAL(2, recv(b[1], buf, sizeof(buf), 0));
+        
+        sendUint32(a[1], 1);
+        sendUint32(b[1], 1);
+        sendUint32(b[1], 2);
+        sendUint32(b[1], 10);
+        sendUint32(b[1], 20);
+        sendUint32(a[1], 1);
+        sendUint32(a[1], 5);
+        
+        int32_t r = 0;
+        CHECK_EQUAL(4, recv(b[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(30, r);
+        CHECK_EQUAL(4, recv(a[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(5, r);
+        CHECK_EQUAL(0, recv(a[1], buf, sizeof(buf), 0));
+        CHECK_EQUAL(0, recv(b[1], buf, sizeof(buf), 0));
+        
+        running = false;
+        loop.join();
+        CHECK_EQUAL(0u, server.taskCount());
+        
+        close(a[1]);
+        close(b[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+
+    TEST(ReadBudget_StreamingClientYields) {
+        const char* logfile = "test_coro_budget.log";
+        const char* dbfile = "test_coro_budget.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+
+        std::atomic<bool> running(true);
+        int a[2], b[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, a));
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, b));
+        {
+            Logger logger(logfile);
+            AuthDB db;
+            db.loadFromFile(dbfile);
+
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(a[1], auth.data(), auth.size(), 0);
+            send(b[1], auth.data(), auth.size(), 0);
+
+            CoroServer server(-1, logger, db, running);
+            server.setReadBudget(4096);
+            server.addClient(a[0], "a");
+            server.addClient(b[0], "b");
+            CHECK_EQUAL("OK", readAvailable(a[1]));
+            CHECK_EQUAL("OK", readAvailable(b[1]));
+
+            // Клиент a передает несколько бюджетов данных без пауз (до EAGAIN
+            // сеанс не дошел бы), клиент b - один короткий вектор
+            std::vector<uint32_t> stream;
+            stream.push_back(3);
+            for(int v = 0; v < 3; ++v) {
+                stream.push_back(2048);
+                stream.insert(stream.end(), 2048, 1);
+            }
+            CHECK_EQUAL(static_cast<ssize_t>(stream.size() * sizeof(uint32_t)),
+                        send(a[1], stream.data(), stream.size() * sizeof(uint32_t), 0));
+            sendUint32(b[1], 1);
+            sendUint32(b[1], 1);
+            sendUint32(b[1], 7);
+
+            std::thread loop([&server] { server.run(); });
+            int32_t r[3] = {};
+            char buf[8];
+            CHECK_EQUAL(4, recv(b[1], r, sizeof(int32_t), MSG_WAITALL));
+            CHECK_EQUAL(7, r[0]);
+            CHECK_EQUAL(12, recv(a[1], r, sizeof(r), MSG_WAITALL));
+            CHECK_EQUAL(2048, r[0]);
+            CHECK_EQUAL(2048, r[2]);
+            CHECK_EQUAL(0, recv(a[1], buf, sizeof(buf), 0));
+            CHECK_EQUAL(0, recv(b[1], buf, sizeof(buf), 0));
+
+            running = false;
+            loop.join();
+        }
+
+        // Сеанс a уступил поток по бюджету, поэтому b завершился раньше
+        std::ifstream log(logfile);
+        std::string text((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+        size_t done_a = text.find("Client disconnected: a");
+        size_t done_b = text.find("Client disconnected: b");
+        CHECK(done_a != std::string::npos);
+        CHECK(done_b < done_a);
+
+        close(a[1]);
+        close(b[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
+SUITE(ThreadPoolTests)
+{
+    TEST(RunsAllTasks) {
+        std::atomic<int> counter(0);
+        {
+            ThreadPool pool(4);
+            CHECK_EQUAL(4u, pool.size());
+            for(int i = 0; i < 1000; ++i)
+                pool.submit([&counter] { counter++; });
+        } // Деструктор дожидается выполнения очереди
+        CHECK_EQUAL(1000, counter.load());
+    }
+    
+    TEST(ZeroThreadsMeansOne) {
+        ThreadPool pool(0);
+        CHECK_EQUAL(1u, pool.size());
+    }
+    
+    TEST(TasksRunConcurrently) {
+        // Две задачи ждут друг друга: возможно только при параллельном выполнении
+        std::atomic<int> arrived(0);
+        std::atomic<bool> both(false);
+        {
+            ThreadPool pool(2);
+            for(int i = 0; i < 2; ++i) {
+                pool.submit([&] {
+                    arrived++;
+                    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                    while(arrived.load() < 2 && std::chrono::steady_clock::now() < deadline)
+                        std::this_thread::yield();
+                    if(arrived.load() == 2)
+                        both = true;
+                });
+            }
+        }
+        CHECK(both.load());
+    }
+}
+
+SUITE(ParallelSumTests)
+{
+    TEST(SmallVector_StaysSingleThreaded) {
+        ParallelSum sum(3);
+        std::vector<uint32_t> v(VectorProcessor::thresholds().parallel_min - 1, 1);
+        CHECK_EQUAL(static_cast<int32_t>(v.size()), sum.sumClamp(v.data(), v.size()));
+        CHECK_EQUAL(0u, sum.lastBlocks());
+    }
+    
+    TEST(MatchesSumClamp) {
+        ParallelSum sum(3);
+        // Без насыщения; размер не кратен блоку и числу потоков
+        std::vector<uint32_t> v(3000001);
+        for(size_t i = 0; i < v.size(); ++i)
+            v[i] = static_cast<uint32_t>(i % 700);
+        CHECK_EQUAL(VectorProcessor::sumClamp(v), sum.sumClamp(v.data(), v.size()));
+        size_t blocks = (v.size() + VectorProcessor::SUM_BLOCK - 1) / VectorProcessor::SUM_BLOCK;
+        CHECK_EQUAL(blocks, sum.lastBlocks());
+        
+        // Насыщение только последним элементом
+        v.back() = 2147483647u;
+        CHECK_EQUAL(2147483647, sum.sumClamp(v.data(), v.size()));
+        CHECK_EQUAL(VectorProcessor::sumClamp(v), sum.sumClamp(v.data(), v.size()));
+    }
+    
+    TEST(Saturation_StopsAllThreadsEarly) {
+        ParallelSum sum(3);
+        // Итог превышает INT32_MAX после ~2.1M из 10M элементов
+        std::vector<uint32_t> v(10000000, 1000);
+        CHECK_EQUAL(2147483647, sum.sumClamp(v.data(), v.size()));
+        size_t blocks = (v.size() + VectorProcessor::SUM_BLOCK - 1) / VectorProcessor::SUM_BLOCK;
+        CHECK(sum.lastBlocks() < blocks / 2);
+    }
+    
+    TEST(LoweredThreshold_GoesParallel) {
+        const SumThresholds saved = VectorProcessor::thresholds();
+        SumThresholds t = saved;
+        t.parallel_min = 10000;
+        VectorProcessor::setThresholds(t);
+        
+        ParallelSum sum(2);
+        std::vector<uint32_t> v(20000, 3);
+        CHECK_EQUAL(60000, sum.sumClamp(v.data(), v.size()));
+        CHECK(sum.lastBlocks() > 0);
+        
+        VectorProcessor::setThresholds(saved);
+    }
+}
+
+SUITE(SumTuningTests)
+{
+    TEST(Calibrate_ReturnsThresholdsWithoutChangingCurrent) {
+        const SumThresholds saved = VectorProcessor::thresholds();
+        
+        // Без пула parallel_min остается по умолчанию
+        SumThresholds t = SumTuning::calibrate(nullptr);
+        CHECK_EQUAL(SumThresholds().parallel_min, t.parallel_min);
+        CHECK(t.simd_min <= 4096 || t.simd_min == SumTuning::THRESHOLD_OFF);
+        
+        // С пулом - один из замеренных размеров или "off" (например, на одном ядре)
+        ParallelSum sum(2);
+        t = SumTuning::calibrate(&sum);
+        CHECK(t.parallel_min == SumTuning::THRESHOLD_OFF ||
+              (t.parallel_min >= (16u << 10) && t.parallel_min <= (4u << 20)));
+        
+        CHECK_EQUAL(saved.simd_min, VectorProcessor::thresholds().simd_min);
+        CHECK_EQUAL(saved.parallel_min, VectorProcessor::thresholds().parallel_min);
+    }
+    
+    TEST(TuningFile_RoundTrip) {
+        const char* filename = "test_sum.tuning";
+        ParallelSum sum(2);
+        SumThresholds t;
+        t.simd_min = 64;
+        t.parallel_min = SumTuning::THRESHOLD_OFF;
+        CHECK(SumTuning::save(filename, &sum, t));
+        
+        SumThresholds loaded;
+        CHECK(SumTuning::load(filename, &sum, loaded));
+        CHECK_EQUAL(64u, loaded.simd_min);
+        CHECK_EQUAL(SumTuning::THRESHOLD_OFF, loaded.parallel_min);
+        
+        remove(filename);
+    }
+    
+    TEST(TuningFile_RejectsMismatchAndCorruption) {
+        const char* filename = "test_sum_bad.tuning";
+        SumThresholds t;
+        t.simd_min = 64;
+        t.parallel_min = 1 << 18;
+        SumThresholds loaded;
+        
+        // Файл снят с другим числом вычислительных потоков
+        ParallelSum sum(2);
+        CHECK(SumTuning::save(filename, &sum, t));
+        CHECK(!SumTuning::load(filename, nullptr, loaded));
+        
+        // Другое ядро
+        {
+            std::ofstream file(filename);
+            file << "kernel=unknown\nthreads=0\nsimd_min=64\nparallel_min=off\n";
+        }
+        CHECK(!SumTuning::load(filename, nullptr, loaded));
+        
+        // Некорректное значение порога
+        {
+            std::ofstream file(filename);
+            file << "kernel=" << SumKernels::name(SumKernels::active())
+                 << "\nthreads=0\nsimd_min=12x\nparallel_min=off\n";
+        }
+        CHECK(!SumTuning::load(filename, nullptr, loaded));
+        
+        // Нет файла
+        remove(filename);
+        CHECK(!SumTuning::load(filename, nullptr, loaded));
+        CHECK_EQUAL(SumThresholds().parallel_min, loaded.parallel_min);
+    }
+    
+    TEST(Configure_CalibratesOnceThenLoads) {
+        const char* logfile = "test_tuning.log";
+        const char* filename = "test_configure.tuning";
+        std::ofstream(logfile, std::ios::trunc).close();
+        remove(filename);
+        const SumThresholds saved = VectorProcessor::thresholds();
+        {
+            Logger logger(logfile);
+            SumThresholds first = SumTuning::configure(filename, nullptr, logger);
+            CHECK_EQUAL(first.simd_min, VectorProcessor::thresholds().simd_min);
+            
+            // Второй запуск загружает записанный файл
+            SumThresholds stored;
+            stored.simd_min = 4;
+            stored.parallel_min = 1 << 22;
+            CHECK(SumTuning::save(filename, nullptr, stored));
+            SumThresholds second = SumTuning::configure(filename, nullptr, logger);
+            CHECK_EQUAL(4u, second.simd_min);
+            CHECK_EQUAL(static_cast<size_t>(1 << 22), VectorProcessor::thresholds().parallel_min);
+        }
+        
+        std::ifstream log(logfile);
+        std::stringstream ss;
+        ss << log.rdbuf();
+        std::string content = ss.str();
+        CHECK(content.find("Sum thresholds calibrated") != std::string::npos);
+        CHECK(content.find("Sum thresholds loaded from test_configure.tuning") != std::string::npos);
+        
+        VectorProcessor::setThresholds(saved);
+        remove(filename);
+        remove(logfile);
+    }
+}
+
+/**
+ * @brief Проверяет операции SocketIo через пару соединенных сокетов
+ */
+static void checkSocketIo(SocketIo& io) {
+    int sv[2];
+    CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    
+    // recvSome: читает то, что есть, не дожидаясь len байт
+    send(sv[1], "hello", 5, 0);
+    char buf[64];
+    CHECK_EQUAL(5, io.recvSome(sv[0], buf, sizeof(buf)));
+    CHECK_EQUAL(std::string("hello"), std::string(buf, 5));
+    
+    // sendAll + recvAll для заголовка
+    uint32_t value = 0xDEADBEEF, got = 0;
+    CHECK(io.sendAll(sv[1], &value, sizeof(value)));
+    CHECK_EQUAL((ssize_t)sizeof(got), io.recvAll(sv[0], &got, sizeof(got)));
+    CHECK_EQUAL(value, got);
+    
+    // sendThenRecv: результат уходит, следующий заголовок читается
+    int32_t result = 42, peer_result = 0;
+    uint32_t next = 7, next_got = 0;
+    send(sv[1], &next, sizeof(next), 0);
+    CHECK_EQUAL((ssize_t)sizeof(next_got),
+                io.sendThenRecv(sv[0], &result, sizeof(result), &next_got, sizeof(next_got)));
+    CHECK_EQUAL(next, next_got);
+    CHECK_EQUAL((ssize_t)sizeof(peer_result), recv(sv[1], &peer_result, sizeof(peer_result), 0));
+    CHECK_EQUAL(result, peer_result);
+    
+    // recvAll для данных больше буфера сокета: пишущий поток отдает порциями
+    std::vector<uint32_t> payload(1 << 20);
+    for(size_t i = 0; i < payload.size(); ++i)
+        payload[i] = static_cast<uint32_t>(i * 2654435761u);
+    std::thread writer([&] {
+        PosixSocketIo posix;
+        posix.sendAll(sv[1], payload.data(), payload.size() * sizeof(uint32_t));
+    });
+    std::vector<uint32_t> received(payload.size());
+    ssize_t bytes = (ssize_t)(received.size() * sizeof(uint32_t));
+    CHECK_EQUAL(bytes, io.recvAll(sv[0], received.data(), received.size() * sizeof(uint32_t)));
+    writer.join();
+    CHECK(payload == received);
+    
+    // Закрытие соединения
+    close(sv[1]);
+    CHECK_EQUAL(0, io.recvAll(sv[0], &got, sizeof(got)));
+    close(sv[0]);
+}
+
+/**
+ * @brief UringSocketIo, у которого io_uring_enter() завершается ошибкой
+ *        после передачи SQE ядру
+ */
+class FailingUringIo : public UringSocketIo {
+public:
+    int failures = 0; ///< Сколько следующих вызовов enter() вернут EIO
+    
+protected:
+    long enter(unsigned to_submit, unsigned min_complete) override {
+        if(failures > 0) {
+            --failures;
+            UringSocketIo::enter(to_submit, 0); // SQE переданы, завершения не ждем
+            errno = EIO;
+            return -1;
+        }
+        return UringSocketIo::enter(to_submit, min_complete);
+    }
+};
+
+SUITE(SocketIoTests)
+{
+    TEST(Posix_Operations) {
+        PosixSocketIo io;
+        CHECK_EQUAL("posix", io.name());
+        checkSocketIo(io);
+    }
+    
+    TEST(Uring_Operations) {
+        std::unique_ptr<UringSocketIo> io;
+        try {
+            io.reset(new UringSocketIo());
+        } catch(const std::system_error&) {
+            return; // io_uring недоступен в ядре - проверять нечего
+        }
+        CHECK_EQUAL("uring", io->name());
+        checkSocketIo(*io);
+    }
+    
+    TEST(Uring_EnterErrorCancelsInFlight) {
+        std::unique_ptr<FailingUringIo> io;
+        try {
+            io.reset(new FailingUringIo());
+        } catch(const std::system_error&) {
+            return; // io_uring недоступен в ядре - проверять нечего
+        }
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        uint32_t value = 0, sent = 42;
+        
+        // Чтение уже в ядре, когда enter() сообщает об ошибке: оно отменяется
+        // и не забирает данные и завершение следующего вызова
+        io->failures = 1;
+        CHECK_EQUAL(-1, io->recvAll(sv[0], &value, sizeof(value)));
+        CHECK_EQUAL(EIO, errno);
+        CHECK(io->ringActive());
+        CHECK_EQUAL(4, send(sv[1], &sent, sizeof(sent), 0));
+        CHECK_EQUAL(4, io->recvAll(sv[0], &value, sizeof(value)));
+        CHECK_EQUAL(42u, value);
+        
+        // Отмена тоже не удалась: кольцо закрывается, дальше работает posix
+        io->failures = 2;
+        CHECK_EQUAL(-1, io->recvAll(sv[0], &value, sizeof(value)));
+        CHECK(!io->ringActive());
+        sent = 7;
+        CHECK_EQUAL(4, send(sv[1], &sent, sizeof(sent), 0));
+        CHECK_EQUAL(4, io->recvAll(sv[0], &value, sizeof(value)));
+        CHECK_EQUAL(7u, value);
+        CHECK(io->sendAll(sv[0], &sent, sizeof(sent)));
+        CHECK_EQUAL(4, recv(sv[1], &value, sizeof(value), MSG_WAITALL));
+        
+        close(sv[0]);
+        close(sv[1]);
+    }
+    
+    TEST(Create_ByName) {
+        CHECK_EQUAL("posix", SocketIo::create("posix")->name());
+        CHECK_THROW(SocketIo::create("epoll"), std::invalid_argument);
+    }
+}
+
+// ============================================================
+// Тесты билетов возобновления сеанса
+// ============================================================
+
+SUITE(SessionTicketsTests)
+{
+    TEST(Issue_VerifyExpiryAndTampering) {
+        unsigned char key[SessionTickets::KEY_SIZE] = {1, 2, 3};
+        SessionTickets tickets(std::chrono::seconds(60), key);
+        auto t0 = SessionTickets::Clock::now();
+        
+        std::string ticket = tickets.issue("user", t0);
+        CHECK_EQUAL(SessionTickets::FIXED_SIZE + 4, ticket.size());
+        std::string login;
+        CHECK(tickets.verify(ticket, login, t0 + std::chrono::seconds(59)));
+        CHECK_EQUAL("user", login);
+        CHECK(!tickets.verify(ticket, login, t0 + std::chrono::seconds(61)));
+        
+        // Любой измененный байт, усечение или чужой ключ отвергаются
+        for(size_t i = 0; i < ticket.size(); ++i) {
+            std::string bad = ticket;
+            bad[i] ^= 0x20;
+            CHECK(!tickets.verify(bad, login, t0));
+        }
+        CHECK(!tickets.verify(ticket.substr(0, ticket.size() - 1), login, t0));
+        CHECK(!tickets.verify("", login, t0));
+        key[0] = 9;
+        SessionTickets other(std::chrono::seconds(60), key);
+        CHECK(!other.verify(ticket, login, t0));
+        
+        CHECK_EQUAL("", tickets.issue(std::string(SessionTickets::MAX_LOGIN + 1, 'a'), t0));
+        std::string longest = tickets.issue(std::string(SessionTickets::MAX_LOGIN, 'a'), t0);
+        CHECK(2 + longest.size() <= AuthHandler::MAX_AUTH_DATA_SIZE);
+    }
+    
+    TEST(AuthRequest_ResumeWithoutAuthDb) {
+        const char* logfile = "test_tickets.log";
+        const char* dbfile = "test_tickets.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        SessionTickets tickets(std::chrono::seconds(60));
+        std::string request = std::string(1, AuthHandler::REQUEST_MARKER) + AuthHandler::TICKET_REQUEST +
+                              makeAuthData("user", "P@ssW0rd");
+        
+        // Полная аутентификация с билетом: "OK", длина и билет
+        AuthHandler full(logger, db);
+        full.setTickets(&tickets);
+        std::string login, response;
+        CHECK(full.checkAuthRequest(request, login, response));
+        CHECK_EQUAL("user", login);
+        CHECK(response.size() > 3);
+        CHECK_EQUAL("OK", response.substr(0, 2));
+        std::string ticket = response.substr(3);
+        CHECK_EQUAL(static_cast<size_t>(static_cast<unsigned char>(response[2])), ticket.size());
+        
+        // Возобновление не обращается к базе: она пуста
+        AuthDB empty;
+        AuthHandler fast(logger, empty);
+        fast.setTickets(&tickets);
+        std::string resume = std::string(1, AuthHandler::REQUEST_MARKER) + AuthHandler::RESUME_REQUEST + ticket;
+        login.clear();
+        CHECK(fast.checkAuthRequest(resume, login, response));
+        CHECK_EQUAL("user", login);
+        CHECK_EQUAL("OK", response);
+        CHECK(!fast.checkAuthRequest(resume.substr(0, resume.size() - 1), login, response));
+        CHECK_EQUAL("ERR", response);
+        
+        // Без билетов: запрос билета - пустой билет, возобновление отвергается
+        AuthHandler plain(logger, db);
+        CHECK(plain.checkAuthRequest(request, login, response));
+        CHECK_EQUAL(std::string("OK\0", 3), response);
+        CHECK(!plain.checkAuthRequest(resume, login, response));
+        CHECK(plain.checkAuthRequest(makeAuthData("user", "P@ssW0rd"), login, response));
+        CHECK_EQUAL("OK", response);
+        
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
+// ============================================================
+// Тесты пакетного хэширования паролей
+// ============================================================
+
+/**
+ * @brief Эталонный SHA224 через Crypto++
+ */
+static std::string referenceSha224(const std::string& data)
+{
+    unsigned char digest[CryptoPP::SHA224::DIGESTSIZE];
+    CryptoPP::SHA224 hash;
+    hash.Update(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    hash.Final(digest);
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+SUITE(CryptoPoolTests)
+{
+    TEST(ShaKernels_AllLevelsMatchCryptopp) {
+        // Длины вокруг границ блока (55/56/64 байт), разрез в разных местах
+        std::vector<std::string> data;
+        for(size_t len = 0; len <= 200; ++len) {
+            std::string s(len, '\0');
+            for(size_t i = 0; i < len; ++i)
+                s[i] = static_cast<char>((i * 131 + len) & 0xFF);
+            data.push_back(s);
+        }
+        std::vector<ShaKernels::Message> messages;
+        for(size_t i = 0; i < data.size(); ++i) {
+            std::string_view all(data[i]);
+            size_t cut = (i * 7) % (all.size() + 1);
+            messages.push_back({all.substr(0, cut), all.substr(cut)});
+        }
+        
+        const ShaKernels::Level levels[] = {ShaKernels::Level::Scalar, ShaKernels::Level::Avx2,
+                                            ShaKernels::Level::ShaNi};
+        for(ShaKernels::Level level : levels) {
+            if(!ShaKernels::supported(level))
+                continue;
+            // Неполная последняя группа AVX2: 201 сообщение
+            std::vector<unsigned char> digests(messages.size() * ShaKernels::DIGEST_SIZE);
+            ShaKernels::kernel(level)(messages.data(), messages.size(), digests.data());
+            for(size_t i = 0; i < data.size(); ++i) {
+                std::string got(reinterpret_cast<const char*>(&digests[i * ShaKernels::DIGEST_SIZE]),
+                                ShaKernels::DIGEST_SIZE);
+                CHECK(referenceSha224(data[i]) == got);
+            }
+        }
+        CHECK(ShaKernels::supported(ShaKernels::active()));
+    }
+    
+    TEST(SyncAndAsync_BatchedResults) {
+        std::atomic<int> matched(0);
+        std::atomic<int> done(0);
+        CryptoPool pool(2);
+        CHECK_EQUAL(2u, pool.threads());
+        
+        // Асинхронные задания копируют данные: буферы можно сразу менять
+        for(int i = 0; i < 100; ++i) {
+            std::string salt = "salt" + std::to_string(i);
+            std::string password = "password" + std::to_string(i);
+            std::string expected = referenceSha224(salt + password);
+            pool.submit(salt, password, [&, expected](const unsigned char* digest) {
+                if(expected == std::string(reinterpret_cast<const char*>(digest), expected.size()))
+                    matched++;
+                done++;
+            });
+        }
+        
+        // Синхронные вызовы из нескольких потоков
+        std::vector<std::thread> callers;
+        std::atomic<int> sync_matched(0);
+        for(int t = 0; t < 4; ++t) {
+            callers.emplace_back([&, t] {
+                for(int i = 0; i < 25; ++i) {
+                    std::string salt = "s" + std::to_string(t);
+                    std::string password = "p" + std::to_string(i);
+                    unsigned char digest[ShaKernels::DIGEST_SIZE];
+                    pool.sha224(salt, password, digest);
+                    if(referenceSha224(salt + password) ==
+                       std::string(reinterpret_cast<const char*>(digest), sizeof(digest)))
+                        sync_matched++;
+                }
+            });
+        }
+        for(std::thread& t : callers)
+            t.join();
+        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(done.load() < 100 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+        CHECK_EQUAL(100, matched.load());
+        CHECK_EQUAL(100, sync_matched.load());
+        CHECK_EQUAL(200u, pool.hashed());
+        CHECK(pool.batches() >= 1u && pool.batches() <= 200u);
+    }
+    
+    TEST(AuthHandler_HashesInPool) {
+        const char* logfile = "test_crypto_auth.log";
+        const char* dbfile = "test_crypto_auth.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        CryptoPool pool(1);
+        AuthHandler handler(logger, db);
+        handler.setCryptoPool(&pool);
+        
+        std::string login, response;
+        CHECK(handler.checkAuthRequest(makeAuthData("user", "P@ssW0rd"), login, response));
+        CHECK_EQUAL("user", login);
+        CHECK_EQUAL("OK", response);
+        CHECK(!handler.checkAuthRequest(makeAuthData("user", "wrong"), login, response));
+        CHECK_EQUAL("ERR", response);
+        CHECK_EQUAL(2u, pool.hashed());
+        
+        // Билет не требует хэша: пул не используется
+        AuthHandler::HashRequest request;
+        CHECK(AuthHandler::AuthStep::Rejected ==
+              handler.beginAuthRequest(std::string(1, AuthHandler::REQUEST_MARKER) + "R", login, response, request));
+        CHECK(AuthHandler::AuthStep::NeedsHash ==
+              handler.beginAuthRequest(makeAuthData("user", "P@ssW0rd"), login, response, request));
+        CHECK_EQUAL(2u, pool.hashed());
+        
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(ClientSession_WaitsForHash) {
+        const char* logfile = "test_crypto_session.log";
+        const char* dbfile = "test_crypto_session.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        CryptoPool pool(1);
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        NetworkUtils::setNonBlocking(sv[0]);
+        
+        {
+            ClientSession session(sv[0], "test", logger, db);
+            std::string salt, password;
+            session.setHashSubmit([&](std::string_view s, std::string_view p) {
+                salt.assign(s);
+                password.assign(p);
+            });
+            
+            // Пока хэш не готов, сеанс не читает количество векторов
+            std::string auth = makeAuthData("user", "P@ssW0rd");
+            send(sv[1], auth.data(), auth.size(), 0);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::AuthHashing);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 1);
+            sendUint32(sv[1], 7);
+            CHECK(session.onReadable());
+            CHECK(session.state() == ClientSession::State::AuthHashing);
+            CHECK_EQUAL("", readAvailable(sv[1]));
+            
+            // Готовый хэш: ответ и чтение уже пришедшего пакета
+            unsigned char digest[ShaKernels::DIGEST_SIZE];
+            pool.sha224(salt, password, digest);
+            CHECK(!session.onAuthHashed(digest));
+            std::string reply = readAvailable(sv[1]);
+            CHECK_EQUAL(6u, reply.size());
+            CHECK_EQUAL("OK", reply.substr(0, 2));
+            int32_t r = 0;
+            std::memcpy(&r, reply.data() + 2, sizeof(r));
+            CHECK_EQUAL(7, r);
+        }
+        
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(CoroServer_AuthInPool) {
+        const char* logfile = "test_crypto_coro.log";
+        const char* dbfile = "test_crypto_coro.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        CryptoPool pool(1);
+        
+        int a[2], b[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, a));
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, b));
+        
+        CoroServer server(-1, logger, db, running);
+        server.setCryptoPool(&pool);
+        server.addClient(a[0], "a");
+        server.addClient(b[0], "b");
+        std::thread loop([&server] { server.run(); });
+        
+        std::string good = makeAuthData("user", "P@ssW0rd");
+        std::string bad = makeAuthData("user", "wrong");
+        send(a[1], good.data(), good.size(), 0);
+        send(b[1], bad.data(), bad.size(), 0);
+        char buf[8];
+        CHECK_EQUAL(2, recv(a[1], buf, sizeof(buf), 0));
+        CHECK_EQUAL("OK", std::string(buf, 2));
+        CHECK_EQUAL(3, recv(b[1], buf, sizeof(buf), 0));
+        CHECK_EQUAL("ERR", std::string(buf, 3));
+        
+        sendUint32(a[1], 1);
+        sendUint32(a[1], 1);
+        sendUint32(a[1], 9);
+        int32_t r = 0;
+        CHECK_EQUAL(4, recv(a[1], &r, sizeof(r), MSG_WAITALL));
+        CHECK_EQUAL(9, r);
+        
+        running = false;
+        loop.join();
+        CHECK_EQUAL(2u, pool.hashed());
+        
+        close(a[1]);
+        close(b[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
+// ============================================================
+// Тесты ограничения частоты клиентов
+// ============================================================
+
+SUITE(RateLimiterTests)
+{
+    TEST(TokenBuckets_BurstAndRefill) {
+        TokenBuckets buckets(10, 3, 16);
+        auto t0 = TokenBuckets::Clock::now();
+        CHECK(buckets.admit(42, t0));
+        CHECK(buckets.admit(42, t0));
+        CHECK(buckets.admit(42, t0));
+        CHECK(!buckets.admit(42, t0));
+        
+        // Один маркер за 100 мс; отказ корзину не тратит
+        CHECK(buckets.admit(42, t0 + std::chrono::milliseconds(100)));
+        CHECK(!buckets.admit(42, t0 + std::chrono::milliseconds(100)));
+        
+        // После долгой паузы корзина полна, но не больше burst
+        auto t1 = t0 + std::chrono::seconds(5);
+        CHECK(buckets.admit(42, t1));
+        CHECK(buckets.admit(42, t1));
+        CHECK(buckets.admit(42, t1));
+        CHECK(!buckets.admit(42, t1));
+    }
+    
+    TEST(TokenBuckets_KeysIndependentInOneSet) {
+        // Один набор: ключи различаются только тегом
+        TokenBuckets buckets(1, 1, 1);
+        auto t0 = TokenBuckets::Clock::now();
+        for(uint64_t i = 1; i <= TokenBuckets::WAYS; ++i)
+            CHECK(buckets.admit(i << 48, t0));
+        for(uint64_t i = 1; i <= TokenBuckets::WAYS; ++i)
+            CHECK(!buckets.admit(i << 48, t0));
+        
+        // Новый ключ вытесняет корзину с наименьшим TAT (первую), остальные сохраняются
+        auto t1 = t0 + std::chrono::milliseconds(1);
+        CHECK(buckets.admit(uint64_t(100) << 48, t1));
+        CHECK(!buckets.admit(uint64_t(100) << 48, t1));
+        for(uint64_t i = 2; i <= TokenBuckets::WAYS; ++i)
+            CHECK(!buckets.admit(i << 48, t1));
+        CHECK(buckets.admit(uint64_t(1) << 48, t1));
+    }
+    
+    TEST(TokenBuckets_ConcurrentAdmitsExactBurst) {
+        TokenBuckets buckets(100, 200, 16);
+        auto now = TokenBuckets::Clock::now();
+        std::atomic<int> admitted(0);
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for(int i = 0; i < 1000; ++i)
+                    admitted += buckets.admit(7, now);
+            });
+        }
+        for(std::thread& t : threads)
+            t.join();
+        CHECK_EQUAL(200, admitted.load());
+    }
+    
+    TEST(CountMinSketch_CountsAndDecays) {
+        CountMinSketch sketch(256, std::chrono::milliseconds(1000));
+        auto t0 = CountMinSketch::Clock::now();
+        uint32_t last = 0;
+        for(int i = 0; i < 50; ++i)
+            last = sketch.add(0x9E3779B97F4A7C15ULL, t0);
+        CHECK(last >= 50u);
+        CHECK(sketch.estimate(0xC2B2AE3D27D4EB4FULL) < 50u);
+        
+        // Окно истекло: счетчики делятся пополам перед учетом события
+        CHECK_EQUAL(last / 2 + 1, sketch.add(0x9E3779B97F4A7C15ULL, t0 + std::chrono::milliseconds(1500)));
+    }
+    
+    TEST(CountMinSketch_DecaysEveryIdleWindow) {
+        CountMinSketch sketch(256, std::chrono::milliseconds(1000));
+        auto t0 = CountMinSketch::Clock::now();
+        uint32_t last = 0;
+        for(int i = 0; i < 200; ++i)
+            last = sketch.add(0x9E3779B97F4A7C15ULL, t0);
+        
+        // Простой в три окна: счетчики делятся пополам трижды, а не один раз
+        uint32_t after = sketch.add(0x9E3779B97F4A7C15ULL, t0 + std::chrono::milliseconds(3500));
+        CHECK_EQUAL((last >> 3) + 1, after);
+        
+        // Следующее деление - на границе окна, а не через окно после простоя
+        CHECK_EQUAL(after / 2 + 1, sketch.add(0x9E3779B97F4A7C15ULL, t0 + std::chrono::milliseconds(4100)));
+        
+        // Простой дольше 32 окон обнуляет счетчики
+        CHECK_EQUAL(1u, sketch.add(0x9E3779B97F4A7C15ULL, t0 + std::chrono::seconds(100)));
+    }
+    
+    TEST(RateLimiter_PeerRateAndHeavyHitter) {
+        sockaddr_in a{}, b{};
+        a.sin_addr.s_addr = htonl(0x0A000001);
+        b.sin_addr.s_addr = htonl(0x0A000002);
+        auto now = RateLimiter::Clock::now();
+        
+        // 1 подключение в секунду, запас на 2 секунды; порт не учитывается
+        RateLimiter rate(1, 0, 0);
+        a.sin_port = htons(1000);
+        CHECK(rate.admitPeer(a, now));
+        a.sin_port = htons(1001);
+        CHECK(rate.admitPeer(a, now));
+        CHECK(!rate.admitPeer(a, now));
+        CHECK(rate.admitPeer(b, now));
+        CHECK(rate.admitLogin("user", now));
+        CHECK_EQUAL(1u, rate.rejectedPeers());
+        CHECK_EQUAL(0u, rate.rejectedHeavy());
+        
+        RateLimiter heavy(0, 0, 5);
+        for(int i = 0; i < 5; ++i)
+            CHECK(heavy.admitPeer(a, now));
+        CHECK(!heavy.admitPeer(a, now));
+        CHECK(heavy.admitPeer(b, now));
+        CHECK_EQUAL(1u, heavy.rejectedHeavy());
+        CHECK_EQUAL(1u, heavy.rejectedPeers());
+    }
+    
+    TEST(AuthHandler_LoginLimitSkipsHash) {
+        const char* logfile = "test_ratelimit_auth.log";
+        const char* dbfile = "test_ratelimit_auth.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\nother:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        CryptoPool pool(1);
+        RateLimiter limiter(0, 0.1, 0);
+        AuthHandler handler(logger, db);
+        handler.setCryptoPool(&pool);
+        handler.setRateLimiter(&limiter);
+        
+        std::string login, response;
+        CHECK(!handler.checkAuthRequest(makeAuthData("user", "wrong"), login, response));
+        CHECK_EQUAL(1u, pool.hashed());
+        
+        // Верный пароль после исчерпания попыток: ERR без хэширования
+        CHECK(!handler.checkAuthRequest(makeAuthData("user", "P@ssW0rd"), login, response));
+        CHECK_EQUAL("ERR", response);
+        CHECK_EQUAL(1u, pool.hashed());
+        CHECK_EQUAL(1u, limiter.rejectedLogins());
+        
+        CHECK(handler.checkAuthRequest(makeAuthData("other", "P@ssW0rd"), login, response));
+        CHECK_EQUAL("other", login);
+        CHECK_EQUAL(2u, pool.hashed());
+        
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(AuthHandler_LoginLimitAppliesToResume) {
+        const char* logfile = "test_ratelimit_resume.log";
+        const char* dbfile = "test_ratelimit_resume.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        SessionTickets tickets(std::chrono::seconds(60));
+        RateLimiter limiter(0, 0.1, 0);
+        AuthHandler handler(logger, db);
+        handler.setTickets(&tickets);
+        handler.setRateLimiter(&limiter);
+        
+        // Полный вход с билетом расходует единственную попытку логина
+        std::string login, response;
+        std::string request = std::string(1, AuthHandler::REQUEST_MARKER) + AuthHandler::TICKET_REQUEST +
+                              makeAuthData("user", "P@ssW0rd");
+        CHECK(handler.checkAuthRequest(request, login, response));
+        std::string resume = std::string(1, AuthHandler::REQUEST_MARKER) + AuthHandler::RESUME_REQUEST +
+                             response.substr(3);
+        
+        // Верный билет не обходит ограничение
+        login.clear();
+        CHECK(!handler.checkAuthRequest(resume, login, response));
+        CHECK_EQUAL("ERR", response);
+        CHECK_EQUAL("", login);
+        CHECK_EQUAL(1u, limiter.rejectedLogins());
+        
+        remove(logfile);
+        remove(dbfile);
+    }
+    
+    TEST(CoroServer_ResetsLimitedPeerAtAccept) {
+        const char* logfile = "test_ratelimit_coro.log";
+        const char* dbfile = "test_ratelimit_coro.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        std::atomic<bool> running(true);
+        RateLimiter limiter(0.1, 0, 0);
+        
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        CHECK_EQUAL(0, bind(listener, (sockaddr*)&addr, sizeof(addr)));
+        CHECK_EQUAL(0, getsockname(listener, (sockaddr*)&addr, &len));
+        CHECK_EQUAL(0, listen(listener, 4));
+        
+        CoroServer server(listener, logger, db, running);
+        server.setRateLimiter(&limiter);
+        std::thread loop([&server] { server.run(); });
+        
+        int first = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK_EQUAL(0, connect(first, (sockaddr*)&addr, sizeof(addr)));
+        std::string good = makeAuthData("user", "P@ssW0rd");
+        send(first, good.data(), good.size(), 0);
+        char buf[8];
+        CHECK_EQUAL(2, recv(first, buf, sizeof(buf), 0));
+        CHECK_EQUAL("OK", std::string(buf, 2));
+        
+        // Второе подключение с того же адреса сбрасывается до чтения данных
+        int second = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK_EQUAL(0, connect(second, (sockaddr*)&addr, sizeof(addr)));
+        CHECK(recv(second, buf, sizeof(buf), 0) <= 0);
+        
+        running = false;
+        loop.join();
+        CHECK_EQUAL(1u, limiter.rejectedPeers());
+        
+        std::ifstream log(logfile);
+        std::string content((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+        size_t accepted = 0;
+        for(size_t pos = content.find("Accepted connection"); pos != std::string::npos;
+            pos = content.find("Accepted connection", pos + 1))
+            ++accepted;
+        CHECK_EQUAL(1u, accepted);
+        
+        close(first);
+        close(second);
+        close(listener);
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
+// ============================================================
+// Тесты выделений памяти при аутентификации
+// (полная аутентификация в потоке сеанса; билеты и CryptoPool
+// выделяют память и здесь не проверяются)
+// ============================================================
+
+SUITE(AuthAllocationTests)
+{
+    TEST(Handshake_NoHeapAllocations) {
+        const char* logfile = "test_authalloc.log";
+        const char* dbfile = "test_authalloc.db";
+        std::ofstream(logfile, std::ios::trunc).close();
+        std::ofstream(dbfile, std::ios::trunc) << "user:P@ssW0rd\n";
+        
+        Logger logger(logfile);
+        AuthDB db;
+        db.loadFromFile(dbfile);
+        AuthHandler handler(logger, db);
+        std::string good = makeAuthData("user", "P@ssW0rd");
+        std::string wrong = makeAuthData("user", "wrong");
+        std::string unknown = makeAuthData("nobody", "P@ssW0rd");
+        std::string login, response;
+        CHECK(handler.checkAuthRequest(good, login, response)); // Прогрев логгера
+        
+        int sv[2];
+        CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+        char reply[8];
+        
+        g_allocations = 0;
+        g_countAllocations = true;
+        bool ok = true;
+        for(int i = 0; i < 10; ++i) {
+            ok &= handler.checkAuthRequest(good, login, response);
+            ok &= !handler.checkAuthRequest(wrong, login, response);
+            ok &= !handler.checkAuthRequest(unknown, login, response);
+            send(sv[1], good.data(), good.size(), 0);
+            ok &= handler.authenticate(sv[0], login);
+            ok &= recv(sv[1], reply, sizeof(reply), 0) == 2;
+        }
+        g_countAllocations = false;
+        
+        CHECK(ok);
+        CHECK_EQUAL(0u, g_allocations.load());
+        CHECK_EQUAL("user", login);
+        
+        close(sv[0]);
+        close(sv[1]);
+        remove(logfile);
+        remove(dbfile);
+    }
+}
+
 // ============================================================
 // Главная функция для запуска тестов
 // ============================================================
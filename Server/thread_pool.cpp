@@ -0,0 +1,65 @@
+#include "thread_pool.h"
+
+/**
+ * @brief Создает пул и запускает рабочие потоки
+ * @param threads Количество рабочих потоков; значение 0 заменяется на 1
+ */
+ThreadPool::ThreadPool(size_t threads)
+{
+    if(threads == 0)
+        threads = 1;
+    workers.reserve(threads);
+    for(size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+/**
+ * @brief Останавливает пул
+ * @details Новые задачи больше не принимаются; рабочие потоки завершают
+ *          все задачи, уже находящиеся в очереди, после чего присоединяются.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> g(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for(std::thread& t : workers)
+        t.join();
+}
+
+/**
+ * @brief Ставит задачу в очередь и будит один свободный поток
+ * @param task Задача для выполнения
+ */
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> g(mtx);
+        tasks.push(std::move(task));
+    }
+    cv.notify_one();
+}
+
+/**
+ * @brief Цикл рабочего потока
+ * @details Ожидает появления задачи или остановки пула. Задача выполняется
+ *          вне блокировки, поэтому долгие задачи не мешают постановке новых.
+ * @note Исключения задач должны перехватываться самими задачами
+ */
+void ThreadPool::workerLoop()
+{
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait(lk, [this] { return stopping || !tasks.empty(); });
+            if(tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Фиксированный пул рабочих потоков с общей очередью задач
+ * @details Задачи выполняются в порядке поступления любым свободным потоком.
+ *          При уничтожении пул дожидается выполнения всех поставленных задач.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Конструктор пула
+     * @param threads Количество рабочих потоков (не менее 1)
+     */
+    explicit ThreadPool(size_t threads);
+
+    /**
+     * @brief Деструктор, выполняет оставшиеся задачи и останавливает потоки
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Постановка задачи в очередь
+     * @param task Задача для выполнения в рабочем потоке
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Количество рабочих потоков
+     * @return Размер пула
+     */
+    size_t size() const { return workers.size(); }
+
+private:
+    /**
+     * @brief Цикл рабочего потока: извлечение и выполнение задач
+     */
+    void workerLoop();
+
+    std::vector<std::thread> workers;         ///< Рабочие потоки
+    std::queue<std::function<void()>> tasks;  ///< Очередь задач
+    std::mutex mtx;                           ///< Мьютекс очереди задач
+    std::condition_variable cv;               ///< Уведомление о новых задачах
+    bool stopping = false;                    ///< Флаг остановки пула
+};
+
+#endif
@@ -0,0 +1,531 @@
+#include "uring_socket_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+/// Тег результата отправки в sendThenRecv()
+const uint64_t TAG_SEND = 0;
+/// Тег результата чтения в sendThenRecv()
+const uint64_t TAG_RECV = 1;
+/// Тег запроса отмены (IORING_OP_ASYNC_CANCEL) в abandon()
+const uint64_t TAG_CANCEL = ~uint64_t(0);
+
+/**
+ * @brief Приведение результата операции io_uring к соглашению recv()
+ * @param res Результат из CQE (отрицательный errno при ошибке)
+ * @return res если он неотрицателен, иначе -1 с установкой errno
+ */
+ssize_t toRecvResult(int res)
+{
+    if(res < 0) {
+        errno = -res;
+        return -1;
+    }
+    return res;
+}
+}
+
+// ====================================================================
+// Создание и освобождение кольца
+// ====================================================================
+
+/**
+ * @brief Создает кольцо io_uring, отображает его в память и регистрирует буфер
+ * @details Выполняет последовательность действий:
+ *          1. io_uring_setup() с entries элементами
+ *          2. mmap() колец отправки/завершений (одно отображение при
+ *             IORING_FEAT_SINGLE_MMAP) и массива SQE
+ *          3. Выделение буфера fixed_size байт и его регистрация
+ *             (IORING_REGISTER_BUFFERS, индекс 0)
+ * @param entries Размер очереди отправки (достаточно 2 для sendThenRecv())
+ * @param fixed_size Размер зарегистрированного буфера
+ * @throw std::system_error если ядро не поддерживает io_uring или ресурс недоступен
+ */
+UringSocketIo::UringSocketIo(unsigned entries, size_t fixed_size)
+    : fixed_size(fixed_size)
+{
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if(ring_fd < 0)
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap)
+        sq_size = cq_size = std::max(sq_size, cq_size);
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ring_fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED) {
+        sq_ptr = nullptr;
+        int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), "mmap(SQ ring)");
+    }
+
+    if(single_mmap) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_CQ_RING);
+        if(cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            int err = errno;
+            release();
+            throw std::system_error(err, std::generic_category(), "mmap(CQ ring)");
+        }
+    }
+
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQES);
+    if(sqes_ptr == MAP_FAILED) {
+        int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), "mmap(SQEs)");
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    char* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    void* buf = mmap(nullptr, fixed_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if(buf == MAP_FAILED) {
+        int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), "mmap(fixed buffer)");
+    }
+    fixed = static_cast<char*>(buf);
+
+    iovec iov;
+    iov.iov_base = fixed;
+    iov.iov_len = fixed_size;
+    if(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+        int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), "io_uring_register");
+    }
+}
+
+/**
+ * @brief Закрывает кольцо и освобождает память
+ */
+UringSocketIo::~UringSocketIo()
+{
+    release();
+}
+
+/**
+ * @brief Освобождает все ресурсы, выделенные к моменту вызова
+ * @note Регистрация буфера снимается ядром при закрытии ring_fd
+ */
+void UringSocketIo::release()
+{
+    if(fixed)
+        munmap(fixed, fixed_size);
+    if(sqes)
+        munmap(sqes, sqes_size);
+    if(cq_ptr && cq_ptr != sq_ptr)
+        munmap(cq_ptr, cq_size);
+    if(sq_ptr)
+        munmap(sq_ptr, sq_size);
+    if(ring_fd >= 0)
+        close(ring_fd);
+    fixed = nullptr;
+    sqes = nullptr;
+    cq_ptr = sq_ptr = nullptr;
+    ring_fd = -1;
+}
+
+// ====================================================================
+// Работа с очередями
+// ====================================================================
+
+/**
+ * @brief Возвращает следующий свободный SQE
+ * @details SQE становится видимым ядру только в submitAndWait(), где
+ *          хвост кольца сдвигается сразу на все подготовленные элементы.
+ * @return Обнуленный элемент очереди отправки
+ */
+io_uring_sqe* UringSocketIo::nextSqe()
+{
+    unsigned index = (*sq_tail + pending) & sq_mask;
+    ++pending;
+    sq_array[index] = index;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/**
+ * @brief Готовит чтение
+ * @details Если буфер назначения лежит в зарегистрированном буфере,
+ *          используется IORING_OP_READ_FIXED, иначе IORING_OP_RECV.
+ * @param sqe Элемент очереди
+ * @param fd Дескриптор сокета
+ * @param buf Буфер назначения
+ * @param len Количество байт
+ * @param waitall Установить MSG_WAITALL (для IORING_OP_RECV)
+ */
+void UringSocketIo::prepRead(io_uring_sqe* sqe, int fd, void* buf, size_t len, bool waitall)
+{
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    if(inFixed(buf, len)) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = 0;
+    } else {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->msg_flags = waitall ? MSG_WAITALL : 0;
+    }
+}
+
+/**
+ * @brief Готовит отправку IORING_OP_SEND с MSG_NOSIGNAL
+ * @param sqe Элемент очереди
+ * @param fd Дескриптор сокета
+ * @param buf Данные
+ * @param len Количество байт
+ */
+void UringSocketIo::prepSend(io_uring_sqe* sqe, int fd, const void* buf, size_t len)
+{
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+/**
+ * @brief Вызывает io_uring_enter() с ожиданием завершений
+ * @param to_submit Количество SQE для передачи ядру
+ * @param min_complete Количество ожидаемых завершений
+ * @return Результат системного вызова
+ */
+long UringSocketIo::enter(unsigned to_submit, unsigned min_complete)
+{
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                   IORING_ENTER_GETEVENTS, nullptr, 0);
+}
+
+/**
+ * @brief Забирает готовые завершения из кольца
+ * @param results Массив результатов, индексируемый user_data элементов
+ * @param cancels Счетчик ожидаемых завершений запросов отмены
+ * @return Количество завершений операций
+ */
+unsigned UringSocketIo::reap(int* results, unsigned& cancels)
+{
+    unsigned done = 0;
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail) {
+        const io_uring_cqe& cqe = cqes[head & cq_mask];
+        if(cqe.user_data == TAG_CANCEL) {
+            --cancels;
+        } else {
+            results[cqe.user_data] = cqe.res;
+            ++done;
+        }
+        ++head;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return done;
+}
+
+/**
+ * @brief Передает подготовленные SQE ядру и ждет все завершения
+ * @details Хвост кольца отправки сдвигается одной записью с семантикой
+ *          release, после чего io_uring_enter() передает элементы и ждет
+ *          столько же завершений. При EINTR вызов повторяется для
+ *          элементов, еще не забранных ядром. При другой ошибке
+ *          переданные операции отменяются и дожидаются (abandon()):
+ *          их завершения не попадут в результаты следующего вызова,
+ *          а ядро не запишет данные в буфер вызывающего после возврата.
+ * @param results Массив результатов, индексируемый user_data элементов
+ * @return false при ошибке io_uring_enter() (errno - ошибка вызова)
+ */
+bool UringSocketIo::submitAndWait(int* results)
+{
+    unsigned count = pending;
+    unsigned first = *sq_tail;
+    pending = 0;
+    __atomic_store_n(sq_tail, first + count, __ATOMIC_RELEASE);
+
+    unsigned done = 0;
+    unsigned cancels = 0;
+    while(done < count) {
+        unsigned to_submit = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        long r = enter(to_submit, count - done);
+        if(r < 0 && errno != EINTR) {
+            int err = errno;
+            abandon(first, done, results);
+            errno = err;
+            return false;
+        }
+        done += reap(results, cancels);
+    }
+    return true;
+}
+
+/**
+ * @brief Отменяет и дожидается операций пакета после ошибки io_uring_enter()
+ * @details SQE, еще не забранные ядром, снимаются с кольца сдвигом хвоста
+ *          назад. Для переданных ставятся запросы IORING_OP_ASYNC_CANCEL по
+ *          user_data (для уже завершенных они вернут -ENOENT), после чего
+ *          забираются все завершения операций и запросов отмены. Если и это
+ *          не удается, кольцо закрывается: ядро отменяет оставшиеся операции,
+ *          а дальнейшие вызовы выполняются через SocketIo::posix().
+ * @param first Позиция первого SQE пакета в кольце отправки
+ * @param done Количество уже полученных завершений
+ * @param results Массив результатов, индексируемый user_data элементов
+ */
+void UringSocketIo::abandon(unsigned first, unsigned done, int* results)
+{
+    unsigned submitted = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) - first;
+    __atomic_store_n(sq_tail, first + submitted, __ATOMIC_RELEASE);
+
+    uint64_t tags[8];
+    unsigned cancels = std::min(submitted, static_cast<unsigned>(sizeof(tags) / sizeof(tags[0])));
+    for(unsigned i = 0; i < cancels; ++i)
+        tags[i] = sqes[sq_array[(first + i) & sq_mask]].user_data;
+    for(unsigned i = 0; i < cancels; ++i) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = tags[i];
+        sqe->user_data = TAG_CANCEL;
+    }
+    unsigned queued = pending;
+    pending = 0;
+    __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+
+    while(done < submitted || cancels > 0) {
+        unsigned to_submit = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if(enter(to_submit, submitted - done + cancels) < 0 && errno != EINTR) {
+            release();
+            return;
+        }
+        done += reap(results, cancels);
+    }
+}
+
+/**
+ * @brief Выполняет единственную подготовленную операцию
+ * @return Результат операции или -errno
+ */
+int UringSocketIo::runOne()
+{
+    int res = 0;
+    if(!submitAndWait(&res))
+        return -errno;
+    return res;
+}
+
+/**
+ * @brief Проверяет, лежит ли область целиком в зарегистрированном буфере
+ * @param p Начало области
+ * @param len Длина области
+ * @return true если область внутри fixed
+ */
+bool UringSocketIo::inFixed(const void* p, size_t len) const
+{
+    const char* c = static_cast<const char*>(p);
+    return fixed && c >= fixed && len <= fixed_size && c + len <= fixed + fixed_size;
+}
+
+// ====================================================================
+// Операции SocketIo
+// ====================================================================
+
+/**
+ * @brief Гарантированно читает len байт в область зарегистрированного буфера
+ * @param fd Дескриптор сокета
+ * @param dst Область внутри fixed
+ * @param len Количество байт
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t UringSocketIo::readFixedAll(int fd, char* dst, size_t len)
+{
+    size_t got = 0;
+    while(got < len) {
+        prepRead(nextSqe(), fd, dst + got, len - got, false);
+        int res = runOne();
+        if(res == -EINTR)
+            continue;
+        if(res <= 0)
+            return toRecvResult(res);
+        got += static_cast<size_t>(res);
+    }
+    return static_cast<ssize_t>(len);
+}
+
+/**
+ * @brief Однократное чтение
+ * @details Данные, помещающиеся в зарегистрированный буфер, читаются
+ *          READ_FIXED и копируются в buf; большие запросы читаются RECV
+ *          сразу в buf.
+ * @param fd Дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Максимальное количество байт
+ * @return Количество прочитанных байт, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t UringSocketIo::recvSome(int fd, void* buf, size_t len)
+{
+    if(!ringActive())
+        return SocketIo::posix().recvSome(fd, buf, len);
+    void* dst = len <= fixed_size ? fixed : buf;
+    prepRead(nextSqe(), fd, dst, len, false);
+    int res = runOne();
+    if(res > 0 && dst != buf)
+        std::memcpy(buf, dst, static_cast<size_t>(res));
+    return toRecvResult(res);
+}
+
+/**
+ * @brief Гарантированное чтение len байт
+ * @details Небольшие запросы (заголовки) читаются через зарегистрированный
+ *          буфер; большие (данные векторов) - одной операцией RECV с
+ *          MSG_WAITALL прямо в буфер назначения с дочитыванием остатка.
+ * @param fd Дескриптор сокета
+ * @param buf Буфер для приема данных
+ * @param len Количество байт для чтения
+ * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t UringSocketIo::recvAll(int fd, void* buf, size_t len)
+{
+    if(!ringActive())
+        return SocketIo::posix().recvAll(fd, buf, len);
+    if(inFixed(buf, len))
+        return readFixedAll(fd, static_cast<char*>(buf), len);
+
+    if(len <= fixed_size) {
+        ssize_t r = readFixedAll(fd, fixed, len);
+        if(r > 0)
+            std::memcpy(buf, fixed, len);
+        return r;
+    }
+
+    char* p = static_cast<char*>(buf);
+    size_t got = 0;
+    while(got < len) {
+        prepRead(nextSqe(), fd, p + got, len - got, true);
+        int res = runOne();
+        if(res == -EINTR)
+            continue;
+        if(res <= 0)
+            return toRecvResult(res);
+        got += static_cast<size_t>(res);
+    }
+    return static_cast<ssize_t>(len);
+}
+
+/**
+ * @brief Гарантированная отправка len байт
+ * @param fd Дескриптор сокета
+ * @param buf Данные
+ * @param len Количество байт
+ * @return true если отправлены все данные
+ */
+bool UringSocketIo::sendAll(int fd, const void* buf, size_t len)
+{
+    if(!ringActive())
+        return SocketIo::posix().sendAll(fd, buf, len);
+    const char* p = static_cast<const char*>(buf);
+    size_t sent = 0;
+    while(sent < len) {
+        prepSend(nextSqe(), fd, p + sent, len - sent);
+        int res = runOne();
+        if(res == -EINTR)
+            continue;
+        if(res <= 0)
+            return false;
+        sent += static_cast<size_t>(res);
+    }
+    return true;
+}
+
+/**
+ * @brief Отправляет данные и читает ответ одним вызовом io_uring_enter()
+ * @details Отправка (SEND) и чтение (READ_FIXED в зарегистрированный буфер)
+ *          связываются флагом IOSQE_IO_LINK: чтение начинается только после
+ *          успешной отправки, а обе операции передаются ядру вместе.
+ *          Короткая отправка разрывает цепочку (чтение завершается с
+ *          -ECANCELED) - тогда остаток отправляется и читается отдельно.
+ *          Если данные не помещаются в зарегистрированный буфер, используется
+ *          реализация SocketIo по умолчанию.
+ * @param fd Дескриптор сокета
+ * @param out Данные для отправки (результат вектора)
+ * @param out_len Количество байт для отправки
+ * @param in Буфер для приема (заголовок следующего вектора)
+ * @param in_len Количество байт для чтения
+ * @return in_len при успехе, 0 при закрытии соединения, -1 при ошибке
+ */
+ssize_t UringSocketIo::sendThenRecv(int fd, const void* out, size_t out_len, void* in, size_t in_len)
+{
+    size_t in_off = (out_len + 7) & ~static_cast<size_t>(7);
+    if(!ringActive() || in_off + in_len > fixed_size)
+        return SocketIo::sendThenRecv(fd, out, out_len, in, in_len);
+
+    std::memcpy(fixed, out, out_len);
+
+    io_uring_sqe* send_sqe = nextSqe();
+    prepSend(send_sqe, fd, fixed, out_len);
+    send_sqe->flags = IOSQE_IO_LINK;
+    send_sqe->user_data = TAG_SEND;
+
+    io_uring_sqe* recv_sqe = nextSqe();
+    prepRead(recv_sqe, fd, fixed + in_off, in_len, false);
+    recv_sqe->user_data = TAG_RECV;
+
+    int results[2] = {0, 0};
+    if(!submitAndWait(results))
+        return -1;
+
+    int sent = results[TAG_SEND];
+    if(sent < 0)
+        return toRecvResult(sent);
+    if(static_cast<size_t>(sent) < out_len &&
+       !sendAll(fd, fixed + sent, out_len - static_cast<size_t>(sent)))
+        return -1;
+
+    int got = results[TAG_RECV];
+    if(got == 0)
+        return 0;
+    if(got < 0) {
+        if(got != -ECANCELED && got != -EINTR)
+            return toRecvResult(got);
+        got = 0;
+    }
+    if(static_cast<size_t>(got) < in_len) {
+        ssize_t r = readFixedAll(fd, fixed + in_off + got, in_len - static_cast<size_t>(got));
+        if(r <= 0)
+            return r;
+    }
+
+    std::memcpy(in, fixed + in_off, in_len);
+    return static_cast<ssize_t>(in_len);
+}
@@ -0,0 +1,168 @@
+#ifndef URING_SOCKET_IO_H
+#define URING_SOCKET_IO_H
+
+#include "socket_io.h"
+#include <cstdint>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @class UringSocketIo
+ * @brief Реализация SocketIo на io_uring (прямые системные вызовы, без liburing)
+ * @details Особенности:
+ *          - зарегистрированный буфер (IORING_REGISTER_BUFFERS): небольшие
+ *            чтения (заголовки, данные аутентификации) идут через
+ *            IORING_OP_READ_FIXED без повторного отображения пользовательской
+ *            памяти ядром на каждую операцию;
+ *          - отправка выполняется IORING_OP_SEND с MSG_NOSIGNAL (запись через
+ *            WRITE_FIXED в сокет привела бы к SIGPIPE при разрыве соединения);
+ *          - пакетная отправка: sendThenRecv() ставит связанные (IOSQE_IO_LINK)
+ *            отправку результата и чтение следующего заголовка и передает их
+ *            ядру одним вызовом io_uring_enter();
+ *          - большие данные читаются IORING_OP_RECV с MSG_WAITALL сразу
+ *            в буфер назначения.
+ * @note Экземпляр используется одним потоком (кольцо не синхронизируется)
+ * @note Если кольцо пришлось закрыть после ошибки io_uring_enter(),
+ *       операции выполняются через SocketIo::posix()
+ */
+class UringSocketIo : public SocketIo {
+public:
+    /**
+     * @brief Создание кольца io_uring и регистрация буфера
+     * @param entries Размер очереди отправки
+     * @param fixed_size Размер зарегистрированного буфера в байтах
+     * @throw std::system_error если io_uring недоступен
+     */
+    explicit UringSocketIo(unsigned entries = 8, size_t fixed_size = 64 * 1024);
+
+    /**
+     * @brief Освобождение кольца и отображенной памяти
+     */
+    ~UringSocketIo() override;
+
+    UringSocketIo(const UringSocketIo&) = delete;
+    UringSocketIo& operator=(const UringSocketIo&) = delete;
+
+    const char* name() const override { return "uring"; }
+    ssize_t recvSome(int fd, void* buf, size_t len) override;
+    ssize_t recvAll(int fd, void* buf, size_t len) override;
+    bool sendAll(int fd, const void* buf, size_t len) override;
+    ssize_t sendThenRecv(int fd, const void* out, size_t out_len, void* in, size_t in_len) override;
+
+    /**
+     * @brief Кольцо открыто (false - закрыто после ошибки, операции идут через posix)
+     */
+    bool ringActive() const { return ring_fd >= 0; }
+
+protected:
+    /**
+     * @brief Вызов io_uring_enter() с ожиданием завершений
+     * @details Виртуальный, чтобы тесты могли имитировать ошибку вызова.
+     * @param to_submit Количество SQE для передачи ядру
+     * @param min_complete Количество ожидаемых завершений
+     * @return Результат системного вызова (-1 с errno при ошибке)
+     */
+    virtual long enter(unsigned to_submit, unsigned min_complete);
+
+private:
+    int ring_fd = -1;               ///< Дескриптор кольца io_uring
+    void* sq_ptr = nullptr;         ///< Отображение кольца отправки
+    size_t sq_size = 0;             ///< Размер отображения кольца отправки
+    void* cq_ptr = nullptr;         ///< Отображение кольца завершений (может совпадать с sq_ptr)
+    size_t cq_size = 0;             ///< Размер отображения кольца завершений
+    io_uring_sqe* sqes = nullptr;   ///< Массив элементов очереди отправки
+    size_t sqes_size = 0;           ///< Размер отображения массива SQE
+
+    unsigned* sq_head = nullptr;    ///< Голова кольца отправки (пишет ядро)
+    unsigned* sq_tail = nullptr;    ///< Хвост кольца отправки (пишем мы)
+    unsigned sq_mask = 0;           ///< Маска индексов кольца отправки
+    unsigned* sq_array = nullptr;   ///< Массив индексов SQE
+    unsigned* cq_head = nullptr;    ///< Голова кольца завершений (пишем мы)
+    unsigned* cq_tail = nullptr;    ///< Хвост кольца завершений (пишет ядро)
+    unsigned cq_mask = 0;           ///< Маска индексов кольца завершений
+    io_uring_cqe* cqes = nullptr;   ///< Массив элементов кольца завершений
+
+    unsigned pending = 0;           ///< Подготовлено SQE, еще не переданных ядру
+
+    char* fixed = nullptr;          ///< Зарегистрированный буфер (индекс 0)
+    size_t fixed_size;              ///< Размер зарегистрированного буфера
+
+    /**
+     * @brief Освобождение кольца, отображений и буфера (для деструктора и ошибок конструктора)
+     */
+    void release();
+
+    /**
+     * @brief Получение очередного свободного SQE (обнуленного)
+     * @return Указатель на SQE
+     */
+    io_uring_sqe* nextSqe();
+
+    /**
+     * @brief Подготовка чтения: READ_FIXED в зарегистрированный буфер или RECV
+     * @param sqe Элемент очереди
+     * @param fd Дескриптор сокета
+     * @param buf Буфер назначения (внутри fixed для READ_FIXED)
+     * @param len Количество байт
+     * @param waitall Читать с MSG_WAITALL (только для RECV)
+     */
+    void prepRead(io_uring_sqe* sqe, int fd, void* buf, size_t len, bool waitall);
+
+    /**
+     * @brief Подготовка отправки (IORING_OP_SEND с MSG_NOSIGNAL)
+     * @param sqe Элемент очереди
+     * @param fd Дескриптор сокета
+     * @param buf Данные
+     * @param len Количество байт
+     */
+    void prepSend(io_uring_sqe* sqe, int fd, const void* buf, size_t len);
+
+    /**
+     * @brief Передача подготовленных SQE ядру и ожидание всех завершений
+     * @param results Массив для результатов (индексируется user_data)
+     * @return false при ошибке io_uring_enter()
+     */
+    bool submitAndWait(int* results);
+
+    /**
+     * @brief Забор готовых завершений
+     * @param results Массив для результатов (индексируется user_data)
+     * @param cancels Уменьшается на число завершений запросов отмены
+     * @return Количество завершений операций (без запросов отмены)
+     */
+    unsigned reap(int* results, unsigned& cancels);
+
+    /**
+     * @brief Отмена и ожидание операций после ошибки io_uring_enter()
+     * @param first Позиция первого SQE пакета в кольце отправки
+     * @param done Количество уже полученных завершений
+     * @param results Массив для результатов (индексируется user_data)
+     */
+    void abandon(unsigned first, unsigned done, int* results);
+
+    /**
+     * @brief Выполнение одной подготовленной операции
+     * @return Результат операции (отрицательный errno при ошибке)
+     */
+    int runOne();
+
+    /**
+     * @brief Гарантированное чтение в область зарегистрированного буфера
+     * @param fd Дескриптор сокета
+     * @param dst Область внутри fixed
+     * @param len Количество байт
+     * @return len при успехе, 0 при закрытии соединения, -1 при ошибке
+     */
+    ssize_t readFixedAll(int fd, char* dst, size_t len);
+
+    /**
+     * @brief Проверка принадлежности указателя зарегистрированному буферу
+     * @param p Указатель
+     * @param len Длина области
+     * @return true если область целиком внутри fixed
+     */
+    bool inFixed(const void* p, size_t len) const;
+};
+
+#endif
@@ -1,82 +1,887 @@
 #include "vector_handler.h"
 #include "network_utils.h"
+#include "thread_pool.h"
+#include "parallel_sum.h"
 #include <stdexcept>
+#include <cerrno>
 #include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <system_error>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 /**
  * @brief Создает обработчик векторных запросов
  * @param logger Логгер для записи событий обработки векторов
+ * @param io Реализация ввода-вывода через сокет; nullptr - SocketIo::posix()
+ * @param reader Буфер чтения соединения, общий с AuthHandler; nullptr -
+ *        обработчик создает собственный буфер
  */
-VectorHandler::VectorHandler(Logger& logger) : logger_(logger) {}
+VectorHandler::VectorHandler(Logger& logger, SocketIo* io, BufferedSocketReader* reader)
+    : logger_(logger)
+    , io_(io ? *io : SocketIo::posix())
+    , own_reader_(reader ? nullptr : new BufferedSocketReader(io_))
+    , reader_(reader ? *reader : *own_reader_)
+    , results_(io_) {}
+
+/**
+ * @brief Подключает пул буферов векторов
+ * @details Шард передает собственный пул, поэтому выделение и возврат
+ *          буферов его сеансов не обращаются к мьютексу общего пула.
+ * @param pool Пул буферов
+ */
+void VectorHandler::setBufferPool(BufferPool& pool) {
+    buffer_pool_ = &pool;
+    small_data_ = PooledBuffer(pool);
+    bulk_aligned_ = PooledBuffer(pool);
+}
 
 /**
  * @brief Основной метод обработки векторов для аутентифицированного клиента
+ * @details Обрабатывает пакет (processBatch()); если в слове количества
+ *          установлен KEEP_ALIVE_FLAG, сеанс не завершается, а ждет слово
+ *          количества следующего пакета (readNextBatch()). Сеанс keep-alive
+ *          заканчивается пакетом без флага, словом END_OF_SESSION, закрытием
+ *          соединения клиентом между пакетами или таймаутом простоя
+ *          (setIdleTimeout()). Повторная аутентификация не нужна.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ */
+void VectorHandler::process(int client_fd, const std::string& login) {
+    BatchHeader batch = checkVectorCount(readUint32(client_fd));
+    for(uint32_t batches = 1;; ++batches) {
+        processBatch(client_fd, login, batch);
+        if(!batch.keep_alive)
+            return;
+        
+        uint32_t raw;
+        if(!readNextBatch(client_fd, raw))
+            return;
+        if(raw == END_OF_SESSION) {
+            logger_.info("Keep-alive session ended by client after " + std::to_string(batches) + " batches");
+            return;
+        }
+        batch = checkVectorCount(raw);
+    }
+}
+
+/**
+ * @brief Ожидает слово количества следующего пакета
+ * @details Слово, уже лежащее в буфере чтения, не ждет сокета. Иначе
+ *          сокет ожидается poll() не дольше таймаута простоя; закрытие
+ *          соединения клиентом между пакетами - обычное завершение сеанса.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param raw Слово количества следующего пакета
+ * @return false если клиент закрыл соединение или истек таймаут простоя
+ * @throw std::runtime_error при ошибке чтения или неполном слове
+ */
+bool VectorHandler::readNextBatch(int client_fd, uint32_t& raw) {
+    if(reader_.buffered() == 0 && idle_timeout_ms_ > 0) {
+        pollfd pfd{client_fd, POLLIN, 0};
+        int r;
+        do {
+            r = poll(&pfd, 1, idle_timeout_ms_);
+        } while(r == -1 && errno == EINTR);
+        if(r == 0) {
+            logger_.info("Keep-alive session idle for " + std::to_string(idle_timeout_ms_) +
+                         " ms, closing");
+            return false;
+        }
+    }
+    ssize_t got = reader_.readAll(client_fd, &raw, sizeof(raw));
+    if(got == 0) {
+        logger_.info("Keep-alive session closed by client");
+        return false;
+    }
+    if(got != (ssize_t)sizeof(raw)) {
+        throw std::runtime_error("Failed to read uint32");
+    }
+    return true;
+}
+
+/**
+ * @brief Обрабатывает один пакет векторов
  * @details Процесс обработки:
- *          1. Чтение количества векторов (uint32_t, сетевой порядок байт)
+ *          1. Выбор формата по слову количества векторов: с флагом
+ *             BULK_FLAG пакет обрабатывается processBulk(), с флагом
+ *             TAGGED_FLAG - processTagged()
  *          2. Для каждого вектора:
- *             a. Чтение размера вектора
+ *             a. Чтение размера вектора (старший байт - тип элементов,
+ *                см. VectorHeader)
  *             b. Чтение данных вектора
  *             c. Обработка вектора (суммирование с ограничением)
  *             d. Отправка результата клиенту
  *          3. Логирование прогресса и статистики
  * @param client_fd Файловый дескриптор клиентского сокета
  * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param batch Разобранное слово количества векторов (уже прочитано process())
  * @throw std::runtime_error при ошибках чтения/записи или неверных данных
  * @note Максимальное количество векторов: 100,000
  * @note Максимальный размер одного вектора: 10,000,000 элементов
  * @note Каждые 10 векторов логируется прогресс обработки
+ * @note В конвейерном режиме (setPipeline()) см. processPipelined(),
+ *       в потоковом (setStreaming()) - processStreaming()
+ * @note Все чтения идут через BufferedSocketReader: заголовки и короткие
+ *       векторы, пришедшие подряд, забираются одним вызовом recv()
+ * @note Векторы до SMALL_VECTOR_MAX_SIZE элементов, уже лежащие в буфере
+ *       чтения, суммируются сериями за один вызов
+ *       VectorProcessor::sumClampSegments() (см. processSmallRun())
  */
-void VectorHandler::process(int client_fd, const std::string& login) {
-    logger_.info("=== VECTOR PROCESSING START ===");
-    logger_.info("Processing vectors for: '" + login + "'");
+void VectorHandler::processBatch(int client_fd, const std::string& login, const BatchHeader& batch) {
+    const uint32_t vec_count = batch.count;
+    if(batch.format == BatchFormat::Bulk) {
+        processBulk(client_fd, login, vec_count);
+        return;
+    }
+    if(batch.format == BatchFormat::Tagged) {
+        processTagged(client_fd, login, vec_count);
+        return;
+    }
+    if(streaming_) {
+        processStreaming(client_fd, login, vec_count);
+        return;
+    }
+    if(pipeline_) {
+        processPipelined(client_fd, login, vec_count);
+        return;
+    }
     
-    // Чтение количества векторов
-    uint32_t vec_count = readVectorCount(client_fd);
-    logger_.info("Vector count: " + std::to_string(vec_count));
+    beginBatch(login, vec_count);
+    results_.begin(client_fd);
+    
+    // Заголовок первого вектора; заголовки следующих читаются вместе
+    // с отправкой результата предыдущего (finishVectors())
+    uint32_t size = readUint32(client_fd);
+    
+    // Обработка каждого вектора; буфер переиспользуется между векторами.
+    // Идущие подряд короткие векторы суммируются сериями (processSmallRun())
+    PooledBuffer vec(*buffer_pool_);
+    VectorHeader header;
+    for(uint32_t i = 0; i < vec_count;) {
+        if(isSmallVector(size)) {
+            i += processSmallRun(client_fd, i, size);
+            continue;
+        }
+        if(!readVectorData(client_fd, size, vec, header)) {
+            throw std::runtime_error("Failed to read vector " + std::to_string(i));
+        }
+        
+        VectorResult result;
+        computeResult(vec, header, result);
+        finishVectors(client_fd, i, 1, result.words, result.count, i + 1 < vec_count, size);
+        
+        vectorDone(i, header.size);
+        ++i;
+    }
+    
+    if(!results_.flush(client_fd)) {
+        throw std::runtime_error("Failed to send results");
+    }
+    endBatch();
+}
+
+/**
+ * @brief Проверяет, обрабатывается ли вектор в серии коротких векторов
+ * @param size Заголовок размера вектора
+ * @return true для допустимых размеров до SMALL_VECTOR_MAX_SIZE с элементами
+ *         uint32_t без маски операций (иначе заголовок больше 10^7)
+ */
+bool VectorHandler::isSmallVector(uint32_t size) {
+    return validateVectorSize(size) && size <= SMALL_VECTOR_MAX_SIZE;
+}
+
+/**
+ * @brief Обрабатывает серию коротких векторов
+ * @details Данные коротких векторов читаются подряд в один буфер, границы
+ *          записываются в массив смещений. Серия продолжается, пока
+ *          заголовок и данные следующего короткого вектора уже лежат
+ *          в буфере BufferedSocketReader: ожидания сокета нет, поэтому
+ *          клиент, который ждет ответ перед отправкой следующего вектора,
+ *          получает его без задержки. Затем все суммы серии считаются
+ *          одним вызовом VectorProcessor::sumClampSegments() и
+ *          отправляются вместе (finishVectors()).
+ *
+ *          Первый вектор серии читается как обычно, с ожиданием. Если
+ *          прочитанный заголовок следующего вектора не подходит (большой
+ *          или недопустимый вектор, данные еще не пришли), серия
+ *          заканчивается, а размер передается в process() через size.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param first Индекс первого вектора серии
+ * @param size Размер первого вектора; на выходе - размер следующего
+ *        вектора (если он есть)
+ * @return Количество обработанных векторов (не меньше 1)
+ * @throw std::runtime_error при ошибках чтения/записи
+ */
+uint32_t VectorHandler::processSmallRun(int client_fd, uint32_t first, uint32_t& size) {
+    small_data_.resize(SMALL_VECTOR_MAX_SIZE * SMALL_RUN_MAX);
+    small_offsets_.assign(1, 0);
+    
+    uint32_t n = 0;
+    bool have_next = false; // Заголовок следующего вектора уже прочитан
+    for(;;) {
+        uint32_t used = small_offsets_.back();
+        size_t bytes = size * sizeof(uint32_t);
+        if(!flushBeforeRead(client_fd, bytes) ||
+           reader_.readAll(client_fd, small_data_.data() + used, bytes) != (ssize_t)bytes) {
+            logger_.error("Failed to read vector data");
+            throw std::runtime_error("Failed to read vector " + std::to_string(first + n));
+        }
+        small_offsets_.push_back(used + size);
+        ++n;
+        
+        have_next = false;
+        if(first + n == vec_count_ || n == SMALL_RUN_MAX || reader_.buffered() < sizeof(size))
+            break;
+        size = readUint32(client_fd);
+        have_next = true;
+        if(!isSmallVector(size) || reader_.buffered() < size * sizeof(uint32_t))
+            break;
+    }
+    
+    small_results_.resize(n);
+    VectorProcessor::sumClampSegments(small_data_.data(), small_offsets_.data(), n,
+                                      small_results_.data());
+    bool more = first + n < vec_count_;
+    finishVectors(client_fd, first, n, small_results_.data(), n, more && !have_next, size);
+    
+    for(uint32_t k = 0; k < n; ++k)
+        vectorDone(first + k, small_offsets_[k + 1] - small_offsets_[k]);
+    return n;
+}
+
+/**
+ * @brief Конвейерная обработка векторов
+ * @details Векторы читаются попеременно в два буфера. Пока вектор i
+ *          суммируется и его результат отправляется в потоке общего пула
+ *          заданий (setJobPool()), основной поток читает из сокета
+ *          вектор i+1. Перед
+ *          запуском суммирования вектора i+1 основной поток дожидается
+ *          завершения задачи вектора i, поэтому результаты уходят клиенту
+ *          строго по порядку, а буфер вектора i освобождается до чтения
+ *          вектора i+2.
+ *
+ *          Результат отправляет сам поток пула: клиент, который ждет ответ
+ *          на вектор i перед отправкой вектора i+1, получает его без
+ *          задержки (основной поток в это время заблокирован в чтении).
+ *          Векторы короче PIPELINE_MIN_SIZE суммируются в основном потоке:
+ *          передача задачи в поток обходится дороже их суммирования. Без
+ *          пула заданий все векторы суммируются в основном потоке.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param vec_count Количество векторов в пакете (уже прочитано process())
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ * @note Отправка из потока пула заданий идет через SocketIo::posix():
+ *       экземпляр io_ (например, кольцо io_uring) не рассчитан на
+ *       одновременное использование двумя потоками
+ */
+void VectorHandler::processPipelined(int client_fd, const std::string& login, uint32_t vec_count) {
+    beginBatch(login, vec_count);
     
-    // Обработка каждого вектора
-    size_t total_vectors = 0;
-    size_t total_numbers = 0;
+    PooledBuffer buffers[2] = {PooledBuffer(*buffer_pool_), PooledBuffer(*buffer_pool_)};
+    VectorHeader headers[2];
+    std::future<void> computing;   // суммирование и отправка предыдущего вектора
+    size_t computing_size = 0;
+    
+    try {
+        for(uint32_t i = 0; i < vec_count; ++i) {
+            PooledBuffer& vec = buffers[i % 2];
+            VectorHeader& header = headers[i % 2];
+            if(!readVector(client_fd, vec, header)) {
+                throw std::runtime_error("Failed to read vector " + std::to_string(i));
+            }
+            
+            if(computing.valid()) {
+                computing.get();
+                vectorDone(i - 1, computing_size);
+            }
+            
+            if(header.size < PIPELINE_MIN_SIZE || !jobs_) {
+                VectorResult result;
+                computeResult(vec, header, result);
+                if(!io_.sendAll(client_fd, result.words, result.bytes())) {
+                    throw std::runtime_error("Failed to send result for vector " + std::to_string(i));
+                }
+                vectorDone(i, header.size);
+                continue;
+            }
+            
+            auto task = std::make_shared<std::packaged_task<void()>>([this, client_fd, i, &vec, &header] {
+                VectorResult result;
+                computeResult(vec, header, result);
+                if(!SocketIo::posix().sendAll(client_fd, result.words, result.bytes())) {
+                    throw std::runtime_error("Failed to send result for vector " + std::to_string(i));
+                }
+            });
+            computing = task->get_future();
+            computing_size = header.size;
+            jobs_->submit([task] { (*task)(); });
+        }
+    } catch(...) {
+        // Задача пула ссылается на буферы сеанса: дождаться ее до их освобождения
+        if(computing.valid())
+            computing.wait();
+        throw;
+    }
+    
+    if(computing.valid()) {
+        computing.get();
+        vectorDone(vec_count - 1, computing_size);
+    }
+    
+    endBatch();
+}
+
+/**
+ * @brief Потоковая обработка векторов
+ * @details Данные вектора читаются порциями по STREAM_CHUNK_SIZE байт
+ *          в один буфер и сразу добавляются к сумме
+ *          (VectorProcessor::sumUpdate()). Память сеанса ограничена размером
+ *          порции (64 КБ) вместо размера вектора (до 40 МБ). Результат и
+ *          порядок обмена совпадают с process().
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param vec_count Количество векторов в пакете (уже прочитано process())
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ */
+void VectorHandler::processStreaming(int client_fd, const std::string& login, uint32_t vec_count) {
+    beginBatch(login, vec_count);
+    
+    results_.begin(client_fd);
+    
+    PooledBuffer chunk(*buffer_pool_);
+    chunk.resize(STREAM_CHUNK_SIZE / sizeof(uint32_t));
+    uint32_t size = readUint32(client_fd);
     
     for(uint32_t i = 0; i < vec_count; ++i) {
-        std::vector<uint32_t> vec;
-        if(!readVector(client_fd, vec)) {
+        VectorResult result;
+        VectorHeader header;
+        if(!readVectorResult(client_fd, size, chunk, result, header)) {
             throw std::runtime_error("Failed to read vector " + std::to_string(i));
         }
         
-        int32_t result = processVector(vec);
-        if(!sendResult(client_fd, result)) {
-            throw std::runtime_error("Failed to send result for vector " + std::to_string(i));
+        finishVectors(client_fd, i, 1, result.words, result.count, i + 1 < vec_count, size);
+        
+        vectorDone(i, header.size);
+    }
+    
+    if(!results_.flush(client_fd)) {
+        throw std::runtime_error("Failed to send results");
+    }
+    endBatch();
+}
+
+/**
+ * @brief Обрабатывает пакет v2
+ * @details За количеством векторов с флагом BULK_FLAG клиент отправляет
+ *          таблицу заголовков всех векторов (по uint32_t, как в исходном
+ *          протоколе, но без масок операций), затем данные всех векторов
+ *          одним блоком подряд. Сервер читает таблицу и блок двумя вызовами
+ *          BufferedSocketReader::readAll() (блок - прямо в буфер пула, без
+ *          промежуточного копирования), считает суммы computeBulk() и
+ *          отправляет их одним массивом int32_t.
+ *
+ *          Формат одинаков во всех режимах process(): порядок векторов
+ *          известен заранее, поэтому конвейер и накопление ответов не нужны,
+ *          а потоковое чтение не дало бы одного большого чтения.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param vec_count Количество векторов в пакете (уже прочитано process())
+ * @throw std::runtime_error при ошибках чтения/записи или неверной таблице
+ * @note Сервер без поддержки v2 отвергает количество с BULK_FLAG как
+ *       недопустимое и закрывает соединение, поэтому клиент может
+ *       вернуться к исходному протоколу
+ */
+void VectorHandler::processBulk(int client_fd, const std::string& login, uint32_t vec_count) {
+    beginBatch(login, vec_count);
+    
+    bulk_raw_.resize(vec_count);
+    size_t table_bytes = vec_count * sizeof(uint32_t);
+    if(reader_.readAll(client_fd, bulk_raw_.data(), table_bytes) != (ssize_t)table_bytes) {
+        throw std::runtime_error("Failed to read size table");
+    }
+    if(!parseSizeTable(bulk_raw_.data(), vec_count, bulk_table_)) {
+        logger_.error(invalidTableMessage(bulk_raw_.data(), vec_count));
+        throw std::runtime_error("Invalid size table");
+    }
+    
+    PooledBuffer payload(*buffer_pool_);
+    size_t bytes = bulk_table_.bytes();
+    payload.resize((bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    if(reader_.readAll(client_fd, payload.data(), bytes) != (ssize_t)bytes) {
+        logger_.error("Failed to read vector data");
+        throw std::runtime_error("Failed to read bulk payload");
+    }
+    
+    bulk_results_.resize(vec_count);
+    computeBulk(payload, bulk_table_, bulk_results_.data());
+    if(!io_.sendAll(client_fd, bulk_results_.data(), vec_count * sizeof(int32_t))) {
+        throw std::runtime_error("Failed to send results");
+    }
+    
+    for(uint32_t i = 0; i < vec_count; ++i)
+        vectorDone(i, bulk_table_.headers[i].size);
+    endBatch();
+}
+
+/**
+ * @brief Обрабатывает задания с идентификаторами
+ * @details Каждое задание - идентификатор (uint32_t, произвольное значение
+ *          клиента), затем вектор в исходном формате (заголовок, маска
+ *          операций, данные). Ответ на задание - тот же идентификатор и
+ *          ответ на вектор (taggedFrame()); клиент не ждет ответа перед
+ *          отправкой следующего задания.
+ *
+ *          Векторы короче PIPELINE_MIN_SIZE основной поток считает сам;
+ *          большие передаются общему пулу заданий сервера (setJobPool()).
+ *          Задача пула только считает: готовый ответ она кладет в очередь
+ *          сеанса, освобождает место TAGGED_MAX_IN_FLIGHT_TOTAL и будит
+ *          сеанс через eventfd. Ответы отправляет основной поток между
+ *          чтениями заданий через io_ (и ResultBatcher при setBatching()),
+ *          поэтому медленный читатель не занимает потоки пула. Пока сокет
+ *          не принимает данные, ответы копятся, а чтение заданий
+ *          продолжается; перед чтением, которого пришлось бы ждать, поток
+ *          ждет сокета или готового ответа (poll()), так что клиент может
+ *          ждать ответа на большое задание перед отправкой следующего.
+ *          Короткое задание, отправленное после большого, не ждет его
+ *          завершения, а ответы приходят в порядке готовности, а не
+ *          отправки. Если TAGGED_MAX_IN_FLIGHT заданий сеанса или
+ *          TAGGED_MAX_IN_FLIGHT_TOTAL заданий всех сеансов еще не
+ *          посчитаны, чтение приостанавливается. Без пула заданий все
+ *          задания считаются в основном потоке.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param vec_count Количество заданий (уже прочитано process())
+ * @throw std::runtime_error при ошибках чтения/записи или неверных данных
+ * @throw std::system_error при ошибке eventfd() или poll()
+ * @note Учет статистики (vectorDone()) идет в порядке отправки ответов,
+ *       поэтому прогресс в логе - количество выполненных заданий
+ */
+void VectorHandler::processTagged(int client_fd, const std::string& login, uint32_t vec_count) {
+    beginBatch(login, vec_count);
+    
+    struct Job {
+        explicit Job(BufferPool& pool) : data(pool) {}
+        uint32_t id = 0;
+        PooledBuffer data;
+        VectorHeader header;
+    };
+    
+    // Очередь готовых ответов больших заданий (заполняют задачи пула)
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    std::vector<uint32_t> ready_words; // ответы подряд
+    std::vector<uint32_t> ready_sizes; // размеры их векторов (для vectorDone())
+    size_t in_flight = 0;
+    
+    struct WakeFd {
+        int fd = -1;
+        ~WakeFd() {
+            if(fd != -1)
+                close(fd);
+        }
+    } wake;
+    if(jobs_) {
+        wake.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(wake.fd == -1)
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+    
+    // Ответы, еще не отправленные клиенту, и размеры их векторов
+    std::vector<uint32_t> words, sizes;
+    auto takeReady = [&] {
+        std::lock_guard<std::mutex> lk(done_mutex);
+        words.insert(words.end(), ready_words.begin(), ready_words.end());
+        sizes.insert(sizes.end(), ready_sizes.begin(), ready_sizes.end());
+        ready_words.clear();
+        ready_sizes.clear();
+    };
+    auto sendPending = [&] {
+        if(words.empty())
+            return;
+        bool ok = true;
+        if(!results_.enabled()) {
+            ok = io_.sendAll(client_fd, words.data(), words.size() * sizeof(uint32_t));
+        } else {
+            for(size_t k = 0; k < words.size() && ok; ++k)
+                ok = results_.add(client_fd, static_cast<int32_t>(words[k]));
+        }
+        if(!ok) {
+            throw std::runtime_error("Failed to send results");
+        }
+        for(uint32_t size : sizes)
+            vectorDone(static_cast<uint32_t>(total_vectors_), size);
+        words.clear();
+        sizes.clear();
+    };
+    // Перед чтением задания: отправить ответы, если сокет принимает данные
+    // (клиент, который шлет задания, не читая ответов, не останавливает
+    // чтение), и, пока данных нет, ждать сокета или следующего ответа
+    auto awaitJob = [&] {
+        for(;;) {
+            takeReady();
+            bool pending = !words.empty();
+            if(pending) {
+                pollfd out = {client_fd, POLLOUT, 0};
+                if(poll(&out, 1, 0) == 1) {
+                    sendPending();
+                    pending = false;
+                }
+            }
+            if(reader_.buffered() >= sizeof(uint32_t))
+                return;
+            if(!pending) {
+                if(!flushBeforeRead(client_fd, sizeof(uint32_t))) {
+                    throw std::runtime_error("Failed to send results");
+                }
+                std::lock_guard<std::mutex> lk(done_mutex);
+                if(in_flight == 0 && ready_words.empty())
+                    return;
+            }
+            short events = static_cast<short>(POLLIN | (pending ? POLLOUT : 0));
+            pollfd fds[2] = {{client_fd, events, 0}, {wake.fd, POLLIN, 0}};
+            if(poll(fds, 2, -1) == -1) {
+                if(errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "poll");
+            }
+            uint64_t count = 0;
+            if((fds[1].revents & POLLIN) && read(wake.fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+                throw std::system_error(errno, std::generic_category(), "eventfd read");
+            if(fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+                return;
+        }
+    };
+    
+    std::counting_semaphore<>* slots = tagged_slots_;
+    try {
+        for(uint32_t i = 0; i < vec_count; ++i) {
+            awaitJob();
+            auto job = std::make_shared<Job>(*buffer_pool_);
+            job->id = readUint32(client_fd);
+            if(!readVector(client_fd, job->data, job->header)) {
+                throw std::runtime_error("Failed to read vector " + std::to_string(i));
+            }
+            
+            if(job->header.size < PIPELINE_MIN_SIZE || !jobs_) {
+                VectorResult result;
+                computeResult(job->data, job->header, result);
+                uint32_t frame[TAGGED_FRAME_WORDS];
+                size_t bytes = taggedFrame(job->id, result, frame);
+                words.insert(words.end(), frame, frame + bytes / sizeof(uint32_t));
+                sizes.push_back(job->header.size);
+                continue;
+            }
+            
+            {
+                std::unique_lock<std::mutex> lk(done_mutex);
+                done_cv.wait(lk, [&] { return in_flight < TAGGED_MAX_IN_FLIGHT; });
+                ++in_flight;
+            }
+            if(slots)
+                slots->acquire();
+            jobs_->submit([&, slots, job] {
+                VectorResult result;
+                computeResult(job->data, job->header, result);
+                uint32_t frame[TAGGED_FRAME_WORDS];
+                size_t bytes = taggedFrame(job->id, result, frame);
+                if(slots)
+                    slots->release();
+                std::lock_guard<std::mutex> lk(done_mutex);
+                ready_words.insert(ready_words.end(), frame, frame + bytes / sizeof(uint32_t));
+                ready_sizes.push_back(job->header.size);
+                uint64_t one = 1;
+                if(write(wake.fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+                    logger_.error(std::string("eventfd write failed: ") + std::strerror(errno));
+                --in_flight;
+                done_cv.notify_all();
+            });
         }
         
-        total_vectors++;
-        total_numbers += vec.size();
+        // Все задания прочитаны: отправить ответы оставшихся по мере готовности
+        for(;;) {
+            takeReady();
+            sendPending();
+            std::unique_lock<std::mutex> lk(done_mutex);
+            if(in_flight == 0 && ready_words.empty())
+                break;
+            done_cv.wait(lk, [&] { return in_flight == 0 || !ready_words.empty(); });
+        }
+    } catch(...) {
+        // Задачи пула ссылаются на состояние пакета: дождаться их до выхода
+        std::unique_lock<std::mutex> lk(done_mutex);
+        done_cv.wait(lk, [&] { return in_flight == 0; });
+        throw;
+    }
+    endBatch();
+}
+
+/**
+ * @brief Считает суммы всех векторов пакета v2
+ * @details Подряд идущие короткие векторы uint32_t (до SMALL_VECTOR_MAX_SIZE)
+ *          лежат в блоке вплотную и суммируются сериями за один вызов
+ *          VectorProcessor::sumClampSegments(). Остальные векторы
+ *          суммируются sumVector(): uint32_t - в том числе параллельно
+ *          (setParallelSum()), другие типы - ядрами sumClampTyped().
+ *
+ *          Данные в блоке идут без выравнивания, поэтому после векторов
+ *          uint8_t и uint16_t смещение вектора (или серии) может быть не
+ *          кратно размеру элемента. Ядра читают элементы через указатели
+ *          на свой тип, поэтому такие данные сначала копируются в
+ *          выровненный буфер bulk_aligned_ (alignedBulkData()).
+ * @param payload Блок данных пакета
+ * @param table Таблица размеров пакета
+ * @param results Суммы векторов в порядке таблицы
+ */
+void VectorHandler::computeBulk(const PooledBuffer& payload, const BulkTable& table, int32_t* results) {
+    const char* base = reinterpret_cast<const char*>(payload.data());
+    const size_t count = table.headers.size();
+    auto small = [&table](size_t k) {
+        return table.headers[k].type == ElementType::U32 &&
+               table.headers[k].size <= SMALL_VECTOR_MAX_SIZE;
+    };
+    
+    for(size_t i = 0; i < count;) {
+        if(!small(i)) {
+            results[i] = sumVector(alignedBulkData(base, table, i, i + 1), table.headers[i]);
+            ++i;
+            continue;
+        }
         
-        // Логирование прогресса
-        if((i + 1) % 10 == 0 || (i + 1) == vec_count) {
-            logger_.info("Processed " + std::to_string(i + 1) + 
-                        "/" + std::to_string(vec_count) + " vectors");
+        size_t end = i;
+        small_offsets_.assign(1, 0);
+        while(end < count && small(end)) {
+            small_offsets_.push_back(small_offsets_.back() + table.headers[end].size);
+            ++end;
+        }
+        VectorProcessor::sumClampSegments(static_cast<const uint32_t*>(alignedBulkData(base, table, i, end)),
+                                          small_offsets_.data(), end - i, results + i);
+        i = end;
+    }
+}
+
+/**
+ * @brief Данные векторов пакета v2, выровненные по размеру элемента
+ * @details Векторы first..last-1 одного типа лежат в блоке подряд. Если
+ *          смещение first кратно размеру элемента, возвращается указатель
+ *          в блок без копирования, иначе данные копируются в bulk_aligned_
+ *          (память пула выровнена по линии кэша).
+ * @param base Начало блока данных (выровнено BufferPool)
+ * @param table Таблица размеров пакета
+ * @param first Первый вектор
+ * @param last Вектор после последнего
+ * @return Указатель на данные, пригодный для чтения элементов их типа
+ */
+const void* VectorHandler::alignedBulkData(const char* base, const BulkTable& table, size_t first, size_t last) {
+    const char* data = base + table.offsets[first];
+    if(table.offsets[first] % VectorProcessor::elementSize(table.headers[first].type) == 0)
+        return data;
+    size_t bytes = table.offsets[last] - table.offsets[first];
+    bulk_aligned_.resize((bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    std::memcpy(bulk_aligned_.data(), data, bytes);
+    return bulk_aligned_.data();
+}
+
+/**
+ * @brief Отправляет ответы на векторы и читает заголовок следующего
+ * @details Без накопления ответы и чтение следующего заголовка
+ *          передаются BufferedSocketReader::sendThenRead(): заголовок,
+ *          уже лежащий в буфере, не читается из сокета, иначе используется
+ *          SocketIo::sendThenRecv() (для io_uring - один системный вызов).
+ *          При накоплении (setBatching()) слова ответов
+ *          добавляются в буфер ResultBatcher, который отправляется по
+ *          политике и обязательно перед чтением, которое пришлось бы ждать.
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param index Индекс первого вектора (для сообщений об ошибках)
+ * @param vectors Количество векторов
+ * @param words Ответы векторов index, index+1, ... подряд: по слову на
+ *        сумму, по два слова на каждое значение операций свертки
+ * @param n Количество слов
+ * @param more Есть ли следующий вектор
+ * @param next_size Размер следующего вектора (читается, если more)
+ * @throw std::runtime_error при ошибке отправки или чтения
+ */
+void VectorHandler::finishVectors(int client_fd, uint32_t index, uint32_t vectors, const int32_t* words,
+                                  size_t n, bool more, uint32_t& next_size) {
+    const std::string last = std::to_string(index + vectors - 1);
+    if(results_.enabled()) {
+        for(size_t k = 0; k < n; ++k) {
+            if(!results_.add(client_fd, words[k]))
+                throw std::runtime_error("Failed to send result for vector " + last);
         }
+        if(more && !flushBeforeRead(client_fd, sizeof(next_size)))
+            throw std::runtime_error("Failed to send result for vector " + last);
+        if(more)
+            next_size = readUint32(client_fd);
+        return;
     }
     
-    logger_.info("=== VECTOR PROCESSING COMPLETE ===");
-    logger_.info("Total: " + std::to_string(total_vectors) + " vectors, " +
-                std::to_string(total_numbers) + " numbers for '" + login + "'");
+    size_t bytes = n * sizeof(int32_t);
+    if(more) {
+        if(reader_.sendThenRead(client_fd, words, bytes, &next_size, sizeof(next_size))
+           != (ssize_t)sizeof(next_size)) {
+            throw std::runtime_error("Failed to send result for vector " + last +
+                                     " or read next vector size");
+        }
+    } else if(!io_.sendAll(client_fd, words, bytes)) {
+        throw std::runtime_error("Failed to send result for vector " + last);
+    }
 }
 
 /**
- * @brief Читает количество векторов для обработки
+ * @brief Отправляет накопленные результаты перед чтением, которое придется ждать
+ * @details Байты, уже лежащие в буфере чтения, доступны без ожидания,
+ *          поэтому ResultBatcher проверяет наличие в сокете только
+ *          недостающей части.
  * @param client_fd Файловый дескриптор клиентского сокета
- * @return Количество векторов для обработки
- * @throw std::runtime_error при ошибке чтения или неверном значении
- * @note Значение читается в сетевом порядке байт и проверяется на корректность
+ * @param need Количество байт, которое будет прочитано
+ * @return false при ошибке отправки
  */
-uint32_t VectorHandler::readVectorCount(int client_fd) {
-    uint32_t count = NetworkUtils::readNetworkUint32(client_fd);
-    if(!validateVectorCount(count)) {
-        throw std::runtime_error("Invalid vector count: " + std::to_string(count));
+bool VectorHandler::flushBeforeRead(int client_fd, size_t need) {
+    size_t have = reader_.buffered();
+    return have >= need || results_.flushBeforeRead(client_fd, need - have);
+}
+
+/**
+ * @brief Начинает учет пакета векторов
+ * @details Сбрасывает статистику пакета и логирует начало обработки
+ *          и количество векторов.
+ *          Вызывается после успешного чтения и проверки количества векторов
+ *          как блокирующим process(), так и неблокирующим ClientSession.
+ * @param login Логин аутентифицированного пользователя (для логирования)
+ * @param count Количество векторов в пакете
+ */
+void VectorHandler::beginBatch(const std::string& login, uint32_t count) {
+    login_ = login;
+    vec_count_ = count;
+    total_vectors_ = 0;
+    total_numbers_ = 0;
+    logger_.info("=== VECTOR PROCESSING START ===");
+    logger_.info("Processing vectors for: '" + login + "'");
+    logger_.info("Vector count: " + std::to_string(count));
+}
+
+/**
+ * @brief Учитывает обработанный вектор
+ * @param index Индекс обработанного вектора (с нуля)
+ * @param size Количество элементов вектора
+ * @note Каждые 10 векторов (и на последнем) логируется прогресс обработки
+ */
+void VectorHandler::vectorDone(uint32_t index, size_t size) {
+    total_vectors_++;
+    total_numbers_ += size;
+    
+    // Логирование прогресса
+    if((index + 1) % 10 == 0 || (index + 1) == vec_count_) {
+        logger_.info("Processed " + std::to_string(index + 1) + 
+                    "/" + std::to_string(vec_count_) + " vectors");
+    }
+}
+
+/**
+ * @brief Завершает учет пакета векторов и логирует итоговую статистику
+ */
+void VectorHandler::endBatch() {
+    logger_.info("=== VECTOR PROCESSING COMPLETE ===");
+    logger_.info("Total: " + std::to_string(total_vectors_) + " vectors, " +
+                std::to_string(total_numbers_) + " numbers for '" + login_ + "'");
+}
+
+/**
+ * @brief Проверяет слово количества векторов
+ * @param raw Слово количества векторов (сетевой порядок байт)
+ * @return Разобранное слово количества
+ * @throw std::runtime_error при неверном значении
+ */
+BatchHeader VectorHandler::checkVectorCount(uint32_t raw) {
+    BatchHeader batch;
+    if(!parseVectorCount(raw, batch)) {
+        throw std::runtime_error("Invalid vector count: " + std::to_string(batch.count));
     }
-    return count;
+    return batch;
+}
+
+/**
+ * @brief Разбирает слово количества векторов
+ * @details Бит 31 (BULK_FLAG) выбирает пакет v2, бит 30 (TAGGED_FLAG) -
+ *          задания с идентификаторами, бит 29 (KEEP_ALIVE_FLAG) оставляет
+ *          сеанс открытым после пакета; остальные биты - количество
+ *          векторов (validateVectorCount()). Без флагов слово совпадает
+ *          с исходным протоколом.
+ * @param raw Слово из сокета
+ * @param batch Разобранное слово
+ * @return true если количество допустимо и BULK_FLAG и TAGGED_FLAG не установлены вместе
+ */
+bool VectorHandler::parseVectorCount(uint32_t raw, BatchHeader& batch) {
+    bool bulk = (raw & BULK_FLAG) != 0;
+    bool tagged = (raw & TAGGED_FLAG) != 0;
+    batch.format = bulk ? BatchFormat::Bulk : tagged ? BatchFormat::Tagged : BatchFormat::Lockstep;
+    batch.keep_alive = (raw & KEEP_ALIVE_FLAG) != 0;
+    batch.count = raw & ~(BULK_FLAG | TAGGED_FLAG | KEEP_ALIVE_FLAG);
+    return !(bulk && tagged) && validateVectorCount(batch.count);
+}
+
+/**
+ * @brief Формирует ответ на задание с идентификатором
+ * @param id Идентификатор задания
+ * @param result Ответ на вектор (сумма или значения операций)
+ * @param frame Буфер не меньше TAGGED_FRAME_WORDS слов
+ * @return Размер ответа в байтах (4 + result.bytes())
+ */
+size_t VectorHandler::taggedFrame(uint32_t id, const VectorResult& result, uint32_t* frame) {
+    frame[0] = id;
+    std::memcpy(frame + 1, result.words, result.bytes());
+    return sizeof(id) + result.bytes();
+}
+
+/**
+ * @brief Разбирает таблицу размеров пакета v2
+ * @details Каждый заголовок разбирается parseVectorHeader(); маски
+ *          операций в пакете v2 не поддерживаются (ответ - ровно одна сумма
+ *          на вектор). Смещения считаются по размеру данных каждого
+ *          вектора, их сумма ограничена BULK_MAX_BYTES.
+ * @param raw Заголовки векторов из сокета
+ * @param count Количество векторов
+ * @param table Разобранная таблица (при ошибке содержимое не определено)
+ * @return true если таблица допустима
+ */
+bool VectorHandler::parseSizeTable(const uint32_t* raw, uint32_t count, BulkTable& table) {
+    table.headers.resize(count);
+    table.offsets.resize(count + 1);
+    table.offsets[0] = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        VectorHeader& header = table.headers[i];
+        if(!parseVectorHeader(raw[i], header) || header.has_ops)
+            return false;
+        table.offsets[i + 1] = table.offsets[i] + header.bytes();
+        if(table.offsets[i + 1] > BULK_MAX_BYTES)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Формирует текст ошибки для недопустимой таблицы размеров
+ * @param raw Заголовки векторов из сокета
+ * @param count Количество векторов
+ * @return Ошибка первого недопустимого заголовка или превышение BULK_MAX_BYTES
+ */
+std::string VectorHandler::invalidTableMessage(const uint32_t* raw, uint32_t count) {
+    size_t bytes = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        VectorHeader header;
+        if(!parseVectorHeader(raw[i], header))
+            return invalidHeaderMessage(raw[i]) + " in size table entry " + std::to_string(i);
+        if(header.has_ops)
+            return "Operations are not supported in bulk batches: size table entry " + std::to_string(i);
+        bytes += header.bytes();
+    }
+    return "Bulk payload too large: " + std::to_string(bytes) + " bytes";
 }
 
 /**
@@ -99,29 +904,145 @@ bool VectorHandler::validateVectorSize(uint32_t size) {
     return size > 0 && size <= 10000000;
 }
 
+/**
+ * @brief Разбирает заголовок размера вектора
+ * @details Младшие 24 бита - количество элементов (проверяется
+ *          validateVectorSize()), биты 24-30 - код ElementType.
+ *          Клиент, объявивший узкий тип (uint8_t, uint16_t), передает
+ *          в 2-4 раза меньше байт; результат остается суммой с
+ *          ограничением [0, 2^31-1]. Бит 31 (OPERATIONS_FLAG) объявляет
+ *          маску операций, которую затем разбирает parseOperations().
+ * @param raw Заголовок из сокета
+ * @param header Разобранный заголовок (ops сбрасывается)
+ * @return true если размер и тип элементов допустимы
+ */
+bool VectorHandler::parseVectorHeader(uint32_t raw, VectorHeader& header) {
+    header.size = raw & VECTOR_SIZE_MASK;
+    header.has_ops = (raw & OPERATIONS_FLAG) != 0;
+    header.ops = 0;
+    return validateVectorSize(header.size) &&
+           VectorProcessor::parseElementType((raw >> ELEMENT_TYPE_SHIFT) & ELEMENT_TYPE_MASK,
+                                             header.type);
+}
+
+/**
+ * @brief Формирует текст ошибки для недопустимого заголовка
+ * @param raw Заголовок из сокета
+ * @return Строка с размером и кодом типа элементов
+ */
+std::string VectorHandler::invalidHeaderMessage(uint32_t raw) {
+    return "Invalid vector size: " + std::to_string(raw & VECTOR_SIZE_MASK) +
+           ", element type " + std::to_string((raw >> ELEMENT_TYPE_SHIFT) & ELEMENT_TYPE_MASK);
+}
+
+/**
+ * @brief Разбирает маску операций вектора
+ * @details Биты маски - ReduceOp; все операции считаются за один проход по
+ *          данным (VectorProcessor::reduceUpdate()), ответ - их 64-битные
+ *          значения в порядке битов (VectorProcessor::operations()).
+ * @param raw Маска из сокета
+ * @param header Заголовок с разобранным размером; при успехе заполняется ops
+ * @return true если маска допустима (VectorProcessor::validOperations())
+ */
+bool VectorHandler::parseOperations(uint32_t raw, VectorHeader& header) {
+    if(!VectorProcessor::validOperations(raw, header.size))
+        return false;
+    header.ops = raw;
+    return true;
+}
+
+/**
+ * @brief Формирует текст ошибки для недопустимой маски операций
+ * @param raw Маска из сокета
+ * @return Строка с маской
+ */
+std::string VectorHandler::invalidOperationsMessage(uint32_t raw) {
+    return "Invalid vector operations: " + std::to_string(raw);
+}
+
+/**
+ * @brief Разбирает заголовок и читает маску операций, если она объявлена
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param raw Заголовок размера вектора
+ * @param header Разобранный заголовок
+ * @return true если заголовок и маска допустимы
+ * @throw std::runtime_error если маску не удалось прочитать
+ */
+bool VectorHandler::readHeader(int client_fd, uint32_t raw, VectorHeader& header) {
+    if(!parseVectorHeader(raw, header)) {
+        logger_.error(invalidHeaderMessage(raw));
+        return false;
+    }
+    if(!header.has_ops)
+        return true;
+    if(!flushBeforeRead(client_fd, sizeof(uint32_t))) {
+        logger_.error("Failed to send results");
+        return false;
+    }
+    uint32_t ops = readUint32(client_fd);
+    if(!parseOperations(ops, header)) {
+        logger_.error(invalidOperationsMessage(ops));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Читает 32-битное значение заголовка через буфер чтения
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @return Прочитанное значение
+ * @throw std::runtime_error если не удалось прочитать 4 байта
+ * @note Порядок байт совпадает с NetworkUtils::readNetworkUint32()
+ */
+uint32_t VectorHandler::readUint32(int client_fd) {
+    uint32_t value;
+    if(reader_.readAll(client_fd, &value, sizeof(value)) != (ssize_t)sizeof(value)) {
+        throw std::runtime_error("Failed to read uint32");
+    }
+    return value;
+}
+
 /**
  * @brief Читает один вектор из сокета
  * @details Читает размер вектора (uint32_t), затем читает данные вектора.
  *          Размер вектора проверяется на корректность.
  * @param client_fd Файловый дескриптор клиентского сокета
  * @param vector Ссылка на вектор для записи данных
+ * @param header Разобранный заголовок (размер и тип элементов)
  * @return true если чтение успешно, false в противном случае
- * @note Использует recvAll() для гарантированного чтения всех данных
+ * @note Использует BufferedSocketReader::readAll() для гарантированного чтения всех данных
  * @post Если возвращено true, vector содержит прочитанные данные
  */
-bool VectorHandler::readVector(int client_fd, std::vector<uint32_t>& vector) {
+bool VectorHandler::readVector(int client_fd, PooledBuffer& vector, VectorHeader& header) {
     // Чтение размера вектора
-    uint32_t size = NetworkUtils::readNetworkUint32(client_fd);
-    if(!validateVectorSize(size)) {
-        logger_.error("Invalid vector size: " + std::to_string(size));
+    uint32_t size = readUint32(client_fd);
+    return readVectorData(client_fd, size, vector, header);
+}
+
+/**
+ * @brief Читает данные вектора, заголовок которого уже прочитан
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param raw Заголовок размера вектора
+ * @param vector Буфер для записи данных (байты элементов типа header.type)
+ * @param header Разобранный заголовок
+ * @return true если заголовок допустим и данные прочитаны, false в противном случае
+ * @note Буфер не заполняется нулями перед чтением; память берется из
+ *       BufferPool, только если емкости буфера не хватает
+ */
+bool VectorHandler::readVectorData(int client_fd, uint32_t raw, PooledBuffer& vector,
+                                   VectorHeader& header) {
+    if(!readHeader(client_fd, raw, header))
         return false;
-    }
     
     // Чтение данных вектора
-    vector.resize(size);
-    size_t bytes = size * sizeof(uint32_t);
+    size_t bytes = header.bytes();
+    vector.resize((bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t));
     
-    if(NetworkUtils::recvAll(client_fd, vector.data(), bytes) != (ssize_t)bytes) {
+    if(!flushBeforeRead(client_fd, bytes)) {
+        logger_.error("Failed to send results");
+        return false;
+    }
+    if(reader_.readAll(client_fd, vector.data(), bytes) != (ssize_t)bytes) {
         logger_.error("Failed to read vector data");
         return false;
     }
@@ -129,6 +1050,72 @@ bool VectorHandler::readVector(int client_fd, std::vector<uint32_t>& vector) {
     return true;
 }
 
+/**
+ * @brief Читает данные вектора порциями и обрабатывает их по мере поступления
+ * @details Без маски операций порции суммируются, иначе добавляются
+ *          к потоковой свертке (VectorProcessor::reduceUpdate()).
+ * @param client_fd Файловый дескриптор клиентского сокета
+ * @param raw Заголовок размера вектора
+ * @param chunk Буфер порции (не меньше двух элементов uint32_t)
+ * @param result Сумма элементов с ограничением (VectorProcessor::sumFinish())
+ *        или значения операций свертки
+ * @param header Разобранный заголовок
+ * @return true если заголовок допустим и данные прочитаны, false в противном случае
+ * @note После насыщения суммы остаток вектора отбрасывается через
+ *       BufferedSocketReader::discardAll() (recv с MSG_TRUNC) без копирования в память
+ */
+bool VectorHandler::readVectorResult(int client_fd, uint32_t raw, PooledBuffer& chunk,
+                                     VectorResult& result, VectorHeader& header) {
+    if(!readHeader(client_fd, raw, header))
+        return false;
+    
+    VectorProcessor::SumState st;
+    VectorProcessor::sumInit(st);
+    VectorProcessor::ReduceState reduce;
+    if(header.ops)
+        VectorProcessor::reduceInit(reduce, header.type, header.ops);
+    
+    const size_t width = VectorProcessor::elementSize(header.type);
+    const size_t per_chunk = chunk.size() * sizeof(uint32_t) / width;
+    size_t remaining = header.size;
+    while(remaining > 0) {
+        size_t n = std::min(remaining, per_chunk);
+        size_t bytes = n * width;
+        if(!flushBeforeRead(client_fd, bytes)) {
+            logger_.error("Failed to send results");
+            return false;
+        }
+        if(reader_.readAll(client_fd, chunk.data(), bytes) != (ssize_t)bytes) {
+            logger_.error("Failed to read vector data");
+            return false;
+        }
+        if(header.ops)
+            VectorProcessor::reduceUpdate(reduce, chunk.data(), n);
+        else
+            VectorProcessor::sumUpdateTyped(st, header.type, chunk.data(), n);
+        remaining -= n;
+        
+        // Сумма достигла INT32_MAX: остаток не влияет на результат
+        // и отбрасывается без копирования
+        if(st.saturated && remaining > 0) {
+            size_t rest = remaining * width;
+            if(reader_.discardAll(client_fd, rest) != (ssize_t)rest) {
+                logger_.error("Failed to read vector data");
+                return false;
+            }
+            remaining = 0;
+        }
+    }
+    
+    if(header.ops) {
+        uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+        result.setValues(values, VectorProcessor::reduceFinish(reduce, values));
+    } else {
+        result.setSum(VectorProcessor::sumFinish(st));
+    }
+    return true;
+}
+
 /**
  * @brief Обрабатывает один вектор (суммирование с ограничением)
  * @param vector Вектор для обработки
@@ -139,6 +1126,71 @@ int32_t VectorHandler::processVector(const std::vector<uint32_t>& vector) {
     return VectorProcessor::sumClamp(vector);
 }
 
+/**
+ * @brief Обрабатывает вектор из буфера пула
+ * @details При заданном пуле (setParallelSum()) векторы от
+ *          SumThresholds::parallel_min элементов суммируются параллельно
+ *          несколькими потоками.
+ * @param vector Буфер с данными вектора
+ * @return Результат обработки (сумма элементов с ограничением)
+ */
+int32_t VectorHandler::processVector(const PooledBuffer& vector) {
+    if(parallel_)
+        return parallel_->sumClamp(vector.data(), vector.size());
+    return VectorProcessor::sumClamp(vector.data(), vector.size());
+}
+
+/**
+ * @brief Обрабатывает вектор с элементами типа из заголовка
+ * @details Векторы uint32_t обрабатываются processVector(const PooledBuffer&)
+ *          (в том числе параллельно), остальные типы - ядрами
+ *          VectorProcessor::sumClampTyped() в потоке сеанса.
+ * @param vector Буфер с данными вектора
+ * @param header Заголовок вектора (размер в элементах и тип)
+ * @return Результат обработки (сумма элементов с ограничением)
+ */
+int32_t VectorHandler::processVector(const PooledBuffer& vector, const VectorHeader& header) {
+    return sumVector(vector.data(), header);
+}
+
+/**
+ * @brief Суммирует вектор по указателю на его данные
+ * @details Общая часть processVector() и computeBulk(): векторы uint32_t
+ *          при заданном пуле суммируются ParallelSum::sumClamp(),
+ *          остальные типы - VectorProcessor::sumClampTyped().
+ * @param data Данные вектора
+ * @param header Заголовок вектора (размер в элементах и тип)
+ * @return Сумма элементов с ограничением
+ */
+int32_t VectorHandler::sumVector(const void* data, const VectorHeader& header) {
+    if(header.type != ElementType::U32)
+        return VectorProcessor::sumClampTyped(header.type, data, header.size);
+    const uint32_t* words = static_cast<const uint32_t*>(data);
+    if(parallel_)
+        return parallel_->sumClamp(words, header.size);
+    return VectorProcessor::sumClamp(words, header.size);
+}
+
+/**
+ * @brief Формирует ответ на вектор
+ * @details Без маски операций ответ - сумма с ограничением
+ *          (processVector(), в том числе параллельная), иначе - значения
+ *          операций VectorProcessor::reduce() за один проход по данным.
+ * @param vector Буфер с данными вектора
+ * @param header Заголовок вектора
+ * @param result Ответ
+ */
+void VectorHandler::computeResult(const PooledBuffer& vector, const VectorHeader& header,
+                                  VectorResult& result) {
+    if(!header.ops) {
+        result.setSum(processVector(vector, header));
+        return;
+    }
+    uint64_t values[VectorProcessor::REDUCE_MAX_VALUES];
+    result.setValues(values, VectorProcessor::reduce(header.type, header.ops, vector.data(),
+                                                     header.size, values));
+}
+
 /**
  * @brief Отправляет результат обработки вектора клиенту
  * @param client_fd Файловый дескриптор клиентского сокета
@@ -147,5 +1199,5 @@ int32_t VectorHandler::processVector(const std::vector<uint32_t>& vector) {
  * @note Результат отправляется в сетевом порядке байт
  */
 bool VectorHandler::sendResult(int client_fd, int32_t result) {
-    return NetworkUtils::sendNetworkUint32(client_fd, result);
+    return io_.sendAll(client_fd, &result, sizeof(result));
 }
\ No newline at end of file
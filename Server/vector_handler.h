@@ -3,8 +3,92 @@
 
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <semaphore>
+#include <vector>
 #include "logger.h"
 #include "vector_processor.h"
+#include "socket_io.h"
+#include "result_batcher.h"
+#include "buffered_socket_reader.h"
+#include "buffer_pool.h"
+
+class ParallelSum;
+class ThreadPool;
+
+/**
+ * @struct VectorHeader
+ * @brief Разобранный заголовок размера вектора
+ * @details Младшие 24 бита заголовка - количество элементов, биты 24-30 -
+ *          код ElementType, бит 31 - за заголовком следует маска операций
+ *          ReduceOp (uint32_t). Заголовок без флага и с кодом 0 (uint32_t)
+ *          совпадает с исходным протоколом.
+ */
+struct VectorHeader {
+    uint32_t size = 0;                   ///< Количество элементов
+    ElementType type = ElementType::U32; ///< Тип элементов
+    bool has_ops = false;                ///< За заголовком следует маска операций
+    uint32_t ops = 0;                    ///< Маска операций (0 - сумма с ограничением int32_t)
+    
+    /// Размер данных вектора в байтах
+    size_t bytes() const { return size * VectorProcessor::elementSize(type); }
+};
+
+/**
+ * @struct VectorResult
+ * @brief Ответ на вектор: сумма int32_t или 64-битные значения операций свертки
+ */
+struct VectorResult {
+    int32_t words[2 * VectorProcessor::REDUCE_MAX_VALUES]; ///< Ответ в виде 32-битных слов
+    uint32_t count = 0;                                    ///< Количество слов
+    
+    /// Ответ исходного протокола
+    void setSum(int32_t sum) { words[0] = sum; count = 1; }
+    
+    /// Ответ операций свертки
+    void setValues(const uint64_t* values, size_t n) {
+        std::memcpy(words, values, n * sizeof(uint64_t));
+        count = static_cast<uint32_t>(2 * n);
+    }
+    
+    /// Размер ответа в байтах
+    size_t bytes() const { return count * sizeof(int32_t); }
+};
+
+/**
+ * @enum BatchFormat
+ * @brief Формат пакета векторов (флаги слова количества векторов)
+ */
+enum class BatchFormat {
+    Lockstep, ///< Исходный протокол: заголовок, данные и ответ каждого вектора по очереди
+    Bulk,     ///< Пакет v2 (BULK_FLAG): таблица размеров и единый блок данных
+    Tagged    ///< Задания с идентификаторами (TAGGED_FLAG): ответы по готовности
+};
+
+/**
+ * @struct BatchHeader
+ * @brief Разобранное слово количества векторов
+ */
+struct BatchHeader {
+    uint32_t count = 0;                         ///< Количество векторов
+    BatchFormat format = BatchFormat::Lockstep; ///< Формат пакета
+    bool keep_alive = false;                    ///< После пакета сеанс ждет следующий
+};
+
+/**
+ * @struct BulkTable
+ * @brief Разобранная таблица размеров пакета v2 (BULK_FLAG)
+ * @details Данные всех векторов пакета идут одним блоком подряд, без
+ *          заголовков и выравнивания; offsets - смещения векторов в блоке.
+ */
+struct BulkTable {
+    std::vector<VectorHeader> headers; ///< Заголовки векторов (без масок операций)
+    std::vector<size_t> offsets;       ///< Смещения данных векторов (байт), последнее - размер блока
+    
+    /// Размер блока данных пакета в байтах
+    size_t bytes() const { return offsets.empty() ? 0 : offsets.back(); }
+};
 
 /**
  * @class VectorHandler
@@ -12,27 +96,121 @@
  */
 class VectorHandler {
 public:
+    /// Минимальный размер вектора (элементов), суммируемого параллельно с чтением следующего
+    static constexpr size_t PIPELINE_MIN_SIZE = 65536;
+    /// Размер порции (байт) при потоковом чтении векторов
+    static constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;
+    /// Наибольший размер вектора (элементов), суммируемого в серии коротких векторов
+    static constexpr uint32_t SMALL_VECTOR_MAX_SIZE = 16;
+    /// Наибольшее количество векторов в серии
+    static constexpr uint32_t SMALL_RUN_MAX = 4096;
+    /// Сдвиг кода типа элементов в заголовке размера вектора
+    static constexpr unsigned ELEMENT_TYPE_SHIFT = 24;
+    /// Маска количества элементов в заголовке размера вектора
+    static constexpr uint32_t VECTOR_SIZE_MASK = (1u << ELEMENT_TYPE_SHIFT) - 1;
+    /// Маска кода типа элементов (после сдвига)
+    static constexpr uint32_t ELEMENT_TYPE_MASK = 0x7F;
+    /// Флаг заголовка: за ним следует маска операций ReduceOp
+    static constexpr uint32_t OPERATIONS_FLAG = 1u << 31;
+    /// Флаг количества векторов: пакет v2 (таблица размеров и единый блок данных)
+    static constexpr uint32_t BULK_FLAG = 1u << 31;
+    /// Наибольший размер блока данных пакета v2 (байт) - как у вектора uint64_t наибольшего размера
+    static constexpr size_t BULK_MAX_BYTES = 80000000;
+    /// Флаг количества векторов: задания с идентификаторами и ответами по готовности
+    static constexpr uint32_t TAGGED_FLAG = 1u << 30;
+    /// Потоков пула заданий сервера для заданий с идентификаторами
+    static constexpr size_t TAGGED_COMPUTE_THREADS = 2;
+    /// Наибольшее количество больших заданий, ожидающих вычисления (ограничивает память сеанса)
+    static constexpr size_t TAGGED_MAX_IN_FLIGHT = 8;
+    /// Наибольшее количество больших заданий всех сеансов в пуле заданий (ограничивает память сервера)
+    static constexpr size_t TAGGED_MAX_IN_FLIGHT_TOTAL = 32;
+    /// Наибольший размер ответа на задание (слов): идентификатор и ответ на вектор
+    static constexpr size_t TAGGED_FRAME_WORDS = 1 + 2 * VectorProcessor::REDUCE_MAX_VALUES;
+    /// Флаг количества векторов: после пакета сеанс не закрывается и ждет следующий
+    static constexpr uint32_t KEEP_ALIVE_FLAG = 1u << 29;
+    /// Слово количества векторов, завершающее сеанс keep-alive
+    static constexpr uint32_t END_OF_SESSION = 0;
+    /// Таймаут ожидания следующего пакета в сеансе keep-alive по умолчанию, мс
+    static constexpr int DEFAULT_IDLE_TIMEOUT_MS = 30000;
+    
     /**
      * @brief Конструктор обработчика векторов
      * @param logger Логгер для записи событий
+     * @param io Реализация ввода-вывода (nullptr - обычные recv()/send())
+     * @param reader Буфер чтения соединения (nullptr - собственный буфер)
      */
-    explicit VectorHandler(Logger& logger);
+    explicit VectorHandler(Logger& logger, SocketIo* io = nullptr,
+                           BufferedSocketReader* reader = nullptr);
     
     /**
-     * @brief Основной метод обработки векторов
+     * @brief Основной метод обработки векторов (один пакет или сеанс keep-alive)
      * @param client_fd Файловый дескриптор клиентского сокета
      * @param login Логин аутентифицированного пользователя
      * @throw std::runtime_error при ошибках обработки
      */
     void process(int client_fd, const std::string& login);
     
+    /**
+     * @brief Включение конвейерного режима process()
+     * @param enabled true - суммирование вектора параллельно с чтением следующего
+     */
+    void setPipeline(bool enabled) { pipeline_ = enabled; }
+    
+    /**
+     * @brief Включение потокового режима process()
+     * @param enabled true - векторы суммируются порциями STREAM_CHUNK_SIZE по мере чтения
+     */
+    void setStreaming(bool enabled) { streaming_ = enabled; }
+    
+    /**
+     * @brief Накопление результатов перед отправкой (кроме конвейерного режима)
+     * @param policy Политика отправки; max_results == 0 - отправка каждого результата
+     */
+    void setBatching(const FlushPolicy& policy) { results_.setPolicy(policy); }
+    
+    /**
+     * @brief Параллельное суммирование больших векторов (кроме потокового режима)
+     * @param sum Пул вычислительных потоков; nullptr - суммирование в потоке сеанса
+     */
+    void setParallelSum(ParallelSum* sum) { parallel_ = sum; }
+    
+    /**
+     * @brief Общий пул заданий сеансов (конвейерный режим, большие задания с идентификаторами)
+     * @param pool Пул сервера; nullptr - векторы считаются в потоке сеанса
+     * @param tagged_slots Общий для сеансов счетчик больших заданий с идентификаторами
+     *        (TAGGED_MAX_IN_FLIGHT_TOTAL); nullptr - только ограничение сеанса
+     */
+    void setJobPool(ThreadPool* pool, std::counting_semaphore<>* tagged_slots = nullptr) {
+        jobs_ = pool;
+        tagged_slots_ = tagged_slots;
+    }
+    
+    /**
+     * @brief Пул буферов векторов сеанса
+     * @param pool Пул (по умолчанию BufferPool::shared(); у шарда - свой)
+     * @note Вызывается до обработки векторов: буферы обработчика пересоздаются в pool
+     */
+    void setBufferPool(BufferPool& pool);
+    
+    /**
+     * @brief Пул буферов векторов сеанса
+     */
+    BufferPool& bufferPool() const { return *buffer_pool_; }
+    
+    /**
+     * @brief Таймаут ожидания следующего пакета в сеансе keep-alive
+     * @param ms Таймаут в миллисекундах (не больше 0 - без ограничения)
+     */
+    void setIdleTimeout(int ms) { idle_timeout_ms_ = ms; }
+    
     /**
      * @brief Чтение вектора из сокета
      * @param client_fd Файловый дескриптор клиентского сокета
-     * @param vector Ссылка на вектор для записи данных
+     * @param vector Буфер для записи данных
+     * @param header Разобранный заголовок вектора
      * @return true если чтение успешно, false в противном случае
      */
-    bool readVector(int client_fd, std::vector<uint32_t>& vector);
+    bool readVector(int client_fd, PooledBuffer& vector, VectorHeader& header);
     
     /**
      * @brief Обработка одного вектора
@@ -41,6 +219,37 @@ public:
      */
     int32_t processVector(const std::vector<uint32_t>& vector);
     
+    /**
+     * @brief Обработка вектора из буфера пула
+     * @param vector Буфер с данными вектора
+     * @return Результат обработки (сумма с ограничением)
+     */
+    int32_t processVector(const PooledBuffer& vector);
+    
+    /**
+     * @brief Обработка вектора с элементами типа из заголовка
+     * @param vector Буфер с данными вектора
+     * @param header Заголовок вектора
+     * @return Результат обработки (сумма с ограничением)
+     */
+    int32_t processVector(const PooledBuffer& vector, const VectorHeader& header);
+    
+    /**
+     * @brief Ответ на вектор: сумма или результаты операций header.ops
+     * @param vector Буфер с данными вектора
+     * @param header Заголовок вектора
+     * @param result Ответ
+     */
+    void computeResult(const PooledBuffer& vector, const VectorHeader& header, VectorResult& result);
+    
+    /**
+     * @brief Суммы с ограничением для всех векторов пакета v2
+     * @param payload Блок данных пакета
+     * @param table Таблица размеров пакета
+     * @param results Суммы (table.headers.size() значений)
+     */
+    void computeBulk(const PooledBuffer& payload, const BulkTable& table, int32_t* results);
+    
     /**
      * @brief Отправка результата клиенту
      * @param client_fd Файловый дескриптор клиентского сокета
@@ -49,30 +258,285 @@ public:
      */
     bool sendResult(int client_fd, int32_t result);
     
+    /**
+     * @brief Валидация количества векторов
+     * @param count Проверяемое количество
+     * @return true если количество допустимо, false в противном случае
+     */
+    static bool validateVectorCount(uint32_t count);
+    
+    /**
+     * @brief Разбор и проверка слова количества векторов
+     * @param raw Слово из сокета
+     * @param batch Количество векторов, формат (BULK_FLAG, TAGGED_FLAG) и KEEP_ALIVE_FLAG
+     * @return true если количество допустимо и формат задан не больше чем одним флагом
+     */
+    static bool parseVectorCount(uint32_t raw, BatchHeader& batch);
+    
+    /**
+     * @brief Ответ на задание: идентификатор и ответ на вектор подряд
+     * @param id Идентификатор задания
+     * @param result Ответ на вектор
+     * @param frame Буфер ответа (TAGGED_FRAME_WORDS слов)
+     * @return Размер ответа в байтах
+     */
+    static size_t taggedFrame(uint32_t id, const VectorResult& result, uint32_t* frame);
+    
+    /**
+     * @brief Разбор и проверка таблицы размеров пакета v2
+     * @param raw Заголовки векторов из сокета
+     * @param count Количество векторов
+     * @param table Разобранная таблица
+     * @return true если все заголовки допустимы и блок данных не больше BULK_MAX_BYTES
+     */
+    static bool parseSizeTable(const uint32_t* raw, uint32_t count, BulkTable& table);
+    
+    /**
+     * @brief Текст ошибки для недопустимой таблицы размеров (для логирования)
+     * @param raw Заголовки векторов из сокета
+     * @param count Количество векторов
+     */
+    static std::string invalidTableMessage(const uint32_t* raw, uint32_t count);
+    
+    /**
+     * @brief Валидация размера вектора
+     * @param size Проверяемый размер
+     * @return true если размер допустим, false в противном случае
+     */
+    static bool validateVectorSize(uint32_t size);
+    
+    /**
+     * @brief Разбор и проверка заголовка размера вектора
+     * @param raw Заголовок из сокета
+     * @param header Разобранный заголовок
+     * @return true если размер и тип элементов допустимы
+     */
+    static bool parseVectorHeader(uint32_t raw, VectorHeader& header);
+    
+    /**
+     * @brief Текст ошибки для недопустимого заголовка (для логирования)
+     * @param raw Заголовок из сокета
+     */
+    static std::string invalidHeaderMessage(uint32_t raw);
+    
+    /**
+     * @brief Разбор и проверка маски операций, следующей за заголовком с OPERATIONS_FLAG
+     * @param raw Маска из сокета
+     * @param header Заголовок (размер уже разобран); заполняется ops
+     * @return true если маска допустима для вектора
+     */
+    static bool parseOperations(uint32_t raw, VectorHeader& header);
+    
+    /**
+     * @brief Текст ошибки для недопустимой маски операций (для логирования)
+     * @param raw Маска из сокета
+     */
+    static std::string invalidOperationsMessage(uint32_t raw);
+    
+    /**
+     * @brief Начало пакета векторов (логирование и сброс статистики)
+     * @param login Логин аутентифицированного пользователя
+     * @param count Количество векторов в пакете
+     */
+    void beginBatch(const std::string& login, uint32_t count);
+    
+    /**
+     * @brief Учет обработанного вектора (статистика и логирование прогресса)
+     * @param index Индекс обработанного вектора
+     * @param size Количество элементов вектора
+     */
+    void vectorDone(uint32_t index, size_t size);
+    
+    /**
+     * @brief Завершение пакета векторов (логирование итоговой статистики)
+     */
+    void endBatch();
+    
 private:
     Logger& logger_; ///< Ссылка на объект логгера
+    SocketIo& io_;   ///< Реализация ввода-вывода через сокет
+    std::unique_ptr<BufferedSocketReader> own_reader_; ///< Собственный буфер чтения (если не передан)
+    BufferedSocketReader& reader_; ///< Буфер чтения соединения
+    bool pipeline_ = false;  ///< Конвейерный режим process()
+    bool streaming_ = false; ///< Потоковый режим process()
+    ParallelSum* parallel_ = nullptr; ///< Пул параллельного суммирования (может отсутствовать)
+    ThreadPool* jobs_ = nullptr;      ///< Пул заданий сеансов (может отсутствовать)
+    std::counting_semaphore<>* tagged_slots_ = nullptr; ///< Места больших заданий всех сеансов (может отсутствовать)
+    BufferPool* buffer_pool_ = &BufferPool::shared(); ///< Пул буферов векторов
+    int idle_timeout_ms_ = DEFAULT_IDLE_TIMEOUT_MS; ///< Таймаут ожидания следующего пакета, мс
+    ResultBatcher results_;  ///< Буфер исходящих результатов
+    
+    PooledBuffer small_data_;             ///< Данные серии коротких векторов
+    std::vector<uint32_t> small_offsets_; ///< Границы векторов серии
+    std::vector<int32_t> small_results_;  ///< Результаты серии
+    
+    std::vector<uint32_t> bulk_raw_;      ///< Таблица размеров пакета v2 из сокета
+    BulkTable bulk_table_;                ///< Разобранная таблица размеров пакета v2
+    std::vector<int32_t> bulk_results_;   ///< Результаты пакета v2
+    PooledBuffer bulk_aligned_;           ///< Выровненная копия вектора пакета v2 с невыровненным смещением
+    
+    std::string login_;        ///< Логин владельца текущего пакета
+    uint32_t vec_count_ = 0;   ///< Количество векторов в текущем пакете
+    size_t total_vectors_ = 0; ///< Обработано векторов в текущем пакете
+    size_t total_numbers_ = 0; ///< Обработано чисел в текущем пакете
+    
+    /**
+     * @brief Обработка одного пакета в формате из слова количества
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param login Логин аутентифицированного пользователя
+     * @param batch Разобранное слово количества векторов
+     * @throw std::runtime_error при ошибках обработки
+     */
+    void processBatch(int client_fd, const std::string& login, const BatchHeader& batch);
+    
+    /**
+     * @brief Ожидание слова количества следующего пакета сеанса keep-alive
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param raw Прочитанное слово
+     * @return false если клиент закрыл соединение или истек таймаут простоя
+     * @throw std::runtime_error при ошибке чтения
+     */
+    bool readNextBatch(int client_fd, uint32_t& raw);
+    
+    /**
+     * @brief Конвейерная обработка: чтение вектора i+1 во время суммирования вектора i
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param login Логин аутентифицированного пользователя
+     * @param vec_count Количество векторов в пакете
+     * @throw std::runtime_error при ошибках обработки
+     */
+    void processPipelined(int client_fd, const std::string& login, uint32_t vec_count);
+    
+    /**
+     * @brief Обработка пакета v2: таблица размеров, одно чтение данных, одна отправка ответов
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param login Логин аутентифицированного пользователя
+     * @param vec_count Количество векторов в пакете
+     * @throw std::runtime_error при ошибках обработки
+     */
+    void processBulk(int client_fd, const std::string& login, uint32_t vec_count);
+    
+    /**
+     * @brief Обработка заданий с идентификаторами: большие векторы считаются
+     *        параллельно, ответы отправляются по готовности
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param login Логин аутентифицированного пользователя
+     * @param vec_count Количество заданий
+     * @throw std::runtime_error при ошибках обработки
+     */
+    void processTagged(int client_fd, const std::string& login, uint32_t vec_count);
+    
+    /**
+     * @brief Короткий ли вектор (допустимый размер до SMALL_VECTOR_MAX_SIZE)
+     * @param size Размер из заголовка
+     */
+    static bool isSmallVector(uint32_t size);
+    
+    /**
+     * @brief Обработка серии коротких векторов, уже лежащих в буфере чтения
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param first Индекс первого вектора серии
+     * @param size Размер первого вектора; на выходе - размер следующего
+     * @return Количество обработанных векторов
+     * @throw std::runtime_error при ошибках чтения/записи
+     */
+    uint32_t processSmallRun(int client_fd, uint32_t first, uint32_t& size);
+    
+    /**
+     * @brief Потоковая обработка: векторы суммируются порциями без буферизации целиком
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param login Логин аутентифицированного пользователя
+     * @param vec_count Количество векторов в пакете
+     * @throw std::runtime_error при ошибках обработки
+     */
+    void processStreaming(int client_fd, const std::string& login, uint32_t vec_count);
+    
+    /**
+     * @brief Чтение данных вектора порциями с суммированием или сверткой
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param raw Заголовок размера вектора
+     * @param chunk Буфер порции (STREAM_CHUNK_SIZE байт)
+     * @param result Ответ на вектор
+     * @param header Разобранный заголовок вектора
+     * @return true если заголовок допустим и данные прочитаны
+     */
+    bool readVectorResult(int client_fd, uint32_t raw, PooledBuffer& chunk, VectorResult& result,
+                          VectorHeader& header);
+    
+    /**
+     * @brief Разбор заголовка и чтение маски операций, если она объявлена
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param raw Заголовок размера вектора
+     * @param header Разобранный заголовок
+     * @return false для недопустимого заголовка или маски (ошибка логируется)
+     */
+    bool readHeader(int client_fd, uint32_t raw, VectorHeader& header);
+    
+    /**
+     * @brief Отправка ответов на векторы и чтение заголовка следующего
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param index Индекс первого вектора
+     * @param vectors Количество векторов
+     * @param words Ответы векторов подряд (32-битные слова)
+     * @param n Количество слов
+     * @param more Есть ли следующий вектор
+     * @param next_size Размер следующего вектора (читается, если more)
+     * @throw std::runtime_error при ошибке отправки или чтения
+     */
+    void finishVectors(int client_fd, uint32_t index, uint32_t vectors, const int32_t* words,
+                       size_t n, bool more, uint32_t& next_size);
     
     /**
-     * @brief Чтение количества векторов
+     * @brief Отправка накопленных результатов, если чтения need байт придется ждать
      * @param client_fd Файловый дескриптор клиентского сокета
-     * @return Количество векторов для обработки
+     * @param need Количество байт, которое будет прочитано
+     * @return false при ошибке отправки
+     */
+    bool flushBeforeRead(int client_fd, size_t need);
+    
+    /**
+     * @brief Проверка слова количества векторов
+     * @param raw Слово количества векторов
+     * @return Разобранное слово количества
      * @throw std::runtime_error при неверном количестве
      */
-    uint32_t readVectorCount(int client_fd);
+    BatchHeader checkVectorCount(uint32_t raw);
     
     /**
-     * @brief Валидация количества векторов
-     * @param count Проверяемое количество
-     * @return true если количество допустимо, false в противном случае
+     * @brief Сумма с ограничением для данных вектора по указателю
+     * @param data Данные вектора (адрес выровнен по размеру элемента)
+     * @param header Заголовок вектора
+     * @return Сумма с ограничением
      */
-    bool validateVectorCount(uint32_t count);
+    int32_t sumVector(const void* data, const VectorHeader& header);
     
     /**
-     * @brief Валидация размера вектора
-     * @param size Проверяемый размер
-     * @return true если размер допустим, false в противном случае
+     * @brief Данные векторов first..last-1 пакета v2, выровненные по размеру элемента
+     * @param base Начало блока данных
+     * @param table Таблица размеров пакета
+     * @param first Первый вектор
+     * @param last Вектор после последнего
+     * @return Указатель в блок или на копию в bulk_aligned_
+     */
+    const void* alignedBulkData(const char* base, const BulkTable& table, size_t first, size_t last);
+    
+    /**
+     * @brief Чтение 32-битного заголовка через io_
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @return Прочитанное значение
+     * @throw std::runtime_error при ошибке чтения
+     */
+    uint32_t readUint32(int client_fd);
+    
+    /**
+     * @brief Чтение данных вектора известного размера
+     * @param client_fd Файловый дескриптор клиентского сокета
+     * @param raw Заголовок размера вектора
+     * @param vector Буфер для записи данных
+     * @param header Разобранный заголовок вектора
+     * @return true если заголовок допустим и данные прочитаны
      */
-    bool validateVectorSize(uint32_t size);
+    bool readVectorData(int client_fd, uint32_t raw, PooledBuffer& vector, VectorHeader& header);
 };
 
 #endif
\ No newline at end of file
@@ -1,20 +1,771 @@
 #include "vector_processor.h"
+#include "sum_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <atomic>
 #include <limits>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+/// Порог векторного ядра (SumThresholds::simd_min)
+std::atomic<size_t> simd_min{SumThresholds().simd_min};
+/// Порог параллельного суммирования (SumThresholds::parallel_min)
+std::atomic<size_t> parallel_min{SumThresholds().parallel_min};
+
+/// Смещение ключа int32_t: порядок знаковых элементов сохраняется в беззнаковых ключах
+const uint32_t I32_BIAS = 0x80000000u;
+
+/**
+ * @brief Ключ нулевого элемента
+ * @param type Тип элементов
+ * @return I32_BIAS для int32_t, иначе 0
+ */
+uint32_t zeroKey(ElementType type) {
+    return type == ElementType::I32 ? I32_BIAS : 0;
+}
+
+/**
+ * @brief Сдвиг ключа до номера корзины гистограммы
+ * @details Корзины делят диапазон типа на 16 равных долей: 4 старших бита
+ *          элемента uint8_t, uint16_t, uint32_t, uint64_t и int32_t (со
+ *          смещением). Элементы uint64_t сдвигаются без приведения к ключам.
+ * @param type Тип элементов
+ * @return Сдвиг
+ */
+unsigned histogramShift(ElementType type) {
+    switch (type) {
+    case ElementType::U8:  return 4;
+    case ElementType::U16: return 12;
+    case ElementType::U64: return 60;
+    case ElementType::U32:
+    case ElementType::I32: break;
+    }
+    return 28;
+}
+
+/**
+ * @brief Значение элемента по ключу
+ * @param type Тип элементов
+ * @param key Ключ
+ * @return Элемент
+ */
+int64_t keyValue(ElementType type, uint32_t key) {
+    if (type == ElementType::I32)
+        return static_cast<int32_t>(key ^ I32_BIAS);
+    return key;
+}
+
+/**
+ * @brief Ключи элементов типа T
+ * @param data Элементы
+ * @param count Количество элементов
+ * @param keys Ключи
+ */
+template <typename T>
+void toKeys(const T* data, size_t count, uint32_t* keys) {
+    for (size_t i = 0; i < count; ++i) {
+        if constexpr (std::is_same_v<T, int32_t>)
+            keys[i] = static_cast<uint32_t>(data[i]) ^ I32_BIAS;
+        else
+            keys[i] = data[i];
+    }
+}
+
+/**
+ * @brief Ключи элементов типа, известного во время выполнения
+ * @details Элементы uint32_t копируются как есть; uint64_t не приводятся
+ *          к ключам (их сворачивает reduceWide()).
+ * @param type Тип элементов
+ * @param data Элементы
+ * @param count Количество элементов
+ * @param keys Ключи
+ */
+void typedKeys(ElementType type, const void* data, size_t count, uint32_t* keys) {
+    switch (type) {
+    case ElementType::U8:
+        toKeys(static_cast<const uint8_t*>(data), count, keys);
+        break;
+    case ElementType::U16:
+        toKeys(static_cast<const uint16_t*>(data), count, keys);
+        break;
+    case ElementType::I32:
+        toKeys(static_cast<const int32_t*>(data), count, keys);
+        break;
+    case ElementType::U32:
+        std::memcpy(keys, data, count * sizeof(uint32_t));
+        break;
+    case ElementType::U64:
+        break;
+    }
+}
+
+/**
+ * @brief Точная сумма элементов
+ * @param st Состояние свертки
+ * @return Сумма ключей без смещения int32_t (для uint64_t - сумма элементов)
+ */
+__int128 exactSum(const VectorProcessor::ReduceState& st) {
+    if (st.type == ElementType::U64)
+        return static_cast<__int128>(st.wide.sum);
+    int64_t sum = static_cast<int64_t>(st.stats.sum);
+    if (st.type == ElementType::I32)
+        sum -= static_cast<int64_t>(st.count) * static_cast<int64_t>(I32_BIAS);
+    return sum;
+}
+
+/**
+ * @brief Записывает double в 64-битное значение результата
+ * @param value Число
+ * @return Биты IEEE 754
+ */
+uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Сумма с ограничением [0, 2^31-1] (ReduceOp::Sum)
+ * @details Для uint64_t совпадает с sumClampAs(): элемент от 2^31 и так
+ *          насыщает сумму. Для int32_t ограничение действует на каждом
+ *          элементе, поэтому сумма берется из ReduceState::clamped, а не
+ *          из ядра статистики.
+ * @param st Состояние свертки
+ * @param out Значение
+ */
+void finishSum(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    if (st.type == ElementType::I32) {
+        out[0] = static_cast<uint64_t>(VectorProcessor::sumFinish(st.clamped));
+        return;
+    }
+    __int128 limit = std::numeric_limits<int32_t>::max();
+    out[0] = static_cast<uint64_t>(std::clamp<__int128>(exactSum(st), 0, limit));
+}
+
+/**
+ * @brief Наименьший элемент (ReduceOp::Min)
+ * @param st Состояние свертки
+ * @param out Значение (int64_t; для uint64_t - uint64_t)
+ */
+void finishMin(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    if (st.type == ElementType::U64)
+        out[0] = st.wide.min;
+    else
+        out[0] = static_cast<uint64_t>(keyValue(st.type, st.stats.min));
+}
+
+/**
+ * @brief Наибольший элемент (ReduceOp::Max)
+ * @param st Состояние свертки
+ * @param out Значение (int64_t; для uint64_t - uint64_t)
+ */
+void finishMax(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    if (st.type == ElementType::U64)
+        out[0] = st.wide.max;
+    else
+        out[0] = static_cast<uint64_t>(keyValue(st.type, st.stats.max));
+}
+
+/**
+ * @brief Количество ненулевых элементов (ReduceOp::CountNonzero)
+ * @param st Состояние свертки
+ * @param out Значение
+ */
+void finishNonzero(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    out[0] = st.count - st.stats.zeros;
+}
+
+/**
+ * @brief Среднее арифметическое (ReduceOp::Mean)
+ * @param st Состояние свертки
+ * @param out Значение (double)
+ */
+void finishMean(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    out[0] = doubleBits(st.count ? static_cast<double>(exactSum(st)) / static_cast<double>(st.count) : 0.0);
+}
+
+/**
+ * @brief Скалярное произведение пар
+ * @details Ядро накапливает точную сумму произведений ключей
+ *          (hi * 2^32 + lo). Для int32_t ключ равен a + 2^31, поэтому
+ *          a*b = a'b' - 2^31(a' + b') + 2^62; поправка считается в 128 битах.
+ *          Для uint64_t - hi * 2^64 + lo накопителей WideStats.
+ * @param st Состояние свертки
+ * @param out Значение (double)
+ */
+void finishDot(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    if (st.type == ElementType::U64) {
+        out[0] = doubleBits(std::ldexp(static_cast<double>(st.wide.dot_hi), 64) +
+                            static_cast<double>(st.wide.dot_lo));
+        return;
+    }
+    __int128 dot = (static_cast<__int128>(st.dot.hi) << 32) + st.dot.lo;
+    if (st.type == ElementType::I32) {
+        __int128 pairs = static_cast<__int128>(st.count / 2);
+        dot -= static_cast<__int128>(I32_BIAS) * (static_cast<__int128>(st.dot.even) + st.dot.odd);
+        dot += pairs * (static_cast<__int128>(1) << 62);
+    }
+    out[0] = doubleBits(static_cast<double>(dot));
+}
+
+/**
+ * @brief Корзины гистограммы (ReduceOp::Histogram)
+ * @param st Состояние свертки
+ * @param out 16 значений
+ */
+void finishHistogram(const VectorProcessor::ReduceState& st, uint64_t* out) {
+    std::copy(std::begin(st.bins), std::end(st.bins), out);
+}
+
+/**
+ * @brief Добавляет пары ключей к скалярному произведению
+ * @details Элемент без пары в конце порции сохраняется в состоянии
+ *          и составляет пару с первым элементом следующей порции.
+ * @param st Состояние свертки
+ * @param kernel Ядро скалярного произведения
+ * @param keys Ключи порции
+ * @param count Количество ключей
+ */
+void reduceDot(VectorProcessor::ReduceState& st, ReduceKernels::DotKernel kernel,
+               const uint32_t* keys, size_t count) {
+    if (st.pending && count > 0) {
+        uint32_t pair[2] = {st.pending_key, keys[0]};
+        kernel(pair, 1, st.dot);
+        st.pending = false;
+        ++keys;
+        --count;
+    }
+    kernel(keys, count / 2, st.dot);
+    if (count % 2) {
+        st.pending = true;
+        st.pending_key = keys[count - 1];
+    }
+}
+
+/**
+ * @brief Добавляет порцию элементов uint64_t ко всем операциям свертки
+ * @details Ключи uint32_t не вмещают диапазон uint64_t, поэтому элементы
+ *          сворачиваются скалярным проходом по 64-битным значениям: минимум,
+ *          максимум и гистограмма - по самим элементам, сумма и скалярное
+ *          произведение - точно в 128 битах. Данные из буфера порции могут
+ *          быть не выровнены и читаются через memcpy.
+ * @param st Состояние свертки
+ * @param bytes Элементы порции
+ * @param count Количество элементов
+ */
+void reduceWide(VectorProcessor::ReduceState& st, const unsigned char* bytes, size_t count) {
+    VectorProcessor::WideStats& w = st.wide;
+    const unsigned shift = histogramShift(ElementType::U64);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t v;
+        std::memcpy(&v, bytes + i * sizeof(v), sizeof(v));
+        if (st.passes & VectorProcessor::REDUCE_PASS_STATS) {
+            w.sum += v;
+            w.min = std::min(w.min, v);
+            w.max = std::max(w.max, v);
+            st.stats.zeros += v == 0;
+        }
+        if (st.passes & VectorProcessor::REDUCE_PASS_DOT) {
+            if (st.pending) {
+                unsigned __int128 product = static_cast<unsigned __int128>(w.pending) * v;
+                w.dot_lo += static_cast<uint64_t>(product);
+                w.dot_hi += static_cast<uint64_t>(product >> 64);
+            } else {
+                w.pending = v;
+            }
+            st.pending = !st.pending;
+        }
+        if (st.passes & VectorProcessor::REDUCE_PASS_HISTOGRAM)
+            ++st.bins[v >> shift];
+    }
+}
+
+/**
+ * @brief Добавляет блок int32_t к сумме с ограничением на каждом элементе
+ * @details Семантика sumClamp(): сумма не опускается ниже 0, а превышение
+ *          2^31-1 насыщает ее. Если сумма отрицательных элементов блока не
+ *          опускает acc ниже 0, ни одна частичная сумма не опускается, а
+ *          если сумма положительных не поднимает acc выше 2^31-1 - не
+ *          поднимается; тогда блок добавляется суммой ядра sum. Иначе блок
+ *          проходится поэлементно.
+ * @param acc Сумма в диапазоне [0, 2^31-1]
+ * @param data Элементы блока
+ * @param count Количество элементов (не больше SUM_BLOCK)
+ * @param sum Сумма элементов блока
+ * @return false, если сумма насыщена
+ */
+bool addSignedBlock(int64_t& acc, const int32_t* data, size_t count, int64_t sum) {
+    const int64_t limit = std::numeric_limits<int32_t>::max();
+    int64_t negative = 0;
+    for (size_t i = 0; i < count; ++i)
+        negative += std::min(data[i], 0);
+    if (acc + negative >= 0 && acc + (sum - negative) <= limit) {
+        acc += sum;
+        return true;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        acc += data[i];
+        if (acc < 0) acc = 0;
+        if (acc > limit) return false;
+    }
+    return true;
+}
+}
 
 int32_t VectorProcessor::sumClamp(const std::vector<uint32_t>& v) {
-    int64_t acc = 0;  // Используем 64-бит для избежания переполнения
+    return sumClamp(v.data(), v.size());
+}
+
+/**
+ * @brief Суммирует элементы массива с контролем переполнения
+ * @details Используется для буферов, не являющихся std::vector
+ *          (PooledBuffer).
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма элементов в диапазоне [0, 2^31-1]
+ */
+int32_t VectorProcessor::sumClamp(const uint32_t* data, size_t count) {
+    SumState st;
+    sumInit(st);
+    sumUpdate(st, data, count);
+    return sumFinish(st);
+}
+
+/**
+ * @brief Суммирует много коротких векторов одним проходом
+ * @details Вызов sumClamp() на вектор из 1-16 элементов почти целиком
+ *          состоит из накладных расходов и плохо предсказуемых ветвлений
+ *          по длине. Здесь один линейный проход строит 64-битные
+ *          префиксные суммы всей полезной нагрузки, после чего сумма
+ *          каждого вектора - разность двух префиксов; ядро отрезков
+ *          SumKernels (AVX2/AVX-512 gather) считает и ограничивает эти
+ *          разности по 4-8 векторов без ветвлений. Префиксы не
+ *          переполняются: 2^31 элементов по 2^32-1 меньше 2^64.
+ * @param data Элементы всех векторов подряд
+ * @param offsets Границы векторов (segments + 1 значение по неубыванию)
+ * @param segments Количество векторов
+ * @param results Суммы векторов в диапазоне [0, 2^31-1]
+ * @note Буфер префиксов принадлежит потоку и растет до наибольшей
+ *       нагрузки, поэтому повторные вызовы не выделяют память
+ */
+void VectorProcessor::sumClampSegments(const uint32_t* data, const uint32_t* offsets,
+                                       size_t segments, int32_t* results) {
+    if(segments == 0)
+        return;
+    
+    thread_local std::vector<uint64_t> prefix;
+    size_t total = offsets[segments];
+    if(prefix.size() < total + 1)
+        prefix.resize(total + 1);
+    
+    uint64_t acc = 0;
+    prefix[0] = 0;
+    for(size_t i = 0; i < total; ++i) {
+        acc += data[i];
+        prefix[i + 1] = acc;
+    }
+    SumKernels::activeSegmentKernel()(prefix.data(), offsets, segments, results);
+}
+
+/**
+ * @brief Сбрасывает состояние потокового суммирования
+ * @param st Состояние суммирования
+ */
+void VectorProcessor::sumInit(SumState& st) {
+    st.acc = 0;
+    st.saturated = false;
+}
+
+/**
+ * @brief Добавляет порцию элементов к потоковой сумме
+ * @details Порция суммируется блоками по SUM_BLOCK элементов ядром
+ *          SumKernels (SSE4.2/AVX2/AVX-512, выбранным по CPUID; порции
+ *          короче порога SumThresholds::simd_min - скалярным), насыщение
+ *          проверяется после каждого блока, а не на каждом элементе.
+ *          Элементы неотрицательны, поэтому сумма монотонна и результат
+ *          совпадает с sumUpdateScalar(): после насыщения остаток может
+ *          только увеличить сумму. Результат не зависит от разбиения вектора
+ *          на порции: после насыщения (acc > INT32_MAX) порции игнорируются,
+ *          как и остаток вектора в sumClamp().
+ * @param st Состояние суммирования
+ * @param data Элементы порции
+ * @param count Количество элементов
+ */
+void VectorProcessor::sumUpdate(SumState& st, const uint32_t* data, size_t count) {
+    sumUpdateAs<uint32_t>(st, data, count);
+}
+
+/**
+ * @brief Добавляет порцию элементов типа T к потоковой сумме
+ * @details Как sumUpdate(), но с ядром SumKernels::kernelFor<T>(). Для
+ *          беззнаковых типов сумма монотонна и насыщение прекращает
+ *          суммирование. Для int32_t ограничение действует на каждом
+ *          элементе, как в sumClamp(): частичная сумма ниже 0 заменяется
+ *          нулем, а превышение 2^31-1 насыщает сумму ({-5, 3} дает 3,
+ *          {2^31-1, 10, -20} - 2^31-1). Блок, в котором ограничение не
+ *          срабатывает, добавляется суммой ядра (addSignedBlock()). Ядро uint64_t
+ *          ограничивает элементы значением 2^31, поэтому блок не переполняет
+ *          аккумулятор, а результат с ограничением не меняется.
+ * @param st Состояние суммирования
+ * @param data Элементы порции
+ * @param count Количество элементов
+ */
+template <typename T>
+void VectorProcessor::sumUpdateAs(SumState& st, const T* data, size_t count) {
+    if (st.saturated) return;
+    
+    SumKernels::KernelOf<T> kernel = strategy(count, false) == SumStrategy::Scalar
+                                   ? SumKernels::kernelFor<T>(SumKernels::Level::Scalar)
+                                   : SumKernels::kernelFor<T>(SumKernels::active());
+    int64_t acc = st.acc;
     
-    for (uint32_t x : v) {
-        acc += x;
+    for (size_t i = 0; i < count; i += SUM_BLOCK) {
+        size_t n = std::min(SUM_BLOCK, count - i);
+        int64_t sum = static_cast<int64_t>(kernel(data + i, n));
+        if constexpr (std::is_signed_v<T>) {
+            if (!addSignedBlock(acc, data + i, n, sum)) {
+                st.saturated = true;
+                break;
+            }
+        } else {
+            acc += sum;
+            if (acc > static_cast<int64_t>(std::numeric_limits<int32_t>::max())) {
+                st.saturated = true;
+                break;
+            }
+        }
+    }
+    
+    st.acc = acc;
+}
+
+/**
+ * @brief Суммирует элементы типа T с ограничением
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма в диапазоне [0, 2^31-1]
+ */
+template <typename T>
+int32_t VectorProcessor::sumClampAs(const T* data, size_t count) {
+    SumState st;
+    sumInit(st);
+    sumUpdateAs(st, data, count);
+    return sumFinish(st);
+}
+
+template void VectorProcessor::sumUpdateAs<uint8_t>(SumState&, const uint8_t*, size_t);
+template void VectorProcessor::sumUpdateAs<uint16_t>(SumState&, const uint16_t*, size_t);
+template void VectorProcessor::sumUpdateAs<uint32_t>(SumState&, const uint32_t*, size_t);
+template void VectorProcessor::sumUpdateAs<uint64_t>(SumState&, const uint64_t*, size_t);
+template void VectorProcessor::sumUpdateAs<int32_t>(SumState&, const int32_t*, size_t);
+template int32_t VectorProcessor::sumClampAs<uint8_t>(const uint8_t*, size_t);
+template int32_t VectorProcessor::sumClampAs<uint16_t>(const uint16_t*, size_t);
+template int32_t VectorProcessor::sumClampAs<uint32_t>(const uint32_t*, size_t);
+template int32_t VectorProcessor::sumClampAs<uint64_t>(const uint64_t*, size_t);
+template int32_t VectorProcessor::sumClampAs<int32_t>(const int32_t*, size_t);
+
+/**
+ * @brief Добавляет порцию элементов типа, заданного в заголовке вектора
+ * @details Данные приходят из сокета в буфер порции, поэтому для
+ *          uint64_t адрес может быть не кратен 8: векторные ядра читают
+ *          невыровненными загрузками, а x86 допускает и невыровненные
+ *          скалярные чтения.
+ * @param st Состояние суммирования
+ * @param type Тип элементов
+ * @param data Элементы порции
+ * @param count Количество элементов
+ */
+void VectorProcessor::sumUpdateTyped(SumState& st, ElementType type, const void* data, size_t count) {
+    switch (type) {
+    case ElementType::U8:
+        sumUpdateAs(st, static_cast<const uint8_t*>(data), count);
+        break;
+    case ElementType::U16:
+        sumUpdateAs(st, static_cast<const uint16_t*>(data), count);
+        break;
+    case ElementType::U64:
+        sumUpdateAs(st, static_cast<const uint64_t*>(data), count);
+        break;
+    case ElementType::I32:
+        sumUpdateAs(st, static_cast<const int32_t*>(data), count);
+        break;
+    case ElementType::U32:
+        sumUpdateAs(st, static_cast<const uint32_t*>(data), count);
+        break;
+    }
+}
+
+/**
+ * @brief Суммирует с ограничением элементы типа, заданного в заголовке вектора
+ * @param type Тип элементов
+ * @param data Элементы
+ * @param count Количество элементов
+ * @return Сумма в диапазоне [0, 2^31-1]
+ */
+int32_t VectorProcessor::sumClampTyped(ElementType type, const void* data, size_t count) {
+    SumState st;
+    sumInit(st);
+    sumUpdateTyped(st, type, data, count);
+    return sumFinish(st);
+}
+
+/**
+ * @brief Возвращает размер элемента
+ * @param type Тип элементов
+ * @return Размер в байтах (1, 2, 4 или 8)
+ */
+size_t VectorProcessor::elementSize(ElementType type) {
+    switch (type) {
+    case ElementType::U8:  return sizeof(uint8_t);
+    case ElementType::U16: return sizeof(uint16_t);
+    case ElementType::U64: return sizeof(uint64_t);
+    case ElementType::I32: return sizeof(int32_t);
+    case ElementType::U32: break;
+    }
+    return sizeof(uint32_t);
+}
+
+/**
+ * @brief Разбирает код типа элементов
+ * @param code Код из заголовка размера вектора
+ * @param type Тип элементов
+ * @return true для кодов 0..4
+ */
+bool VectorProcessor::parseElementType(uint32_t code, ElementType& type) {
+    if (code > static_cast<uint32_t>(ElementType::I32))
+        return false;
+    type = static_cast<ElementType>(code);
+    return true;
+}
+
+/**
+ * @brief Возвращает реестр операций свертки
+ * @details Операция описывается битом маски, размером результата,
+ *          нужными проходами ядер ReduceKernels и функцией записи
+ *          результата из общего состояния. Несколько операций одного
+ *          прохода (сумма, минимум, максимум, ненулевые, среднее) считаются
+ *          одним ядром статистики; новая операция добавляется строкой
+ *          реестра и, при необходимости, ядром нового прохода.
+ * @return Операции в порядке битов маски
+ */
+const std::vector<VectorProcessor::ReduceOpInfo>& VectorProcessor::operations() {
+    static const std::vector<ReduceOpInfo> registry = {
+        {ReduceOp::Sum,          "sum",       1, REDUCE_PASS_STATS,     finishSum},
+        {ReduceOp::Min,          "min",       1, REDUCE_PASS_STATS,     finishMin},
+        {ReduceOp::Max,          "max",       1, REDUCE_PASS_STATS,     finishMax},
+        {ReduceOp::CountNonzero, "nonzero",   1, REDUCE_PASS_STATS,     finishNonzero},
+        {ReduceOp::Mean,         "mean",      1, REDUCE_PASS_STATS,     finishMean},
+        {ReduceOp::Dot,          "dot",       1, REDUCE_PASS_DOT,       finishDot},
+        {ReduceOp::Histogram,    "histogram", ReduceKernels::HISTOGRAM_BINS,
+                                                 REDUCE_PASS_HISTOGRAM, finishHistogram},
+    };
+    return registry;
+}
+
+/**
+ * @brief Проверяет маску операций
+ * @param ops Маска операций ReduceOp
+ * @param count Количество элементов вектора
+ * @return true если маска непуста, содержит только операции реестра,
+ *         а для Dot количество элементов четное
+ */
+bool VectorProcessor::validOperations(uint32_t ops, size_t count) {
+    uint32_t known = 0;
+    for (const ReduceOpInfo& info : operations())
+        known |= static_cast<uint32_t>(info.op);
+    if (ops == 0 || (ops & ~known) != 0)
+        return false;
+    return !(ops & static_cast<uint32_t>(ReduceOp::Dot)) || count % 2 == 0;
+}
+
+/**
+ * @brief Считает размер результата свертки
+ * @param ops Маска операций
+ * @return Количество 64-битных значений
+ */
+size_t VectorProcessor::reduceValues(uint32_t ops) {
+    size_t values = 0;
+    for (const ReduceOpInfo& info : operations()) {
+        if (ops & static_cast<uint32_t>(info.op))
+            values += info.values;
+    }
+    return values;
+}
+
+/**
+ * @brief Сбрасывает состояние свертки и выбирает нужные проходы ядер
+ * @param st Состояние свертки
+ * @param type Тип элементов
+ * @param ops Маска операций
+ */
+void VectorProcessor::reduceInit(ReduceState& st, ElementType type, uint32_t ops) {
+    st = ReduceState();
+    st.type = type;
+    st.ops = ops;
+    for (const ReduceOpInfo& info : operations()) {
+        if (ops & static_cast<uint32_t>(info.op))
+            st.passes |= info.passes;
+    }
+}
+
+/**
+ * @brief Добавляет порцию элементов ко всем операциям свертки
+ * @details Порция обрабатывается блоками по SUM_BLOCK элементов. Элементы
+ *          приводятся к ключам uint32_t с сохранением порядка: uint32_t
+ *          используются как есть, uint8_t и uint16_t расширяются, int32_t
+ *          смещаются на 2^31; uint64_t в ключи не вмещаются и сворачиваются
+ *          reduceWide() по 64-битным значениям. Затем каждый нужный проход ядра ReduceKernels обрабатывает
+ *          блок, пока он в кэше L1: данные вектора читаются из памяти один
+ *          раз для всех запрошенных операций, а сумма, минимум, максимум,
+ *          ненулевые и среднее считаются одним ядром статистики (сумму
+ *          int32_t с ограничением на каждом элементе дополнительно считает
+ *          sumUpdateAs()). Короткие
+ *          порции (SumStrategy::Scalar) обрабатываются скалярными ядрами.
+ * @param st Состояние свертки
+ * @param data Элементы порции (выравнивание - как у sumUpdateTyped())
+ * @param count Количество элементов
+ */
+void VectorProcessor::reduceUpdate(ReduceState& st, const void* data, size_t count) {
+    if (st.type == ElementType::U64) {
+        reduceWide(st, static_cast<const unsigned char*>(data), count);
+        st.count += count;
+        return;
+    }
+    if (st.type == ElementType::I32 && (st.ops & static_cast<uint32_t>(ReduceOp::Sum)))
+        sumUpdateAs(st.clamped, static_cast<const int32_t*>(data), count);
+    ReduceKernels::Set kernels = strategy(count, false) == SumStrategy::Scalar
+                               ? ReduceKernels::kernels(SumKernels::Level::Scalar)
+                               : ReduceKernels::activeKernels();
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const size_t width = elementSize(st.type);
+    const uint32_t zero = zeroKey(st.type);
+    const unsigned shift = histogramShift(st.type);
+    alignas(64) uint32_t block[SUM_BLOCK];
+    
+    for (size_t i = 0; i < count; i += SUM_BLOCK) {
+        size_t n = std::min(SUM_BLOCK, count - i);
+        const uint32_t* keys = block;
+        if (st.type == ElementType::U32)
+            keys = reinterpret_cast<const uint32_t*>(bytes + i * width);
+        else
+            typedKeys(st.type, bytes + i * width, n, block);
+        
+        if (st.passes & REDUCE_PASS_STATS)
+            kernels.stats(keys, n, zero, st.stats);
+        if (st.passes & REDUCE_PASS_DOT)
+            reduceDot(st, kernels.dot, keys, n);
+        if (st.passes & REDUCE_PASS_HISTOGRAM)
+            kernels.histogram(keys, n, shift, st.bins);
+    }
+    st.count += count;
+}
+
+/**
+ * @brief Записывает результаты операций свертки
+ * @param st Состояние свертки
+ * @param values Значения операций подряд в порядке реестра
+ * @return Количество записанных значений (reduceValues(st.ops))
+ */
+size_t VectorProcessor::reduceFinish(const ReduceState& st, uint64_t* values) {
+    size_t n = 0;
+    for (const ReduceOpInfo& info : operations()) {
+        if (st.ops & static_cast<uint32_t>(info.op)) {
+            info.finish(st, values + n);
+            n += info.values;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Выполняет свертку целого вектора
+ * @param type Тип элементов
+ * @param ops Маска операций
+ * @param data Элементы
+ * @param count Количество элементов
+ * @param values Значения операций
+ * @return Количество записанных значений
+ */
+size_t VectorProcessor::reduce(ElementType type, uint32_t ops, const void* data, size_t count,
+                               uint64_t* values) {
+    ReduceState st;
+    reduceInit(st, type, ops);
+    reduceUpdate(st, data, count);
+    return reduceFinish(st, values);
+}
+
+/**
+ * @brief Эталонная скалярная версия sumUpdate()
+ * @details Исходный поэлементный цикл; используется тестами для сравнения
+ *          с векторными ядрами.
+ * @param st Состояние суммирования
+ * @param data Элементы порции
+ * @param count Количество элементов
+ */
+void VectorProcessor::sumUpdateScalar(SumState& st, const uint32_t* data, size_t count) {
+    if (st.saturated) return;
+    
+    int64_t acc = st.acc;  // Используем 64-бит для избежания переполнения
+    
+    for (size_t i = 0; i < count; ++i) {
+        acc += data[i];
         if (acc < 0) acc = 0;
-        if (acc > static_cast<int64_t>(std::numeric_limits<int32_t>::max()))
-            return std::numeric_limits<int32_t>::max();
+        if (acc > static_cast<int64_t>(std::numeric_limits<int32_t>::max())) {
+            st.saturated = true;
+            break;
+        }
     }
     
-    if (acc < 0) return 0;
-    if (acc > static_cast<int64_t>(std::numeric_limits<int32_t>::max()))
+    st.acc = acc;
+}
+
+/**
+ * @brief Возвращает итог потокового суммирования
+ * @param st Состояние суммирования
+ * @return Сумма, приведенная к int32_t с учетом ограничений
+ */
+int32_t VectorProcessor::sumFinish(const SumState& st) {
+    if (st.saturated) return std::numeric_limits<int32_t>::max();
+    if (st.acc < 0) return 0;
+    if (st.acc > static_cast<int64_t>(std::numeric_limits<int32_t>::max()))
         return std::numeric_limits<int32_t>::max();
     
-    return static_cast<int32_t>(acc);
-}
\ No newline at end of file
+    return static_cast<int32_t>(st.acc);
+}
+
+/**
+ * @brief Выбирает способ суммирования по размеру вектора
+ * @param count Количество элементов
+ * @param parallel Доступен ли пул параллельного суммирования
+ * @return Parallel от parallel_min (если пул доступен), Simd от simd_min,
+ *         иначе Scalar
+ */
+SumStrategy VectorProcessor::strategy(size_t count, bool parallel) {
+    if (parallel && count >= parallel_min.load(std::memory_order_relaxed))
+        return SumStrategy::Parallel;
+    if (count >= simd_min.load(std::memory_order_relaxed))
+        return SumStrategy::Simd;
+    return SumStrategy::Scalar;
+}
+
+/**
+ * @brief Устанавливает пороги выбора способа суммирования
+ * @param t Пороги
+ */
+void VectorProcessor::setThresholds(const SumThresholds& t) {
+    simd_min.store(t.simd_min, std::memory_order_relaxed);
+    parallel_min.store(t.parallel_min, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает текущие пороги
+ * @return Пороги
+ */
+SumThresholds VectorProcessor::thresholds() {
+    SumThresholds t;
+    t.simd_min = simd_min.load(std::memory_order_relaxed);
+    t.parallel_min = parallel_min.load(std::memory_order_relaxed);
+    return t;
+}
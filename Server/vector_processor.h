@@ -1,6 +1,52 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include "reduce_kernels.h"
+
+/**
+ * @brief Способ суммирования вектора
+ */
+enum class SumStrategy {
+    Scalar,  ///< Скалярное ядро (короткие векторы)
+    Simd,    ///< Векторное ядро SumKernels
+    Parallel ///< Векторное ядро на нескольких потоках (ParallelSum)
+};
+
+/**
+ * @brief Тип элементов вектора (код в старшем байте заголовка размера)
+ */
+enum class ElementType : uint8_t {
+    U32 = 0, ///< uint32_t (исходный протокол)
+    U8 = 1,  ///< uint8_t
+    U16 = 2, ///< uint16_t
+    U64 = 3, ///< uint64_t
+    I32 = 4  ///< int32_t
+};
+
+/**
+ * @brief Операция свертки вектора (бит маски операций вектора)
+ * @details Результат - 64-битные значения операций в порядке битов маски
+ *          (см. VectorProcessor::operations()).
+ */
+enum class ReduceOp : uint32_t {
+    Sum = 1u << 0,          ///< Сумма с ограничением [0, 2^31-1], как sumClamp() (int64_t)
+    Min = 1u << 1,          ///< Наименьший элемент (int64_t; для uint64_t - uint64_t)
+    Max = 1u << 2,          ///< Наибольший элемент (int64_t; для uint64_t - uint64_t)
+    CountNonzero = 1u << 3, ///< Количество ненулевых элементов (uint64_t)
+    Mean = 1u << 4,         ///< Среднее арифметическое (double)
+    Dot = 1u << 5,          ///< Скалярное произведение пар a0 b0 a1 b1 ... (double)
+    Histogram = 1u << 6     ///< 16 корзин по равным долям диапазона типа (uint64_t)
+};
+
+/**
+ * @struct SumThresholds
+ * @brief Пороги выбора способа суммирования по размеру вектора (элементов)
+ */
+struct SumThresholds {
+    size_t simd_min = 0;           ///< Векторное ядро для векторов от simd_min элементов
+    size_t parallel_min = 1 << 20; ///< Параллельное суммирование от parallel_min элементов
+};
 
 /**
  * @class VectorProcessor
@@ -8,6 +54,70 @@
  */
 class VectorProcessor {
 public:
+    /// Размер блока (элементов), после которого проверяется насыщение суммы
+    static constexpr size_t SUM_BLOCK = 4096;
+
+    /**
+     * @brief Состояние потокового суммирования (sumInit/sumUpdate/sumFinish)
+     */
+    struct SumState {
+        int64_t acc = 0;        ///< 64-битный аккумулятор
+        bool saturated = false; ///< Сумма достигла INT32_MAX, дальнейшие данные не влияют на результат
+    };
+
+    /// Наибольшее количество 64-битных значений результата свертки (все операции)
+    static constexpr size_t REDUCE_MAX_VALUES = 6 + ReduceKernels::HISTOGRAM_BINS;
+
+    /// Проход ядра статистики ReduceKernels (сумма, минимум, максимум, нули)
+    static constexpr unsigned REDUCE_PASS_STATS = 1;
+    /// Проход ядра скалярного произведения пар
+    static constexpr unsigned REDUCE_PASS_DOT = 2;
+    /// Проход ядра гистограммы
+    static constexpr unsigned REDUCE_PASS_HISTOGRAM = 4;
+
+    /**
+     * @brief Накопители свертки элементов uint64_t (без приведения к ключам)
+     * @details Сумма и скалярное произведение точные: произведение < 2^128
+     *          делится на младшие и старшие 64 бита, как в ReduceKernels::DotSums.
+     */
+    struct WideStats {
+        unsigned __int128 sum = 0;    ///< Сумма элементов
+        uint64_t min = UINT64_MAX;    ///< Наименьший элемент
+        uint64_t max = 0;             ///< Наибольший элемент
+        unsigned __int128 dot_lo = 0; ///< Сумма младших половин произведений пар
+        unsigned __int128 dot_hi = 0; ///< Сумма старших половин произведений пар
+        uint64_t pending = 0;         ///< Первый элемент неполной пары
+    };
+
+    /**
+     * @brief Состояние потоковой свертки (reduceInit/reduceUpdate/reduceFinish)
+     */
+    struct ReduceState {
+        ElementType type = ElementType::U32; ///< Тип элементов
+        uint32_t ops = 0;                    ///< Маска операций ReduceOp
+        unsigned passes = 0;                 ///< Нужные проходы ядер (REDUCE_PASS_*)
+        uint64_t count = 0;                  ///< Получено элементов
+        ReduceKernels::Stats stats;          ///< Сумма, минимум, максимум и нули ключей
+        ReduceKernels::DotSums dot;          ///< Скалярное произведение пар ключей
+        uint64_t bins[ReduceKernels::HISTOGRAM_BINS] = {}; ///< Корзины гистограммы
+        bool pending = false;                ///< Порция закончилась первым элементом пары
+        uint32_t pending_key = 0;            ///< Ключ этого элемента
+        WideStats wide;                      ///< Накопители для uint64_t (вместо stats и dot)
+        SumState clamped;                    ///< Сумма int32_t с ограничением на каждом элементе
+    };
+
+    /**
+     * @struct ReduceOpInfo
+     * @brief Описание операции в реестре operations()
+     */
+    struct ReduceOpInfo {
+        ReduceOp op;      ///< Бит маски операций
+        const char* name; ///< Название для логирования
+        size_t values;    ///< 64-битных значений в результате
+        unsigned passes;  ///< Нужные проходы ядер (REDUCE_PASS_*)
+        void (*finish)(const ReduceState& st, uint64_t* out); ///< Запись результата
+    };
+
     /**
      * @brief Суммирует элементы вектора с контролем переполнения
      * @details Использует 64-битный аккумулятор для избежания переполнения,
@@ -16,4 +126,176 @@ public:
      * @return Сумма элементов, приведенная к int32_t с учетом ограничений
      */
     static int32_t sumClamp(const std::vector<uint32_t>& v);
-};
\ No newline at end of file
+
+    /**
+     * @brief Суммирует элементы массива с контролем переполнения
+     * @param data Элементы
+     * @param count Количество элементов
+     * @return Сумма элементов, приведенная к int32_t с учетом ограничений
+     */
+    static int32_t sumClamp(const uint32_t* data, size_t count);
+
+    /**
+     * @brief Суммы с ограничением для многих коротких векторов за один вызов
+     * @param data Элементы всех векторов подряд
+     * @param offsets Границы векторов: вектор i - [offsets[i], offsets[i+1]),
+     *        segments + 1 значение, меньше 2^31
+     * @param segments Количество векторов
+     * @param results Результаты (segments значений, как у sumClamp())
+     */
+    static void sumClampSegments(const uint32_t* data, const uint32_t* offsets,
+                                 size_t segments, int32_t* results);
+
+    /**
+     * @brief Начало потокового суммирования
+     * @param st Состояние для сброса
+     */
+    static void sumInit(SumState& st);
+
+    /**
+     * @brief Добавление очередной порции элементов
+     * @param st Состояние суммирования
+     * @param data Элементы порции
+     * @param count Количество элементов
+     */
+    static void sumUpdate(SumState& st, const uint32_t* data, size_t count);
+
+    /**
+     * @brief Добавление порции элементов типа T (uint8_t, uint16_t, uint32_t, uint64_t, int32_t)
+     * @param st Состояние суммирования
+     * @param data Элементы порции
+     * @param count Количество элементов
+     */
+    template <typename T>
+    static void sumUpdateAs(SumState& st, const T* data, size_t count);
+
+    /**
+     * @brief Сумма с ограничением для элементов типа T
+     * @param data Элементы
+     * @param count Количество элементов
+     * @return Сумма в диапазоне [0, 2^31-1]
+     */
+    template <typename T>
+    static int32_t sumClampAs(const T* data, size_t count);
+
+    /**
+     * @brief Добавление порции элементов типа, известного во время выполнения
+     * @param st Состояние суммирования
+     * @param type Тип элементов
+     * @param data Элементы порции (выравнивание не требуется)
+     * @param count Количество элементов
+     */
+    static void sumUpdateTyped(SumState& st, ElementType type, const void* data, size_t count);
+
+    /**
+     * @brief Сумма с ограничением для элементов типа, известного во время выполнения
+     * @param type Тип элементов
+     * @param data Элементы
+     * @param count Количество элементов
+     * @return Сумма в диапазоне [0, 2^31-1]
+     */
+    static int32_t sumClampTyped(ElementType type, const void* data, size_t count);
+
+    /**
+     * @brief Размер элемента в байтах
+     * @param type Тип элементов
+     */
+    static size_t elementSize(ElementType type);
+
+    /**
+     * @brief Разбор кода типа элементов
+     * @param code Код из заголовка
+     * @param type Тип элементов
+     * @return false для неизвестного кода
+     */
+    static bool parseElementType(uint32_t code, ElementType& type);
+
+    /**
+     * @brief Реестр операций свертки в порядке битов маски
+     */
+    static const std::vector<ReduceOpInfo>& operations();
+
+    /**
+     * @brief Проверка маски операций для вектора
+     * @param ops Маска операций ReduceOp
+     * @param count Количество элементов (для Dot - четное)
+     * @return false для пустой маски, неизвестных битов или нечетного Dot
+     */
+    static bool validOperations(uint32_t ops, size_t count);
+
+    /**
+     * @brief Количество 64-битных значений результата
+     * @param ops Маска операций
+     */
+    static size_t reduceValues(uint32_t ops);
+
+    /**
+     * @brief Начало потоковой свертки
+     * @param st Состояние для сброса
+     * @param type Тип элементов
+     * @param ops Маска операций (validOperations())
+     */
+    static void reduceInit(ReduceState& st, ElementType type, uint32_t ops);
+
+    /**
+     * @brief Добавление порции элементов (один проход по данным для всех операций)
+     * @param st Состояние свертки
+     * @param data Элементы порции типа st.type
+     * @param count Количество элементов
+     */
+    static void reduceUpdate(ReduceState& st, const void* data, size_t count);
+
+    /**
+     * @brief Результаты операций свертки
+     * @param st Состояние свертки
+     * @param values Значения (не меньше reduceValues(st.ops))
+     * @return Количество записанных значений
+     */
+    static size_t reduceFinish(const ReduceState& st, uint64_t* values);
+
+    /**
+     * @brief Свертка целого вектора
+     * @param type Тип элементов
+     * @param ops Маска операций
+     * @param data Элементы
+     * @param count Количество элементов
+     * @param values Значения (не меньше reduceValues(ops))
+     * @return Количество записанных значений
+     */
+    static size_t reduce(ElementType type, uint32_t ops, const void* data, size_t count,
+                         uint64_t* values);
+
+    /**
+     * @brief Эталонная скалярная версия sumUpdate() (проверка на каждом элементе)
+     * @param st Состояние суммирования
+     * @param data Элементы порции
+     * @param count Количество элементов
+     */
+    static void sumUpdateScalar(SumState& st, const uint32_t* data, size_t count);
+
+    /**
+     * @brief Результат потокового суммирования (как у sumClamp())
+     * @param st Состояние суммирования
+     * @return Сумма в диапазоне [0, 2^31-1]
+     */
+    static int32_t sumFinish(const SumState& st);
+
+    /**
+     * @brief Выбор способа суммирования по размеру
+     * @param count Количество элементов
+     * @param parallel Доступен ли пул параллельного суммирования
+     * @return Способ суммирования согласно текущим порогам
+     */
+    static SumStrategy strategy(size_t count, bool parallel);
+
+    /**
+     * @brief Установка порогов (обычно результатов SumTuning при запуске)
+     * @param t Пороги
+     */
+    static void setThresholds(const SumThresholds& t);
+
+    /**
+     * @brief Текущие пороги
+     */
+    static SumThresholds thresholds();
+};